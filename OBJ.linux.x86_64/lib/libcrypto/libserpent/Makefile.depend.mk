@@ -0,0 +1,2 @@
+-include $(builddir)/serpent.d # serpent.o
+-include $(builddir)/serpent_cbc.d # serpent_cbc.o
@@ -0,0 +1,2 @@
+-include $(builddir)/twofish.d # twofish.o
+-include $(builddir)/twofish_cbc.d # twofish_cbc.o
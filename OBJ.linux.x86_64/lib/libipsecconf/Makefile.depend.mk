@@ -0,0 +1,9 @@
+-include $(builddir)/confread.d # confread.o
+-include $(builddir)/confwrite.d # confwrite.o
+-include $(builddir)/starterwhack.d # starterwhack.o
+-include $(builddir)/starterlog.d # starterlog.o
+-include $(builddir)/parser.tab.d # parser.tab.o
+-include $(builddir)/lex.yy.d # lex.yy.o
+-include $(builddir)/keywords.d # keywords.o
+-include $(builddir)/interfaces.d # interfaces.o
+-include $(builddir)/addr_lookup.d # addr_lookup.o
@@ -0,0 +1,2 @@
+-include $(builddir)/lswlog.d # lswlog.o
+-include $(builddir)/libreswan_exit.d # libreswan_exit.o
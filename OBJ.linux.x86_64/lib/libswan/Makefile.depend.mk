@@ -0,0 +1,106 @@
+-include $(builddir)/x509dn.d # x509dn.o
+-include $(builddir)/asn1.d # asn1.o
+-include $(builddir)/oid.d # oid.o
+-include $(builddir)/addrtoa.d # addrtoa.o
+-include $(builddir)/addrtot.d # addrtot.o
+-include $(builddir)/addrtypeof.d # addrtypeof.o
+-include $(builddir)/anyaddr.d # anyaddr.o
+-include $(builddir)/constants.d # constants.o
+-include $(builddir)/datatot.d # datatot.o
+-include $(builddir)/alloc.d # alloc.o
+-include $(builddir)/diag.d # diag.o
+-include $(builddir)/goodmask.d # goodmask.o
+-include $(builddir)/id.d # id.o
+-include $(builddir)/initaddr.d # initaddr.o
+-include $(builddir)/initsaid.d # initsaid.o
+-include $(builddir)/initsubnet.d # initsubnet.o
+-include $(builddir)/iprange.d # iprange.o
+-include $(builddir)/keyblobtoid.d # keyblobtoid.o
+-include $(builddir)/kernel_alg.d # kernel_alg.o
+-include $(builddir)/lex.d # lex.o
+-include $(builddir)/lswconf.d # lswconf.o
+-include $(builddir)/lswfips.d # lswfips.o
+-include $(builddir)/rangetosubnet.d # rangetosubnet.o
+-include $(builddir)/sameaddr.d # sameaddr.o
+-include $(builddir)/satot.d # satot.o
+-include $(builddir)/secrets.d # secrets.o
+-include $(builddir)/subnetof.d # subnetof.o
+-include $(builddir)/subnettoa.d # subnettoa.o
+-include $(builddir)/subnettot.d # subnettot.o
+-include $(builddir)/subnettypeof.d # subnettypeof.o
+-include $(builddir)/ttoaddr.d # ttoaddr.o
+-include $(builddir)/ttodata.d # ttodata.o
+-include $(builddir)/ttoprotoport.d # ttoprotoport.o
+-include $(builddir)/ttorange.d # ttorange.o
+-include $(builddir)/ttosa.d # ttosa.o
+-include $(builddir)/ttosubnet.d # ttosubnet.o
+-include $(builddir)/ttoul.d # ttoul.o
+-include $(builddir)/ultot.d # ultot.o
+-include $(builddir)/secitem_chunk.d # secitem_chunk.o
+-include $(builddir)/base64_rsa_pubkey.d # base64_rsa_pubkey.o
+-include $(builddir)/lswnss.d # lswnss.o
+-include $(builddir)/lsw_passert_fail.d # lsw_passert_fail.o
+-include $(builddir)/libreswan_log.d # libreswan_log.o
+-include $(builddir)/libreswan_loglog.d # libreswan_loglog.o
+-include $(builddir)/alg_byname.d # alg_byname.o
+-include $(builddir)/alg_info.d # alg_info.o
+-include $(builddir)/esp_info.d # esp_info.o
+-include $(builddir)/ike_info.d # ike_info.o
+-include $(builddir)/ah_info.d # ah_info.o
+-include $(builddir)/chunk.d # chunk.o
+-include $(builddir)/ip_address.d # ip_address.o
+-include $(builddir)/lmod.d # lmod.o
+-include $(builddir)/deltatime.d # deltatime.o
+-include $(builddir)/realtime.d # realtime.o
+-include $(builddir)/monotime.d # monotime.o
+-include $(builddir)/debug.d # debug.o
+-include $(builddir)/impair.d # impair.o
+-include $(builddir)/libreswan_DBG_dump.d # libreswan_DBG_dump.o
+-include $(builddir)/libreswan_DBG_log.d # libreswan_DBG_log.o
+-include $(builddir)/libreswan_exit_log_errno.d # libreswan_exit_log_errno.o
+-include $(builddir)/libreswan_log_errno.d # libreswan_log_errno.o
+-include $(builddir)/libreswan_pexpect_log.d # libreswan_pexpect_log.o
+-include $(builddir)/libreswan_bad_case.d # libreswan_bad_case.o
+-include $(builddir)/rate_log.d # rate_log.o
+-include $(builddir)/lswlog.d # lswlog.o
+-include $(builddir)/lswlog_dbg.d # lswlog_dbg.o
+-include $(builddir)/lswlog_nss_error.d # lswlog_nss_error.o
+-include $(builddir)/lswlog_nss_ckm.d # lswlog_nss_ckm.o
+-include $(builddir)/lswlog_nss_ckf.d # lswlog_nss_ckf.o
+-include $(builddir)/lswlog_nss_cka.d # lswlog_nss_cka.o
+-include $(builddir)/lswlog_source_line.d # lswlog_source_line.o
+-include $(builddir)/lswlog_sanitized.d # lswlog_sanitized.o
+-include $(builddir)/lswlog_errno.d # lswlog_errno.o
+-include $(builddir)/lswlog_bytes.d # lswlog_bytes.o
+-include $(builddir)/lswlog_enum_lset_short.d # lswlog_enum_lset_short.o
+-include $(builddir)/lswlog_realtime.d # lswlog_realtime.o
+-include $(builddir)/lswlog_deltatime.d # lswlog_deltatime.o
+-include $(builddir)/lswlog_monotime.d # lswlog_monotime.o
+-include $(builddir)/lswlog_ip.d # lswlog_ip.o
+-include $(builddir)/lswlog_sensitive_ip.d # lswlog_sensitive_ip.o
+-include $(builddir)/lswlog_to_file_stream.d # lswlog_to_file_stream.o
+-include $(builddir)/lswlog_pexpect.d # lswlog_pexpect.o
+-include $(builddir)/lswlog_passert.d # lswlog_passert.o
+-include $(builddir)/ike_alg_desc.d # ike_alg_desc.o
+-include $(builddir)/ike_alg_3des.d # ike_alg_3des.o
+-include $(builddir)/ike_alg_aes.d # ike_alg_aes.o
+-include $(builddir)/ike_alg_camellia.d # ike_alg_camellia.o
+-include $(builddir)/ike_alg_cast.d # ike_alg_cast.o
+-include $(builddir)/ike_alg_dh.d # ike_alg_dh.o
+-include $(builddir)/ike_alg_md5.d # ike_alg_md5.o
+-include $(builddir)/ike_alg_null.d # ike_alg_null.o
+-include $(builddir)/ike_alg_serpent.d # ike_alg_serpent.o
+-include $(builddir)/ike_alg_sha1.d # ike_alg_sha1.o
+-include $(builddir)/ike_alg_sha2.d # ike_alg_sha2.o
+-include $(builddir)/ike_alg_twofish.d # ike_alg_twofish.o
+-include $(builddir)/nss_copies.d # nss_copies.o
+-include $(builddir)/unbound.d # unbound.o
+-include $(builddir)/sanitizestring.d # sanitizestring.o
+-include $(builddir)/pfkey_print.d # pfkey_print.o
+-include $(builddir)/pfkey_sock.d # pfkey_sock.o
+-include $(builddir)/pfkey_error.d # pfkey_error.o
+-include $(builddir)/pfkey_v2_build.d # pfkey_v2_build.o
+-include $(builddir)/pfkey_v2_ext_bits.d # pfkey_v2_ext_bits.o
+-include $(builddir)/pfkey_v2_parse.d # pfkey_v2_parse.o
+-include $(builddir)/pfkey_v2_debug.d # pfkey_v2_debug.o
+-include $(builddir)/version.d # /root/repo/OBJ.linux.x86_64/lib/libswan/version.o
@@ -0,0 +1,3 @@
+-include $(builddir)/whacklib.d # whacklib.o
+-include $(builddir)/aliascomp.d # aliascomp.o
+-include $(builddir)/whackbatch.d # whackbatch.o
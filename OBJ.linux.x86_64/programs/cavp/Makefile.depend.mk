@@ -0,0 +1,28 @@
+-include $(builddir)/cavp.d # cavp.o
+-include $(builddir)/cavp_print.d # cavp_print.o
+-include $(builddir)/cavp_ikev1.d # cavp_ikev1.o
+-include $(builddir)/cavp_ikev2.d # cavp_ikev2.o
+-include $(builddir)/cavp_sha.d # cavp_sha.o
+-include $(builddir)/cavp_hmac.d # cavp_hmac.o
+-include $(builddir)/cavp_gcm.d # cavp_gcm.o
+-include $(builddir)/ike_alg.d # /root/repo/OBJ.linux.x86_64/programs/pluto/ike_alg.o
+-include $(builddir)/ike_alg_hmac_prf_ops.d # /root/repo/OBJ.linux.x86_64/programs/pluto/ike_alg_hmac_prf_ops.o
+-include $(builddir)/ike_alg_nss_cbc.d # /root/repo/OBJ.linux.x86_64/programs/pluto/ike_alg_nss_cbc.o
+-include $(builddir)/ike_alg_nss_ecp.d # /root/repo/OBJ.linux.x86_64/programs/pluto/ike_alg_nss_ecp.o
+-include $(builddir)/ike_alg_nss_gcm.d # /root/repo/OBJ.linux.x86_64/programs/pluto/ike_alg_nss_gcm.o
+-include $(builddir)/ike_alg_nss_hash_ops.d # /root/repo/OBJ.linux.x86_64/programs/pluto/ike_alg_nss_hash_ops.o
+-include $(builddir)/ike_alg_nss_modp.d # /root/repo/OBJ.linux.x86_64/programs/pluto/ike_alg_nss_modp.o
+-include $(builddir)/ike_alg_nss_prf_ops.d # /root/repo/OBJ.linux.x86_64/programs/pluto/ike_alg_nss_prf_ops.o
+-include $(builddir)/crypt_symkey.d # /root/repo/OBJ.linux.x86_64/programs/pluto/crypt_symkey.o
+-include $(builddir)/crypt_hash.d # /root/repo/OBJ.linux.x86_64/programs/pluto/crypt_hash.o
+-include $(builddir)/test_buffer.d # /root/repo/OBJ.linux.x86_64/programs/pluto/test_buffer.o
+-include $(builddir)/ikev1_prf.d # /root/repo/OBJ.linux.x86_64/programs/pluto/ikev1_prf.o
+-include $(builddir)/ikev2_prf.d # /root/repo/OBJ.linux.x86_64/programs/pluto/ikev2_prf.o
+-include $(builddir)/crypt_prf.d # /root/repo/OBJ.linux.x86_64/programs/pluto/crypt_prf.o
+-include $(builddir)/crypt_dh.d # /root/repo/OBJ.linux.x86_64/programs/pluto/crypt_dh.o
+-include $(builddir)/crypt_utils.d # /root/repo/OBJ.linux.x86_64/programs/pluto/crypt_utils.o
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/liblswtool/liblswtool.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libcrypto/libserpent/libserpent.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libcrypto/libtwofish/libtwofish.a ignored by Makefile.dep
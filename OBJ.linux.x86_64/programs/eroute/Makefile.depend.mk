@@ -0,0 +1,4 @@
+-include $(builddir)/eroute.d # eroute.o
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/liblswtool/liblswtool.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
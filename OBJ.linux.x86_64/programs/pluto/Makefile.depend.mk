@@ -0,0 +1,120 @@
+-include $(builddir)/send.d # send.o
+-include $(builddir)/ikev1_send.d # ikev1_send.o
+-include $(builddir)/ikev2_send.d # ikev2_send.o
+-include $(builddir)/state_db.d # state_db.o
+-include $(builddir)/connection_db.d # connection_db.o
+-include $(builddir)/host_pair_db.d # host_pair_db.o
+-include $(builddir)/spd_db.d # spd_db.o
+-include $(builddir)/show.d # show.o
+-include $(builddir)/retransmit.d # retransmit.o
+-include $(builddir)/kernel_pfkey.d # kernel_pfkey.o
+-include $(builddir)/kernel_netlink.d # kernel_netlink.o
+-include $(builddir)/kernel_klips.d # kernel_klips.o
+-include $(builddir)/x509.d # x509.o
+-include $(builddir)/fetch.d # fetch.o
+-include $(builddir)/dns_cache.d # dns_cache.o
+-include $(builddir)/reload.d # reload.o
+-include $(builddir)/metrics.d # metrics.o
+-include $(builddir)/ikev1_xauth.d # ikev1_xauth.o
+-include $(builddir)/addresspool.d # addresspool.o
+-include $(builddir)/pam_conv.d # pam_conv.o
+-include $(builddir)/xauth.d # xauth.o
+-include $(builddir)/ikev1_aggr.d # ikev1_aggr.o
+-include $(builddir)/security_selinux.d # security_selinux.o
+-include $(builddir)/pluto_sd.d # pluto_sd.o
+-include $(builddir)/ike_alg_nss_modp.d # ike_alg_nss_modp.o
+-include $(builddir)/ike_alg_nss_ecp.d # ike_alg_nss_ecp.o
+-include $(builddir)/ike_alg_nss_cbc.d # ike_alg_nss_cbc.o
+-include $(builddir)/ike_alg_nss_hash_ops.d # ike_alg_nss_hash_ops.o
+-include $(builddir)/ike_alg_hmac_prf_ops.d # ike_alg_hmac_prf_ops.o
+-include $(builddir)/ike_alg_nss_prf_ops.d # ike_alg_nss_prf_ops.o
+-include $(builddir)/ike_alg_nss_gcm.d # ike_alg_nss_gcm.o
+-include $(builddir)/ike_alg.d # ike_alg.o
+-include $(builddir)/db_ops.d # db_ops.o
+-include $(builddir)/sysdep_linux.d # sysdep_linux.o
+-include $(builddir)/udpfromto.d # udpfromto.o
+-include $(builddir)/connections.d # connections.o
+-include $(builddir)/initiate.d # initiate.o
+-include $(builddir)/terminate.d # terminate.o
+-include $(builddir)/cbc_test_vectors.d # cbc_test_vectors.o
+-include $(builddir)/ctr_test_vectors.d # ctr_test_vectors.o
+-include $(builddir)/gcm_test_vectors.d # gcm_test_vectors.o
+-include $(builddir)/test_buffer.d # test_buffer.o
+-include $(builddir)/pending.d # pending.o
+-include $(builddir)/cookie.d # cookie.o
+-include $(builddir)/crypto.d # crypto.o
+-include $(builddir)/defs.d # defs.o
+-include $(builddir)/foodgroups.d # foodgroups.o
+-include $(builddir)/log.d # log.o
+-include $(builddir)/state.d # state.o
+-include $(builddir)/plutomain.d # plutomain.o
+-include $(builddir)/plutoalg.d # plutoalg.o
+-include $(builddir)/server.d # server.o
+-include $(builddir)/peerlog.d # peerlog.o
+-include $(builddir)/hash_table.d # hash_table.o
+-include $(builddir)/list_entry.d # list_entry.o
+-include $(builddir)/timer.d # timer.o
+-include $(builddir)/timer_wheel.d # timer_wheel.o
+-include $(builddir)/rekey.d # rekey.o
+-include $(builddir)/hmac.d # hmac.o
+-include $(builddir)/hostpair.d # hostpair.o
+-include $(builddir)/myid.d # myid.o
+-include $(builddir)/ipsec_doi.d # ipsec_doi.o
+-include $(builddir)/ikev2_ipseckey.d # ikev2_ipseckey.o
+-include $(builddir)/ikev1.d # ikev1.o
+-include $(builddir)/ikev1_main.d # ikev1_main.o
+-include $(builddir)/ikev1_quick.d # ikev1_quick.o
+-include $(builddir)/ikev1_dpd.d # ikev1_dpd.o
+-include $(builddir)/ikev1_spdb_struct.d # ikev1_spdb_struct.o
+-include $(builddir)/ikev1_msgid.d # ikev1_msgid.o
+-include $(builddir)/ikev2.d # ikev2.o
+-include $(builddir)/ikev2_parent.d # ikev2_parent.o
+-include $(builddir)/ikev2_child.d # ikev2_child.o
+-include $(builddir)/ikev2_spdb_struct.d # ikev2_spdb_struct.o
+-include $(builddir)/ikev2_rsa.d # ikev2_rsa.o
+-include $(builddir)/ikev2_psk.d # ikev2_psk.o
+-include $(builddir)/ikev2_ppk.d # ikev2_ppk.o
+-include $(builddir)/ikev2_crypto.d # ikev2_crypto.o
+-include $(builddir)/crypt_symkey.d # crypt_symkey.o
+-include $(builddir)/crypt_prf.d # crypt_prf.o
+-include $(builddir)/ikev1_prf.d # ikev1_prf.o
+-include $(builddir)/ikev2_prf.d # ikev2_prf.o
+-include $(builddir)/crypt_hash.d # crypt_hash.o
+-include $(builddir)/kernel.d # kernel.o
+-include $(builddir)/updown.d # updown.o
+-include $(builddir)/kernel_nokernel.d # kernel_nokernel.o
+-include $(builddir)/rcv_whack.d # rcv_whack.o
+-include $(builddir)/pluto_stats.d # pluto_stats.o
+-include $(builddir)/demux.d # demux.o
+-include $(builddir)/msgdigest.d # msgdigest.o
+-include $(builddir)/keys.d # keys.o
+-include $(builddir)/pluto_crypt.d # pluto_crypt.o
+-include $(builddir)/helper_queue.d # helper_queue.o
+-include $(builddir)/crypt_utils.d # crypt_utils.o
+-include $(builddir)/crypt_ke.d # crypt_ke.o
+-include $(builddir)/crypt_dh.d # crypt_dh.o
+-include $(builddir)/crypt_dh_pool.d # crypt_dh_pool.o
+-include $(builddir)/crypt_dh_v1.d # crypt_dh_v1.o
+-include $(builddir)/crypt_dh_v2.d # crypt_dh_v2.o
+-include $(builddir)/crypt_rsa.d # crypt_rsa.o
+-include $(builddir)/rnd.d # rnd.o
+-include $(builddir)/spdb.d # spdb.o
+-include $(builddir)/spdb_struct.d # spdb_struct.o
+-include $(builddir)/vendor.d # vendor.o
+-include $(builddir)/nat_traversal.d # nat_traversal.o
+-include $(builddir)/virtual.d # virtual.o
+-include $(builddir)/packet.d # packet.o
+-include $(builddir)/pluto_constants.d # pluto_constants.o
+-include $(builddir)/readwhackmsg.d # readwhackmsg.o
+-include $(builddir)/nss_cert_load.d # nss_cert_load.o
+-include $(builddir)/pem.d # pem.o
+-include $(builddir)/nss_cert_verify.d # nss_cert_verify.o
+-include $(builddir)/nss_ocsp.d # nss_ocsp.o
+-include $(builddir)/nss_crl_import.d # nss_crl_import.o
+-include $(builddir)/nss_err.d # nss_err.o
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libwhack/libwhack.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libipsecconf/libipsecconf.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libcrypto/libserpent/libserpent.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libcrypto/libtwofish/libtwofish.a ignored by Makefile.dep
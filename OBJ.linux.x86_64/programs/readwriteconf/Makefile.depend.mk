@@ -0,0 +1,6 @@
+-include $(builddir)/readwriteconf.d # readwriteconf.o
+# /root/repo/OBJ.linux.x86_64/lib/libipsecconf/libipsecconf.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libwhack/libwhack.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/liblswtool/liblswtool.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
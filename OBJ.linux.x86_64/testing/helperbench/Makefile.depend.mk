@@ -0,0 +1,6 @@
+-include $(builddir)/helperbench.d # helperbench.o
+-include $(builddir)/helper_queue.d # /root/repo/OBJ.linux.x86_64/programs/pluto/helper_queue.o
+-include $(builddir)/list_entry.d # /root/repo/OBJ.linux.x86_64/programs/pluto/list_entry.o
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/liblswtool/liblswtool.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
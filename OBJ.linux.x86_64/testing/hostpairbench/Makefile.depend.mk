@@ -0,0 +1,7 @@
+-include $(builddir)/hostpairbench.d # hostpairbench.o
+-include $(builddir)/host_pair_db.d # /root/repo/OBJ.linux.x86_64/programs/pluto/host_pair_db.o
+-include $(builddir)/hash_table.d # /root/repo/OBJ.linux.x86_64/programs/pluto/hash_table.o
+-include $(builddir)/list_entry.d # /root/repo/OBJ.linux.x86_64/programs/pluto/list_entry.o
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/liblswtool/liblswtool.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
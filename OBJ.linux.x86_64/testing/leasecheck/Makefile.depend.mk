@@ -0,0 +1,7 @@
+-include $(builddir)/leasecheck.d # leasecheck.o
+-include $(builddir)/addresspool.d # /root/repo/OBJ.linux.x86_64/programs/pluto/addresspool.o
+-include $(builddir)/hash_table.d # /root/repo/OBJ.linux.x86_64/programs/pluto/hash_table.o
+-include $(builddir)/list_entry.d # /root/repo/OBJ.linux.x86_64/programs/pluto/list_entry.o
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/liblswtool/liblswtool.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
@@ -0,0 +1,5 @@
+-include $(builddir)/rekeycheck.d # rekeycheck.o
+-include $(builddir)/rekey.d # /root/repo/OBJ.linux.x86_64/programs/pluto/rekey.o
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/liblswtool/liblswtool.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
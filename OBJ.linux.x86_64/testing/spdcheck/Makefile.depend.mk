@@ -0,0 +1,6 @@
+-include $(builddir)/spdcheck.d # spdcheck.o
+-include $(builddir)/spd_db.d # /root/repo/OBJ.linux.x86_64/programs/pluto/spd_db.o
+-include $(builddir)/list_entry.d # /root/repo/OBJ.linux.x86_64/programs/pluto/list_entry.o
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/liblswtool/liblswtool.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
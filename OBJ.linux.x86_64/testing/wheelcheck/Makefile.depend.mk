@@ -0,0 +1,5 @@
+-include $(builddir)/wheelcheck.d # wheelcheck.o
+-include $(builddir)/timer_wheel.d # /root/repo/OBJ.linux.x86_64/programs/pluto/timer_wheel.o
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/liblswtool/liblswtool.a ignored by Makefile.dep
+# /root/repo/OBJ.linux.x86_64/lib/libswan/libswan.a ignored by Makefile.dep
@@ -47,6 +47,8 @@ enum keyword_string_config_field {
 	KSF_SYSLOG,
 	KSF_DUMPDIR,
 	KSF_STATSBINARY,
+	KSF_UPDOWN_COPROCESS,
+	KSF_METRICS_SOCKET,
 	KSF_IPSECDIR,
 	KSF_NSSDIR,
 	KSF_SECRETSFILE,
@@ -105,6 +107,13 @@ enum keyword_numeric_config_field {
 	KBF_KLIPSDEBUG,
 	KBF_PLUTODEBUG,
 	KBF_NHELPERS,
+	KBF_DH_POOL_SIZE,
+	KBF_DH_REUSE_SECONDS,
+	KBF_DH_REUSE_LIMIT,
+	KBF_UPDOWN_WORKERS,
+	KBF_SA_COUNTER_REFRESH,
+	KBF_REKEY_RATE,
+	KBF_PAM_WORKERS,
 	KBF_DPDDELAY,
 	KBF_DPDTIMEOUT,
 	KBF_METRIC,
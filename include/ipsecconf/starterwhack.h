@@ -27,5 +27,25 @@ int starter_whack_initiate_conn(struct starter_config *cfg,
 				struct starter_conn *conn);
 extern int starter_whack_listen(struct starter_config *cfg);
 
+/*
+ * Send the messages of the calls in between down one connection,
+ * without waiting for each reply (those calls return 0 once the
+ * message is sent).  End returns the status of the last message that
+ * failed, if any.  If begin fails, messages are sent one at a time.
+ */
+extern int starter_whack_batch_begin(struct starter_config *cfg);
+extern int starter_whack_batch_end(struct starter_config *cfg);
+
+/*
+ * Reload ipsec.conf: connections added after begin only replace what
+ * pluto has if they changed, and routes and initiates are ignored
+ * for connections the reload left alone; end deletes the ipsec.conf
+ * connections that weren't added, or kept.
+ */
+extern int starter_whack_reload_begin(struct starter_config *cfg);
+extern int starter_whack_keep_conn(struct starter_config *cfg,
+				const struct starter_conn *conn);
+extern int starter_whack_reload_end(struct starter_config *cfg);
+
 #endif /* _STARTER_WHACK_H_ */
 
@@ -108,6 +108,9 @@ enum rc_type {
 	RC_ENTERSECRET = 40,
 	RC_USERPROMPT = 41,
 
+	/* end of the output for one message of a whack batch */
+	RC_WHACK_BATCH_ACK = 50,
+
 	/* progress: start of range for successful state transition.
 	 * Actual value is RC_NEW_STATE plus the new state code.
 	 */
@@ -57,6 +57,8 @@ monotime_t mononow(void);
 monotime_t monotimesum(monotime_t t, deltatime_t d);
 bool monobefore(monotime_t a, monotime_t b);
 deltatime_t monotimediff(monotime_t a, monotime_t b);
+/* microseconds from START to END; 0 if END isn't after START */
+uintmax_t monotime_elapsed_us(monotime_t start, monotime_t end);
 intmax_t monosecs(monotime_t m);
 
 /* output as "smart" seconds */
@@ -57,7 +57,7 @@
  */
 
 #define WHACK_BASIC_MAGIC (((((('w' << 8) + 'h') << 8) + 'k') << 8) + 25)
-#define WHACK_MAGIC (((((('o' << 8) + 'h') << 8) + 'k') << 8) + 45)
+#define WHACK_MAGIC (((((('o' << 8) + 'h') << 8) + 'k') << 8) + 48)
 
 /*
  * Where, if any, is the pubkey coming from.
@@ -125,11 +125,36 @@ enum whack_opt_set {
 	WHACK_STOPWHACKRECORD=3,	/* turn off recording to file */
 };
 
+/*
+ * How addconn is loading a connection from ipsec.conf.
+ *
+ * For a reload, addconn sends RELOAD_START, every connection (and
+ * then its route or initiate) as RELOAD, and then RELOAD_END.
+ * Pluto adds new connections, replaces only those that changed, and
+ * then deletes the ipsec.conf connections that weren't sent; a
+ * RELOAD route or initiate is ignored unless the reload added or
+ * replaced the connection.
+ *
+ * An auto=ignore connection is only loaded by hand, so the reload
+ * sends just its name, as RELOAD_KEEP: if loaded, it is left alone.
+ */
+enum whack_config {
+	WHACK_CONFIG_NONE = 0,		/* not from ipsec.conf */
+	WHACK_CONFIG_ADD,
+	WHACK_CONFIG_RELOAD_START,
+	WHACK_CONFIG_RELOAD,
+	WHACK_CONFIG_RELOAD_END,
+	WHACK_CONFIG_RELOAD_KEEP,
+};
+
+#define WHACK_CONFIG_DIGEST_SIZE 32	/* SHA-256 */
+
 struct whack_message {
 	unsigned int magic;
 
 	bool whack_status;
 	bool whack_global_status;
+	bool whack_metrics;
 	bool whack_clear_stats;
 	bool whack_traffic_status;
 	bool whack_shunt_status;
@@ -367,6 +392,12 @@ struct whack_message {
 	 * 28 remote_host
 	 * plus keyval (limit: 8K bits + overhead), a chunk.
 	 */
+	/* for connections from ipsec.conf */
+	unsigned config_auto;	/* auto= (enum keyword_auto); only digested */
+	enum whack_config whack_config;
+	/* set by pluto: a digest of the rest of the packed message */
+	unsigned char config_digest[WHACK_CONFIG_DIGEST_SIZE];
+
 	size_t str_size;
 	unsigned char string[4096];
 };
@@ -410,4 +441,42 @@ extern int whack_get_value(char *buf, size_t bufsize);
 extern bool lsw_alias_cmp(const char *needle, const char *haystack);
 extern void whack_process(int whackfd, const struct whack_message *const m);
 
+/*
+ * A whack batch sends many messages down a single connection to
+ * pluto: WHACK_BATCH_MAGIC and then, for each message, its packed
+ * length (a uint32_t) followed by the packed message.
+ *
+ * Pluto handles the messages in order, following the output of each
+ * with an RC_WHACK_BATCH_ACK line (the text is the message's number
+ * within the batch, counting from 1).  Messages are sent without
+ * waiting for the acks, up to WHACK_BATCH_WINDOW ahead.
+ *
+ * Since there's no way to answer a prompt, pluto rejects --initiate
+ * in a batch.
+ */
+
+#define WHACK_BATCH_MAGIC (((((('b' << 8) + 'h') << 8) + 'k') << 8) + 1)
+#define WHACK_BATCH_WINDOW 64
+
+struct whack_batch {
+	int sock;
+	unsigned long sent;
+	unsigned long acked;
+	unsigned long failed;	/* acked with a bad status */
+	int last_failure;	/* status of the most recent failure */
+	int status;		/* of the message being acked */
+	/* if non-NULL, passed each line of output, including the NL */
+	void (*reply)(const char *line, size_t len, void *arg);
+	void *reply_arg;
+	size_t len;		/* of the partial line in buf */
+	char buf[4097];		/* arbitrary limit on log line length */
+};
+
+/* on failure, these return a diagnostic (NOT RE-ENTRANT) */
+extern err_t whack_batch_open(struct whack_batch *b, const char *ctlsocket);
+extern err_t whack_batch_send(struct whack_batch *b,
+			      struct whack_message *msg);
+/* wait for the remaining acks, then close; call even after a failure */
+extern err_t whack_batch_close(struct whack_batch *b);
+
 #endif /* _WHACK_H */
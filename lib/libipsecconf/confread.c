@@ -90,6 +90,13 @@ void ipsecconf_default_values(struct starter_config *cfg)
 	cfg->setup.options[KBF_NFLOG_ALL] = 0; /* disabled per default */
 	cfg->setup.options[KBF_XFRMLIFETIME] = 300; /* not used by pluto itself */
 	cfg->setup.options[KBF_NHELPERS] = -1; /* see also plutomain.c */
+	cfg->setup.options[KBF_DH_POOL_SIZE] = 4; /* see also crypt_dh_pool.c */
+	cfg->setup.options[KBF_DH_REUSE_SECONDS] = 0; /* disabled per default */
+	cfg->setup.options[KBF_DH_REUSE_LIMIT] = 0; /* no limit */
+	cfg->setup.options[KBF_UPDOWN_WORKERS] = 0; /* wait for each updown */
+	cfg->setup.options[KBF_SA_COUNTER_REFRESH] = 0; /* query each SA */
+	cfg->setup.options[KBF_REKEY_RATE] = 0; /* no limit */
+	cfg->setup.options[KBF_PAM_WORKERS] = 0; /* fork for each request */
 
 	cfg->setup.options[KBF_KEEPALIVE] = 0;                  /* config setup */
 	cfg->setup.options[KBF_NATIKEPORT] = NAT_IKE_UDP_PORT;
@@ -713,7 +720,7 @@ static bool validate_end(struct starter_conn *conn_st,
 			    "connection's %saddresspool set to: %s",
 			    leftright, end->strings[KSCF_ADDRESSPOOL] );
 
-		er = ttorange(addresspool, 0, AF_INET, &end->pool_range, TRUE);
+		er = ttorange(addresspool, 0, AF_UNSPEC, &end->pool_range, TRUE);
 		if (er != NULL)
 			ERR_FOUND("bad %saddresspool=%s [%s]", leftright,
 					addresspool, er);
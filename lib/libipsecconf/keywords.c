@@ -451,6 +451,15 @@ const struct keyword_def ipsec_conf_keywords[] = {
   { "listen",  kv_config,  kt_string,  KSF_LISTEN, NULL, NULL, },
   { "protostack",  kv_config,  kt_string,  KSF_PROTOSTACK,  &kw_proto_stack, NULL, },
   { "nhelpers",  kv_config,  kt_number,  KBF_NHELPERS, NULL, NULL, },
+  { "dh-pool-size",  kv_config,  kt_number,  KBF_DH_POOL_SIZE, NULL, NULL, },
+  { "dh-reuse-seconds",  kv_config,  kt_number,  KBF_DH_REUSE_SECONDS, NULL, NULL, },
+  { "dh-reuse-limit",  kv_config,  kt_number,  KBF_DH_REUSE_LIMIT, NULL, NULL, },
+  { "updown-workers",  kv_config,  kt_number,  KBF_UPDOWN_WORKERS, NULL, NULL, },
+  { "updown-coprocess",  kv_config,  kt_filename,  KSF_UPDOWN_COPROCESS, NULL, NULL, },
+  { "sa-counter-refresh",  kv_config,  kt_number,  KBF_SA_COUNTER_REFRESH, NULL, NULL, },
+  { "rekey-rate",  kv_config,  kt_number,  KBF_REKEY_RATE, NULL, NULL, },
+  { "pam-workers",  kv_config,  kt_number,  KBF_PAM_WORKERS, NULL, NULL, },
+  { "metrics-socket",  kv_config,  kt_string,  KSF_METRICS_SOCKET, NULL, NULL, },
   { "drop-oppo-null",  kv_config,  kt_bool,  KBF_DROP_OPPO_NULL, NULL, NULL, },
 #ifdef HAVE_LABELED_IPSEC
   /* ??? AN ATTRIBUTE TYPE, NOT VALUE! */
@@ -218,6 +218,62 @@ static int starter_whack_read_reply(int sock,
 	return ret;
 }
 
+/*
+ * While a batch is open, messages are pipelined down its connection
+ * and the status of each is only known when the batch is ended.
+ */
+static bool batching = FALSE;
+static struct whack_batch batch;
+
+static void batch_reply(const char *line, size_t len, void *arg UNUSED)
+{
+	if (isatty(STDOUT_FILENO) &&
+		write(STDOUT_FILENO, line, len) == -1) {
+		int e = errno;
+		starter_log(LOG_LEVEL_ERR,
+			"whack: write() failed (%d %s), and ignored.",
+			e, strerror(e));
+	}
+}
+
+int starter_whack_batch_begin(struct starter_config *cfg)
+{
+	err_t ugh;
+
+	passert(!batching);
+	batch.reply = batch_reply;
+	batch.reply_arg = NULL;
+	ugh = whack_batch_open(&batch, cfg->ctlsocket);
+	if (ugh != NULL) {
+		starter_log(LOG_LEVEL_ERR, "whack batch: %s", ugh);
+		whack_batch_close(&batch);
+		return -1;
+	}
+	batching = TRUE;
+	return 0;
+}
+
+int starter_whack_batch_end(struct starter_config *cfg UNUSED)
+{
+	err_t ugh;
+
+	if (!batching)
+		return -1;
+	batching = FALSE;
+	ugh = whack_batch_close(&batch);
+	if (ugh != NULL) {
+		starter_log(LOG_LEVEL_ERR, "whack batch: %s", ugh);
+		return -1;
+	}
+	if (batch.failed > 0) {
+		starter_log(LOG_LEVEL_INFO,
+			"whack batch: %lu of %lu messages failed",
+			batch.failed, batch.sent);
+		return batch.last_failure;
+	}
+	return 0;
+}
+
 static int send_whack_msg(struct whack_message *msg, char *ctlsocket)
 {
 	struct sockaddr_un ctl_addr = { .sun_family = AF_UNIX };
@@ -227,6 +283,16 @@ static int send_whack_msg(struct whack_message *msg, char *ctlsocket)
 	err_t ugh;
 	int ret;
 
+	/* an initiate can prompt, so it always gets its own connection */
+	if (batching && !msg->whack_initiate) {
+		ugh = whack_batch_send(&batch, msg);
+		if (ugh != NULL) {
+			starter_log(LOG_LEVEL_ERR, "whack batch: %s", ugh);
+			return -1;
+		}
+		return 0;
+	}
+
 	/* copy socket location */
 	fill_and_terminate(ctl_addr.sun_path, ctlsocket, sizeof(ctl_addr.sun_path));
 
@@ -284,6 +350,9 @@ static int send_whack_msg(struct whack_message *msg, char *ctlsocket)
 	return ret;
 }
 
+/* changed to WHACK_CONFIG_RELOAD by starter_whack_reload_begin() */
+static enum whack_config whack_config = WHACK_CONFIG_ADD;
+
 static void init_whack_msg(struct whack_message *msg)
 {
 	/* properly initialzes pointers to NULL */
@@ -291,6 +360,7 @@ static void init_whack_msg(struct whack_message *msg)
 
 	*msg = zwm;
 	msg->magic = WHACK_MAGIC;
+	msg->whack_config = whack_config;
 }
 
 /* NOT RE-ENTRANT: uses a static buffer */
@@ -516,10 +586,40 @@ static int starter_whack_add_pubkey(struct starter_config *cfg,
 	return 0;
 }
 
+/*
+ * The rsasigkeys follow the connection as separate whack_key
+ * messages, out of sight of pluto's config_digest() of the connection
+ * message.  So that a reload notices when only a key changed, put a
+ * hash (FNV-1a) of them in the connection message's keyval, which is
+ * otherwise unused there.
+ */
+static void hash_rsakeys(const struct starter_conn *conn,
+			 unsigned char hash[8])
+{
+	const char *keys[] = {
+		conn->left.rsakey1, conn->left.rsakey2,
+		conn->right.rsakey1, conn->right.rsakey2,
+	};
+	uint64_t h = 14695981039346656037ULL;
+
+	for (unsigned i = 0; i < elemsof(keys); i++) {
+		const char *p = keys[i] == NULL ? "" : keys[i];
+
+		/* include the NUL, it separates the keys */
+		do {
+			h ^= (unsigned char)*p;
+			h *= 1099511628211ULL;
+		} while (*p++ != '\0');
+	}
+	for (unsigned i = 0; i < 8; i++)
+		hash[i] = h >> (8 * i);
+}
+
 static int starter_whack_basic_add_conn(struct starter_config *cfg,
 					const struct starter_conn *conn)
 {
 	struct whack_message msg;
+	unsigned char rsakeys_hash[8];
 	int r;
 
 	init_whack_msg(&msg);
@@ -527,6 +627,8 @@ static int starter_whack_basic_add_conn(struct starter_config *cfg,
 	msg.whack_connection = TRUE;
 	msg.whack_delete = TRUE;	/* always do replace for now */
 	msg.name = connection_name(conn);
+	/* so that a reload notices when only auto= changed */
+	msg.config_auto = conn->desired_state;
 
 	msg.addr_family = conn->left.addr_family;
 	msg.tunnel_addr_family = conn->left.addr_family;
@@ -707,6 +809,12 @@ static int starter_whack_basic_add_conn(struct starter_config *cfg,
 	msg.esp = conn->esp;
 	msg.ike = conn->ike;
 
+	if (conn->left.rsakey1 != NULL || conn->left.rsakey2 != NULL ||
+	    conn->right.rsakey1 != NULL || conn->right.rsakey2 != NULL) {
+		hash_rsakeys(conn, rsakeys_hash);
+		msg.keyval.ptr = rsakeys_hash;
+		msg.keyval.len = sizeof(rsakeys_hash);
+	}
 
 	r = send_whack_msg(&msg, cfg->ctlsocket);
 	if (r != 0)
@@ -947,3 +1055,34 @@ int starter_whack_listen(struct starter_config *cfg)
 	msg.whack_listen = TRUE;
 	return send_whack_msg(&msg, cfg->ctlsocket);
 }
+
+int starter_whack_reload_begin(struct starter_config *cfg)
+{
+	struct whack_message msg;
+
+	init_whack_msg(&msg);
+	msg.whack_config = WHACK_CONFIG_RELOAD_START;
+	whack_config = WHACK_CONFIG_RELOAD;
+	return send_whack_msg(&msg, cfg->ctlsocket);
+}
+
+/* an auto=ignore connection; any loaded by hand must survive the reload */
+int starter_whack_keep_conn(struct starter_config *cfg,
+			const struct starter_conn *conn)
+{
+	struct whack_message msg;
+
+	init_whack_msg(&msg);
+	msg.whack_config = WHACK_CONFIG_RELOAD_KEEP;
+	msg.name = connection_name(conn);
+	return send_whack_msg(&msg, cfg->ctlsocket);
+}
+
+int starter_whack_reload_end(struct starter_config *cfg)
+{
+	struct whack_message msg;
+
+	init_whack_msg(&msg);
+	msg.whack_config = WHACK_CONFIG_RELOAD_END;
+	return send_whack_msg(&msg, cfg->ctlsocket);
+}
@@ -122,3 +122,13 @@ deltatime_t monotimediff(monotime_t a, monotime_t b)
 	timersub(&a.mt, &b.mt, &d);
 	return deltatime_ms((intmax_t)d.tv_sec * 1000 + d.tv_usec / 1000);
 }
+
+uintmax_t monotime_elapsed_us(monotime_t start, monotime_t end)
+{
+	struct timeval d;
+
+	if (!timercmp(&start.mt, &end.mt, <))
+		return 0;
+	timersub(&end.mt, &start.mt, &d);
+	return (uintmax_t)d.tv_sec * 1000000 + d.tv_usec;
+}
@@ -24,9 +24,9 @@
 err_t ttorange(src, srclen, af, dst, non_zero)
 const char *src;
 size_t srclen;	/* 0 means "apply strlen" */
-int af;	/* AF_INET only.  AF_INET6 not supported yet. */
+int af;	/* AF_INET, AF_INET6, or AF_UNSPEC (use the first address) */
 ip_range *dst;
-bool non_zero;  /* is 0.0.0.0 allowed? */
+bool non_zero;  /* is 0.0.0.0 (or ::) allowed? */
 {
 	const char *dash;
 	const char *high;
@@ -37,8 +37,8 @@ bool non_zero;  /* is 0.0.0.0 allowed? */
 	ip_address addr_end_tmp;
 
 	/* this should be a passert */
-	if (af != AF_INET)
-		return "ttorange only supports IPv4 addresses";
+	if (af != AF_INET && af != AF_INET6 && af != AF_UNSPEC)
+		return "ttorange only supports IPv4 and IPv6 addresses";
 
 	if (srclen == 0)
 		srclen = strlen(src);
@@ -53,25 +53,21 @@ bool non_zero;  /* is 0.0.0.0 allowed? */
 	if (oops != NULL)
 		return oops;
 
-	/*
-	 * If we allowed af == AF_UNSPEC,
-	 * set it to addrtypeof(&addr_start_tmp)
-	 */
+	/* the end address must be the same family as the start */
+	af = addrtypeof(&addr_start_tmp);
 
 	/* extract end ip address */
 	oops = ttoaddr_num(high, hlen, af, &addr_end_tmp);
 	if (oops != NULL)
 		return oops;
 
-	if (ntohl(addr_end_tmp.u.v4.sin_addr.s_addr) <
-		ntohl(addr_start_tmp.u.v4.sin_addr.s_addr))
+	if (addrcmp(&addr_start_tmp, &addr_end_tmp) > 0)
 		return "start of range must not be greater than end";
 
-	if (non_zero) {
-		uint32_t addr  = ntohl(addr_start_tmp.u.v4.sin_addr.s_addr);
-
-		if (addr == 0)
-			return "'0.0.0.0' not allowed in range";
+	if (non_zero && isanyaddr(&addr_start_tmp)) {
+		return af == AF_INET ?
+			"'0.0.0.0' not allowed in range" :
+			"'::' not allowed in range";
 	}
 
 	/* We have validated the range. Now put bounds in dst. */
@@ -0,0 +1,220 @@
+/*
+ * send a batch of messages to pluto, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <libreswan.h>
+
+#include "constants.h"
+#include "lswlog.h"
+#include "socketwrapper.h"
+#include "whack.h"
+
+static err_t send_all(struct whack_batch *b, const void *ptr, size_t len)
+{
+	const char *p = ptr;
+
+	while (len > 0) {
+		ssize_t n = send(b->sock, p, len, MSG_NOSIGNAL);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return builddiag("write(pluto_ctl) failed: %s",
+					 strerror(errno));
+		}
+		p += n;
+		len -= n;
+	}
+	return NULL;
+}
+
+/*
+ * Pass each complete line of output to the reply callback, and use
+ * its RC to update the status of the message being replied to (the
+ * same way a single whack connection's exit status is determined).
+ */
+static void process_replies(struct whack_batch *b)
+{
+	char *ls = b->buf;
+	char *be = b->buf + b->len;
+
+	for (;;) {
+		char *le = memchr(ls, '\n', be - ls);
+
+		if (le == NULL)
+			break;
+		le++;	/* include NL in line */
+
+		/* as for whack, nonsense is 0 */
+		unsigned long s = strtoul(ls, NULL, 10);
+
+		switch (s) {
+		case RC_WHACK_BATCH_ACK:
+			b->acked++;
+			if (b->status != 0) {
+				b->failed++;
+				b->last_failure = b->status;
+			}
+			b->status = 0;
+			break;
+		case RC_COMMENT:
+		case RC_LOG:
+			/* ignore */
+			break;
+		case RC_SUCCESS:
+			b->status = 0;
+			break;
+		default:
+			b->status = s;
+			break;
+		}
+		if (s != RC_WHACK_BATCH_ACK && b->reply != NULL)
+			b->reply(ls, le - ls, b->reply_arg);
+		ls = le;
+	}
+
+	/* move last, partial line to start of buffer */
+	memmove(b->buf, ls, be - ls);
+	b->len = be - ls;
+	if (b->len == sizeof(b->buf) - 1) {
+		/* too long; pass it on in pieces */
+		if (b->reply != NULL)
+			b->reply(b->buf, b->len, b->reply_arg);
+		b->len = 0;
+	}
+}
+
+/*
+ * Read whatever pluto has sent; when WAIT, block until there is
+ * something.
+ */
+static err_t read_replies(struct whack_batch *b, bool wait)
+{
+	for (;;) {
+		ssize_t n = recv(b->sock, b->buf + b->len,
+				 sizeof(b->buf) - 1 - b->len,
+				 wait ? 0 : MSG_DONTWAIT);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (!wait && (errno == EAGAIN || errno == EWOULDBLOCK))
+				return NULL;
+			return builddiag("read(pluto_ctl) failed: %s",
+					 strerror(errno));
+		}
+		if (n == 0) {
+			return builddiag("pluto closed the connection after %lu of %lu messages",
+					 b->acked, b->sent);
+		}
+		b->len += n;
+		process_replies(b);
+		if (wait)
+			return NULL;
+	}
+}
+
+err_t whack_batch_open(struct whack_batch *b, const char *ctlsocket)
+{
+	struct sockaddr_un ctl_addr = { .sun_family = AF_UNIX };
+
+	b->sock = -1;
+	b->sent = b->acked = b->failed = 0;
+	b->last_failure = b->status = 0;
+	b->len = 0;
+
+	fill_and_terminate(ctl_addr.sun_path, ctlsocket,
+			   sizeof(ctl_addr.sun_path));
+
+	b->sock = safe_socket(AF_UNIX, SOCK_STREAM, 0);
+	if (b->sock < 0) {
+		return builddiag("socket() failed: %s", strerror(errno));
+	}
+	if (connect(b->sock, (struct sockaddr *)&ctl_addr,
+		    offsetof(struct sockaddr_un, sun_path) +
+			strlen(ctl_addr.sun_path)) < 0) {
+		err_t ugh = builddiag("connect(pluto_ctl) failed: %s",
+				      strerror(errno));
+		close(b->sock);
+		b->sock = -1;
+		return ugh;
+	}
+
+	unsigned int magic = WHACK_BATCH_MAGIC;
+
+	return send_all(b, &magic, sizeof(magic));
+}
+
+err_t whack_batch_send(struct whack_batch *b, struct whack_message *msg)
+{
+	struct whackpacker wp;
+	err_t ugh;
+
+	/* Pack strings */
+	wp.msg = msg;
+	wp.str_next = (unsigned char *)msg->string;
+	wp.str_roof = (unsigned char *)&msg->string[sizeof(msg->string)];
+
+	ugh = pack_whack_msg(&wp);
+	if (ugh != NULL)
+		return builddiag("can't pack strings: %s", ugh);
+
+	uint32_t len = wp.str_next - (unsigned char *)msg;
+
+	/* wait for room in the window */
+	while (b->sent - b->acked >= WHACK_BATCH_WINDOW) {
+		ugh = read_replies(b, TRUE);
+		if (ugh != NULL)
+			return ugh;
+	}
+
+	ugh = send_all(b, &len, sizeof(len));
+	if (ugh == NULL)
+		ugh = send_all(b, msg, len);
+	if (ugh != NULL)
+		return ugh;
+	b->sent++;
+
+	/* keep pluto's output from backing up */
+	return read_replies(b, FALSE);
+}
+
+err_t whack_batch_close(struct whack_batch *b)
+{
+	err_t ugh = NULL;
+
+	if (b->sock < 0)
+		return NULL;
+
+	/* pluto closes its end once it has seen the last message */
+	if (shutdown(b->sock, SHUT_WR) < 0) {
+		ugh = builddiag("shutdown(pluto_ctl) failed: %s",
+				strerror(errno));
+	}
+	while (ugh == NULL && b->acked < b->sent)
+		ugh = read_replies(b, TRUE);
+
+	close(b->sock);
+	b->sock = -1;
+	return ugh;
+}
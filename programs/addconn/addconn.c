@@ -173,7 +173,7 @@ static const char *usage_string = ""
 	"               [--configsetup]\n"
 	"               [--liststack]\n"
 	"               [--checkconfig]\n"
-	"               [--autoall]\n"
+	"               [--autoall] [--reload]\n"
 	"               [--listall] [--listadd] [--listroute] [--liststart]\n"
 	"               [--listignore]\n"
 	"               names\n";
@@ -192,6 +192,7 @@ static const struct option longopts[] =
 	{ "verbose", no_argument, NULL, 'D' },
 	{ "addall", no_argument, NULL, 'a' }, /* alias, backwards compat */
 	{ "autoall", no_argument, NULL, 'a' },
+	{ "reload", no_argument, NULL, 'R' },
 	{ "listall", no_argument, NULL, 'A' },
 	{ "listadd", no_argument, NULL, 'L' },
 	{ "listroute", no_argument, NULL, 'r' },
@@ -216,6 +217,7 @@ int main(int argc, char *argv[])
 {
 	int opt;
 	bool autoall = FALSE;
+	bool reload = FALSE;	/* autoall, changes only */
 	int configsetup = 0;
 	int checkconfig = 0;
 	const char *export = "export"; /* display export before the foo=bar or not */
@@ -256,6 +258,11 @@ int main(int argc, char *argv[])
 			autoall = TRUE;
 			break;
 
+		case 'R':
+			autoall = TRUE;
+			reload = TRUE;
+			break;
+
 		case 'D':
 			verbose++;
 			lex_verbosity++;
@@ -434,6 +441,16 @@ int main(int argc, char *argv[])
 		if (verbose)
 			printf("  Pass #1: Loading auto=add, auto=route and auto=start connections\n");
 
+		starter_whack_batch_begin(cfg);
+		/*
+		 * When reloading, pluto leaves unchanged connections
+		 * alone (and ignores their route and initiate below)
+		 * and deletes those no longer in the file; auto=ignore
+		 * connections are only named, so that any added by hand
+		 * aren't deleted.
+		 */
+		if (reload)
+			starter_whack_reload_begin(cfg);
 		for (conn = cfg->conns.tqh_first; conn != NULL; conn = conn->link.tqe_next) {
 			if (conn->desired_state == STARTUP_ADD ||
 				conn->desired_state == STARTUP_ONDEMAND ||
@@ -443,8 +460,13 @@ int main(int argc, char *argv[])
 					printf(" %s", conn->name);
 				resolve_defaultroute(conn);
 				starter_whack_add_conn(cfg, conn);
+			} else if (reload) {
+				starter_whack_keep_conn(cfg, conn);
 			}
 		}
+		if (reload)
+			starter_whack_reload_end(cfg);
+		starter_whack_batch_end(cfg);
 
 		/*
 		 * We loaded all connections. Now tell pluto to listen,
@@ -455,6 +477,7 @@ int main(int argc, char *argv[])
 		if (verbose)
 			printf("  Pass #2: Routing auto=route connections\n");
 
+		starter_whack_batch_begin(cfg);
 		for (conn = cfg->conns.tqh_first; conn != NULL; conn = conn->link.tqe_next) {
 			if (conn->desired_state == STARTUP_ONDEMAND)
 			{
@@ -464,6 +487,7 @@ int main(int argc, char *argv[])
 					starter_whack_route_conn(cfg, conn);
 			}
 		}
+		starter_whack_batch_end(cfg);
 
 		if (verbose)
 			printf("  Pass #3: Initiating auto=start connections\n");
@@ -22,11 +22,14 @@
  * With XAUTH/CP, we need a way to allocate an address to a client.
  * This address must be unique on our system.
  * The pools of addresses to be used are declared in our config file.
- * Each connection may specify a pool as a range of IPv4 addresses.
+ * Each connection may specify a pool as a range of IPv4 or IPv6 addresses.
  * All pools must be non-everlapping, but each pool may be
  * used for more than one connection.
  */
 
+#include <string.h>
+#include <ctype.h>
+
 #include "libreswan.h"
 #include "lswalloc.h"
 #include "lswlog.h"
@@ -36,15 +39,25 @@
 #include "addresspool.h"
 #include "monotime.h"
 #include "ip_address.h"
+#include "x509.h"		/* for dntoa() */
+#include "hash_table.h"
+#include "log.h"		/* for whack_log_comment() */
 
 
 /*
- * A pool is a range of IPv4 addresses to be individually allocated.
+ * A pool is a range of IPv4 or IPv6 addresses to be individually
+ * allocated.
  * A connection may have a pool.
  * That pool may be shared with other connections (hence the reference count).
  *
- * A pool has a linked list of leases.
- * This list is in monotonically increasing order.
+ * Leases are found by index (range start + index == IP address) using
+ * the LEASES array, which only extends as far as the highest index
+ * used so far.  Indices below that, that have been freed, are kept in
+ * a min-heap so that, as before, the lowest free index is always
+ * allocated first.
+ *
+ * An IPv6 range can be much bigger than 2^32; only the first 2^32-1
+ * addresses are used.
  */
 struct ip_pool {
 	unsigned pool_refcount;	/* reference counted! */
@@ -52,7 +65,17 @@ struct ip_pool {
 	u_int32_t size;		/* number of addresses within range */
 	u_int32_t used;		/* number of addresses in use (includes lingering) */
 	u_int32_t lingering;	/* number of lingering addresses */
-	struct lease_addr *leases;	/* monotonically increasing index values */
+
+	struct lease_addr **leases;	/* [0..nr_leases); NULL when free */
+	u_int32_t nr_leases;		/* indices in use, or freed */
+	u_int32_t leases_size;		/* allocated */
+
+	u_int32_t *free_indices;	/* min-heap of freed indices */
+	u_int32_t nr_free_indices;
+	u_int32_t free_indices_size;
+
+	struct list_head lingering_leases;	/* oldest first */
+	struct list_head wildcard_leases;	/* thatid is ID_NONE */
 
 	struct ip_pool *next;	/* next pool */
 };
@@ -73,8 +96,8 @@ struct ip_pool {
  * Otherwise it "lingers" so that the same client (based on ID) can later
  * be assigned the same address from the pool.
  *
- * In the future we may implement code to delete a lingering lease to free
- * the address if there is no free address in the pool.
+ * When the pool has no free address, the lease that has been
+ * lingering the longest is taken over.
  *
  * Life cycle:
  *
@@ -95,7 +118,9 @@ struct lease_addr {
 	unsigned refcnt;	/* reference counted */
 	monotime_t lingering_since;	/* when did this begin to linger */
 
-	struct lease_addr *next;	/* next in pool's list of leases */
+	struct ip_pool *pool;
+	struct list_entry id_entry;	/* in lease_id_hash_table, or wildcard_leases */
+	struct list_entry lingering_entry;	/* while refcnt == 0 */
 };
 
 /*
@@ -104,49 +129,293 @@ struct lease_addr {
  */
 static struct ip_pool *pluto_pools = NULL;
 
-/* note: free_lease_entry returns a pointer to h's list successor.
- * The caller MUST use this to replace the linked list's pointer to h.
+/*
+ * All the leases, of all the pools, hashed by thatid.
+ *
+ * The hash must agree with same_id(): IDs that are the same must
+ * hash the same.  Hence the case of names is ignored (as are a
+ * FQDN's trailing dots) and a DN is hashed using its text (which
+ * doesn't include the string types that same_dn() ignores).  Long
+ * IDs are truncated.
+ *
+ * An ID_NONE matches anything so those leases are kept on the pool's
+ * wildcard_leases list instead.
  */
-static struct lease_addr *free_lease_entry(struct lease_addr *h) MUST_USE_RESULT;
 
-static struct lease_addr *free_lease_entry(struct lease_addr *h)
+#define LEASE_ID_TABLE_SIZE 499
+
+static size_t lease_id_hasher(const struct id *id)
 {
-	struct lease_addr *next = h->next;
+	unsigned char key[1 + IDTOA_BUF];
+	size_t len = 0;
 
-	DBG(DBG_CONTROL, DBG_log("addresspool free lease entry ptr %p refcnt %u",
-		h, h->refcnt));
+	key[len++] = id->kind;
+	switch (id->kind) {
+	case ID_IPV4_ADDR:
+	case ID_IPV6_ADDR:
+	{
+		const unsigned char *bytes;
+		size_t n = addrbytesptr_read(&id->ip_addr, &bytes);
+		memcpy(key + len, bytes, n);
+		len += n;
+		break;
+	}
+	case ID_FQDN:
+	case ID_USER_FQDN:
+	{
+		size_t n = id->name.len;
+		while (n > 0 && id->name.ptr[n - 1] == '.')
+			n--;
+		for (size_t i = 0; i < n && len < sizeof(key); i++)
+			key[len++] = tolower(id->name.ptr[i]);
+		break;
+	}
+	case ID_FROMCERT:
+	case ID_DER_ASN1_DN:
+	{
+		char dn[IDTOA_BUF];
+		dntoa(dn, sizeof(dn), id->name);
+		for (const char *p = dn; *p != '\0' && len < sizeof(key); p++)
+			key[len++] = tolower(*p);
+		break;
+	}
+	case ID_KEY_ID:
+	{
+		size_t n = id->name.len;
+		if (n > sizeof(key) - len)
+			n = sizeof(key) - len;
+		memcpy(key + len, id->name.ptr, n);
+		len += n;
+		break;
+	}
+	default:
+		break;
+	}
+	/* peers can pick their ID; use the keyed hash */
+	return hash_table_bytes(key, len);
+}
 
-	free_id_content(&h->thatid);
-	pfree(h);
-	return next;
+static size_t lease_id_hash(void *data)
+{
+	struct lease_addr *lease = data;
+	return lease_id_hasher(&lease->thatid);
 }
 
-static void free_lease_list(struct lease_addr **head)
+static size_t log_lease(struct lswlog *buf, void *data)
 {
-	DBG(DBG_CONTROL,
-	    DBG_log("%s: addresspool free the lease list ptr %p",
-		    __func__, *head));
-	while (*head != NULL)
-		*head = free_lease_entry(*head);
+	struct lease_addr *lease = data;
+	return lswlogf(buf, "lease %u", lease->index);
+}
+
+static const struct list_info lease_list_info = {
+	.debug = DBG_CONTROLMORE,
+	.name = "addresspool leases",
+	.log = log_lease,
+};
+
+static struct list_head lease_id_hash_slots[LEASE_ID_TABLE_SIZE];
+static struct hash_table lease_id_hash_table = {
+	.info = {
+		.debug = DBG_CONTROLMORE,
+		.name = "addresspool lease id table",
+		.log = log_lease,
+	},
+	.hash = lease_id_hash,
+	.nr_slots = LEASE_ID_TABLE_SIZE,
+	.slots = lease_id_hash_slots,
+};
+
+static void add_lease_id(struct lease_addr *lease)
+{
+	if (lease->thatid.kind == ID_NONE) {
+		lease->id_entry = list_entry(&lease_list_info, lease);
+		insert_list_entry(&lease->pool->wildcard_leases,
+				  &lease->id_entry);
+	} else {
+		lease->id_entry = list_entry(&lease_id_hash_table.info, lease);
+		add_hash_table_entry(&lease_id_hash_table, lease,
+				     &lease->id_entry);
+	}
+}
+
+static void del_lease_id(struct lease_addr *lease)
+{
+	if (lease->thatid.kind == ID_NONE)
+		remove_list_entry(&lease->id_entry);
+	else
+		del_hash_table_entry(&lease_id_hash_table, &lease->id_entry);
 }
 
 /*
- *search for a lease in a pool with index i
- *
- * tricky: returns a pointer to the pointer that connects the lease.
- * This allows efficient removal.
- * It the index isn't found, NULL is returned (not a pointer to the
- * pointer to NULL).
+ * Convert between an index and an address.
  */
 
-static struct lease_addr **ref_to_lease(struct ip_pool *pool, u_int32_t i) {
-	struct lease_addr **pp;
-	struct lease_addr *p;
+/* HI - LO; FALSE when HI < LO; saturates at UINT32_MAX */
+static bool address_difference(const ip_address *hi, const ip_address *lo,
+			       u_int32_t *diff)
+{
+	const unsigned char *h;
+	const unsigned char *l;
+	size_t len = addrbytesptr_read(hi, &h);
 
-	for (pp = &pool->leases; (p = *pp) != NULL; pp = &p->next)
-		if (p->index == i)
-			return pp;
-	return NULL;
+	if (addrtypeof(hi) != addrtypeof(lo) || len < sizeof(u_int32_t) ||
+	    addrbytesptr_read(lo, &l) != len)
+		return FALSE;
+
+	unsigned char d[16];
+	unsigned borrow = 0;
+	passert(len <= sizeof(d));
+	for (size_t i = len; i > 0; i--) {
+		unsigned sub = l[i - 1] + borrow;
+		borrow = h[i - 1] < sub;
+		d[i - 1] = (h[i - 1] - sub) & 0xff;
+	}
+	if (borrow)
+		return FALSE;
+
+	*diff = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (i < len - sizeof(u_int32_t) && d[i] != 0) {
+			*diff = UINT32_MAX;
+			return TRUE;
+		}
+		*diff = (*diff << 8) | d[i];
+	}
+	return TRUE;
+}
+
+/* the index of ADDR, if it is within POOL */
+static bool index_of_address(const struct ip_pool *pool,
+			     const ip_address *addr, u_int32_t *index)
+{
+	return address_difference(addr, &pool->r.start, index) &&
+		*index < pool->size;
+}
+
+static void address_of_index(const struct ip_pool *pool, u_int32_t index,
+			     ip_address *addr)
+{
+	const unsigned char *start;
+	size_t len = addrbytesptr_read(&pool->r.start, &start);
+	unsigned char bytes[16];
+
+	passert(len <= sizeof(bytes));
+	memcpy(bytes, start, len);
+	/* big-endian addition; can't overflow as the index is in the range */
+	u_int64_t carry = index;
+	for (size_t i = len; i > 0 && carry != 0; i--) {
+		carry += bytes[i - 1];
+		bytes[i - 1] = carry & 0xff;
+		carry >>= 8;
+	}
+	initaddr(bytes, len, addrtypeof(&pool->r.start), addr);
+}
+
+/*
+ * The min-heap of freed indices.
+ */
+
+static void push_free_index(struct ip_pool *pool, u_int32_t index)
+{
+	if (pool->nr_free_indices >= pool->free_indices_size) {
+		u_int32_t size = pool->free_indices_size == 0 ? 16 :
+			pool->free_indices_size * 2;
+		u_int32_t *indices = alloc_things(u_int32_t, size,
+						  "addresspool free indices");
+		if (pool->free_indices != NULL) {
+			memcpy(indices, pool->free_indices,
+			       pool->nr_free_indices * sizeof(indices[0]));
+			pfree(pool->free_indices);
+		}
+		pool->free_indices = indices;
+		pool->free_indices_size = size;
+	}
+	u_int32_t *heap = pool->free_indices;
+	u_int32_t i = pool->nr_free_indices++;
+	while (i > 0 && heap[(i - 1) / 2] > index) {
+		heap[i] = heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	heap[i] = index;
+}
+
+static u_int32_t pop_free_index(struct ip_pool *pool)
+{
+	u_int32_t *heap = pool->free_indices;
+	u_int32_t top = heap[0];
+	u_int32_t last = heap[--pool->nr_free_indices];
+	u_int32_t n = pool->nr_free_indices;
+	u_int32_t i = 0;
+	for (;;) {
+		u_int32_t child = 2 * i + 1;
+		if (child >= n)
+			break;
+		if (child + 1 < n && heap[child + 1] < heap[child])
+			child++;
+		if (last <= heap[child])
+			break;
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = last;
+	return top;
+}
+
+/*
+ * Allocate the lowest free index; FALSE when the pool is exhausted.
+ */
+static bool alloc_index(struct ip_pool *pool, u_int32_t *index)
+{
+	if (pool->nr_free_indices > 0) {
+		*index = pop_free_index(pool);
+		return TRUE;
+	}
+	if (pool->nr_leases >= pool->size)
+		return FALSE;
+	if (pool->nr_leases >= pool->leases_size) {
+		u_int32_t size = pool->leases_size == 0 ? 16 :
+			pool->leases_size * 2;
+		if (size > pool->size)
+			size = pool->size;
+		struct lease_addr **leases =
+			alloc_things(struct lease_addr *, size,
+				     "addresspool leases");
+		if (pool->leases != NULL) {
+			memcpy(leases, pool->leases,
+			       pool->nr_leases * sizeof(leases[0]));
+			pfree(pool->leases);
+		}
+		pool->leases = leases;
+		pool->leases_size = size;
+	}
+	*index = pool->nr_leases++;
+	return TRUE;
+}
+
+static void free_lease_entry(struct lease_addr *h)
+{
+	DBG(DBG_CONTROL, DBG_log("addresspool free lease entry ptr %p refcnt %u",
+		h, h->refcnt));
+
+	del_lease_id(h);
+	if (h->refcnt == 0)
+		remove_list_entry(&h->lingering_entry);
+	h->pool->leases[h->index] = NULL;
+	free_id_content(&h->thatid);
+	pfree(h);
+}
+
+static void free_lease_list(struct ip_pool *pool)
+{
+	DBG(DBG_CONTROL,
+	    DBG_log("%s: addresspool free the lease list ptr %p",
+		    __func__, pool->leases));
+	for (u_int32_t i = 0; i < pool->nr_leases; i++) {
+		if (pool->leases[i] != NULL)
+			free_lease_entry(pool->leases[i]);
+	}
+	pfreeany(pool->leases);
+	pfreeany(pool->free_indices);
 }
 
 /*
@@ -155,7 +424,7 @@ static struct lease_addr **ref_to_lease(struct ip_pool *pool, u_int32_t i) {
  * If the ID is distinctive and uniqueid is set, the lease "lingers"
  * so that the same client can be reassigned the same address.
  * A lingering lease is available to be re-activated
- * by lease_an_address/find_lingering_lease to the same thatid when uniqueid is
+ * by lease_an_address/share_lease to the same thatid when uniqueid is
  * set.
  *
  * If uniqueIDs is set or thatid is ID_NONE, we don't know how to share.
@@ -166,33 +435,21 @@ static struct lease_addr **ref_to_lease(struct ip_pool *pool, u_int32_t i) {
 void rel_lease_addr(struct connection *c)
 {
 	struct ip_pool *pool = c->pool;
-	u_int32_t i;	/* index within range of IPv4 address to be released */
+	u_int32_t i;	/* index within range of address to be released */
 	unsigned refcnt;	/* for DBG logging */
 	const char *story;	/* for DBG logging */
 
 	if (!c->spd.that.has_lease)
 		return; /* it is not from the addresspool to free */
 
-	passert(addrtypeof(&c->spd.that.client.addr) == AF_INET);
-
-	/* i is index of client.addr within pool's range.
-	 * Using unsigned arithmetic means that if client.addr is less than
-	 * start, i will wrap around to a very large value.
-	 * Therefore a single test against size will indicate
-	 * membership in the range.
-	 */
-	i = ntohl(c->spd.that.client.addr.u.v4.sin_addr.s_addr) -
-	    ntohl(pool->r.start.u.v4.sin_addr.s_addr);
-
-	passert(i < pool->size);
+	bool in_pool = index_of_address(pool, &c->spd.that.client.addr, &i);
+	passert(in_pool);
 
 	{
-		struct lease_addr **pp = ref_to_lease(pool, i);
-		struct lease_addr *p;
+		passert(i < pool->nr_leases);
+		struct lease_addr *p = pool->leases[i];
 
-		passert(pp != NULL);	/* not found */
-
-		p = *pp;
+		passert(p != NULL);	/* not found */
 
 		if (could_share_lease(c)) {
 			/* we could share, so leave lease lingering */
@@ -203,15 +460,18 @@ void rel_lease_addr(struct connection *c)
 				story = "left (to linger)";
 				pool->lingering++;
 				p->lingering_since = mononow();
+				p->lingering_entry = list_entry(&lease_list_info, p);
+				insert_list_entry(&pool->lingering_leases,
+						  &p->lingering_entry);
 			}
 			refcnt = p->refcnt;
 		} else {
 			/* cannot share: free it */
 			story = "freed";
 			passert(p->refcnt == 1);
-			p->refcnt--;
-			refcnt = p->refcnt;
-			*pp = free_lease_entry(p);
+			refcnt = 0;
+			free_lease_entry(p);
+			push_free_index(pool, i);
 			pool->used--;
 		}
 	}
@@ -236,167 +496,152 @@ void rel_lease_addr(struct connection *c)
 /*
  * return previous lease if there is one lingering for the same ID
  * but only if uniqueIDs, and ID_NONE does not count.
+ *
+ * Should several leases match (an ID_NONE matches anything) the one
+ * with the lowest index is used.
  */
-static bool share_lease(const struct connection *c,
-			u_int32_t *index /*result*/)
+static struct lease_addr *share_lease(const struct connection *c)
 {
+	struct ip_pool *pool = c->pool;
+	const struct id *thatid = &c->spd.that.id;
+	struct lease_addr *best = NULL;
 	struct lease_addr *p;
-	bool r = FALSE;
 
 	if (!could_share_lease(c))
-		return FALSE;
+		return NULL;
 
-	for (p = c->pool->leases; p != NULL; p = p->next) {
-		if (same_id(&p->thatid, &c->spd.that.id)) {
-			*index = p->index;
-			if (p->refcnt == 0) {
-				c->pool->lingering--;
-				c->pool->used++;
-			}
-			p->refcnt++;
-			r = TRUE;
-			break;
+	if (thatid->kind == ID_NONE) {
+		/* matches anything */
+		for (u_int32_t i = 0; best == NULL && i < pool->nr_leases; i++)
+			best = pool->leases[i];
+	} else {
+		struct list_head *slot =
+			hash_table_slot_by_hash(&lease_id_hash_table,
+						lease_id_hasher(thatid));
+		FOR_EACH_LIST_ENTRY_NEW2OLD(slot, p) {
+			if (p->pool == pool &&
+			    (best == NULL || p->index < best->index) &&
+			    same_id(&p->thatid, thatid))
+				best = p;
+		}
+		FOR_EACH_LIST_ENTRY_NEW2OLD(&pool->wildcard_leases, p) {
+			if (best == NULL || p->index < best->index)
+				best = p;
 		}
 	}
 
+	if (best != NULL) {
+		if (best->refcnt == 0) {
+			pool->lingering--;
+			remove_list_entry(&best->lingering_entry);
+		}
+		best->refcnt++;
+	}
+
 	DBG(DBG_CONTROLMORE, {
-		char thatid[IDTOA_BUF];
+		char thatidbuf[IDTOA_BUF];
 
-		idtoa(&c->spd.that.id, thatid, sizeof(thatid));
-		if (r) {
+		idtoa(thatid, thatidbuf, sizeof(thatidbuf));
+		if (best != NULL) {
 			ipstr_buf b;
 			ip_address ipaddr;
-			uint32_t addr = ntohl(c->pool->r.start.u.v4.sin_addr.s_addr) + *index;
-			uint32_t addr_nw = htonl(addr);
-
-			initaddr((unsigned char *)&addr_nw,
-				sizeof(addr_nw), AF_INET, &ipaddr);
 
+			address_of_index(pool, best->index, &ipaddr);
 			DBG_log("in %s: found a lingering addresspool lease %s refcnt %d for '%s'",
 				__func__,
 				ipstr(&ipaddr, &b),
-				p->refcnt,
-				thatid);
+				best->refcnt,
+				thatidbuf);
 		} else {
 			DBG_log("in %s: no lingering addresspool lease for '%s'",
 				__func__,
-				thatid);
+				thatidbuf);
 		}
 	});
 
-	return r;
+	return best;
 }
 
 err_t lease_an_address(const struct connection *c,
 		     ip_address *ipa /*result*/)
 {
-	/*
-	 * index within address range
-	 * Initialized just to silence GCC.
-	 */
-	u_int32_t i = 0;
-	bool s;
+	struct ip_pool *pool = c->pool;
 
 	DBG(DBG_CONTROL, {
 		char rbuf[RANGETOT_BUF];
 		char thatidbuf[IDTOA_BUF];
 		ipstr_buf b;
 
-		rangetot(&c->pool->r, 0, rbuf, sizeof(rbuf));
+		rangetot(&pool->r, 0, rbuf, sizeof(rbuf));
 		idtoa(&c->spd.that.id, thatidbuf, sizeof(thatidbuf));
 
 		/* ??? what is that.client.addr and why do we care? */
 		DBG_log("request lease from addresspool %s reference count %u thatid '%s' that.client.addr %s",
-			rbuf, c->pool->pool_refcount, thatidbuf,
+			rbuf, pool->pool_refcount, thatidbuf,
 			ipstr(&c->spd.that.client.addr, &b));
 	});
 
-	s = share_lease(c, &i);
-	if (!s) {
+	struct lease_addr *p = share_lease(c);
+	bool s = (p != NULL);
+	u_int32_t i;
+
+	if (s) {
+		i = p->index;
+	} else if (alloc_index(pool, &i)) {
 		/*
 		 * cannot find or cannot share an existing lease:
 		 * allocate a new one
 		 */
-		const u_int32_t size = c->pool->size;
-		struct lease_addr **pp;
-		struct lease_addr *p;
-		struct lease_addr *ll = NULL;	/* longest lingerer */
-
-		for (pp = &c->pool->leases; (p = *pp) != NULL; pp = &p->next) {
-			/* check that list of leases is
-			 * monotonically increasing.
-			 */
-			passert(p->index >= i);
-			if (p->index > i)
-				break;
-			/* remember the longest lingering lease found */
-			if (p->refcnt == 0 &&
-			    (ll == NULL ||
-			     monobefore(ll->lingering_since, p->lingering_since)))
-				ll = p;
-			/* Subtle point: this addition won't overflow.
-			 * 0.0.0.0 cannot be in a range
-			 * so the size will be less than 2^32.
-			 * No index can equal size
-			 * so i cannot exceed it.
-			 */
-			i = p->index + 1;
-		}
+		struct lease_addr *a = alloc_thing(struct lease_addr, "address lease entry");
 
-		if (i < size) {
-			/* we can allocate a new address and lease */
-			struct lease_addr *a = alloc_thing(struct lease_addr, "address lease entry");
-
-			a->index = i;
-			a->refcnt = 1;
-			c->pool->used++;
-
-			duplicate_id(&a->thatid, &c->spd.that.id);
-
-			a->next = p;
-			*pp = a;
-
-			DBG(DBG_CONTROLMORE,
-				DBG_log("New lease from addresspool index %u", i));
-		} else if (ll != NULL) {
-			/* we take over this lingering lease */
-			DBG(DBG_CONTROLMORE, {
-				char thatidbuf[IDTOA_BUF];
-
-				idtoa(&ll->thatid, thatidbuf, sizeof(thatidbuf));
-				DBG_log("grabbed lingering lease index %u from %s",
-					i, thatidbuf);
-			});
-			duplicate_id(&ll->thatid, &c->spd.that.id);
-			c->pool->lingering--;
-			ll->refcnt++;
-			i = ll->index;
-		} else {
-			DBG(DBG_CONTROL,
-			    DBG_log("no free address within pool; size %u, used %u, lingering %u",
-				size, c->pool->used, c->pool->lingering));
-			passert(size == c->pool->used);
-			return "no free address in addresspool";
-		}
+		a->index = i;
+		a->refcnt = 1;
+		a->pool = pool;
+		pool->used++;
+
+		duplicate_id(&a->thatid, &c->spd.that.id);
+		add_lease_id(a);
+		pool->leases[i] = a;
+
+		DBG(DBG_CONTROLMORE,
+			DBG_log("New lease from addresspool index %u", i));
+	} else if (pool->lingering_leases.head.newer != &pool->lingering_leases.head) {
+		/* we take over the longest lingering lease */
+		struct lease_addr *ll = pool->lingering_leases.head.newer->data;
+
+		i = ll->index;
+		DBG(DBG_CONTROLMORE, {
+			char thatidbuf[IDTOA_BUF];
+
+			idtoa(&ll->thatid, thatidbuf, sizeof(thatidbuf));
+			DBG_log("grabbed lingering lease index %u from %s",
+				i, thatidbuf);
+		});
+		remove_list_entry(&ll->lingering_entry);
+		del_lease_id(ll);
+		free_id_content(&ll->thatid);
+		duplicate_id(&ll->thatid, &c->spd.that.id);
+		add_lease_id(ll);
+		pool->lingering--;
+		ll->refcnt++;
+	} else {
+		DBG(DBG_CONTROL,
+		    DBG_log("no free address within pool; size %u, used %u, lingering %u",
+			pool->size, pool->used, pool->lingering));
+		passert(pool->size == pool->used);
+		return "no free address in addresspool";
 	}
 
 	/* convert index i in range to an IP_address */
-	{
-		uint32_t addr = ntohl(c->pool->r.start.u.v4.sin_addr.s_addr) + i;
-		uint32_t addr_nw = htonl(addr);
-		err_t e = initaddr((unsigned char *)&addr_nw, sizeof(addr_nw),
-			     AF_INET, ipa);
+	address_of_index(pool, i, ipa);
 
-		if (e != NULL)
-			return e;
-	}
 	DBG(DBG_CONTROL, {
 		char rbuf[RANGETOT_BUF];
 		char thatidbuf[IDTOA_BUF];
 		ipstr_buf a;
 		ipstr_buf l;
 
-		rangetot(&c->pool->r, 0, rbuf, sizeof(rbuf));
+		rangetot(&pool->r, 0, rbuf, sizeof(rbuf));
 		idtoa(&c->spd.that.id, thatidbuf, sizeof(thatidbuf));
 
 		DBG_log("%s lease %s from addresspool %s to that.client.addr %s thatid '%s'",
@@ -422,7 +667,7 @@ static void free_addresspool(struct ip_pool *pool)
 	for (pp = &pluto_pools; (p = *pp) != NULL; pp = &p->next) {
 		if (p == pool) {
 			*pp = p->next;	/* unlink pool */
-			free_lease_list(&pool->leases);
+			free_lease_list(pool);
 			pfree(pool);
 			return;
 		}
@@ -505,8 +750,7 @@ err_t find_addresspool(const ip_range *pool_range, struct ip_pool **pool)
 
 /*
  * the caller must enforce the following:
- * - Range must not include 0.0.0.0
- * - Only IPv4 allowed.
+ * - Range must not include 0.0.0.0 (or ::)
  * - The range must be non-empty
  */
 struct ip_pool *install_addresspool(const ip_range *pool_range)
@@ -533,10 +777,15 @@ struct ip_pool *install_addresspool(const ip_range *pool_range)
 
 		p->pool_refcount = 0;
 		p->r = *pool_range;
-		p->size = ntohl(p->r.end.u.v4.sin_addr.s_addr) -
-			  ntohl(p->r.start.u.v4.sin_addr.s_addr) + 1;
+		/* an IPv6 range can be huge; only use the first 2^32-1 */
+		u_int32_t last;
+		if (!address_difference(&p->r.end, &p->r.start, &last))
+			last = 0;	/* caller checked */
+		p->size = last == UINT32_MAX ? UINT32_MAX : last + 1;
 		p->used = 0;
 		p->lingering = 0;
+		init_list(&lease_list_info, &p->lingering_leases);
+		init_list(&lease_list_info, &p->wildcard_leases);
 
 		DBG(DBG_CONTROLMORE, {
 			char rbuf[RANGETOT_BUF];
@@ -545,9 +794,36 @@ struct ip_pool *install_addresspool(const ip_range *pool_range)
 			DBG_log("add new addresspool to global pools %s size %d ptr %p",
 				rbuf, p->size, p);
 		});
-		p->leases = NULL;
 		p->next = *head;
 		*head = p;
 	}
 	return p;
 }
+
+void init_addresspools(void)
+{
+	init_hash_table(&lease_id_hash_table);
+}
+
+void free_addresspools(void)
+{
+	free_hash_table(&lease_id_hash_table);
+}
+
+void show_addresspool_status(void)
+{
+	/* per pool counts are 32-bit, their sums need not be */
+	uint64_t size = 0;
+	uint64_t used = 0;
+	uint64_t lingering = 0;
+	for (struct ip_pool *p = pluto_pools; p != NULL; p = p->next) {
+		size += p->size;
+		used += p->used;
+		lingering += p->lingering;
+	}
+	whack_log_comment("current.addresspool.size=%ju", (uintmax_t)size);
+	whack_log_comment("current.addresspool.used=%ju", (uintmax_t)used);
+	whack_log_comment("current.addresspool.lingering=%ju",
+			  (uintmax_t)lingering);
+	show_hash_table_status(&lease_id_hash_table, "addresspool_id");
+}
@@ -29,4 +29,8 @@ extern void reference_addresspool(struct connection *c);
 extern err_t lease_an_address(const struct connection *c, ip_address *ipa /*result*/);
 extern void rel_lease_addr(struct connection *c);
 
+extern void init_addresspools(void);
+extern void free_addresspools(void);
+extern void show_addresspool_status(void);
+
 #endif /* _ADDRESSPOOL_H */
@@ -0,0 +1,244 @@
+/* Connection tables indexed by name and alias, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <string.h>
+
+#include "defs.h"
+
+#include "lswlog.h"
+#include "lswalloc.h"
+#include "connections.h"
+#include "connection_db.h"
+#include "hash_table.h"
+
+/*
+ * Initial (and minimum) number of slots in each table; the tables
+ * grow as connections are added.
+ */
+#define CONNECTION_TABLE_SIZE 499
+
+/*
+ * An alias is a list of words (see lsw_alias_cmp()).  The alias
+ * table contains one group per word, and each group lists the
+ * connections with that word.  A popular word (for instance, one
+ * shared by every connection loaded from a file) only costs one
+ * entry.
+ */
+
+struct alias_group {
+	struct list_entry entry;	/* in the alias table */
+	char *word;
+	struct list_head connections;	/* of struct connection_alias */
+	unsigned busy;			/* being iterated over */
+};
+
+struct connection_alias {
+	struct list_entry entry;	/* in GROUP->connections */
+	struct alias_group *group;
+};
+
+static size_t log_connection(struct lswlog *buf, void *data)
+{
+	struct connection *c = data;
+	return lswlogf(buf, "connection \"%s\"", c->name);
+}
+
+static size_t log_alias_group(struct lswlog *buf, void *data)
+{
+	struct alias_group *g = data;
+	return lswlogf(buf, "alias %s", g->word);
+}
+
+static const struct list_info alias_connections_info = {
+	.debug = DBG_CONTROLMORE,
+	.name = "alias connections",
+	.log = log_connection,
+};
+
+/*
+ * Names and aliases are under the control of the local admin, but
+ * pluto creates instance names from things the peer sends, so use
+ * the keyed hash.
+ */
+
+static size_t name_hash(void *data)
+{
+	struct connection *c = data;
+	return hash_table_bytes(c->name, strlen(c->name));
+}
+
+static size_t alias_hash(void *data)
+{
+	struct alias_group *g = data;
+	return hash_table_bytes(g->word, strlen(g->word));
+}
+
+static struct list_head name_hash_slots[CONNECTION_TABLE_SIZE];
+static struct hash_table name_hash_table = {
+	.info = {
+		.debug = DBG_CONTROLMORE,
+		.name = "connection name table",
+		.log = log_connection,
+	},
+	.hash = name_hash,
+	.nr_slots = CONNECTION_TABLE_SIZE,
+	.slots = name_hash_slots,
+};
+
+static struct list_head alias_hash_slots[CONNECTION_TABLE_SIZE];
+static struct hash_table alias_hash_table = {
+	.info = {
+		.debug = DBG_CONTROLMORE,
+		.name = "connection alias table",
+		.log = log_alias_group,
+	},
+	.hash = alias_hash,
+	.nr_slots = CONNECTION_TABLE_SIZE,
+	.slots = alias_hash_slots,
+};
+
+struct list_head *connection_name_slot(const char *name)
+{
+	return hash_table_slot_by_hash(&name_hash_table,
+				       hash_table_bytes(name, strlen(name)));
+}
+
+static struct alias_group *alias_group(const char *word, size_t len)
+{
+	size_t hash = hash_table_bytes(word, len);
+	struct alias_group *g;
+	FOR_EACH_LIST_ENTRY_NEW2OLD(hash_table_slot_by_hash(&alias_hash_table,
+							    hash), g) {
+		if (strlen(g->word) == len && strneq(g->word, word, len)) {
+			return g;
+		}
+	}
+	return NULL;
+}
+
+static void release_alias_group(struct alias_group *g)
+{
+	if (g->busy == 0 &&
+	    g->connections.head.newer == &g->connections.head) {
+		del_hash_table_entry(&alias_hash_table, &g->entry);
+		pfree(g->word);
+		pfree(g);
+	}
+}
+
+static bool is_alias_space(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+void add_connection_to_db(struct connection *c)
+{
+	c->name_entry = list_entry(&name_hash_table.info, c);
+	add_hash_table_entry(&name_hash_table, c, &c->name_entry);
+
+	c->aliases = NULL;
+	c->nr_aliases = 0;
+	if (c->connalias == NULL) {
+		return;
+	}
+
+	/* over-estimate the number of words */
+	unsigned nr_words = 0;
+	for (const char *s = c->connalias; *s != '\0'; s++) {
+		if (!is_alias_space(*s) &&
+		    (s == c->connalias || is_alias_space(s[-1]))) {
+			nr_words++;
+		}
+	}
+	if (nr_words == 0) {
+		return;
+	}
+	c->aliases = alloc_things(struct connection_alias, nr_words,
+				  "connection aliases");
+	for (const char *s = c->connalias; *s != '\0'; ) {
+		if (is_alias_space(*s)) {
+			s++;
+			continue;
+		}
+		size_t len = strcspn(s, " \t");
+		struct alias_group *g = alias_group(s, len);
+		if (g == NULL) {
+			g = alloc_thing(struct alias_group, "alias group");
+			g->word = clone_bytes(s, len + 1, "alias word");
+			g->word[len] = '\0';
+			init_list(&alias_connections_info, &g->connections);
+			g->entry = list_entry(&alias_hash_table.info, g);
+			add_hash_table_entry(&alias_hash_table, g, &g->entry);
+		}
+		/* the newest entry; was the word already listed? */
+		if (g->connections.head.older->data == c) {
+			s += len;
+			continue;
+		}
+		struct connection_alias *a = &c->aliases[c->nr_aliases++];
+		a->group = g;
+		a->entry = list_entry(&alias_connections_info, c);
+		insert_list_entry(&g->connections, &a->entry);
+		s += len;
+	}
+}
+
+void del_connection_from_db(struct connection *c)
+{
+	del_hash_table_entry(&name_hash_table, &c->name_entry);
+	for (unsigned i = 0; i < c->nr_aliases; i++) {
+		struct connection_alias *a = &c->aliases[i];
+		remove_list_entry(&a->entry);
+		release_alias_group(a->group);
+	}
+	pfreeany(c->aliases);
+	c->aliases = NULL;
+	c->nr_aliases = 0;
+}
+
+int foreach_connection_with_alias(const char *alias,
+				  int (*f)(struct connection *c, void *arg),
+				  void *arg)
+{
+	struct alias_group *g = alias_group(alias, strlen(alias));
+	if (g == NULL) {
+		return 0;
+	}
+	int count = 0;
+	struct connection *c;
+	g->busy++;
+	FOR_EACH_LIST_ENTRY_NEW2OLD(&g->connections, c) {
+		count += f(c, arg);
+	}
+	g->busy--;
+	release_alias_group(g);
+	return count;
+}
+
+void init_connection_db(void)
+{
+	init_hash_table(&name_hash_table);
+	init_hash_table(&alias_hash_table);
+}
+
+void free_connection_db(void)
+{
+	free_hash_table(&name_hash_table);
+	free_hash_table(&alias_hash_table);
+}
+
+void show_connection_db_status(void)
+{
+	show_hash_table_status(&name_hash_table, "connection.name");
+	show_hash_table_status(&alias_hash_table, "connection.alias");
+}
@@ -0,0 +1,49 @@
+/* Connection tables indexed by name and alias, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef _connection_db_h_
+#define _connection_db_h_
+
+#include <stddef.h>
+
+struct connection;
+struct list_head;
+
+void init_connection_db(void);
+void free_connection_db(void);
+void show_connection_db_status(void);
+
+/*
+ * Add C, using its current name and alias, to the tables; both
+ * strings must belong to C (see unshare_connection()).
+ */
+void add_connection_to_db(struct connection *c);
+void del_connection_from_db(struct connection *c);
+
+/*
+ * Return the slot for NAME.  It will contain many connections, not
+ * just those called NAME.  Extra filtering is required!
+ */
+struct list_head *connection_name_slot(const char *name);
+
+/*
+ * Call F on each connection with the alias ALIAS (a single word),
+ * newest first.  As when walking the connections list, F can delete
+ * the connection it is passed, and add new ones (which are skipped),
+ * but shouldn't delete others.
+ */
+int foreach_connection_with_alias(const char *alias,
+				  int (*f)(struct connection *c, void *arg),
+				  void *arg);
+
+#endif
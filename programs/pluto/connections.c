@@ -56,6 +56,8 @@
 
 #include "defs.h"
 #include "connections.h" /* needs id.h */
+#include "connection_db.h"
+#include "spd_db.h"
 #include "pending.h"
 #include "foodgroups.h"
 #include "packet.h"
@@ -76,6 +78,7 @@
 #include "plutoalg.h"
 #include "ikev1_xauth.h"
 #include "addresspool.h"
+#include "dns_cache.h"
 #include "nat_traversal.h"
 #include "pluto_x509.h"
 #include "nss_cert_verify.h" /* for cert_VerifySubjectAltName() */
@@ -100,34 +103,23 @@ static uint32_t global_marks = MINIMUM_IPSEC_SA_RANDOM_MARK;
  * Find a connection by name.
  *
  * If strict, don't accept a CK_INSTANCE.
- * Move the winner (if any) to the front.
  * If none is found, and strict, a diagnostic is logged to whack.
  */
 struct connection *conn_by_name(const char *nm, bool strict, bool quiet)
 {
-	struct connection *p, *prev;
-
-	for (prev = NULL, p = connections;; prev = p, p = p->ac_next) {
-		if (p == NULL) {
-			if (strict)
-				if (!quiet)
-					whack_log(RC_UNKNOWN_NAME,
-						"no connection named \"%s\"", nm);
-			break;
-		}
+	struct connection *p;
+
+	FOR_EACH_LIST_ENTRY_NEW2OLD(connection_name_slot(nm), p) {
 		if (streq(p->name, nm) &&
 			(!strict || p->kind != CK_INSTANCE)) {
-			if (prev != NULL) {
-				/* remove p from list */
-				prev->ac_next = p->ac_next;
-				/* and stick it on front */
-				p->ac_next = connections;
-				connections = p;
-			}
-			break;
+			return p;
 		}
 	}
-	return p;
+	if (strict)
+		if (!quiet)
+			whack_log(RC_UNKNOWN_NAME,
+				"no connection named \"%s\"", nm);
+	return NULL;
 }
 
 void release_connection(struct connection *c, bool relations)
@@ -166,9 +158,12 @@ void update_host_pairs(struct connection *c)
 	pexpect(dnshostname == d->dnshostname || streq(dnshostname, d->dnshostname));
 
 	ip_address new_addr;
+	err_t ugh;
 
+	/* when the lookup is pending, it is called again once answered */
 	if (d->dnshostname == NULL ||
-	    ttoaddr(d->dnshostname, 0, d->addr_family, &new_addr) != NULL ||
+	    dns_lookup(d->dnshostname, d->addr_family,
+		       &new_addr, &ugh) != DNS_FOUND ||
 	    sameaddr(&new_addr, &hp->him.addr))
 		return;
 
@@ -202,6 +197,7 @@ void update_host_pairs(struct connection *c)
 			 */
 			if (!d->spd.that.has_client) {
 				addrtosubnet(&new_addr, &d->spd.that.client);
+				rehash_spd_routes_in_db(d);
 			}
 
 			d->spd.that.host_addr = new_addr;
@@ -223,7 +219,7 @@ void update_host_pairs(struct connection *c)
 
 	if (hp->connections == NULL) {
 		passert(hp->pending == NULL); /* ??? must deal with this! */
-		list_rm(struct host_pair, next, hp, host_pairs);
+		remove_host_pair(hp);
 		pfree(hp);
 	}
 }
@@ -300,6 +296,8 @@ void delete_connection(struct connection *c, bool relations)
 
 	/* find and delete c from connections list */
 	list_rm(struct connection, ac_next, c, connections);
+	del_connection_from_db(c);
+	del_spd_routes_from_db(c);
 
 	/* find and delete c from the host pair list */
 	if (c->host_pair == NULL) {
@@ -372,13 +370,18 @@ int foreach_connection_by_alias(const char *alias,
 	struct connection *p, *pnext;
 	int count = 0;
 
-	for (p = connections; p != NULL; p = pnext) {
-		pnext = p->ac_next;
+	if (alias[0] == '\0' || strpbrk(alias, " \t") != NULL) {
+		/* not a single word; do it the hard way */
+		for (p = connections; p != NULL; p = pnext) {
+			pnext = p->ac_next;
 
-		if (lsw_alias_cmp(alias, p->connalias))
-			count += (*f)(p, arg);
+			if (lsw_alias_cmp(alias, p->connalias))
+				count += (*f)(p, arg);
+		}
+		return count;
 	}
-	return count;
+
+	return foreach_connection_with_alias(alias, f, arg);
 }
 
 static int delete_connection_wrap(struct connection *c, void *arg)
@@ -962,31 +965,28 @@ static bool extract_end(struct end *dst, const struct whack_end *src,
 	dst->sendcert =  src->sendcert;
 
 	/*
-	 * see if we can resolve the DNS name right now
-	 * XXX this is WRONG, we should do this asynchronously, as part of
-	 * the normal loading process
+	 * resolve the DNS name now (unless it is already cached); later
+	 * lookups happen in the background and connections_dns_answered()
+	 * fills in any new address
 	 */
-	{
+	if (dst->host_type == KH_IPHOSTNAME) {
 		err_t er;
-		int port;
-
-		switch (dst->host_type) {
-		case KH_IPHOSTNAME:
-			er = ttoaddr(dst->host_addr_name, 0, addrtypeof(&dst->host_addr),
-				&dst->host_addr);
-
-			/* The above call wipes out the port, put it again */
-			port = htons(dst->port);
-			setportof(port, &dst->host_addr);
-
-			if (er != NULL) {
-				loglog(RC_COMMENT,
-					"failed to convert '%s' at load time: %s", dst->host_addr_name, er);
-			}
+		ip_address addr;
+
+		switch (dns_lookup_now(dst->host_addr_name,
+				   addrtypeof(&dst->host_addr), &addr, &er)) {
+		case DNS_FOUND:
+			dst->host_addr = addr;
+			/* lookups don't know the port, put it again */
+			setportof(htons(dst->port), &dst->host_addr);
 			break;
-
-		default:
+		case DNS_FAILED:
+			loglog(RC_COMMENT,
+				"failed to convert '%s' at load time: %s", dst->host_addr_name, er);
 			break;
+		case DNS_PENDING:
+			/* not from dns_lookup_now() */
+			bad_case(DNS_PENDING);
 		}
 	}
 
@@ -1021,11 +1021,18 @@ static bool check_connection_end(const struct whack_end *this,
 		return FALSE;
 	}
 
-	/* ??? seems like a nasty test (in-band, low-level) */
-	if (this->pool_range.start.u.v4.sin_addr.s_addr != 0) {
+	if (addrtypeof(&this->pool_range.start) != AF_UNSPEC) {
 		struct ip_pool *pool;
-		err_t er = find_addresspool(&this->pool_range, &pool);
+		err_t er;
+
+		/* IKEv1 ModeCFG can only hand out IPv4 addresses */
+		if (addrtypeof(&this->pool_range.start) != AF_INET &&
+		    (wm->policy & POLICY_IKEV1_ALLOW)) {
+			loglog(RC_CLASH, "IPv6 addresspool requires ikev2=insist");
+			return FALSE;
+		}
 
+		er = find_addresspool(&this->pool_range, &pool);
 		if (er != NULL) {
 			loglog(RC_CLASH, "leftaddresspool clash");
 			return FALSE;
@@ -1483,6 +1490,10 @@ void add_connection(const struct whack_message *wm)
 
 		c->name = wm->name;
 		c->connalias = wm->connalias;
+		c->from_config = wm->whack_config != WHACK_CONFIG_NONE;
+		passert(sizeof(c->config_digest) == sizeof(wm->config_digest));
+		memcpy(c->config_digest, wm->config_digest,
+		       sizeof(c->config_digest));
 		c->dnshostname = wm->dnshostname;
 		c->policy = wm->policy;
 		if (NEVER_NEGOTIATE(c->policy)) {
@@ -1751,13 +1762,13 @@ void add_connection(const struct whack_message *wm)
 		 * It is not necessary on the initiator
 		 */
 
-		if (wm->left.pool_range.start.u.v4.sin_addr.s_addr != 0) {
+		if (addrtypeof(&wm->left.pool_range.start) != AF_UNSPEC) {
 			/* there is address pool range add to the global list */
 			c->pool = install_addresspool(&wm->left.pool_range);
 			c->spd.that.modecfg_server = TRUE;
 			c->spd.this.modecfg_client = TRUE;
 		}
-		if (wm->right.pool_range.start.u.v4.sin_addr.s_addr != 0) {
+		if (addrtypeof(&wm->right.pool_range.start) != AF_UNSPEC) {
 			/* there is address pool range add to the global list */
 			c->pool = install_addresspool(&wm->right.pool_range);
 			c->spd.that.modecfg_client = TRUE;
@@ -1896,6 +1907,8 @@ void add_connection(const struct whack_message *wm)
 
 		/* ensure we allocate copies of all strings */
 		unshare_connection(c);
+		add_connection_to_db(c);
+		add_spd_routes_to_db(c);
 
 		(void)orient(c);
 
@@ -2012,6 +2025,8 @@ char *add_group_instance(struct connection *group, const ip_subnet *target,
 		/* add to connections list */
 		t->ac_next = connections;
 		connections = t;
+		add_connection_to_db(t);
+		add_spd_routes_to_db(t);
 
 		/* same host_pair as parent: stick after parent on list */
 		/* t->hp_next = group->hp_next; */	/* done by clone_thing */
@@ -2086,6 +2101,8 @@ struct connection *instantiate(struct connection *c, const ip_address *him,
 	/* set internal fields */
 	d->ac_next = connections;
 	connections = d;
+	add_connection_to_db(d);
+	add_spd_routes_to_db(d);
 	d->spd.routing = RT_UNROUTED;
 	d->newest_isakmp_sa = SOS_NOBODY;
 	d->newest_ipsec_sa = SOS_NOBODY;
@@ -2134,6 +2151,7 @@ struct connection *rw_instantiate(struct connection *c,
 		d->spd.that.client = *aftoinfo(subnettypeof(
 						&d->spd.that.client))->none;
 	}
+	rehash_spd_routes_in_db(d);
 	DBG(DBG_CONTROL, {
 		ipstr_buf b;
 		char inst[CONN_INST_BUF];
@@ -2260,15 +2278,20 @@ struct connection *find_connection_for_clients(struct spd_route **srp,
 			transport_proto, peer_port);
 	});
 
-	struct connection *c;
+	/* only spd routes with a .that.client containing peer_client */
+	struct spd_route_refs refs = { 0, 0, NULL, };
+	spd_routes_with_that_client_containing(&refs, peer_client);
+	sort_spd_route_refs(&refs);
+
+	for (unsigned i = 0; i < refs.nr; i++) {
+		struct connection *c = refs.refs[i].c;
 
-	for (c = connections; c != NULL; c = c->ac_next) {
 		if (c->kind == CK_GROUP)
 			continue;
 
-		struct spd_route *sr;
+		struct spd_route *sr = refs.refs[i].sr;
 
-		for (sr = &c->spd; best != c && sr; sr = sr->spd_next) {
+		if (best != c) {
 			if ((routed(sr->routing) ||
 					c->instance_initiation_ok) &&
 				addrinsubnet(our_client, &sr->this.client) &&
@@ -2343,6 +2366,7 @@ struct connection *find_connection_for_clients(struct spd_route **srp,
 			}
 		}
 	}
+	free_spd_route_refs(&refs);
 
 	if (best != NULL && NEVER_NEGOTIATE(best->policy))
 		best = NULL;
@@ -2417,6 +2441,7 @@ static struct connection *oppo_instantiate(struct connection *c,
 	passert(d->policy & POLICY_OPPORTUNISTIC);
 	passert(addrinsubnet(peer_client, &d->spd.that.client));
 	happy(addrtosubnet(peer_client, &d->spd.that.client));
+	rehash_spd_routes_in_db(d);
 
 	/* opportunistic connections do not use port selectors */
 	setportof(0, &d->spd.that.client.addr);
@@ -2593,7 +2618,16 @@ struct connection *route_owner(struct connection *c,
 	enum routing_t best_routing = cur_spd->routing,
 		best_erouting = best_routing;
 
-	for (struct connection *d = connections; d != NULL; d = d->ac_next) {
+	/* only spd routes with the same .that.client as one of c's */
+	struct spd_route_refs refs = { 0, 0, NULL, };
+	for (const struct spd_route *src = &c->spd; src != NULL;
+	     src = src->spd_next)
+		spd_routes_with_that_client(&refs, &src->that.client);
+	sort_spd_route_refs(&refs);
+
+	for (unsigned i = 0; i < refs.nr; i++) {
+		struct connection *d = refs.refs[i].c;
+
 		if (!oriented(*d))
 			continue;
 #ifdef KLIPS_MAST
@@ -2620,12 +2654,9 @@ struct connection *route_owner(struct connection *c,
 		     (c->sa_marks.out.val & c->sa_marks.out.mask) != (d->sa_marks.out.val & d->sa_marks.out.mask))
 			continue;
 
-		struct spd_route *srd;
-
-		for (srd = &d->spd; srd != NULL; srd = srd->spd_next) {
-			if (srd->routing == RT_UNROUTED)
-				continue;
+		struct spd_route *srd = refs.refs[i].sr;
 
+		if (srd->routing != RT_UNROUTED) {
 			const struct spd_route *src;
 
 			for (src = &c->spd; src != NULL; src = src->spd_next) {
@@ -2659,6 +2690,7 @@ struct connection *route_owner(struct connection *c,
 			}
 		}
 	}
+	free_spd_route_refs(&refs);
 
 	DBG(DBG_CONTROL, {
 		char cib[CONN_INST_BUF];
@@ -3420,10 +3452,22 @@ static bool is_virtual_net_used(struct connection *c,
 				const ip_subnet *peer_net,
 				const struct id *peer_id)
 {
-	struct connection *d;
 	char cbuf[CONN_INST_BUF];
 
-	for (d = connections; d != NULL; d = d->ac_next) {
+	/* only spd routes with a .that.client overlapping peer_net */
+	struct spd_route_refs refs = { 0, 0, NULL, };
+	spd_routes_with_that_client_overlapping(&refs, peer_net);
+	sort_spd_route_refs(&refs);
+
+	bool used = FALSE;
+
+	for (unsigned i = 0; !used && i < refs.nr; i++) {
+		struct connection *d = refs.refs[i].c;
+
+		/* only a connection's first spd route is checked */
+		if (refs.refs[i].sr != &d->spd)
+			continue;
+
 		switch (d->kind) {
 		case CK_PERMANENT:
 		case CK_TEMPLATE:
@@ -3453,7 +3497,8 @@ static bool is_virtual_net_used(struct connection *c,
 					libreswan_log(
 						"Kernel method '%s' does not support overlapping IP ranges",
 						kernel_if_name());
-					return TRUE;
+					used = TRUE;
+					break;
 
 				} else if (LIN(POLICY_OVERLAPIP, c->policy) &&
 					LIN(POLICY_OVERLAPIP, d->policy)) {
@@ -3492,7 +3537,7 @@ static bool is_virtual_net_used(struct connection *c,
 				idtoa(peer_id, buf, sizeof(buf));
 				libreswan_log("Your ID is '%s'", buf);
 
-				return TRUE; /* already used by another one */
+				used = TRUE; /* already used by another one */
 			}
 			break;
 		case CK_GOING_AWAY:
@@ -3500,7 +3545,8 @@ static bool is_virtual_net_used(struct connection *c,
 			break;
 		}
 	}
-	return FALSE; /* you can safely use it */
+	free_spd_route_refs(&refs);
+	return used; /* when FALSE, you can safely use it */
 }
 
 /*
@@ -4426,28 +4472,33 @@ struct connection *eclipsed(const struct connection *c, struct spd_route **esrp
 
 	/* ??? this logic seems broken: it doesn't try all spd_routes of c */
 
-	struct connection *ue;
+	/* only spd routes with the same .that.client as one of c's */
+	struct spd_route_refs refs = { 0, 0, NULL, };
+	const struct spd_route *src;
 
-	for (ue = connections; ue != NULL; ue = ue->ac_next) {
-		struct spd_route *srue;
+	for (src = &c->spd; src != NULL; src = src->spd_next)
+		spd_routes_with_that_client(&refs, &src->that.client);
+	sort_spd_route_refs(&refs);
 
-		for (srue = &ue->spd; srue != NULL; srue =srue->spd_next) {
-			const struct spd_route *src;
+	for (unsigned i = 0; i < refs.nr; i++) {
+		struct connection *ue = refs.refs[i].c;
+		struct spd_route *srue = refs.refs[i].sr;
 
-			for (src = &c->spd; src != NULL; src = src->spd_next) {
-				if (srue->routing == RT_ROUTED_ECLIPSED &&
-				    samesubnet(&src->this.client, &srue->this.client) &&
-				    samesubnet(&src->that.client, &srue->that.client))
-				{
-					DBG(DBG_CONTROLMORE,
-						DBG_log("%s eclipsed %s",
-							c->name, ue->name));
-					*esrp = srue;
-					return ue;
-				}
+		for (src = &c->spd; src != NULL; src = src->spd_next) {
+			if (srue->routing == RT_ROUTED_ECLIPSED &&
+			    samesubnet(&src->this.client, &srue->this.client) &&
+			    samesubnet(&src->that.client, &srue->that.client))
+			{
+				DBG(DBG_CONTROLMORE,
+					DBG_log("%s eclipsed %s",
+						c->name, ue->name));
+				free_spd_route_refs(&refs);
+				*esrp = srue;
+				return ue;
 			}
 		}
 	}
+	free_spd_route_refs(&refs);
 	*esrp = NULL;
 	return NULL;
 }
@@ -137,6 +137,7 @@ extern void fmt_policy_prio(policy_prio_t pp, char buf[POLICY_PRIO_BUF]);
 #include <sys/queue.h>
 #include "id.h"    /* for struct id */
 #include "lmod.h"
+#include "list_entry.h"
 
 struct virtual_t;
 
@@ -298,6 +299,12 @@ struct connection {
 	lmod_t extra_debugging;
 	lmod_t extra_impairing;
 
+	/* for connections from ipsec.conf; see reload.c */
+	bool from_config;
+	unsigned char config_digest[32];	/* WHACK_CONFIG_DIGEST_SIZE */
+	unsigned long config_seen;	/* the last reload to send it */
+	unsigned long config_loaded;	/* the last reload to (re)add it */
+
 	/* note: if the client is the gateway, the following must be equal */
 	sa_family_t addr_family;	/* between gateways */
 	sa_family_t tunnel_addr_family;	/* between clients */
@@ -324,6 +331,16 @@ struct connection {
 
 	struct connection *ac_next;	/* all connections list link */
 
+	/* connection_db linkage */
+	struct list_entry name_entry;
+	struct connection_alias *aliases;
+	unsigned nr_aliases;
+
+	/* spd_db linkage */
+	unsigned long spd_db_serial;
+	struct spd_db_entry *spd_db_entries;
+	unsigned nr_spd_db_entries;
+
 	enum send_ca_policy send_ca;
 	char *dnshostname;
 
@@ -515,6 +532,7 @@ extern void host_pair_enqueue_pending(const struct connection *c,
 struct pending **host_pair_first_pending(const struct connection *c);
 
 void connection_check_ddns(void);
+void connections_dns_answered(void);
 
 void connection_check_phase2(void);
 void init_connections(void);
@@ -99,6 +99,28 @@ struct dh_secret *calc_dh_secret(const struct oakley_group_desc *group,
 	return secret;
 }
 
+/*
+ * An independent copy of SECRET; NSS duplicates the private key's
+ * PKCS#11 object.
+ */
+struct dh_secret *clone_dh_secret(const struct dh_secret *secret)
+{
+	SECKEYPrivateKey *privk = SECKEY_CopyPrivateKey(secret->privk);
+	SECKEYPublicKey *pubk = SECKEY_CopyPublicKey(secret->pubk);
+	if (privk == NULL || pubk == NULL) {
+		if (privk != NULL)
+			SECKEY_DestroyPrivateKey(privk);
+		if (pubk != NULL)
+			SECKEY_DestroyPublicKey(pubk);
+		return NULL;
+	}
+	struct dh_secret *clone = alloc_thing(struct dh_secret, "DH secret");
+	clone->group = secret->group;
+	clone->privk = privk;
+	clone->pubk = pubk;
+	return clone;
+}
+
 /** Compute DH shared secret from our local secret and the peer's public value.
  * We make the leap that the length should be that of the group
  * (see quoted passage at start of ACCEPT_KE).
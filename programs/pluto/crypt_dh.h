@@ -31,6 +31,7 @@
 #include <pk11pub.h>
 
 #include "chunk.h"
+#include "deltatime.h"
 
 struct oakley_group_desc;
 struct state;
@@ -44,6 +45,8 @@ struct dh_secret;
 struct dh_secret *calc_dh_secret(const struct oakley_group_desc *group,
 				 chunk_t *ke);
 
+struct dh_secret *clone_dh_secret(const struct dh_secret *secret);
+
 PK11SymKey *calc_dh_shared(struct dh_secret *secret,
 			   chunk_t remote_ke);
 
@@ -55,4 +58,23 @@ void transfer_dh_secret_to_helper(struct state *st,
 
 void free_dh_secret(struct dh_secret **secret);
 
+/*
+ * Pools of pre-computed DH secrets, one per group; see
+ * crypt_dh_pool.c.
+ */
+
+extern unsigned dh_pool_size;		/* per group; 0 disables */
+extern deltatime_t dh_reuse_time;	/* 0 disables */
+extern unsigned long dh_reuse_limit;	/* 0 means no limit */
+
+/* MUST BE THREAD-SAFE */
+struct dh_secret *get_dh_secret(const struct oakley_group_desc *group,
+				chunk_t *ke, bool reusable);
+
+/* IN A HELPER THREAD; returns FALSE when there was nothing to do */
+bool refill_dh_pool(void);
+
+void show_dh_pool_status(void);
+void free_dh_pools(void);
+
 #endif
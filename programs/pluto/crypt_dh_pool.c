@@ -0,0 +1,255 @@
+/*
+ * Pools of pre-computed DH secrets, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <pthread.h>
+
+#include <libreswan.h>
+
+#include "sysdep.h"
+#include "constants.h"
+#include "defs.h"
+#include "lswlog.h"
+#include "log.h"
+#include "ike_alg.h"
+#include "monotime.h"
+#include "crypt_dh.h"
+
+/*
+ * Generating a DH secret (especially MODP) is the most expensive part
+ * of KE; do it before it is needed.
+ *
+ * A group's pool is created the first time a secret for that group
+ * is requested, so only groups that are actually negotiated get
+ * pre-computed.  Idle helpers then top each pool up to DH_POOL_SIZE.
+ *
+ * A responder may also re-use its secret for a while (RFC 7296
+ * 2.12); each state gets its own copy so ownership is unchanged.
+ */
+
+unsigned dh_pool_size = 4;
+deltatime_t dh_reuse_time = DELTATIME(0);
+unsigned long dh_reuse_limit = 0;
+
+struct dh_keypair {
+	struct dh_secret *secret;
+	chunk_t ke;
+};
+
+struct dh_pool {
+	const struct oakley_group_desc *group;	/* NULL until first used */
+	struct dh_keypair *keypairs;		/* DH_POOL_SIZE of them */
+	unsigned nr_keypairs;
+	unsigned nr_refilling;			/* being computed by helpers */
+	/* the responder's shared secret */
+	struct dh_keypair reuse;
+	monotime_t reuse_expires;
+	unsigned long reuse_count;
+	/* statistics */
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long reuses;
+};
+
+/* everything below is protected by DH_POOL_MUTEX */
+static pthread_mutex_t dh_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct dh_pool dh_pools[OAKLEY_GROUP_ROOF];
+
+static void free_dh_keypair(struct dh_keypair *kp)
+{
+	if (kp->secret != NULL)
+		free_dh_secret(&kp->secret);
+	freeanychunk(kp->ke);
+}
+
+/* find, and if needed create, GROUP's pool */
+static struct dh_pool *dh_pool(const struct oakley_group_desc *group)
+{
+	if (group->group >= elemsof(dh_pools))
+		return NULL;
+	struct dh_pool *pool = &dh_pools[group->group];
+	if (pool->group == NULL) {
+		pool->group = group;
+		if (dh_pool_size > 0)
+			pool->keypairs = alloc_things(struct dh_keypair,
+						      dh_pool_size,
+						      "DH pool keypairs");
+	}
+	return pool;
+}
+
+static bool reuse_expired(const struct dh_pool *pool)
+{
+	if (deltasecs(dh_reuse_time) > 0 &&
+	    !monobefore(mononow(), pool->reuse_expires))
+		return TRUE;
+	if (dh_reuse_limit > 0 && pool->reuse_count >= dh_reuse_limit)
+		return TRUE;
+	return FALSE;
+}
+
+/*
+ * Return a secret, and its KE, for GROUP.  When REUSABLE (only the
+ * responder's IKE SA secret is) the secret may be shared with other
+ * exchanges.
+ */
+
+struct dh_secret *get_dh_secret(const struct oakley_group_desc *group,
+				chunk_t *ke, bool reusable)
+{
+	bool reuse = reusable &&
+		(deltasecs(dh_reuse_time) > 0 || dh_reuse_limit > 0);
+	struct dh_secret *secret = NULL;
+	struct dh_keypair expired = { NULL, { NULL, 0 } };
+
+	pthread_mutex_lock(&dh_pool_mutex);
+	struct dh_pool *pool = dh_pool(group);
+	if (pool != NULL && reuse && pool->reuse.secret != NULL) {
+		if (reuse_expired(pool)) {
+			expired = pool->reuse;
+			pool->reuse = (struct dh_keypair) { NULL, { NULL, 0 } };
+		} else {
+			secret = clone_dh_secret(pool->reuse.secret);
+			if (secret != NULL) {
+				clonetochunk(*ke, pool->reuse.ke.ptr,
+					     pool->reuse.ke.len, "local ke");
+				pool->reuse_count++;
+				pool->reuses++;
+			}
+		}
+	}
+	bool shared = (secret != NULL);
+	if (!shared && pool != NULL) {
+		if (pool->nr_keypairs > 0) {
+			struct dh_keypair *kp =
+				&pool->keypairs[--pool->nr_keypairs];
+			secret = kp->secret;
+			*ke = kp->ke;
+			*kp = (struct dh_keypair) { NULL, { NULL, 0 } };
+			pool->hits++;
+		} else {
+			pool->misses++;
+		}
+	}
+	pthread_mutex_unlock(&dh_pool_mutex);
+
+	free_dh_keypair(&expired);
+
+	if (shared) {
+		DBG(DBG_CRYPT,
+		    DBG_log("re-using %s DH secret", group->common.name));
+		return secret;
+	}
+
+	if (secret == NULL)
+		secret = calc_dh_secret(group, ke);
+
+	if (pool != NULL && reuse) {
+		struct dh_keypair kp = {
+			.secret = clone_dh_secret(secret),
+		};
+		if (kp.secret != NULL) {
+			clonetochunk(kp.ke, ke->ptr, ke->len,
+				     "shared local ke");
+			pthread_mutex_lock(&dh_pool_mutex);
+			if (pool->reuse.secret == NULL) {
+				pool->reuse = kp;
+				pool->reuse_expires = monotimesum(mononow(),
+								  dh_reuse_time);
+				pool->reuse_count = 1;
+				kp = (struct dh_keypair) { NULL, { NULL, 0 } };
+			}
+			pthread_mutex_unlock(&dh_pool_mutex);
+			free_dh_keypair(&kp);
+		}
+	}
+	return secret;
+}
+
+bool refill_dh_pool(void)
+{
+	/* the emptiest pool first */
+	struct dh_pool *pool = NULL;
+	const struct oakley_group_desc *group = NULL;
+	pthread_mutex_lock(&dh_pool_mutex);
+	for (unsigned g = 0; g < elemsof(dh_pools); g++) {
+		struct dh_pool *p = &dh_pools[g];
+		unsigned have = p->nr_keypairs + p->nr_refilling;
+		if (p->keypairs != NULL && have < dh_pool_size &&
+		    (pool == NULL ||
+		     have < pool->nr_keypairs + pool->nr_refilling)) {
+			pool = p;
+		}
+	}
+	if (pool != NULL) {
+		pool->nr_refilling++;
+		group = pool->group;
+	}
+	pthread_mutex_unlock(&dh_pool_mutex);
+
+	if (pool == NULL)
+		return FALSE;
+
+	struct dh_keypair kp;
+	kp.secret = calc_dh_secret(group, &kp.ke);
+
+	pthread_mutex_lock(&dh_pool_mutex);
+	pool->nr_refilling--;
+	if (pool->keypairs != NULL && pool->nr_keypairs < dh_pool_size) {
+		pool->keypairs[pool->nr_keypairs++] = kp;
+		kp = (struct dh_keypair) { NULL, { NULL, 0 } };
+	}
+	pthread_mutex_unlock(&dh_pool_mutex);
+
+	free_dh_keypair(&kp);
+	return TRUE;
+}
+
+void show_dh_pool_status(void)
+{
+	pthread_mutex_lock(&dh_pool_mutex);
+	for (unsigned g = 0; g < elemsof(dh_pools); g++) {
+		const struct dh_pool *pool = &dh_pools[g];
+		if (pool->group == NULL)
+			continue;
+		const char *name = pool->group->common.name;
+		whack_log_comment("current.dh.pool.%s.keypairs=%u",
+				  name, pool->nr_keypairs);
+		whack_log_comment("total.dh.pool.%s.hits=%lu",
+				  name, pool->hits);
+		whack_log_comment("total.dh.pool.%s.misses=%lu",
+				  name, pool->misses);
+		whack_log_comment("total.dh.pool.%s.reuses=%lu",
+				  name, pool->reuses);
+	}
+	pthread_mutex_unlock(&dh_pool_mutex);
+}
+
+void free_dh_pools(void)
+{
+	pthread_mutex_lock(&dh_pool_mutex);
+	for (unsigned g = 0; g < elemsof(dh_pools); g++) {
+		struct dh_pool *pool = &dh_pools[g];
+		if (pool->keypairs != NULL) {
+			for (unsigned i = 0; i < pool->nr_keypairs; i++)
+				free_dh_keypair(&pool->keypairs[i]);
+			pfree(pool->keypairs);
+			pool->keypairs = NULL;
+		}
+		pool->nr_keypairs = 0;
+		free_dh_keypair(&pool->reuse);
+		/* stops any further refills */
+		pool->group = NULL;
+	}
+	pthread_mutex_unlock(&dh_pool_mutex);
+}
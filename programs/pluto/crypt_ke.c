@@ -62,7 +62,7 @@ void calc_ke(struct pcr_kenonce *kn)
 {
 	const struct oakley_group_desc *group = kn->group;
 
-	kn->secret = calc_dh_secret(kn->group, &kn->gi);
+	kn->secret = get_dh_secret(kn->group, &kn->gi, kn->reusable);
 
 	DBG(DBG_CRYPT,
 	    DBG_log("NSS: Local DH %s secret (pointer): %p",
@@ -102,6 +102,19 @@ void request_ke_and_nonce(const char *name,
 	send_crypto_helper_request(st, cn);
 }
 
+/* as above, but the responder's KE may be shared with other exchanges */
+void request_responder_ke_and_nonce(const char *name,
+				    struct state *st,
+				    const struct oakley_group_desc *group,
+				    crypto_req_cont_func *callback)
+{
+	struct pluto_crypto_req_cont *cn = new_pcrc(callback, name);
+	struct pcr_kenonce *kn = pcr_kenonce_init(cn, pcr_build_ke_and_nonce,
+						  group);
+	kn->reusable = TRUE;
+	send_crypto_helper_request(st, cn);
+}
+
 void request_nonce(const char *name,
 		   struct state *st,
 		   crypto_req_cont_func *callback)
@@ -0,0 +1,161 @@
+/*
+ * Cryptographic helper function - RSA signatures
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ */
+
+#include <libreswan.h>
+
+#include "sysdep.h"
+#include "constants.h"
+#include "defs.h"
+#include "lswlog.h"
+#include "log.h"
+#include "id.h"
+#include "connections.h"
+#include "state.h"
+#include "pluto_crypt.h"
+#include "keys.h"
+#include "secrets.h"
+
+#include <secitem.h>
+
+/*
+ * Signing.
+ *
+ * The private key belongs to the secrets list, which can be reloaded
+ * while the helper is busy, so the helper gets its own copy of the
+ * parts sign_hash() needs.
+ */
+
+void start_rsa_sign(struct state *st, const char *name,
+		    const struct RSA_private_key *k,
+		    const u_char *hash_val, size_t hash_len,
+		    crypto_req_cont_func *pcrc_func)
+{
+	struct pluto_crypto_req_cont *cn = new_pcrc(pcrc_func, name);
+	struct pcr_rsa_sign *rs = pcr_rsa_sign_init(cn);
+
+	rs->key = alloc_thing(struct RSA_private_key, "RSA private key copy");
+	memcpy(rs->key->pub.keyid, k->pub.keyid, sizeof(k->pub.keyid));
+	rs->key->pub.k = k->pub.k;
+	rs->key->pub.ckaid.nss = SECITEM_DupItem(k->pub.ckaid.nss);
+	clonetochunk(rs->hash, hash_val, hash_len, "RSA hash to sign");
+
+	send_crypto_helper_request(st, cn);
+}
+
+void calc_rsa_sign(struct pcr_rsa_sign *rs)
+{
+	size_t sz = rs->key->pub.k;
+	u_char sig_val[RSA_MAX_OCTETS];
+
+	passert(sz <= sizeof(sig_val));
+	int shr = sign_hash(rs->key, rs->hash.ptr, rs->hash.len, sig_val, sz);
+	if (shr > 0) {
+		passert(shr == (int)sz);
+		clonetochunk(rs->sig, sig_val, sz, "RSA signature");
+	}
+}
+
+static void free_rsa_sign_key(struct pcr_rsa_sign *rs)
+{
+	if (rs->key != NULL) {
+		freeanyckaid(&rs->key->pub.ckaid);
+		pfree(rs->key);
+		rs->key = NULL;
+	}
+	freeanychunk(rs->hash);
+}
+
+/* returns FALSE, with SIG empty, when signing failed */
+bool finish_rsa_sign(struct pluto_crypto_req *r, chunk_t *sig)
+{
+	struct pcr_rsa_sign *rs = &r->pcr_d.rsa_sign;
+	passert(r->pcr_type == pcr_rsa_sign);
+
+	free_rsa_sign_key(rs);
+	*sig = rs->sig;
+	rs->sig = empty_chunk;
+	return sig->ptr != NULL;
+}
+
+void cancelled_rsa_sign(struct pcr_rsa_sign *rs)
+{
+	free_rsa_sign_key(rs);
+	freeanychunk(rs->sig);
+}
+
+/*
+ * Verifying.
+ *
+ * The candidate keys are referenced so they can't be deleted while
+ * the helper is looking at them.
+ */
+
+void start_rsa_verify(struct state *st, const char *name,
+		      const u_char *hash_val, size_t hash_len,
+		      const u_char *sig_val, size_t sig_len,
+		      crypto_req_cont_func *pcrc_func)
+{
+	struct pluto_crypto_req_cont *cn = new_pcrc(pcrc_func, name);
+	struct pcr_rsa_verify *rv = pcr_rsa_verify_init(cn);
+
+	rv->keys = RSA_signature_candidates(st->st_connection, &rv->nr_keys);
+	if (rv->nr_keys > 0) {
+		rv->ughs = alloc_things(err_t, rv->nr_keys,
+					"RSA signature results");
+	}
+	clonetochunk(rv->hash, hash_val, hash_len, "RSA hash to verify");
+	clonetochunk(rv->sig, sig_val, sig_len, "RSA signature to verify");
+
+	DBG(DBG_CONTROL,
+	    DBG_log("checking RSA signature against %u candidate keys",
+		    rv->nr_keys));
+
+	send_crypto_helper_request(st, cn);
+}
+
+void calc_rsa_verify(struct pcr_rsa_verify *rv)
+{
+	for (rv->nr_tried = 0; rv->nr_tried < rv->nr_keys; ) {
+		const struct RSA_public_key *k =
+			&rv->keys[rv->nr_tried]->u.rsa;
+		err_t ugh = try_RSA_signature_nss(k, rv->hash.ptr, rv->hash.len,
+						  rv->sig.ptr, rv->sig.len);
+		rv->ughs[rv->nr_tried++] = ugh;
+		if (ugh == NULL) {
+			break;
+		}
+	}
+}
+
+void cancelled_rsa_verify(struct pcr_rsa_verify *rv)
+{
+	release_RSA_signature_candidates(&rv->keys, rv->nr_keys);
+	pfreeany(rv->ughs);
+	rv->ughs = NULL;
+	freeanychunk(rv->hash);
+	freeanychunk(rv->sig);
+}
+
+/* logs the outcome and, on success, updates ST's peer key */
+stf_status finish_rsa_verify(struct state *st, struct pluto_crypto_req *r)
+{
+	struct pcr_rsa_verify *rv = &r->pcr_d.rsa_verify;
+	passert(r->pcr_type == pcr_rsa_verify);
+
+	stf_status stat = RSA_check_signature_results(st, rv->keys, rv->ughs,
+						      rv->nr_tried);
+	cancelled_rsa_verify(rv);
+	return stat;
+}
@@ -23,6 +23,9 @@
  * (all the code that used to be here is now in ikev1.c)
  */
 
+#if defined(linux)
+# define _GNU_SOURCE	/* for recvmmsg() */
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -68,6 +71,7 @@
 
 #include "ip_address.h"
 #include "pluto_stats.h"
+#include "metrics.h"
 
 /* This file does basic header checking and demux of
  * incoming packets.
@@ -80,131 +84,114 @@ void init_demux(void)
 }
 
 /*
- * read the message.
+ * Reading packets.
+ *
+ * Since we don't know a message's size, it is read into an overly
+ * large buffer and then copied to a new, properly sized buffer.
  *
- * Since we don't know its size, we read it into an overly large
- * buffer and then copy it to a new, properly sized buffer.
+ * Where recvmmsg() is available, up to MAX_READ_BATCH messages are
+ * read per wakeup.
  */
 
-static struct msg_digest *read_packet(const struct iface_port *ifp)
-{
-	int packet_len;
-	/* ??? this buffer seems *way* too big */
-	u_int8_t bigbuffer[MAX_INPUT_UDP_SIZE];
-
-	u_int8_t *_buffer = bigbuffer;
-	union {
-		struct sockaddr sa;
-		struct sockaddr_in sa_in4;
-		struct sockaddr_in6 sa_in6;
-	} from
-#if defined(HAVE_UDPFROMTO)
-	, to
-#endif
-	;
-	socklen_t from_len = sizeof(from);
-#if defined(HAVE_UDPFROMTO)
-	socklen_t to_len   = sizeof(to);
+#if defined(linux)
+# define MAX_READ_BATCH 32
+#else
+# define MAX_READ_BATCH 1
 #endif
-	err_t from_ugh = NULL;
-	static const char undisclosed[] = "unknown source";
 
-	ip_address sender;
-	happy(anyaddr(addrtypeof(&ifp->ip_addr), &sender));
-	zero(&from.sa);
+/* ??? these buffers seem *way* too big */
+static u_int8_t read_buffers[MAX_READ_BATCH][MAX_INPUT_UDP_SIZE];
 
-#if defined(HAVE_UDPFROMTO)
-	packet_len = recvfromto(ifp->fd, bigbuffer,
-				sizeof(bigbuffer), /*flags*/ 0,
-				&from.sa, &from_len,
-				&to.sa, &to_len);
-#else
-	packet_len = recvfrom(ifp->fd, bigbuffer,
-			      sizeof(bigbuffer), /*flags*/ 0,
-			      &from.sa, &from_len);
-#endif
+union packet_sockaddr {
+	struct sockaddr sa;
+	struct sockaddr_in sa_in4;
+	struct sockaddr_in6 sa_in6;
+};
 
-	/* we do not do anything with *to* addresses yet... we will */
+static const char undisclosed[] = "unknown source";
 
-	/* First: digest the from address.
-	 * We presume that nothing here disturbs errno.
-	 */
-	if (packet_len == -1 &&
-	    from_len == sizeof(from) &&
-	    all_zero((const void *)&from.sa, sizeof(from))) {
-		/* "from" is untouched -- not set by recvfrom */
-		from_ugh = undisclosed;
-	} else if (from_len   <
-		   (int) (offsetof(struct sockaddr,
-				   sa_family) + sizeof(from.sa.sa_family))) {
-		from_ugh = "truncated";
-	} else {
-		const struct af_info *afi = aftoinfo(from.sa.sa_family);
+/* digest the from address */
+static err_t decode_sender(const union packet_sockaddr *from,
+			   socklen_t from_len, ip_address *sender)
+{
+	if (from_len   <
+	    (int) (offsetof(struct sockaddr,
+			    sa_family) + sizeof(from->sa.sa_family))) {
+		return "truncated";
+	}
 
-		if (afi == NULL) {
-			from_ugh = "unexpected Address Family";
-		} else if (from_len != afi->sa_sz) {
-			from_ugh = "wrong length";
-		} else {
-			switch (from.sa.sa_family) {
-			case AF_INET:
-				from_ugh = initaddr(
-					(void *) &from.sa_in4.sin_addr,
-					sizeof(from.sa_in4.sin_addr),
-					AF_INET, &sender);
-				setportof(from.sa_in4.sin_port, &sender);
-				break;
-			case AF_INET6:
-				from_ugh = initaddr(
-					(void *) &from.sa_in6.sin6_addr,
-					sizeof(from.sa_in6.
-					       sin6_addr),
-					AF_INET6, &sender);
-				setportof(from.sa_in6.sin6_port, &sender);
-				break;
-			}
-		}
+	const struct af_info *afi = aftoinfo(from->sa.sa_family);
+
+	if (afi == NULL) {
+		return "unexpected Address Family";
+	} else if (from_len != afi->sa_sz) {
+		return "wrong length";
 	}
 
-	/* now we report any actual I/O error */
-	if (packet_len == -1) {
-		if (from_ugh == undisclosed &&
-		    errno == ECONNREFUSED) {
-			/* Tone down scary message for vague event:
-			 * We get "connection refused" in response to some
-			 * datagram we sent, but we cannot tell which one.
-			 */
-			libreswan_log(
-				"some IKE message we sent has been rejected with ECONNREFUSED (kernel supplied no details)");
-		} else if (from_ugh != NULL) {
-			LSWLOG_ERRNO(errno, buf) {
-				lswlogf(buf, "recvfrom on %s failed; Pluto cannot decode source sockaddr in rejection: %s",
-					ifp->ip_dev->id_rname, from_ugh);
-			}
-		} else {
-			LSWLOG_ERRNO(errno, buf) {
-				lswlogf(buf, "recvfrom on %s from ",
-					ifp->ip_dev->id_rname);
-				lswlog_ip(buf, &sender);
-				lswlogs(buf, " failed");
-			}
-		}
+	err_t from_ugh = NULL;
+	switch (from->sa.sa_family) {
+	case AF_INET:
+		from_ugh = initaddr(
+			(const void *) &from->sa_in4.sin_addr,
+			sizeof(from->sa_in4.sin_addr),
+			AF_INET, sender);
+		setportof(from->sa_in4.sin_port, sender);
+		break;
+	case AF_INET6:
+		from_ugh = initaddr(
+			(const void *) &from->sa_in6.sin6_addr,
+			sizeof(from->sa_in6.
+			       sin6_addr),
+			AF_INET6, sender);
+		setportof(from->sa_in6.sin6_port, sender);
+		break;
+	}
+	return from_ugh;
+}
 
-		return NULL;
-	} else if (from_ugh != NULL) {
+/* report an actual I/O error */
+static void log_read_error(const struct iface_port *ifp, int error,
+			   err_t from_ugh, const ip_address *sender)
+{
+	if (from_ugh == undisclosed &&
+	    error == ECONNREFUSED) {
+		/* Tone down scary message for vague event:
+		 * We get "connection refused" in response to some
+		 * datagram we sent, but we cannot tell which one.
+		 */
 		libreswan_log(
-			"recvfrom on %s returned malformed source sockaddr: %s",
-			ifp->ip_dev->id_rname, from_ugh);
-		return NULL;
+			"some IKE message we sent has been rejected with ECONNREFUSED (kernel supplied no details)");
+	} else if (from_ugh != NULL) {
+		LSWLOG_ERRNO(error, buf) {
+			lswlogf(buf, "recvfrom on %s failed; Pluto cannot decode source sockaddr in rejection: %s",
+				ifp->ip_dev->id_rname, from_ugh);
+		}
+	} else {
+		LSWLOG_ERRNO(error, buf) {
+			lswlogf(buf, "recvfrom on %s from ",
+				ifp->ip_dev->id_rname);
+			lswlog_ip(buf, sender);
+			lswlogs(buf, " failed");
+		}
 	}
+}
 
+/*
+ * Strip and check any Non-ESP marker and then wrap the message up in
+ * a msg_digest.
+ */
+static struct msg_digest *digest_packet(const struct iface_port *ifp,
+					const ip_address *sender,
+					u_int8_t *_buffer, int packet_len,
+					monotime_t now)
+{
 	if (ifp->ike_float) {
 		u_int32_t non_esp;
 
 		if (packet_len < (int)sizeof(u_int32_t)) {
 			LSWLOG(buf) {
 				lswlogs(buf, "recvfrom ");
-				lswlog_ip(buf, &sender); /* sensitive? */
+				lswlog_ip(buf, sender); /* sensitive? */
 				lswlogf(buf, " too small packet (%d)",
 					packet_len);
 			}
@@ -214,7 +201,7 @@ static struct msg_digest *read_packet(const struct iface_port *ifp)
 		if (non_esp != 0) {
 			LSWLOG(buf) {
 				lswlogs(buf, "recvfrom ");
-				lswlog_ip(buf, &sender);
+				lswlog_ip(buf, sender);
 				lswlogs(buf, " has no Non-ESP marker");
 			}
 			return NULL;
@@ -236,7 +223,7 @@ static struct msg_digest *read_packet(const struct iface_port *ifp)
 			   NON_ESP_MARKER_SIZE)) {
 			LSWLOG(buf) {
 				lswlogs(buf, "Mangled packet with potential spurious non-esp marker ignored. Sender: ");
-				lswlog_ip(buf, &sender); /* sensitiv? */
+				lswlog_ip(buf, sender); /* sensitiv? */
 			}
 			return NULL;
 		}
@@ -250,7 +237,7 @@ static struct msg_digest *read_packet(const struct iface_port *ifp)
 		 */
 		LSWDBGP(DBG_NATT, buf) {
 			lswlogs(buf, "NAT-T keep-alive (boggus ?) should not reach this point. Ignored. Sender: ");
-			lswlog_ip(buf, &sender);
+			lswlog_ip(buf, sender);
 		};
 		return NULL;
 	}
@@ -262,17 +249,16 @@ static struct msg_digest *read_packet(const struct iface_port *ifp)
 	 */
 	struct msg_digest *md = alloc_md("msg_digest in read_packet");
 	md->iface = ifp;
-	md->sender = sender;
+	md->sender = *sender;
+	md->arrived = now;
 
-	init_pbs(&md->packet_pbs
-		 , clone_bytes(_buffer, packet_len,
-			       "message buffer in read_packet()")
-		 , packet_len, "packet");
+	init_md_packet(md, _buffer, packet_len,
+		       "message buffer in read_packet()");
 
 	LSWDBGP(DBG_RAW | DBG_CRYPT | DBG_PARSING | DBG_CONTROL, buf) {
 		lswlogf(buf, "*received %d bytes from ",
 			(int) pbs_room(&md->packet_pbs));
-		lswlog_ip(buf, &sender);
+		lswlog_ip(buf, sender);
 		lswlogf(buf, " on %s (port=%d)",
 			ifp->ip_dev->id_rname, ifp->port);
 	};
@@ -285,6 +271,150 @@ static struct msg_digest *read_packet(const struct iface_port *ifp)
 	return md;
 }
 
+#if MAX_READ_BATCH == 1
+
+/* read one message */
+static unsigned read_packets(const struct iface_port *ifp,
+			     struct msg_digest *mds[MAX_READ_BATCH])
+{
+	int packet_len;
+	u_int8_t *bigbuffer = read_buffers[0];
+
+	union packet_sockaddr from
+#if defined(HAVE_UDPFROMTO)
+	, to
+#endif
+	;
+	socklen_t from_len = sizeof(from);
+#if defined(HAVE_UDPFROMTO)
+	socklen_t to_len   = sizeof(to);
+#endif
+	err_t from_ugh = NULL;
+
+	ip_address sender;
+	happy(anyaddr(addrtypeof(&ifp->ip_addr), &sender));
+	zero(&from.sa);
+
+#if defined(HAVE_UDPFROMTO)
+	packet_len = recvfromto(ifp->fd, bigbuffer,
+				sizeof(read_buffers[0]), /*flags*/ 0,
+				&from.sa, &from_len,
+				&to.sa, &to_len);
+#else
+	packet_len = recvfrom(ifp->fd, bigbuffer,
+			      sizeof(read_buffers[0]), /*flags*/ 0,
+			      &from.sa, &from_len);
+#endif
+
+	/* we do not do anything with *to* addresses yet... we will */
+
+	/* First: digest the from address.
+	 * We presume that nothing here disturbs errno.
+	 */
+	if (packet_len == -1 &&
+	    from_len == sizeof(from) &&
+	    all_zero((const void *)&from.sa, sizeof(from))) {
+		/* "from" is untouched -- not set by recvfrom */
+		from_ugh = undisclosed;
+	} else {
+		from_ugh = decode_sender(&from, from_len, &sender);
+	}
+
+	/* now we report any actual I/O error */
+	if (packet_len == -1) {
+		log_read_error(ifp, errno, from_ugh, &sender);
+		return 0;
+	} else if (from_ugh != NULL) {
+		libreswan_log(
+			"recvfrom on %s returned malformed source sockaddr: %s",
+			ifp->ip_dev->id_rname, from_ugh);
+		return 0;
+	}
+
+	pstats_ike_recv_wakeups++;
+	pstats_ike_recv_packets++;
+	monotime_t now = mononow();
+	metrics_packets_received(now, 1);
+
+	mds[0] = digest_packet(ifp, &sender, bigbuffer, packet_len, now);
+	return mds[0] != NULL ? 1 : 0;
+}
+
+#else
+
+/* read up to MAX_READ_BATCH messages */
+static unsigned read_packets(const struct iface_port *ifp,
+			     struct msg_digest *mds[MAX_READ_BATCH])
+{
+	struct mmsghdr msgs[MAX_READ_BATCH];
+	struct iovec iovs[MAX_READ_BATCH];
+	union packet_sockaddr froms[MAX_READ_BATCH];
+#if defined(HAVE_UDPFROMTO)
+	char cbufs[MAX_READ_BATCH][UDPFROMTO_CMSG_SIZE];
+#endif
+
+	zero(&msgs);
+	zero(&froms);
+	for (unsigned i = 0; i < MAX_READ_BATCH; i++) {
+		iovs[i].iov_base = read_buffers[i];
+		iovs[i].iov_len = sizeof(read_buffers[i]);
+		msgs[i].msg_hdr.msg_name = &froms[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(froms[i]);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+#if defined(HAVE_UDPFROMTO)
+		msgs[i].msg_hdr.msg_control = cbufs[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cbufs[i]);
+#endif
+	}
+
+	int nr_msgs = recvmmsg(ifp->fd, msgs, MAX_READ_BATCH,
+			       MSG_DONTWAIT, NULL);
+	if (nr_msgs == -1) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			/* the kernel doesn't say who */
+			log_read_error(ifp, errno, undisclosed, NULL);
+		}
+		return 0;
+	}
+
+	pstats_ike_recv_wakeups++;
+	pstats_ike_recv_packets += nr_msgs;
+	monotime_t now = mononow();
+	metrics_packets_received(now, nr_msgs);
+
+	unsigned nr_mds = 0;
+	for (int i = 0; i < nr_msgs; i++) {
+		ip_address sender;
+		happy(anyaddr(addrtypeof(&ifp->ip_addr), &sender));
+		err_t from_ugh = decode_sender(&froms[i],
+					       msgs[i].msg_hdr.msg_namelen,
+					       &sender);
+		if (from_ugh != NULL) {
+			libreswan_log(
+				"recvmmsg on %s returned malformed source sockaddr: %s",
+				ifp->ip_dev->id_rname, from_ugh);
+			continue;
+		}
+
+#if defined(HAVE_UDPFROMTO)
+		/* we do not do anything with *to* addresses yet... we will */
+		union packet_sockaddr to;
+		socklen_t to_len = sizeof(to);
+		udpfromto_dest(ifp->fd, &msgs[i].msg_hdr, &to.sa, &to_len);
+#endif
+
+		struct msg_digest *md = digest_packet(ifp, &sender,
+						      read_buffers[i],
+						      msgs[i].msg_len, now);
+		if (md != NULL)
+			mds[nr_mds++] = md;
+	}
+	return nr_mds;
+}
+
+#endif
+
 /*
  * process an input packet, possibly generating a reply.
  *
@@ -396,7 +526,7 @@ static void process_md(struct msg_digest **mdp)
 	reset_cur_connection();
 }
 
-/* wrapper for read_packet and process_packet
+/* wrapper for read_packets and process_packet
  *
  * The main purpose of this wrapper is to factor out teardown code
  * from the many return points in process_packet.  This amounts to
@@ -406,8 +536,8 @@ static void process_md(struct msg_digest **mdp)
  * process_packet sets md to NULL to prevent the msg_digest being freed.
  * Someone else must ensure that msg_digest is freed eventually.
  *
- * read_packet is broken out to minimize the lifetime of the
- * enormous input packet buffer, an auto.
+ * All the packets are read before any are processed; each has its
+ * own copy of the message.
  */
 
 static bool incoming_impaired(void);
@@ -428,14 +558,17 @@ static void comm_handle(const struct iface_port *ifp)
 	if (!check_incoming_msg_errqueue(ifp, "read_packet"))
 		return; /* no normal message to read */
 
-	struct msg_digest *md = read_packet(ifp);
-	if (md != NULL) {
+	struct msg_digest *mds[MAX_READ_BATCH];
+	unsigned nr_mds = read_packets(ifp, mds);
+	for (unsigned i = 0; i < nr_mds; i++) {
+		struct msg_digest *md = mds[i];
 		if (incoming_impaired()) {
 			impair_incoming(&md);
 		} else {
 			process_md(&md);
 		}
 		pexpect(md == NULL);
+		pexpect_reset_globals();
 	}
 	pexpect_reset_globals();
 }
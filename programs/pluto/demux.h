@@ -69,14 +69,17 @@ struct payload_summary {
 };
 
 /* message digest
- * Note: raw_packet and packet_pbs are "owners" of space on heap.
+ * Note: raw_packet and packet_pbs are "owners" of space on heap;
+ * packet_pbs's space may be the pooled packet_buffer.
  */
 
 struct msg_digest {
 	struct msg_digest *next;		/* for free list */
+	u_int8_t *packet_buffer;		/* pooled; see alloc_md_packet() */
 	chunk_t raw_packet;			/* (v1) if encrypted, received packet before decryption */
 	const struct iface_port *iface;		/* interface on which message arrived */
 	ip_address sender;			/* where message came from (network order) */
+	monotime_t arrived;			/* when read; see metrics_transition() */
 	struct isakmp_hdr hdr;			/* message's header */
 	bool encrypted;				/* (v1) was it encrypted? */
 	enum state_kind from_state;		/* state we started in */
@@ -143,6 +146,10 @@ struct msg_digest {
 
 extern struct msg_digest *alloc_md(const char *mdname);
 struct msg_digest *clone_md(struct msg_digest *md, const char *name);
+/* space for, or a copy of, MD's packet; release_md() frees it */
+void *alloc_md_packet(struct msg_digest *md, size_t size, const char *name);
+void init_md_packet(struct msg_digest *md, const void *bytes, size_t size,
+		    const char *name);
 extern void release_md(struct msg_digest *md);
 extern void release_any_md(struct msg_digest **mdp);
 void schedule_md_event(const char *name, struct msg_digest *md);
@@ -155,6 +162,7 @@ extern void fmt_isakmp_sa_established(struct state *st,
 				      char *sadetails, size_t sad_len);
 
 extern void free_md_pool(void);
+extern void show_md_pool_status(void);
 
 extern void process_packet(struct msg_digest **mdp);
 
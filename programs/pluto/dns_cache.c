@@ -0,0 +1,525 @@
+/* asynchronous host name lookups, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * A connection can name its peer (and even itself) using a host
+ * name.  Resolving that with ttoaddr(), which calls gethostbyname2(),
+ * stops the event loop for as long as the resolver takes: with lots
+ * of connections, or an unresponsive name server, that is seconds.
+ *
+ * Only a name's first lookup, when the connection is loaded, still
+ * blocks (so that whack sees the answer, and a following --up or
+ * --route has an address to work with).  After that the main thread
+ * only ever consults this cache.  When the
+ * name isn't there, or the answer is out of date, the lookup is
+ * handed to a resolver thread and the caller carries on with what is
+ * known (nothing, or the previous answer).  The answers are passed
+ * back to the main thread in batches, cached, and then
+ * connections_dns_answered() revisits the connections using those
+ * names.
+ *
+ * getaddrinfo() doesn't reveal the record's TTL so answers are kept
+ * for a fixed time; failures for less.
+ */
+
+#include <pthread.h>	/* Must be the first include file */
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+
+#include "libreswan.h"
+#include "ip_address.h"
+#include "lswalloc.h"
+#include "lswlog.h"
+#include "constants.h"
+#include "defs.h"
+#include "log.h"		/* for whack_log_comment() */
+#include "server.h"		/* for pluto_event_now() */
+#include "connections.h"	/* for connections_dns_answered() */
+#include "hash_table.h"
+#include "dns_cache.h"
+
+#define DNS_FOUND_TTL secs_per_minute
+#define DNS_FAILED_TTL 10	/* seconds */
+
+/* lookups that can be outstanding before the next one waits */
+#define DNS_RESOLVER_THREADS 4
+
+/*
+ * Entries that have expired and haven't been asked for in this long
+ * are dropped (a connection that resolved its peer doesn't ask
+ * again); the next lookup of the name just misses.  Looked for at
+ * most once a sweep interval, when a name is added.
+ */
+#define DNS_IDLE_TIME (10 * secs_per_minute)
+#define DNS_SWEEP_INTERVAL secs_per_minute
+
+/* the hash table's initial size; it grows (and shrinks) with use */
+#define DNS_TABLE_SIZE 64
+
+struct dns_entry {
+	char *name;
+	int af;
+
+	/* the cached answer; main thread only */
+	enum dns_answer answer;
+	ip_address addr;
+	err_t ugh;
+	monotime_t expires;
+	monotime_t used;	/* last dns_lookup() */
+	unsigned batch;		/* answered in this batch */
+	bool outstanding;	/* queued, resolving, or answered */
+	monotime_t started;
+	struct list_entry entry;
+	struct dns_entry *all_next;
+
+	/* protected by dns_mutex */
+	bool resolving;		/* a resolver thread has it */
+	struct dns_entry *next;	/* on requests or answers */
+
+	/* the lookup result; written by the thread while .resolving */
+	ip_address new_addr;
+	err_t new_ugh;
+};
+
+static pthread_mutex_t dns_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dns_cond = PTHREAD_COND_INITIALIZER;
+static struct dns_entry *requests;		/* oldest first */
+static struct dns_entry **requests_tail = &requests;
+static struct dns_entry *answers;
+static bool stopping;
+
+/* main thread only */
+static struct dns_entry *all_entries;
+static unsigned nr_entries;
+static unsigned nr_threads;
+static unsigned nr_outstanding;
+static unsigned batch;
+static monotime_t last_sweep;
+
+static unsigned long total_hits;
+static unsigned long total_stale;
+static unsigned long total_misses;
+static unsigned long total_queries;
+static unsigned long total_found;
+static unsigned long total_failed;
+static unsigned long total_batches;
+static unsigned long total_evicted;
+static intmax_t total_latency_ms;
+static intmax_t max_latency_ms;
+
+static size_t log_dns_entry(struct lswlog *buf, void *data)
+{
+	struct dns_entry *e = data;
+	return lswlogf(buf, "DNS %s", e->name);
+}
+
+/* only the name is hashed so dns_answered() can find all families */
+static size_t dns_entry_hash(void *data)
+{
+	struct dns_entry *e = data;
+	return hash_table_bytes(e->name, strlen(e->name));
+}
+
+static struct list_head dns_hash_slots[DNS_TABLE_SIZE];
+static struct hash_table dns_hash_table = {
+	.info = {
+		.debug = DBG_DNS,
+		.name = "DNS cache",
+		.log = log_dns_entry,
+	},
+	.hash = dns_entry_hash,
+	.nr_slots = DNS_TABLE_SIZE,
+	.slots = dns_hash_slots,
+};
+
+static struct list_head *dns_name_slot(const char *name)
+{
+	return hash_table_slot_by_hash(&dns_hash_table,
+				       hash_table_bytes(name, strlen(name)));
+}
+
+static struct dns_entry *find_dns_entry(const char *name, int af)
+{
+	struct dns_entry *e;
+	FOR_EACH_LIST_ENTRY_NEW2OLD(dns_name_slot(name), e) {
+		if (e->af == af && streq(e->name, name)) {
+			return e;
+		}
+	}
+	return NULL;
+}
+
+static void free_dns_entry(struct dns_entry *e)
+{
+	pfree(e->name);
+	pfree(e);
+}
+
+/*
+ * Look up NAME the slow way; like ttoaddr(), prefer IPv6 when either
+ * will do.
+ */
+static err_t resolve(const char *name, int af, ip_address *addr)
+{
+	const struct addrinfo hints = {
+		.ai_family = af,
+		.ai_socktype = SOCK_DGRAM,
+	};
+	struct addrinfo *res;
+	int r = getaddrinfo(name, NULL, &hints, &res);
+	if (r != 0) {
+		return gai_strerror(r);
+	}
+
+	const struct addrinfo *best = NULL;
+	for (const struct addrinfo *ai = res; ai != NULL; ai = ai->ai_next) {
+		if (ai->ai_family == AF_INET6) {
+			best = ai;
+			break;
+		}
+		if (ai->ai_family == AF_INET && best == NULL) {
+			best = ai;
+		}
+	}
+
+	err_t ugh;
+	if (best == NULL) {
+		ugh = "no IPv4 or IPv6 address for name";
+	} else if (best->ai_family == AF_INET) {
+		const struct sockaddr_in *sin =
+			(const struct sockaddr_in *)best->ai_addr;
+		ugh = initaddr((const unsigned char *)&sin->sin_addr,
+			       sizeof(sin->sin_addr), AF_INET, addr);
+	} else {
+		const struct sockaddr_in6 *sin6 =
+			(const struct sockaddr_in6 *)best->ai_addr;
+		ugh = initaddr((const unsigned char *)&sin6->sin6_addr,
+			       sizeof(sin6->sin6_addr), AF_INET6, addr);
+	}
+	freeaddrinfo(res);
+	return ugh;
+}
+
+static void cache_answer(struct dns_entry *e, err_t ugh,
+			 const ip_address *addr, monotime_t now)
+{
+	if (ugh == NULL) {
+		e->answer = DNS_FOUND;
+		e->addr = *addr;
+		e->ugh = NULL;
+		e->expires = monotimesum(now, deltatime(DNS_FOUND_TTL));
+		total_found++;
+	} else {
+		e->answer = DNS_FAILED;
+		e->ugh = ugh;
+		e->expires = monotimesum(now, deltatime(DNS_FAILED_TTL));
+		total_failed++;
+	}
+}
+
+static void dns_answers_cb(struct state *st UNUSED,
+			   struct msg_digest **mdp UNUSED,
+			   void *context UNUSED)
+{
+	pthread_mutex_lock(&dns_mutex);
+	struct dns_entry *e = answers;
+	answers = NULL;
+	pthread_mutex_unlock(&dns_mutex);
+
+	monotime_t now = mononow();
+	batch++;
+	total_batches++;
+	for (; e != NULL; e = e->next) {
+		e->outstanding = FALSE;
+		nr_outstanding--;
+		intmax_t ms = deltamillisecs(monotimediff(now, e->started));
+		total_latency_ms += ms;
+		if (ms > max_latency_ms) {
+			max_latency_ms = ms;
+		}
+		e->batch = batch;
+		cache_answer(e, e->new_ugh, &e->new_addr, now);
+		DBG(DBG_DNS, {
+			ipstr_buf b;
+			DBG_log("DNS lookup of \"%s\" took %jdms: %s",
+				e->name, ms,
+				e->answer == DNS_FOUND ?
+					ipstr(&e->addr, &b) : e->ugh);
+		});
+	}
+
+	connections_dns_answered();
+}
+
+static void *resolver_thread(void *arg UNUSED)
+{
+	pthread_mutex_lock(&dns_mutex);
+	for (;;) {
+		while (requests == NULL && !stopping) {
+			pthread_cond_wait(&dns_cond, &dns_mutex);
+		}
+		if (stopping) {
+			break;
+		}
+
+		struct dns_entry *e = requests;
+		requests = e->next;
+		if (requests == NULL) {
+			requests_tail = &requests;
+		}
+		e->resolving = TRUE;
+		pthread_mutex_unlock(&dns_mutex);
+
+		e->new_ugh = resolve(e->name, e->af, &e->new_addr);
+
+		pthread_mutex_lock(&dns_mutex);
+		if (stopping) {
+			/* free_dns_cache() has let go of it */
+			free_dns_entry(e);
+			break;
+		}
+		e->resolving = FALSE;
+		e->next = answers;
+		answers = e;
+		if (e->next == NULL) {
+			/* first of a new batch */
+			pluto_event_now("DNS answers", SOS_NOBODY,
+					dns_answers_cb, NULL);
+		}
+	}
+	pthread_mutex_unlock(&dns_mutex);
+	return NULL;
+}
+
+static void start_lookup(struct dns_entry *e)
+{
+	e->outstanding = TRUE;
+	e->started = mononow();
+	nr_outstanding++;
+	total_queries++;
+
+	pthread_mutex_lock(&dns_mutex);
+	e->next = NULL;
+	*requests_tail = e;
+	requests_tail = &e->next;
+	pthread_cond_signal(&dns_cond);
+	pthread_mutex_unlock(&dns_mutex);
+
+	if (nr_outstanding > nr_threads && nr_threads < DNS_RESOLVER_THREADS) {
+		pthread_t thread;
+		int status = pthread_create(&thread, NULL, resolver_thread, NULL);
+		if (status != 0) {
+			/* tried again by the next lookup */
+			libreswan_log("could not start a DNS resolver thread, status = %d",
+				      status);
+		} else {
+			pthread_detach(thread);
+			nr_threads++;
+		}
+	}
+}
+
+/*
+ * Drop the entries nobody has asked about for a while.  One that is
+ * being looked up is left alone, a resolver thread has it.
+ */
+static void sweep_dns_entries(monotime_t now)
+{
+	last_sweep = now;
+	struct dns_entry **ep = &all_entries;
+	while (*ep != NULL) {
+		struct dns_entry *e = *ep;
+		if (e->outstanding ||
+		    monobefore(now, e->expires) ||
+		    monobefore(now, monotimesum(e->used,
+						deltatime(DNS_IDLE_TIME)))) {
+			ep = &e->all_next;
+			continue;
+		}
+		DBG(DBG_DNS,
+		    DBG_log("DNS cache entry for \"%s\" evicted", e->name));
+		*ep = e->all_next;
+		del_hash_table_entry(&dns_hash_table, &e->entry);
+		free_dns_entry(e);
+		nr_entries--;
+		total_evicted++;
+	}
+}
+
+static struct dns_entry *dns_entry(const char *name, int af)
+{
+	monotime_t now = mononow();
+	struct dns_entry *e = find_dns_entry(name, af);
+	if (e == NULL) {
+		if (!monobefore(now, monotimesum(last_sweep,
+						 deltatime(DNS_SWEEP_INTERVAL)))) {
+			sweep_dns_entries(now);
+		}
+		e = alloc_thing(struct dns_entry, "DNS cache entry");
+		e->name = clone_str(name, "DNS cache name");
+		e->af = af;
+		e->answer = DNS_PENDING;
+		e->entry = list_entry(&dns_hash_table.info, e);
+		add_hash_table_entry(&dns_hash_table, e, &e->entry);
+		e->all_next = all_entries;
+		all_entries = e;
+		nr_entries++;
+	}
+	e->used = now;
+	return e;
+}
+
+enum dns_answer dns_lookup(const char *name, int af,
+			   ip_address *addr, err_t *ugh)
+{
+	/* no need to ask */
+	if (ttoaddr_num(name, 0, af, addr) == NULL) {
+		return DNS_FOUND;
+	}
+
+	struct dns_entry *e = dns_entry(name, af);
+
+	if (e->answer == DNS_PENDING) {
+		total_misses++;
+	} else if (monobefore(mononow(), e->expires)) {
+		total_hits++;
+	} else {
+		total_stale++;
+	}
+
+	if (!e->outstanding &&
+	    (e->answer == DNS_PENDING || !monobefore(mononow(), e->expires))) {
+		DBG(DBG_DNS,
+		    DBG_log("DNS lookup of \"%s\" started", name));
+		start_lookup(e);
+	}
+
+	switch (e->answer) {
+	case DNS_FOUND:
+		*addr = e->addr;
+		break;
+	case DNS_FAILED:
+		*ugh = e->ugh;
+		break;
+	case DNS_PENDING:
+		*ugh = "host name lookup in progress";
+		break;
+	}
+	return e->answer;
+}
+
+enum dns_answer dns_lookup_now(const char *name, int af,
+			       ip_address *addr, err_t *ugh)
+{
+	if (ttoaddr_num(name, 0, af, addr) == NULL) {
+		return DNS_FOUND;
+	}
+
+	struct dns_entry *e = dns_entry(name, af);
+	if (e->answer != DNS_PENDING) {
+		/* known, perhaps out of date; that's for dns_lookup() */
+		return dns_lookup(name, af, addr, ugh);
+	}
+
+	/*
+	 * Never answered: ask the slow way, as connections were
+	 * always loaded.  Should a resolver thread also be looking
+	 * it up, its answer replaces this one.
+	 */
+	total_misses++;
+	total_queries++;
+	monotime_t started = mononow();
+	ip_address new_addr;
+	err_t new_ugh = ttoaddr(name, 0, af, &new_addr);
+	monotime_t now = mononow();
+	intmax_t ms = deltamillisecs(monotimediff(now, started));
+	total_latency_ms += ms;
+	if (ms > max_latency_ms) {
+		max_latency_ms = ms;
+	}
+	cache_answer(e, new_ugh, &new_addr, now);
+	DBG(DBG_DNS, {
+		ipstr_buf b;
+		DBG_log("DNS lookup of \"%s\" took %jdms (blocking): %s",
+			e->name, ms,
+			e->answer == DNS_FOUND ?
+				ipstr(&e->addr, &b) : e->ugh);
+	});
+
+	if (e->answer == DNS_FOUND) {
+		*addr = e->addr;
+	} else {
+		*ugh = e->ugh;
+	}
+	return e->answer;
+}
+
+bool dns_answered(const char *name)
+{
+	struct dns_entry *e;
+	FOR_EACH_LIST_ENTRY_NEW2OLD(dns_name_slot(name), e) {
+		if (e->batch == batch && streq(e->name, name)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+void init_dns_cache(void)
+{
+	init_hash_table(&dns_hash_table);
+}
+
+/*
+ * A thread can be stuck in getaddrinfo() for some time, don't wait;
+ * the thread frees its entry should it return before pluto exits.
+ */
+void free_dns_cache(void)
+{
+	pthread_mutex_lock(&dns_mutex);
+	stopping = TRUE;
+	pthread_cond_broadcast(&dns_cond);
+	while (all_entries != NULL) {
+		struct dns_entry *e = all_entries;
+		all_entries = e->all_next;
+		del_hash_table_entry(&dns_hash_table, &e->entry);
+		if (!e->resolving) {
+			free_dns_entry(e);
+		}
+	}
+	requests = NULL;
+	requests_tail = &requests;
+	answers = NULL;
+	nr_entries = 0;
+	pthread_mutex_unlock(&dns_mutex);
+	free_hash_table(&dns_hash_table);
+}
+
+void show_dns_cache_status(void)
+{
+	whack_log_comment("current.dns.names=%u", nr_entries);
+	whack_log_comment("current.dns.lookups=%u", nr_outstanding);
+	whack_log_comment("current.dns.threads=%u", nr_threads);
+	whack_log_comment("total.dns.hits=%lu", total_hits);
+	whack_log_comment("total.dns.stale=%lu", total_stale);
+	whack_log_comment("total.dns.misses=%lu", total_misses);
+	whack_log_comment("total.dns.lookups=%lu", total_queries);
+	whack_log_comment("total.dns.found=%lu", total_found);
+	whack_log_comment("total.dns.failed=%lu", total_failed);
+	whack_log_comment("total.dns.batches=%lu", total_batches);
+	whack_log_comment("total.dns.evicted=%lu", total_evicted);
+	whack_log_comment("total.dns.latency=%jdms", total_latency_ms);
+	whack_log_comment("total.dns.latency.max=%jdms", max_latency_ms);
+}
@@ -0,0 +1,53 @@
+/* asynchronous host name lookups, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef _DNS_CACHE_H
+#define _DNS_CACHE_H
+
+enum dns_answer {
+	DNS_PENDING,	/* being looked up; try again when answered */
+	DNS_FOUND,
+	DNS_FAILED,
+};
+
+/*
+ * Return what is known about NAME (of address family AF, or
+ * AF_UNSPEC) without blocking.
+ *
+ * DNS_FOUND sets *ADDR; DNS_FAILED and DNS_PENDING set *UGH.  When
+ * NAME isn't cached, or the answer is out of date, a lookup is also
+ * started (an out-of-date answer is still returned); once it
+ * completes, connections_dns_answered() is called.
+ */
+enum dns_answer dns_lookup(const char *name, int af,
+			   ip_address *addr, err_t *ugh);
+
+/*
+ * Like dns_lookup() except that when nothing at all is known about
+ * NAME it is looked up, blocking, and the answer is cached; never
+ * DNS_PENDING.  For loading a connection.
+ */
+enum dns_answer dns_lookup_now(const char *name, int af,
+			       ip_address *addr, err_t *ugh);
+
+/*
+ * For connections_dns_answered(): was NAME (for any address family)
+ * among the lookups that were just completed?
+ */
+bool dns_answered(const char *name);
+
+void init_dns_cache(void);
+void show_dns_cache_status(void);
+void free_dns_cache(void);
+
+#endif
@@ -1,6 +1,7 @@
 /* State lists and hash tables, for libreswan
  *
  * Copyright (C) 2015 Andrew Cagney <andrew.cagney@gmail.com>
+ * Copyright (C) 2017 agent <agent@local>
  *
  * This program is free software; you can redistribute it and/or modify it
  * under the terms of the GNU General Public License as published by the
@@ -16,22 +17,251 @@
 #include <stdint.h>
 
 #include "lswlog.h"
+#include "lswalloc.h"
 
 #include "defs.h"
+#include "log.h"
+#include "rnd.h"
 #include "hash_table.h"
 
+/*
+ * Split a slot when the average chain length exceeds MAX_LOAD; merge
+ * slots (a few at a time) when it drops below 1/2.
+ */
+#define MAX_LOAD 2
+#define MAX_MERGES_PER_ADD 4
+
+/*
+ * Per-boot secret for hash_table_bytes(); filled in by the first
+ * call to init_hash_table().
+ */
+static bool hash_key_valid;
+static uint64_t hash_key[2];
+
+static uint64_t rotl64(uint64_t x, unsigned b)
+{
+	return (x << b) | (x >> (64 - b));
+}
+
+static uint64_t load64(const uint8_t *p)
+{
+	uint64_t v = 0;
+	for (unsigned i = 0; i < 8; i++) {
+		v |= (uint64_t)p[i] << (8 * i);
+	}
+	return v;
+}
+
+#define SIPROUND(V0, V1, V2, V3)					\
+	{								\
+		V0 += V1; V1 = rotl64(V1, 13); V1 ^= V0; V0 = rotl64(V0, 32); \
+		V2 += V3; V3 = rotl64(V3, 16); V3 ^= V2;		\
+		V0 += V3; V3 = rotl64(V3, 21); V3 ^= V0;		\
+		V2 += V1; V1 = rotl64(V1, 17); V1 ^= V2; V2 = rotl64(V2, 32); \
+	}
+
+/*
+ * SipHash-2-4.
+ */
+size_t hash_table_bytes(const void *bytes, size_t size)
+{
+	passert(hash_key_valid);
+	const uint8_t *p = bytes;
+	uint64_t v0 = hash_key[0] ^ UINT64_C(0x736f6d6570736575);
+	uint64_t v1 = hash_key[1] ^ UINT64_C(0x646f72616e646f6d);
+	uint64_t v2 = hash_key[0] ^ UINT64_C(0x6c7967656e657261);
+	uint64_t v3 = hash_key[1] ^ UINT64_C(0x7465646279746573);
+
+	size_t left = size;
+	for (; left >= 8; left -= 8, p += 8) {
+		uint64_t m = load64(p);
+		v3 ^= m;
+		SIPROUND(v0, v1, v2, v3);
+		SIPROUND(v0, v1, v2, v3);
+		v0 ^= m;
+	}
+
+	uint64_t b = (uint64_t)size << 56;
+	for (unsigned i = 0; i < left; i++) {
+		b |= (uint64_t)p[i] << (8 * i);
+	}
+	v3 ^= b;
+	SIPROUND(v0, v1, v2, v3);
+	SIPROUND(v0, v1, v2, v3);
+	v0 ^= b;
+
+	v2 ^= 0xff;
+	SIPROUND(v0, v1, v2, v3);
+	SIPROUND(v0, v1, v2, v3);
+	SIPROUND(v0, v1, v2, v3);
+	SIPROUND(v0, v1, v2, v3);
+	return (size_t)(v0 ^ v1 ^ v2 ^ v3);
+}
+
+static unsigned long nr_table_slots(const struct hash_table *table)
+{
+	return table->level_slots + table->split;
+}
+
+static struct list_head *slot_by_index(const struct hash_table *table,
+				       unsigned long index)
+{
+	passert(index < nr_table_slots(table));
+	unsigned long segment = index / table->nr_slots;
+	unsigned long offset = index % table->nr_slots;
+	if (segment == 0) {
+		return &table->slots[offset];
+	} else {
+		return &table->segments[segment - 1][offset];
+	}
+}
+
 void init_hash_table(struct hash_table *table)
 {
+	if (!hash_key_valid) {
+		get_rnd_bytes((u_char *)hash_key, sizeof(hash_key));
+		hash_key_valid = true;
+	}
+	passert(table->nr_slots > 0);
 	for (unsigned i = 0; i < table->nr_slots; i++) {
 		init_list(&table->info, &table->slots[i]);
 	}
+	if (table->level_slots == 0) {
+		table->level_slots = table->nr_slots;
+		table->split = 0;
+	}
+}
+
+void free_hash_table(struct hash_table *table)
+{
+	/* SLOTS belongs to the caller */
+	for (unsigned long s = 0; s < table->nr_segments; s++) {
+		pfree(table->segments[s]);
+	}
+	if (table->segments != NULL) {
+		pfree(table->segments);
+		table->segments = NULL;
+	}
+	table->nr_segments = 0;
+	table->level_slots = table->nr_slots;
+	table->split = 0;
 }
 
 struct list_head *hash_table_slot_by_hash(struct hash_table *table,
 					  unsigned long hash)
 {
 	/* let caller do logging */
-	return &table->slots[hash % table->nr_slots];
+	unsigned long index = hash % table->level_slots;
+	if (index < table->split) {
+		/* already split this round */
+		index = hash % (table->level_slots * 2);
+	}
+	return slot_by_index(table, index);
+}
+
+/*
+ * Move the entries in FROM that hash to slot INDEX (or all entries
+ * when INDEX is NULL) over to TO.
+ *
+ * Entries are moved oldest first and inserted at the front so their
+ * relative order is preserved.
+ */
+
+static void move_slot_entries(struct hash_table *table,
+			      struct list_head *from, struct list_head *to,
+			      const unsigned long *index, unsigned long modulus)
+{
+	struct list_entry *entry = from->head.newer;
+	while (entry != &from->head) {
+		struct list_entry *next = entry->newer;
+		if (index == NULL ||
+		    table->hash(entry->data) % modulus == *index) {
+			remove_list_entry(entry);
+			insert_list_entry(to, entry);
+		}
+		entry = next;
+	}
+}
+
+static void split_slot(struct hash_table *table)
+{
+	unsigned long old_index = table->split;
+	unsigned long new_index = table->level_slots + table->split;
+
+	if (new_index % table->nr_slots == 0) {
+		/* need another segment */
+		struct list_head **segments =
+			alloc_things(struct list_head *,
+				     table->nr_segments + 1, table->info.name);
+		if (table->segments != NULL) {
+			memcpy(segments, table->segments,
+			       table->nr_segments * sizeof(segments[0]));
+			pfree(table->segments);
+		}
+		segments[table->nr_segments] =
+			alloc_things(struct list_head, table->nr_slots,
+				     table->info.name);
+		table->segments = segments;
+		table->nr_segments++;
+	}
+
+	/* make NEW_INDEX visible */
+	table->split++;
+	struct list_head *new_slot = slot_by_index(table, new_index);
+	init_list(&table->info, new_slot);
+	move_slot_entries(table, slot_by_index(table, old_index), new_slot,
+			  &new_index, table->level_slots * 2);
+
+	if (table->split == table->level_slots) {
+		/* start the next round */
+		table->level_slots *= 2;
+		table->split = 0;
+	}
+	table->nr_splits++;
+}
+
+static void merge_slot(struct hash_table *table)
+{
+	if (table->split == 0) {
+		/* back to the previous round */
+		table->level_slots /= 2;
+		table->split = table->level_slots;
+	}
+	unsigned long old_index = table->level_slots + table->split - 1;
+	unsigned long new_index = table->split - 1;
+	move_slot_entries(table, slot_by_index(table, old_index),
+			  slot_by_index(table, new_index), NULL, 0);
+	table->split--;
+
+	if (old_index % table->nr_slots == 0) {
+		/* last segment is empty; keep the directory */
+		table->nr_segments--;
+		pfree(table->segments[table->nr_segments]);
+		table->segments[table->nr_segments] = NULL;
+	}
+	table->nr_merges++;
+}
+
+/*
+ * Resize by at most a few slots.  Since this only happens when an
+ * entry is added, deleting entries while iterating over a slot
+ * can't cause the remaining entries to be moved.
+ */
+
+static void resize_hash_table(struct hash_table *table)
+{
+	if (table->nr_entries > (long)(MAX_LOAD * nr_table_slots(table))) {
+		split_slot(table);
+		return;
+	}
+	for (unsigned m = 0; m < MAX_MERGES_PER_ADD; m++) {
+		unsigned long nr_slots = nr_table_slots(table);
+		if (nr_slots <= table->nr_slots ||
+		    table->nr_entries * 2 >= (long)nr_slots) {
+			return;
+		}
+		merge_slot(table);
+	}
 }
 
 void add_hash_table_entry(struct hash_table *table,
@@ -42,6 +272,7 @@ void add_hash_table_entry(struct hash_table *table,
 		hash_table_slot_by_hash(table, table->hash(data));
 	table->nr_entries++;
 	insert_list_entry(slot, entry);
+	resize_hash_table(table);
 }
 
 void del_hash_table_entry(struct hash_table *table,
@@ -50,3 +281,35 @@ void del_hash_table_entry(struct hash_table *table,
 	table->nr_entries--;
 	remove_list_entry(entry);
 }
+
+void show_hash_table_status(const struct hash_table *table,
+			    const char *name)
+{
+	unsigned long nr_slots = nr_table_slots(table);
+	unsigned long empty = 0;
+	unsigned long longest = 0;
+	for (unsigned long i = 0; i < nr_slots; i++) {
+		unsigned long length = 0;
+		void *data;
+		FOR_EACH_LIST_ENTRY_OLD2NEW(slot_by_index(table, i), data) {
+			length++;
+		}
+		if (length == 0) {
+			empty++;
+		}
+		if (length > longest) {
+			longest = length;
+		}
+	}
+	unsigned long load = table->nr_entries * 100 / nr_slots;
+
+	whack_log_comment("current.hash.%s.entries=%ld",
+			  name, table->nr_entries);
+	whack_log_comment("current.hash.%s.slots=%lu", name, nr_slots);
+	whack_log_comment("current.hash.%s.load=%lu.%02lu",
+			  name, load / 100, load % 100);
+	whack_log_comment("current.hash.%s.chain.longest=%lu", name, longest);
+	whack_log_comment("current.hash.%s.chain.empty=%lu", name, empty);
+	whack_log_comment("total.hash.%s.splits=%lu", name, table->nr_splits);
+	whack_log_comment("total.hash.%s.merges=%lu", name, table->nr_merges);
+}
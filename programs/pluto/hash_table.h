@@ -20,6 +20,16 @@
 
 /*
  * Generic hash table.
+ *
+ * The table grows and shrinks one slot at a time using linear
+ * hashing: each resize step splits (or merges) a single slot so there
+ * is never a stop-the-world rehash.  The caller provides the initial
+ * SLOTS array; it is used as the first segment and NR_SLOTS is both
+ * the minimum size and the size of each additional segment.
+ *
+ * Entries are only ever moved between slots by
+ * add_hash_table_entry(); it is safe to delete entries while
+ * iterating over a slot.
  */
 
 struct hash_table {
@@ -28,9 +38,17 @@ struct hash_table {
 	long nr_entries; /* approx? */
 	unsigned long nr_slots;
 	struct list_head *slots;
+	/* private: maintained by the table */
+	struct list_head **segments; /* after SLOTS */
+	unsigned long nr_segments;
+	unsigned long level_slots; /* slots at start of this round */
+	unsigned long split; /* next slot to split */
+	unsigned long nr_splits;
+	unsigned long nr_merges;
 };
 
 void init_hash_table(struct hash_table *table);
+void free_hash_table(struct hash_table *table);
 
 /*
  * Maintain the table.
@@ -55,4 +73,21 @@ void del_hash_table_entry(struct hash_table *table,
 struct list_head *hash_table_slot_by_hash(struct hash_table *table,
 					  unsigned long hash);
 
+/*
+ * Keyed hash of BYTES.
+ *
+ * The key is a per-boot secret so that a peer, which gets to choose
+ * things like SPIs, can't steer entries onto a single chain.
+ */
+
+size_t hash_table_bytes(const void *bytes, size_t size);
+
+/*
+ * Log the table's size, load factor and chain lengths using
+ * whack_log_comment() (as in: current.hash.NAME.entries=...).
+ */
+
+void show_hash_table_status(const struct hash_table *table,
+			    const char *name);
+
 #endif
@@ -0,0 +1,366 @@
+/* per-helper work queues with work stealing, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(linux)
+# include <sys/eventfd.h>
+#endif
+
+#include "lswlog.h"
+#include "lswalloc.h"
+
+#include "defs.h"
+#include "helper_queue.h"
+
+struct helper_queue {
+	/* pushed by the main thread; taken by anyone */
+	struct helper_work *inbox;
+	/* set, while holding MUTEX, just before waiting on COND */
+	bool sleeping;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	/* protected by MUTEX */
+	struct list_head queue;
+	unsigned long queue_len;
+	/* atomic */
+	unsigned long steals;
+};
+
+struct helper_queues {
+	int nr_helpers;
+	int next_helper; /* main thread only */
+	struct helper_queue *helpers;
+};
+
+void init_helper_work(struct helper_work *work,
+		      const struct list_info *info, void *data)
+{
+	work->hw_next = NULL;
+	work->hw_entry = list_entry(info, data);
+}
+
+struct helper_queues *alloc_helper_queues(int nr_helpers,
+					  const struct list_info *info)
+{
+	passert(nr_helpers > 0);
+	struct helper_queues *queues =
+		alloc_thing(struct helper_queues, "helper queues (ignore)");
+	queues->nr_helpers = nr_helpers;
+	queues->helpers = alloc_things(struct helper_queue, nr_helpers,
+				       "helper queue (ignore)");
+	for (int h = 0; h < nr_helpers; h++) {
+		struct helper_queue *q = &queues->helpers[h];
+		pthread_mutex_init(&q->mutex, NULL);
+		pthread_cond_init(&q->cond, NULL);
+		init_list(info, &q->queue);
+	}
+	return queues;
+}
+
+static void wake_helper(struct helper_queue *q)
+{
+	pthread_mutex_lock(&q->mutex);
+	pthread_cond_signal(&q->cond);
+	pthread_mutex_unlock(&q->mutex);
+}
+
+/*
+ * The push and the load of .sleeping are both sequentially
+ * consistent, as are the helper's store of .sleeping and its
+ * re-check for work.  Hence either the helper sees the new work or
+ * this code sees the helper asleep and wakes it.
+ */
+
+void submit_helper_work(struct helper_queues *queues,
+			struct helper_work *work)
+{
+	/* prefer a helper that is asleep */
+	int h = queues->next_helper;
+	for (int i = 0; i < queues->nr_helpers; i++) {
+		int c = (queues->next_helper + i) % queues->nr_helpers;
+		if (__atomic_load_n(&queues->helpers[c].sleeping, __ATOMIC_SEQ_CST)) {
+			h = c;
+			break;
+		}
+	}
+	queues->next_helper = (h + 1) % queues->nr_helpers;
+
+	struct helper_queue *q = &queues->helpers[h];
+	work->hw_next = __atomic_load_n(&q->inbox, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&q->inbox, &work->hw_next, work,
+					    false, __ATOMIC_SEQ_CST,
+					    __ATOMIC_RELAXED)) {
+		/* a thief emptied the inbox; HW_NEXT was updated */
+	}
+
+	if (__atomic_load_n(&q->sleeping, __ATOMIC_SEQ_CST)) {
+		wake_helper(q);
+		return;
+	}
+	/* H is busy; wake anyone that can steal it */
+	for (int i = 1; i < queues->nr_helpers; i++) {
+		struct helper_queue *t =
+			&queues->helpers[(h + i) % queues->nr_helpers];
+		if (__atomic_load_n(&t->sleeping, __ATOMIC_SEQ_CST)) {
+			wake_helper(t);
+			return;
+		}
+	}
+}
+
+/*
+ * Move everything in FROM's inbox to the end of TO's queue.  The
+ * inbox is newest-first so reverse it.
+ */
+
+static void drain_inbox(struct helper_queue *from, struct helper_queue *to)
+{
+	if (__atomic_load_n(&from->inbox, __ATOMIC_RELAXED) == NULL) {
+		return;
+	}
+	struct helper_work *work = __atomic_exchange_n(&from->inbox, NULL,
+						       __ATOMIC_SEQ_CST);
+	struct helper_work *oldest = NULL;
+	while (work != NULL) {
+		struct helper_work *next = work->hw_next;
+		work->hw_next = oldest;
+		oldest = work;
+		work = next;
+	}
+	if (oldest == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&to->mutex);
+	for (work = oldest; work != NULL; work = work->hw_next) {
+		insert_list_entry(&to->queue, &work->hw_entry);
+		__atomic_add_fetch(&to->queue_len, 1, __ATOMIC_SEQ_CST);
+	}
+	pthread_mutex_unlock(&to->mutex);
+}
+
+static void *dequeue_oldest(struct helper_queue *q)
+{
+	if (__atomic_load_n(&q->queue_len, __ATOMIC_RELAXED) == 0) {
+		return NULL;
+	}
+	void *data = NULL;
+	pthread_mutex_lock(&q->mutex);
+	/* the list is circular; HEAD.newer is the oldest */
+	struct list_entry *entry = q->queue.head.newer;
+	if (entry != &q->queue.head) {
+		data = entry->data;
+		remove_list_entry(entry);
+		__atomic_sub_fetch(&q->queue_len, 1, __ATOMIC_SEQ_CST);
+	}
+	pthread_mutex_unlock(&q->mutex);
+	return data;
+}
+
+static bool have_work(struct helper_queues *queues)
+{
+	for (int h = 0; h < queues->nr_helpers; h++) {
+		struct helper_queue *q = &queues->helpers[h];
+		if (__atomic_load_n(&q->inbox, __ATOMIC_SEQ_CST) != NULL ||
+		    __atomic_load_n(&q->queue_len, __ATOMIC_SEQ_CST) > 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool have_helper_work(struct helper_queues *queues)
+{
+	return have_work(queues);
+}
+
+void *next_helper_work(struct helper_queues *queues, int helper)
+{
+	passert(helper >= 0 && helper < queues->nr_helpers);
+	struct helper_queue *self = &queues->helpers[helper];
+	for (;;) {
+		/* own work first */
+		drain_inbox(self, self);
+		void *data = dequeue_oldest(self);
+		if (data != NULL) {
+			return data;
+		}
+
+		/* then steal, oldest first */
+		for (int i = 1; i < queues->nr_helpers; i++) {
+			struct helper_queue *victim =
+				&queues->helpers[(helper + i) % queues->nr_helpers];
+			data = dequeue_oldest(victim);
+			if (data == NULL) {
+				/* VICTIM is busy; take its inbox */
+				drain_inbox(victim, self);
+				data = dequeue_oldest(self);
+			}
+			if (data != NULL) {
+				__atomic_add_fetch(&self->steals, 1,
+						   __ATOMIC_RELAXED);
+				return data;
+			}
+		}
+
+		/* nothing; sleep, but only after a final check */
+		pthread_mutex_lock(&self->mutex);
+		__atomic_store_n(&self->sleeping, true, __ATOMIC_SEQ_CST);
+		if (!have_work(queues)) {
+			DBG(DBG_CONTROL,
+			    DBG_log("crypto helper %d waiting (nothing to do)",
+				    helper));
+			pthread_cond_wait(&self->cond, &self->mutex);
+			DBG(DBG_CONTROL,
+			    DBG_log("crypto helper %d resuming", helper));
+		}
+		__atomic_store_n(&self->sleeping, false, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&self->mutex);
+	}
+}
+
+unsigned long helper_queue_steals(const struct helper_queues *queues,
+				  int helper)
+{
+	passert(helper >= 0 && helper < queues->nr_helpers);
+	return __atomic_load_n(&queues->helpers[helper].steals,
+			       __ATOMIC_RELAXED);
+}
+
+struct helper_answers {
+	/* pushed by helpers; newest first */
+	struct helper_work *inbox;
+	/* main thread only; oldest first */
+	struct list_head answers;
+#if defined(linux)
+	int fd;
+#else
+	int fds[2];	/* read, write */
+#endif
+};
+
+struct helper_answers *alloc_helper_answers(const struct list_info *info)
+{
+	struct helper_answers *answers =
+		alloc_thing(struct helper_answers, "helper answers (ignore)");
+	init_list(info, &answers->answers);
+#if defined(linux)
+	answers->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (answers->fd < 0) {
+		EXIT_LOG_ERRNO(errno, "eventfd() for helper answers failed");
+	}
+#else
+	if (pipe(answers->fds) != 0) {
+		EXIT_LOG_ERRNO(errno, "pipe() for helper answers failed");
+	}
+	for (int i = 0; i < 2; i++) {
+		fcntl(answers->fds[i], F_SETFD, FD_CLOEXEC);
+		fcntl(answers->fds[i], F_SETFL, O_NONBLOCK);
+	}
+#endif
+	return answers;
+}
+
+int helper_answers_fd(const struct helper_answers *answers)
+{
+#if defined(linux)
+	return answers->fd;
+#else
+	return answers->fds[0];
+#endif
+}
+
+void signal_helper_answers_fd(struct helper_answers *answers)
+{
+	/* a full counter/pipe is already signalled */
+#if defined(linux)
+	uint64_t one = 1;
+	ssize_t n = write(answers->fd, &one, sizeof(one));
+#else
+	char one = 1;
+	ssize_t n = write(answers->fds[1], &one, sizeof(one));
+#endif
+	(void)n;
+}
+
+void clear_helper_answers_fd(struct helper_answers *answers)
+{
+#if defined(linux)
+	uint64_t count;
+	ssize_t n = read(answers->fd, &count, sizeof(count));
+#else
+	char buf[64];
+	ssize_t n;
+	do {
+		n = read(answers->fds[0], buf, sizeof(buf));
+	} while (n == sizeof(buf));
+#endif
+	(void)n;
+}
+
+/*
+ * The push is sequentially consistent, as is the main thread's
+ * exchange of the inbox.  Hence when this push finds the inbox empty
+ * the main thread has either already taken everything or hasn't yet
+ * looked, and the signal below covers both.
+ */
+
+void send_helper_answer(struct helper_answers *answers,
+			struct helper_work *work)
+{
+	work->hw_next = __atomic_load_n(&answers->inbox, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&answers->inbox, &work->hw_next,
+					    work, false, __ATOMIC_SEQ_CST,
+					    __ATOMIC_RELAXED)) {
+		/* the main thread emptied the inbox; HW_NEXT was updated */
+	}
+	if (work->hw_next == NULL) {
+		signal_helper_answers_fd(answers);
+	}
+}
+
+void *next_helper_answer(struct helper_answers *answers)
+{
+	/* the list is circular; HEAD.newer is the oldest */
+	if (answers->answers.head.newer == &answers->answers.head) {
+		struct helper_work *work =
+			__atomic_exchange_n(&answers->inbox, NULL,
+					    __ATOMIC_SEQ_CST);
+		/* reverse, so oldest first */
+		struct helper_work *oldest = NULL;
+		while (work != NULL) {
+			struct helper_work *next = work->hw_next;
+			work->hw_next = oldest;
+			oldest = work;
+			work = next;
+		}
+		for (work = oldest; work != NULL; work = work->hw_next) {
+			insert_list_entry(&answers->answers, &work->hw_entry);
+		}
+	}
+	struct list_entry *entry = answers->answers.head.newer;
+	if (entry == &answers->answers.head) {
+		return NULL;
+	}
+	void *data = entry->data;
+	remove_list_entry(entry);
+	return data;
+}
+
+bool have_helper_answers(const struct helper_answers *answers)
+{
+	return (answers->answers.head.newer != &answers->answers.head ||
+		__atomic_load_n(&answers->inbox, __ATOMIC_SEQ_CST) != NULL);
+}
@@ -0,0 +1,91 @@
+/* per-helper work queues with work stealing, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef _helper_queue_h_
+#define _helper_queue_h_
+
+#include "list_entry.h"
+
+/*
+ * Each helper thread has its own queue.
+ *
+ * The main thread submits work, without taking a lock, by pushing it
+ * onto a helper's inbox (preferring a helper that is asleep).  A
+ * helper first drains its own inbox into its queue; when that is
+ * empty it steals work from the other helpers.  Each queue has its
+ * own lock so helpers only contend when stealing.
+ *
+ * Once submitted, work can't be withdrawn; the caller should flag it
+ * as cancelled and let the helper hand it back.
+ */
+
+struct helper_work {
+	struct helper_work *hw_next;	/* while in an inbox */
+	struct list_entry hw_entry;	/* while in a queue */
+};
+
+struct helper_queues;
+
+void init_helper_work(struct helper_work *work,
+		      const struct list_info *info, void *data);
+
+struct helper_queues *alloc_helper_queues(int nr_helpers,
+					  const struct list_info *info);
+
+/* main thread */
+void submit_helper_work(struct helper_queues *queues,
+			struct helper_work *work);
+
+/*
+ * IN A HELPER THREAD: return the data of the next work item; blocks
+ * until there is something to do.
+ */
+void *next_helper_work(struct helper_queues *queues, int helper);
+
+/* approximate; is there work waiting for a helper? */
+bool have_helper_work(struct helper_queues *queues);
+
+/* approximate; for statistics */
+unsigned long helper_queue_steals(const struct helper_queues *queues,
+				  int helper);
+
+/*
+ * Completed work is handed back to the main thread using a single
+ * queue.
+ *
+ * Helpers push answers, without taking a lock, onto an inbox and
+ * only signal the file descriptor when the inbox was empty.  The main
+ * thread waits for the descriptor to become readable, clears it, and
+ * then takes answers (oldest first) until there are none left or it
+ * has done enough for one go; if answers remain it re-signals the
+ * descriptor so that other events get a look in.
+ */
+
+struct helper_answers;
+
+struct helper_answers *alloc_helper_answers(const struct list_info *info);
+
+/* the descriptor to wait on */
+int helper_answers_fd(const struct helper_answers *answers);
+
+/* IN A HELPER THREAD (or any thread) */
+void send_helper_answer(struct helper_answers *answers,
+			struct helper_work *work);
+
+/* main thread */
+void clear_helper_answers_fd(struct helper_answers *answers);
+void *next_helper_answer(struct helper_answers *answers);
+bool have_helper_answers(const struct helper_answers *answers);
+void signal_helper_answers_fd(struct helper_answers *answers);
+
+#endif
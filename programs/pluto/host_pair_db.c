@@ -0,0 +1,144 @@
+/* Host pair table indexed by address, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <string.h>
+
+#include <libreswan.h>
+
+#include "defs.h"
+
+#include "lswlog.h"
+#include "ip_address.h"
+#include "hostpair.h"
+#include "host_pair_db.h"
+#include "hash_table.h"
+
+/*
+ * Initial (and minimum) number of slots in the table; it grows as
+ * host pairs are added.
+ */
+#define HOST_PAIR_TABLE_SIZE 499
+
+/*
+ * Only the addresses are hashed: a host pair's ports need not be
+ * "specific", and pluto_port and pluto_nat_port are equivalent.
+ *
+ * A peer of %any hashes like any other address, so templates don't
+ * need a table of their own: there is one %any host pair per local
+ * address and it is found in the same way.
+ */
+
+static size_t host_pair_hasher(const ip_address *myaddr,
+			       const ip_address *hisaddr)
+{
+	unsigned char key[2 * 16];	/* two IPv6 addresses */
+	const unsigned char *bytes;
+	size_t len = addrbytesptr_read(myaddr, &bytes);
+	memcpy(key, bytes, len);
+	size_t his_len = addrbytesptr_read(hisaddr, &bytes);
+	memcpy(key + len, bytes, his_len);
+	/* peers can pick their address; use the keyed hash */
+	return hash_table_bytes(key, len + his_len);
+}
+
+static size_t host_pair_hash(void *data)
+{
+	struct host_pair *hp = data;
+	return host_pair_hasher(&hp->me.addr, &hp->him.addr);
+}
+
+static size_t log_host_pair(struct lswlog *buf, void *data)
+{
+	struct host_pair *hp = data;
+	size_t size = 0;
+	size += lswlogs(buf, "host pair ");
+	size += lswlog_ip(buf, &hp->me.addr);
+	size += lswlogs(buf, " ");
+	size += lswlog_ip(buf, &hp->him.addr);
+	return size;
+}
+
+static struct list_head host_pair_hash_slots[HOST_PAIR_TABLE_SIZE];
+static struct hash_table host_pair_hash_table = {
+	.info = {
+		.debug = DBG_CONTROLMORE,
+		.name = "host pair table",
+		.log = log_host_pair,
+	},
+	.hash = host_pair_hash,
+	.nr_slots = HOST_PAIR_TABLE_SIZE,
+	.slots = host_pair_hash_slots,
+};
+
+void add_host_pair_to_db(struct host_pair *hp)
+{
+	hp->hash_entry = list_entry(&host_pair_hash_table.info, hp);
+	add_hash_table_entry(&host_pair_hash_table, hp, &hp->hash_entry);
+}
+
+void del_host_pair_from_db(struct host_pair *hp)
+{
+	del_hash_table_entry(&host_pair_hash_table, &hp->hash_entry);
+}
+
+void rehash_host_pair_in_db(struct host_pair *hp)
+{
+	del_host_pair_from_db(hp);
+	add_host_pair_to_db(hp);
+}
+
+struct host_pair *host_pair_by_addrs(const ip_address *myaddr,
+				     u_int16_t myport,
+				     const ip_address *hisaddr,
+				     u_int16_t hisport)
+{
+	struct list_head *slot =
+		hash_table_slot_by_hash(&host_pair_hash_table,
+					host_pair_hasher(myaddr, hisaddr));
+	struct host_pair *p;
+	FOR_EACH_LIST_ENTRY_NEW2OLD(slot, p) {
+
+		DBG(DBG_CONTROLMORE, {
+			ipstr_buf b1;
+			ipstr_buf b2;
+
+			DBG_log("find_host_pair: comparing %s:%d to %s:%d",
+				ipstr(&p->me.addr, &b1), p->me.host_port,
+				ipstr(&p->him.addr, &b2), p->him.host_port);
+		    });
+
+		if (sameaddr(&p->me.addr, myaddr) &&
+		    (!p->me.host_port_specific || p->me.host_port == myport) &&
+		    sameaddr(&p->him.addr, hisaddr) &&
+		    (!p->him.host_port_specific || p->him.host_port == hisport)
+		    ) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+void init_host_pair_db(void)
+{
+	init_hash_table(&host_pair_hash_table);
+}
+
+void free_host_pair_db(void)
+{
+	free_hash_table(&host_pair_hash_table);
+}
+
+void show_host_pair_db_status(void)
+{
+	show_hash_table_status(&host_pair_hash_table, "host_pair");
+}
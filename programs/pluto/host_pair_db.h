@@ -0,0 +1,38 @@
+/* Host pair table indexed by address, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef _host_pair_db_h_
+#define _host_pair_db_h_
+
+struct host_pair;
+
+void init_host_pair_db(void);
+void free_host_pair_db(void);
+void show_host_pair_db_status(void);
+
+void add_host_pair_to_db(struct host_pair *hp);
+void del_host_pair_from_db(struct host_pair *hp);
+/* after changing HP's addresses */
+void rehash_host_pair_in_db(struct host_pair *hp);
+
+/*
+ * Return the host pair for the two addresses and ports.  The caller
+ * is responsible for treating pluto_port and pluto_nat_port as the
+ * same port (see find_host_pair()).
+ */
+struct host_pair *host_pair_by_addrs(const ip_address *myaddr,
+				     u_int16_t myport,
+				     const ip_address *hisaddr,
+				     u_int16_t hisport);
+
+#endif
@@ -70,6 +70,7 @@
 #include "virtual.h"	/* needs connections.h */
 
 #include "hostpair.h"
+#include "host_pair_db.h"
 
 /* struct host_pair: a nexus of information about a pair of hosts.
  * A host is an IP address, UDP port pair.  This is a debatable choice:
@@ -111,17 +112,13 @@ bool same_peer_ids(const struct connection *c, const struct connection *d,
 /** returns a host pair based upon addresses.
  *
  * find_host_pair is given a pair of addresses, plus UDP ports, and
- * returns a host_pair entry that covers it. It also moves the relevant
- * pair description to the beginning of the list, so that it can be
- * found faster next time.
+ * returns a host_pair entry that covers it.
  */
 struct host_pair *find_host_pair(const ip_address *myaddr,
 				 u_int16_t myport,
 				 const ip_address *hisaddr,
 				 u_int16_t hisport)
 {
-	struct host_pair *p, *prev;
-
 	/* default hisaddr to an appropriate any */
 	if (hisaddr == NULL) {
 		hisaddr = aftoinfo(addrtypeof(myaddr))->any;
@@ -143,36 +140,13 @@ struct host_pair *find_host_pair(const ip_address *myaddr,
 	if (hisport == pluto_nat_port)
 		hisport = pluto_port;
 
-	for (prev = NULL, p = host_pairs; p != NULL; prev = p, p = p->next) {
-
-		DBG(DBG_CONTROLMORE, {
-			ipstr_buf b1;
-			ipstr_buf b2;
-
-			DBG_log("find_host_pair: comparing %s:%d to %s:%d",
-				ipstr(&p->me.addr, &b1), p->me.host_port,
-				ipstr(&p->him.addr, &b2), p->him.host_port);
-		    });
-
-		if (sameaddr(&p->me.addr, myaddr) &&
-		    (!p->me.host_port_specific || p->me.host_port == myport) &&
-		    sameaddr(&p->him.addr, hisaddr) &&
-		    (!p->him.host_port_specific || p->him.host_port == hisport)
-		    ) {
-			if (prev != NULL) {
-				prev->next = p->next;   /* remove p from list */
-				p->next = host_pairs;   /* and stick it on front */
-				host_pairs = p;
-			}
-			break;
-		}
-	}
-	return p;
+	return host_pair_by_addrs(myaddr, myport, hisaddr, hisport);
 }
 
 void remove_host_pair(struct host_pair *hp)
 {
 	list_rm(struct host_pair, next, hp, host_pairs);
+	del_host_pair_from_db(hp);
 }
 
 /* find head of list of connections with this pair of hosts */
@@ -239,6 +213,7 @@ void connect_to_host_pair(struct connection *c)
 			hp->pending = NULL;
 			hp->next = host_pairs;
 			host_pairs = hp;
+			add_host_pair_to_db(hp);
 		}
 		c->host_pair = hp;
 		c->hp_next = hp->connections;
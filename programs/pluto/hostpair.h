@@ -20,6 +20,9 @@
  * for more details.
  *
  */
+
+#include "list_entry.h"
+
 struct host_pair {
 	struct {
 		ip_address addr;
@@ -29,6 +32,7 @@ struct host_pair {
 	struct connection *connections;         /* connections with this pair */
 	struct pending *pending;                /* awaiting Keying Channel */
 	struct host_pair *next;
+	struct list_entry hash_entry;		/* see host_pair_db.c */
 };
 
 extern struct host_pair *host_pairs;
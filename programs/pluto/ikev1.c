@@ -155,6 +155,8 @@
 #include "vendor.h"
 #include "ikev1_dpd.h"
 #include "hostpair.h"
+#include "host_pair_db.h"
+#include "spd_db.h"
 #include "ip_address.h"
 
 #ifdef HAVE_NM
@@ -162,6 +164,8 @@
 #endif
 
 #include "pluto_stats.h"
+#include "metrics.h"
+#include "rekey.h"
 
 /*
  * state_v1_microcode is a tuple of information parameterizing certain
@@ -909,10 +913,12 @@ static stf_status informational(struct state *st UNUSED, struct msg_digest *md)
 							ipstr(&new_peer, &b));
 					});
 					tmp_c->spd.that.client.addr = new_peer;
+					rehash_spd_routes_in_db(tmp_c);
 				}
 
 				/* ??? is this wise?  This may changes a lot of other connections. */
 				tmp_c->host_pair->him.addr = new_peer;
+				rehash_host_pair_in_db(tmp_c->host_pair);
 
 				/* Initiating connection to the redirected peer */
 				initiate_connection(tmp_name, tmp_whack_sock,
@@ -1607,12 +1613,13 @@ void process_v1_packet(struct msg_digest **mdp)
 					break; /* fragment list incomplete */
 				} else if (frag->index == last_frag_index) {
 					struct msg_digest *whole_md = alloc_md("msg_digest by ikev1 fragment handler");
-					u_int8_t *buffer = alloc_bytes(size,
-								       "IKE fragments buffer");
+					u_int8_t *buffer = alloc_md_packet(whole_md, size,
+									   "IKE fragments buffer");
 					size_t offset = 0;
 
 					whole_md->iface = frag->md->iface;
 					whole_md->sender = frag->md->sender;
+					whole_md->arrived = md->arrived;	/* the last fragment */
 
 					/* Reassemble fragments in buffer */
 					frag = st->st_v1_rfrags;
@@ -2279,6 +2286,8 @@ void complete_v1_state_transition(struct msg_digest **mdp, stf_status result)
 	} else {
 		pstats(ike_stf, result);
 	}
+	if (result != STF_SUSPEND)
+		metrics_transition(md);
 
 	DBG(DBG_CONTROL,
 	    DBG_log("complete v1 state transition with %s",
@@ -2563,7 +2572,11 @@ void complete_v1_state_transition(struct msg_digest **mdp, stf_status result)
 					}
 				}
 				/* XXX: DELAY_MS should be a deltatime_t */
-				event_schedule(kind, deltatime_ms(delay_ms), st);
+				deltatime_t delay = deltatime_ms(delay_ms);
+				if (is_rekey_event(kind)) {
+					delay = rekey_spread(st, delay);
+				}
+				event_schedule(kind, delay, st);
 				break;
 
 			case EVENT_SO_DISCARD:
@@ -44,6 +44,7 @@
 #include "x509.h"
 #include "certs.h"
 #include "connections.h"        /* needs id.h */
+#include "spd_db.h"
 #include "keys.h"
 #include "packet.h"
 #include "demux.h"      /* needs packet.h */
@@ -1351,6 +1352,7 @@ static stf_status quick_inI1_outR1_tail(struct verify_oppo_bundle *b)
 			    DBG_log("setting phase 2 virtual values to %s",
 				    cthat));
 		}
+		rehash_spd_routes_in_db(c);
 	}
 
 	passert((p1st->st_policy & POLICY_PFS) == 0 ||
@@ -59,6 +59,7 @@
 #include "x509.h"
 #include "certs.h"
 #include "connections.h"	/* needs id.h */
+#include "spd_db.h"
 #include "packet.h"
 #include "demux.h"		/* needs packet.h */
 #include "log.h"
@@ -429,6 +430,7 @@ static stf_status modecfg_resp(struct state *st,
 				c->spd.that.client.addr = ia.ipaddr;
 				c->spd.that.client.maskbits = 32;
 				c->spd.that.has_client = TRUE;
+				rehash_spd_routes_in_db(c);
 				if (has_lease)
 					c->spd.that.has_lease = TRUE;
 			}
@@ -1863,6 +1865,7 @@ stf_status modecfg_inR1(struct state *st, struct msg_digest *md)
 					c->spd.that.has_client = TRUE;
 					c->spd.that.client = *af_inet4_info.all;
 					c->spd.that.has_client_wildcard = FALSE;
+					rehash_spd_routes_in_db(c);
 				}
 
 				while (pbs_left(&strattr) > 0) {
@@ -1932,6 +1935,7 @@ stf_status modecfg_inR1(struct state *st, struct msg_digest *md)
 
 							unshare_connection_end(&sr->this);
 							unshare_connection_end(&sr->that);
+							rehash_spd_routes_in_db(c);
 							break;
 						}
 					}
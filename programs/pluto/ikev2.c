@@ -75,6 +75,8 @@
 #include "plutoalg.h" /* for default_ike_groups */
 
 #include "pluto_stats.h"
+#include "metrics.h"
+#include "rekey.h"
 
 enum smf2_flags {
 	/*
@@ -2133,6 +2135,9 @@ deltatime_t ikev2_replace_delay(struct state *st, enum event_type *pkind)
 			*pkind = kind = EVENT_SA_EXPIRE;
 		}
 	}
+	if (is_rekey_event(kind)) {
+		return rekey_spread(st, deltatime(delay));
+	}
 	return deltatime(delay);
 }
 
@@ -2292,10 +2297,7 @@ static void success_v2_state_transition(struct msg_digest *md)
 			delete_event(st);
 			if (DBGP(IMPAIR_RETRANSMITS)) {
 				libreswan_log("suppressing retransmit because IMPAIR_RETRANSMITS is set.");
-				if (st->st_rel_whack_event != NULL) {
-					pfreeany(st->st_rel_whack_event);
-					st->st_rel_whack_event = NULL;
-				}
+				delete_state_event(st, &st->st_rel_whack_event);
 				event_schedule_s(EVENT_v2_RELEASE_WHACK,
 						 EVENT_RELEASE_WHACK_DELAY, st);
 				kind = EVENT_SA_REPLACE;
@@ -2423,6 +2425,8 @@ void complete_v2_state_transition(struct msg_digest **mdp,
 	} else {
 		pstats(ike_stf, (unsigned long)result);
 	}
+	if (result != STF_SUSPEND)
+		metrics_transition(md);
 
 	/* handle oddball/meta results now */
 
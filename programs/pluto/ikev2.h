@@ -155,6 +155,11 @@ extern bool ikev2_calculate_rsa_sha1(struct state *st,
 				     bool calc_no_ppk_auth,
 				     chunk_t *no_ppk_auth);
 
+extern bool ikev2_start_rsa_sha1(struct state *st,
+				 enum original_role role,
+				 unsigned char *idhash,
+				 crypto_req_cont_func *fn);
+
 extern bool ikev2_create_psk_auth(enum keyword_authby authby,
 				     struct state *st,
 				     unsigned char *idhash,
@@ -167,6 +172,12 @@ extern stf_status ikev2_verify_rsa_sha1(struct state *st,
 					unsigned char *idhash,
 					pb_stream *sig_pbs);
 
+extern void ikev2_start_verify_rsa_sha1(struct state *st,
+					enum original_role role,
+					unsigned char *idhash,
+					const pb_stream *sig_pbs,
+					crypto_req_cont_func *fn);
+
 extern stf_status ikev2_verify_psk_auth(enum keyword_authby authby,
 					struct state *st,
 					unsigned char *idhash,
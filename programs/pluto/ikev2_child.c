@@ -46,6 +46,7 @@
 #include "pluto_x509.h"
 #include "certs.h"
 #include "connections.h"        /* needs id.h */
+#include "spd_db.h"
 #include "state.h"
 #include "packet.h"
 #include "crypto.h"
@@ -936,10 +937,10 @@ static stf_status ikev2_cp_reply_state(const struct msg_digest *md,
 	struct state **ret_cst,
 	enum isakmp_xchg_types isa_xchg)
 {
-	ip_address ipv4;
+	ip_address lease;
 	struct connection *c = md->st->st_connection;
 
-	err_t e = lease_an_address(c, &ipv4);
+	err_t e = lease_an_address(c, &lease);
 	if (e != NULL) {
 		libreswan_log("ikev2 lease_an_address failure %s", e);
 		return STF_INTERNAL_ERROR;
@@ -961,9 +962,11 @@ static stf_status ikev2_cp_reply_state(const struct msg_digest *md,
 
 	struct spd_route *spd = &md->st->st_connection->spd;
 	spd->that.has_lease = TRUE;
-	spd->that.client.addr = ipv4;
-	spd->that.client.maskbits = 32; /* export it as value */
+	spd->that.client.addr = lease;
+	/* export it as value; the pool can be IPv4 or IPv6 */
+	spd->that.client.maskbits = addrlenof(&lease) * BITS_PER_BYTE;
 	spd->that.has_client = TRUE;
+	rehash_spd_routes_in_db(md->st->st_connection);
 
 	cst->st_ts_this = ikev2_end_to_ts(&spd->this);
 	cst->st_ts_that = ikev2_end_to_ts(&spd->that);
@@ -1311,7 +1314,11 @@ static bool ikev2_set_ia(pb_stream *cp_a_pbs, struct state *st, int af)
 	ip_address ip;
 	ipstr_buf ip_str;
 	struct connection *c = st->st_connection;
-	err_t ugh = initaddr(cp_a_pbs->cur, pbs_left(cp_a_pbs), af, &ip);
+	size_t len = pbs_left(cp_a_pbs);
+	/* an INTERNAL_IP6_ADDRESS ends with a prefix-length; ignore it */
+	if (af == AF_INET6 && len == 16 + 1)
+		len = 16;
+	err_t ugh = initaddr(cp_a_pbs->cur, len, af, &ip);
 	bool responder = st->st_state != STATE_PARENT_I2;
 
 	if ((ugh != NULL && st->st_state == STATE_PARENT_I2) || isanyaddr(&ip)) {
@@ -44,6 +44,7 @@
 #include "keys.h" /* needs state.h */
 #include "id.h"
 #include "connections.h"
+#include "spd_db.h"
 
 #include "crypto.h"
 #include "x509.h"
@@ -515,13 +516,18 @@ static stf_status ikev2_match_ke_group_and_proposal(struct msg_digest *md,
 /*
  * Called by ikev2_parent_inI2outR2_tail() and ikev2_parent_inR2()
  * Do the actual AUTH payload verification
+ *
+ * When RSA_CONT is non-NULL, RSA signatures are checked by a crypto
+ * helper and STF_SUSPEND is returned; RSA_CONT then calls
+ * finish_rsa_verify().
  */
-static bool v2_check_auth(enum ikev2_auth_method atype,
+static stf_status v2_check_auth(enum ikev2_auth_method atype,
 	struct state *st,
 	const enum original_role role,
 	unsigned char idhash_in[MAX_DIGEST_LEN],
 	pb_stream *pbs,
-	const enum keyword_authby that_authby)
+	const enum keyword_authby that_authby,
+	crypto_req_cont_func *rsa_cont)
 {
 	unsigned char check_rsa_sha1_blob[ASN1_SHA1_RSA_OID_SIZE] = {0x0};
 	unsigned char check_length_rsa_sha1_blob[ASN1_LEN_ALGO_IDENTIFIER]= {0};
@@ -531,7 +537,13 @@ static bool v2_check_auth(enum ikev2_auth_method atype,
 		if (!LIN(POLICY_RSASIG, st->st_connection->policy) &&  that_authby != AUTH_RSASIG) {
 			libreswan_log("Peer attempted RSA authentication but we want %s",
 				enum_name(&ikev2_asym_auth_name, that_authby));
-			return FALSE;
+			return STF_FAIL;
+		}
+
+		if (rsa_cont != NULL) {
+			ikev2_start_verify_rsa_sha1(st, role, idhash_in, pbs,
+						    rsa_cont);
+			return STF_SUSPEND;
 		}
 
 		stf_status authstat = ikev2_verify_rsa_sha1(
@@ -542,9 +554,9 @@ static bool v2_check_auth(enum ikev2_auth_method atype,
 
 		if (authstat != STF_OK) {
 			libreswan_log("RSA authentication failed");
-			return FALSE;
+			return STF_FAIL;
 		}
-		return TRUE;
+		return STF_OK;
 	}
 
 	case IKEv2_AUTH_PSK:
@@ -552,7 +564,7 @@ static bool v2_check_auth(enum ikev2_auth_method atype,
 		if (!LIN(POLICY_PSK, st->st_connection->policy) &&  that_authby != AUTH_PSK) {
 			libreswan_log("Peer attempted PSK authentication but we want %s",
 				enum_name(&ikev2_asym_auth_name, that_authby));
-			return FALSE;
+			return STF_FAIL;
 		}
 
                stf_status authstat = ikev2_verify_psk_auth(
@@ -561,9 +573,9 @@ static bool v2_check_auth(enum ikev2_auth_method atype,
 
                if (authstat != STF_OK) {
                        libreswan_log("PSK Authentication failed: AUTH mismatch!");
-                       return FALSE;
+                       return STF_FAIL;
                }
-               return TRUE;
+               return STF_OK;
 	}
 
 	case IKEv2_AUTH_NULL:
@@ -571,7 +583,7 @@ static bool v2_check_auth(enum ikev2_auth_method atype,
 		if (!LIN(POLICY_AUTH_NULL, st->st_connection->policy) &&  that_authby != AUTH_NULL) {
 			libreswan_log("Peer attempted NULL authentication but we want %s",
 				enum_name(&ikev2_asym_auth_name, that_authby));
-			return FALSE;
+			return STF_FAIL;
 		}
 
 		stf_status authstat = ikev2_verify_psk_auth(
@@ -580,10 +592,10 @@ static bool v2_check_auth(enum ikev2_auth_method atype,
 
 		if (authstat != STF_OK) {
 			libreswan_log("NULL Authentication failed: AUTH mismatch! (implementation bug?)");
-			return FALSE;
+			return STF_FAIL;
 		}
 		st->st_ikev2_anon = TRUE;
-		return TRUE;
+		return STF_OK;
 	}
 
 	case IKEv2_AUTH_DIGSIG:
@@ -591,19 +603,25 @@ static bool v2_check_auth(enum ikev2_auth_method atype,
 		if (!LIN(POLICY_RSASIG, st->st_connection->policy) &&  that_authby != AUTH_RSASIG) {
 			libreswan_log("Peer attempted Authentication through Digital Signature but we want %s",
 				enum_name(&ikev2_asym_auth_name, that_authby));
-			return FALSE;
+			return STF_FAIL;
 		}
 		if (!in_raw(check_length_rsa_sha1_blob, ASN1_LEN_ALGO_IDENTIFIER, pbs,
 				"Algorithm Identifier length"))
-			return FALSE;
+			return STF_FAIL;
 		if (!memeq(check_length_rsa_sha1_blob, len_sha1_rsa_oid_blob, ASN1_LEN_ALGO_IDENTIFIER))
-			return FALSE;
+			return STF_FAIL;
 
 		if (!in_raw(check_rsa_sha1_blob, ASN1_SHA1_RSA_OID_SIZE, pbs,
 				"Algorithm Identifier value"))
-			return FALSE;
+			return STF_FAIL;
 		if (!memeq(check_rsa_sha1_blob, sha1_rsa_oid_blob, ASN1_SHA1_RSA_OID_SIZE))
-			return FALSE;
+			return STF_FAIL;
+
+		if (rsa_cont != NULL) {
+			ikev2_start_verify_rsa_sha1(st, role, idhash_in, pbs,
+						    rsa_cont);
+			return STF_SUSPEND;
+		}
 
 		stf_status authstat = ikev2_verify_rsa_sha1(
 				st,
@@ -613,16 +631,16 @@ static bool v2_check_auth(enum ikev2_auth_method atype,
 
 		if (authstat != STF_OK) {
 			libreswan_log("Digital Signature authentication failed");
-			return FALSE;
+			return STF_FAIL;
 		}
-		return TRUE;
+		return STF_OK;
 	}
 
 	default:
 	{
 		libreswan_log("authentication method: %s not supported",
 				enum_name(&ikev2_auth_names, atype));
-		return FALSE;
+		return STF_FAIL;
 	}
 
 	}
@@ -1435,9 +1453,9 @@ stf_status ikev2_parent_inI1outR1(struct state *null_st, struct msg_digest *md)
 	}
 
 	/* calculate the nonce and the KE */
-	request_ke_and_nonce("ikev2_inI1outR1 KE", st,
-			     st->st_oakley.ta_dh,
-			     ikev2_parent_inI1outR1_continue);
+	request_responder_ke_and_nonce("ikev2_inI1outR1 KE", st,
+				       st->st_oakley.ta_dh,
+				       ikev2_parent_inI1outR1_continue);
 	return STF_SUSPEND;
 }
 
@@ -2590,8 +2608,11 @@ static stf_status ikev2_ship_cp_attr_ip(u_int16_t type, ip_address *ip,
 	struct ikev2_cp_attribute attr;
 	pb_stream a_pbs;
 
+	/* RFC 7296 3.15.1: an INTERNAL_IP6_ADDRESS has a prefix-length */
+	bool prefix = type == IKEv2_INTERNAL_IP6_ADDRESS;
+
 	attr.type = type;
-	attr.len = (ip == NULL) ? 0 : addrtypeof(ip) == AF_INET ? 4 : 32;
+	attr.len = (ip == NULL) ? 0 : addrlenof(ip) + (prefix ? 1 : 0);
 
 	if (!out_struct(&attr, &ikev2_cp_attribute_desc, outpbs,
 				&a_pbs))
@@ -2599,9 +2620,16 @@ static stf_status ikev2_ship_cp_attr_ip(u_int16_t type, ip_address *ip,
 
 	if (attr.len > 0) {
 		const unsigned char *byte_ptr;
-		addrbytesptr_read(ip, &byte_ptr);
-		if (!out_raw(byte_ptr, attr.len, &a_pbs, story))
+		size_t len = addrbytesptr_read(ip, &byte_ptr);
+		if (!out_raw(byte_ptr, len, &a_pbs, story))
 			return STF_INTERNAL_ERROR;
+		if (prefix) {
+			/* a single address */
+			u_int8_t prefix_len = len * BITS_PER_BYTE;
+			if (!out_raw(&prefix_len, sizeof(prefix_len), &a_pbs,
+				     "prefix-length"))
+				return STF_INTERNAL_ERROR;
+		}
 	}
 
 	close_output_pbs(&a_pbs);
@@ -2716,18 +2744,10 @@ stf_status ikev2_send_cp(struct state *st, enum next_payload_types_ikev2 np,
 	return STF_OK;
 }
 
-static stf_status ikev2_send_auth(struct connection *c,
-				  struct state *st,
-				  enum original_role role,
-				  enum next_payload_types_ikev2 np,
-				  unsigned char *idhash_out,
-				  pb_stream *outpbs,
-				  chunk_t *null_auth)
+/* how we authenticate ourselves */
+static enum keyword_authby v2_auth_by(const struct connection *c,
+				      const struct state *st)
 {
-	struct ikev2_a a;
-	pb_stream a_pbs;
-	struct state *pst = IS_CHILD_SA(st) ?
-		state_with_serialno(st->st_clonedfrom) : st;
 	enum keyword_authby authby = c->spd.this.authby;
 
 	if (st->st_peer_wants_null) {
@@ -2744,6 +2764,62 @@ static stf_status ikev2_send_auth(struct connection *c,
 			authby = AUTH_NULL;
 		}
 	}
+	return authby;
+}
+
+/*
+ * Compute the hash of the IDr payload that
+ * ikev2_parent_inI2outR2_auth_tail() will emit.
+ */
+static bool v2_calc_idhash_out(struct state *st,
+			       unsigned char idhash_out[MAX_DIGEST_LEN])
+{
+	struct connection *c = st->st_connection;
+	struct ikev2_id r_id;
+	chunk_t id_b;
+	pb_stream id_pbs, r_id_pbs;
+
+	build_id_payload((struct isakmp_ipsec_id *)&r_id,
+			 &id_b,
+			 &c->spd.this, st->st_peer_wants_null);
+	r_id.isai_critical = ISAKMP_PAYLOAD_NONCRITICAL;
+	r_id.isai_np = ISAKMP_NEXT_v2NONE;
+
+	size_t room = NSIZEOF_isakmp_generic + sizeof(r_id) + id_b.len;
+	u_char *buf = alloc_bytes(room, "IDr for AUTH hash");
+	init_out_pbs(&id_pbs, buf, room, "IDr for AUTH hash");
+	if (!out_struct(&r_id, &ikev2_id_desc, &id_pbs, &r_id_pbs) ||
+	    !out_chunk(id_b, &r_id_pbs, "my identity")) {
+		pfree(buf);
+		return FALSE;
+	}
+	close_output_pbs(&r_id_pbs);
+
+	unsigned char *id_start = buf + NSIZEOF_isakmp_generic;
+	unsigned int id_len = id_pbs.cur - id_start;
+	struct hmac_ctx id_ctx;
+	hmac_init(&id_ctx, st->st_oakley.ta_prf, st->st_skey_pr_nss);
+	DBG(DBG_CRYPT,
+	    DBG_dump("idhash calc R2", id_start, id_len));
+	hmac_update(&id_ctx, id_start, id_len);
+	hmac_final(idhash_out, &id_ctx);
+	pfree(buf);
+	return TRUE;
+}
+
+static stf_status ikev2_send_auth(struct connection *c,
+				  struct state *st,
+				  enum original_role role,
+				  enum next_payload_types_ikev2 np,
+				  unsigned char *idhash_out,
+				  pb_stream *outpbs,
+				  chunk_t *null_auth)
+{
+	struct ikev2_a a;
+	pb_stream a_pbs;
+	struct state *pst = IS_CHILD_SA(st) ?
+		state_with_serialno(st->st_clonedfrom) : st;
+	enum keyword_authby authby = v2_auth_by(c, st);
 
 	/* ??? isn't c redundant? */
 	pexpect(c == st->st_connection);
@@ -3650,6 +3726,16 @@ stf_status ikev2_parent_inI2outR2(struct state *st, struct msg_digest *md UNUSED
 
 static stf_status ikev2_parent_inI2outR2_continue_tail(struct state *st,
 						       struct msg_digest *md);
+static void complete_v2_inI2outR2_transition(struct state *st,
+					     struct msg_digest **mdp,
+					     stf_status e);
+static stf_status ikev2_parent_inI2outR2_authenticated(struct state *st,
+						       struct msg_digest *md);
+static stf_status ikev2_parent_inI2outR2_certs_tail(struct state *st,
+						    struct msg_digest *md);
+static crypto_req_cont_func ikev2_parent_inI2outR2_certs_continue;	/* type assertion */
+static crypto_req_cont_func ikev2_parent_inI2outR2_verify_continue;	/* type assertion */
+static crypto_req_cont_func ikev2_parent_inI2outR2_sign_continue;	/* type assertion */
 
 static void ikev2_parent_inI2outR2_continue(struct state *st,
 					    struct msg_digest **mdp,
@@ -3730,6 +3816,13 @@ static void ikev2_parent_inI2outR2_continue(struct state *st,
 	/* The connection is "up", start authenticating it */
 
 	stf_status e = ikev2_parent_inI2outR2_continue_tail(st, *mdp);
+	complete_v2_inI2outR2_transition(st, mdp, e);
+}
+
+static void complete_v2_inI2outR2_transition(struct state *st,
+					     struct msg_digest **mdp,
+					     stf_status e)
+{
 	DBG(DBG_CONTROL,
 	    if (e > STF_FAIL) {
 		    int v2_notify_num = e - STF_FAIL;
@@ -3761,9 +3854,6 @@ static void ikev2_parent_inI2outR2_continue(struct state *st,
 static stf_status ikev2_parent_inI2outR2_continue_tail(struct state *st,
 						       struct msg_digest *md)
 {
-	stf_status ret;
-	enum ikev2_auth_method atype;
-
 	ikev2_log_parentSA(st);
 
 	struct state *pst = IS_CHILD_SA(md->st) ?
@@ -3774,6 +3864,34 @@ static stf_status ikev2_parent_inI2outR2_continue_tail(struct state *st,
 
 	nat_traversal_change_port_lookup(md, st);
 
+	/* verify any certificates off the main thread */
+	if (start_x509_verify(md->st, md, ikev2_parent_inI2outR2_certs_continue))
+		return STF_SUSPEND;
+
+	return ikev2_parent_inI2outR2_certs_tail(st, md);
+}
+
+static void ikev2_parent_inI2outR2_certs_continue(struct state *st,
+						  struct msg_digest **mdp,
+						  struct pluto_crypto_req *r)
+{
+	DBG(DBG_CONTROL,
+	    DBG_log("ikev2_parent_inI2outR2_certs_continue for #%lu: verified certificates",
+		    st->st_serialno));
+
+	passert(*mdp != NULL); /* AUTH request */
+
+	finish_x509_verify(st, r);
+	stf_status e = ikev2_parent_inI2outR2_certs_tail(st, *mdp);
+	complete_v2_inI2outR2_transition(st, mdp, e);
+}
+
+static stf_status ikev2_parent_inI2outR2_certs_tail(struct state *st,
+						    struct msg_digest *md)
+{
+	stf_status ret;
+	enum ikev2_auth_method atype;
+
 	/* this call might update connection in md->st */
 	if (!ikev2_decode_peer_id_and_certs(md))
 		return STF_FAIL + v2N_AUTHENTICATION_FAILED;
@@ -3947,9 +4065,9 @@ stf_status ikev2_parent_inI2outR2_id_tail(struct msg_digest *md)
 		size_t len = pbs_left(&pbs);
 		init_pbs(&pbs_no_ppk_auth, st->st_no_ppk_auth.ptr, len, "pb_stream for verifying NO_PPK_AUTH");
 
-		if (!v2_check_auth(md->chain[ISAKMP_NEXT_v2AUTH]->payload.v2a.isaa_type,
+		if (v2_check_auth(md->chain[ISAKMP_NEXT_v2AUTH]->payload.v2a.isaa_type,
 			st, ORIGINAL_RESPONDER, idhash_in, &pbs_no_ppk_auth,
-			st->st_connection->spd.that.authby))
+			st->st_connection->spd.that.authby, NULL) != STF_OK)
 		{
 			send_v2_notification_from_state(st, md, v2N_AUTHENTICATION_FAILED, NULL);
 			return STF_FATAL;
@@ -3968,9 +4086,9 @@ stf_status ikev2_parent_inI2outR2_id_tail(struct msg_digest *md)
 
 			DBG(DBG_CONTROL, DBG_log("going to try to verify NULL_AUTH from Notify payload"));
 			init_pbs(&pbs_null_auth, null_auth.ptr, len, "pb_stream for verifying NULL_AUTH");
-			if (!v2_check_auth(IKEv2_AUTH_NULL,
+			if (v2_check_auth(IKEv2_AUTH_NULL,
 				st, ORIGINAL_RESPONDER, idhash_in, &pbs_null_auth,
-				AUTH_NULL))
+				AUTH_NULL, NULL) != STF_OK)
 			{
 				/* TODO: This should really be an encrypted message! */
 				send_v2_notification_from_state(st, md, v2N_AUTHENTICATION_FAILED, NULL);
@@ -3978,10 +4096,16 @@ stf_status ikev2_parent_inI2outR2_id_tail(struct msg_digest *md)
 			}
 			DBG(DBG_CONTROL, DBG_log("NULL_AUTH verified"));
 		} else {
-			if (!v2_check_auth(md->chain[ISAKMP_NEXT_v2AUTH]->payload.v2a.isaa_type,
-				st, ORIGINAL_RESPONDER, idhash_in, &md->chain[ISAKMP_NEXT_v2AUTH]->pbs,
-				st->st_connection->spd.that.authby))
-			{
+			/* the RSA check is done by a crypto helper */
+			stf_status authstat =
+				v2_check_auth(md->chain[ISAKMP_NEXT_v2AUTH]->payload.v2a.isaa_type,
+					      st, ORIGINAL_RESPONDER, idhash_in, &md->chain[ISAKMP_NEXT_v2AUTH]->pbs,
+					      st->st_connection->spd.that.authby,
+					      ikev2_parent_inI2outR2_verify_continue);
+			if (authstat == STF_SUSPEND) {
+				return STF_SUSPEND;
+			}
+			if (authstat != STF_OK) {
 			/* TODO: This should really be an encrypted message! */
 			send_v2_notification_from_state(st, md, v2N_AUTHENTICATION_FAILED, NULL);
 			return STF_FATAL;
@@ -3989,8 +4113,13 @@ stf_status ikev2_parent_inI2outR2_id_tail(struct msg_digest *md)
 		}
 	}
 
-	/* AUTH succeeded */
+	return ikev2_parent_inI2outR2_authenticated(st, md);
+}
 
+/* AUTH succeeded */
+static stf_status ikev2_parent_inI2outR2_authenticated(struct state *st,
+						       struct msg_digest *md)
+{
 #ifdef XAUTH_HAVE_PAM
 	if (st->st_connection->policy & POLICY_IKEV2_PAM_AUTHORIZE)
 		return ikev2_start_pam_authorize(st);
@@ -3998,6 +4127,73 @@ stf_status ikev2_parent_inI2outR2_id_tail(struct msg_digest *md)
 	return ikev2_parent_inI2outR2_auth_tail(st, md, TRUE);
 }
 
+static void ikev2_parent_inI2outR2_verify_continue(struct state *st,
+						   struct msg_digest **mdp,
+						   struct pluto_crypto_req *r)
+{
+	DBG(DBG_CONTROL,
+	    DBG_log("ikev2_parent_inI2outR2_verify_continue for #%lu: checked RSA signature",
+		    st->st_serialno));
+
+	passert(*mdp != NULL); /* AUTH request */
+
+	stf_status e;
+	if (finish_rsa_verify(st, r) != STF_OK) {
+		libreswan_log("RSA authentication failed");
+		/* TODO: This should really be an encrypted message! */
+		send_v2_notification_from_state(st, *mdp, v2N_AUTHENTICATION_FAILED, NULL);
+		e = STF_FATAL;
+	} else {
+		e = ikev2_parent_inI2outR2_authenticated(st, *mdp);
+	}
+	complete_v2_inI2outR2_transition(st, mdp, e);
+}
+
+static void ikev2_parent_inI2outR2_sign_continue(struct state *st,
+						 struct msg_digest **mdp,
+						 struct pluto_crypto_req *r)
+{
+	DBG(DBG_CONTROL,
+	    DBG_log("ikev2_parent_inI2outR2_sign_continue for #%lu: computed RSA signature",
+		    st->st_serialno));
+
+	passert(*mdp != NULL); /* AUTH request */
+
+	stf_status e;
+	freeanychunk(st->st_v2_rsa_sig);
+	if (!finish_rsa_sign(r, &st->st_v2_rsa_sig)) {
+		loglog(RC_LOG_SERIOUS, "Failed to compute our RSA signature");
+		e = STF_FATAL;
+	} else {
+		e = ikev2_parent_inI2outR2_auth_tail(st, *mdp, TRUE);
+	}
+	complete_v2_inI2outR2_transition(st, mdp, e);
+}
+
+/*
+ * If the AUTH payload we're about to send needs an RSA signature,
+ * hand it to a crypto helper.
+ */
+static bool ikev2_parent_inI2outR2_start_sign(struct state *st)
+{
+	if (v2_auth_by(st->st_connection, st) != AUTH_RSASIG ||
+	    st->st_v2_rsa_sig.ptr != NULL) {
+		return FALSE;
+	}
+	if (st->st_seen_hashnotify &&
+	    !(st->st_hash_negotiated & NEGOTIATE_AUTH_HASH_SHA1)) {
+		/* ikev2_send_auth() will complain */
+		return FALSE;
+	}
+
+	unsigned char idhash_out[MAX_DIGEST_LEN];
+	if (!v2_calc_idhash_out(st, idhash_out)) {
+		return FALSE;
+	}
+	return ikev2_start_rsa_sha1(st, ORIGINAL_RESPONDER, idhash_out,
+				    ikev2_parent_inI2outR2_sign_continue);
+}
+
 static stf_status ikev2_parent_inI2outR2_auth_tail(struct state *st,
 						   struct msg_digest *md,
 						   bool pam_status)
@@ -4015,6 +4211,11 @@ static stf_status ikev2_parent_inI2outR2_auth_tail(struct state *st,
 		return STF_FATAL;
 	}
 
+	/* come back once a helper has signed */
+	if (ikev2_parent_inI2outR2_start_sign(st)) {
+		return STF_SUSPEND;
+	}
+
 	/*
 	 * Now create child state.
 	 * As we will switch to child state, force the parent to the
@@ -4575,6 +4776,7 @@ static stf_status ikev2_process_ts_and_rest(struct msg_digest *md)
 					  &c->spd.this.client));
 
 			c->spd.that.client = tmp_subnet_r;
+			rehash_spd_routes_in_db(c);
 			c->spd.that.port = st->st_ts_that.startport;
 			c->spd.that.protocol = st->st_ts_that.ipprotoid;
 			setportof(htons(c->spd.that.port),
@@ -4804,9 +5006,9 @@ stf_status ikev2_parent_inR2(struct state *st, struct msg_digest *md)
 
 	/* process AUTH payload */
 
-	if (!v2_check_auth(md->chain[ISAKMP_NEXT_v2AUTH]->payload.v2a.isaa_type,
+	if (v2_check_auth(md->chain[ISAKMP_NEXT_v2AUTH]->payload.v2a.isaa_type,
 		pst, ORIGINAL_INITIATOR, idhash_in, &md->chain[ISAKMP_NEXT_v2AUTH]->pbs,
-		that_authby))
+		that_authby, NULL) != STF_OK)
 	{
 		/*
 		 * We cannot send a response as we are processing IKE_AUTH reply
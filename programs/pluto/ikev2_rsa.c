@@ -98,6 +98,23 @@ static void ikev2_calculate_sighash(struct state *st,
 			       ike_alg_hash_sha1.hash_digest_len);
 }
 
+/*
+ * Fill in SIGNED_OCTETS (the DER digest info followed by the sighash)
+ * and return its length.
+ */
+static size_t ikev2_rsa_sha1_octets(struct state *st,
+				    enum original_role role,
+				    unsigned char *idhash,
+				    chunk_t firstpacket,
+				    unsigned char signed_octets[SHA1_DIGEST_SIZE + 16])
+{
+	memcpy(signed_octets, der_digestinfo, der_digestinfo_len);
+
+	ikev2_calculate_sighash(st, role, idhash, firstpacket,
+				signed_octets + der_digestinfo_len);
+	return der_digestinfo_len + SHA1_DIGEST_SIZE;
+}
+
 bool ikev2_calculate_rsa_sha1(struct state *st,
 			      enum original_role role,
 			      unsigned char *idhash,
@@ -108,6 +125,14 @@ bool ikev2_calculate_rsa_sha1(struct state *st,
 	unsigned char signed_octets[SHA1_DIGEST_SIZE + 16];
 	size_t signed_len;
 	const struct connection *c = st->st_connection;
+
+	if (!calc_no_ppk_auth && st->st_v2_rsa_sig.ptr != NULL) {
+		/* already computed by a helper; see ikev2_start_rsa_sha1() */
+		bool ok = out_chunk(st->st_v2_rsa_sig, a_pbs, "rsa signature");
+		freeanychunk(st->st_v2_rsa_sig);
+		return ok;
+	}
+
 	const struct RSA_private_key *k = get_RSA_private_key(c);
 	unsigned int sz;
 
@@ -116,12 +141,9 @@ bool ikev2_calculate_rsa_sha1(struct state *st,
 
 	sz = k->pub.k;
 
-	memcpy(signed_octets, der_digestinfo, der_digestinfo_len);
-
-	ikev2_calculate_sighash(st, role, idhash,
-				st->st_firstpacket_me,
-				signed_octets + der_digestinfo_len);
-	signed_len = der_digestinfo_len + SHA1_DIGEST_SIZE;
+	signed_len = ikev2_rsa_sha1_octets(st, role, idhash,
+					   st->st_firstpacket_me,
+					   signed_octets);
 
 	passert(RSA_MIN_OCTETS <= sz && 4 + signed_len < sz &&
 		sz <= RSA_MAX_OCTETS);
@@ -150,6 +172,35 @@ bool ikev2_calculate_rsa_sha1(struct state *st,
 	return TRUE;
 }
 
+/*
+ * Hand the signing to a crypto helper.  FN should save the signature
+ * in .st_v2_rsa_sig where ikev2_calculate_rsa_sha1() will find it.
+ */
+bool ikev2_start_rsa_sha1(struct state *st,
+			  enum original_role role,
+			  unsigned char *idhash,
+			  crypto_req_cont_func *fn)
+{
+	unsigned char signed_octets[SHA1_DIGEST_SIZE + 16];
+	const struct RSA_private_key *k = get_RSA_private_key(st->st_connection);
+
+	if (k == NULL)
+		return FALSE; /* failure: no key to use */
+
+	size_t signed_len = ikev2_rsa_sha1_octets(st, role, idhash,
+						  st->st_firstpacket_me,
+						  signed_octets);
+
+	passert(RSA_MIN_OCTETS <= k->pub.k && 4 + signed_len < k->pub.k &&
+		k->pub.k <= RSA_MAX_OCTETS);
+
+	DBG(DBG_CRYPT,
+	    DBG_dump("v2rsa octets", signed_octets, signed_len));
+
+	start_rsa_sign(st, "IKEv2 RSA sign", k, signed_octets, signed_len, fn);
+	return TRUE;
+}
+
 static err_t try_RSA_signature_v2(const u_char hash_val[MAX_DIGEST_LEN],
 				  size_t hash_len,
 				  const pb_stream *sig_pbs, struct pubkey *kr,
@@ -195,3 +246,25 @@ stf_status ikev2_verify_rsa_sha1(struct state *st,
 				       sig_pbs, try_RSA_signature_v2);
 
 }
+
+/*
+ * Hand the check to a crypto helper; FN should call
+ * finish_rsa_verify().
+ */
+void ikev2_start_verify_rsa_sha1(struct state *st,
+				 enum original_role role,
+				 unsigned char *idhash,
+				 const pb_stream *sig_pbs,
+				 crypto_req_cont_func *fn)
+{
+	unsigned char calc_hash[SHA1_DIGEST_SIZE];
+	enum original_role invertrole;
+
+	invertrole = (role == ORIGINAL_INITIATOR ? ORIGINAL_RESPONDER : ORIGINAL_INITIATOR);
+
+	ikev2_calculate_sighash(st, invertrole, idhash, st->st_firstpacket_him,
+				calc_hash);
+
+	start_rsa_verify(st, "IKEv2 RSA verify", calc_hash, sizeof(calc_hash),
+			 sig_pbs->cur, pbs_left(sig_pbs), fn);
+}
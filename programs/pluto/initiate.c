@@ -52,11 +52,13 @@
 
 #include "defs.h"
 #include "connections.h"        /* needs id.h */
+#include "spd_db.h"
 #include "pending.h"
 #include "foodgroups.h"
 #include "packet.h"
 #include "demux.h"      /* needs packet.h */
 #include "state.h"
+#include "dns_cache.h"
 #include "timer.h"
 #include "ipsec_doi.h"  /* needs demux.h and state.h */
 #include "server.h"
@@ -90,6 +92,7 @@ static void swap_ends(struct connection *c)
 
 	sr->this = sr->that;
 	sr->that = t;
+	rehash_spd_routes_in_db(c);
 
 	/*
 	 * incase of asymetric auth c->policy contains left.authby
@@ -529,6 +532,7 @@ static void cannot_oppo(struct connection *c,
 		nc->spd.spd_next = shunt_spd;
 
 		happy(addrtosubnet(&b->peer_client, &shunt_spd->that.client));
+		rehash_spd_routes_in_db(nc);
 
 		if (sameaddr(&b->peer_client, &shunt_spd->that.host_addr))
 			shunt_spd->that.has_client = FALSE;
@@ -1101,6 +1105,32 @@ struct connection *shunt_owner(const ip_subnet *ours, const ip_subnet *his)
 /* time before retrying DDNS host lookup for phase 1 */
 #define PENDING_DDNS_INTERVAL secs_per_minute
 
+/*
+ * Route a connection whose --route arrived before its peer's address
+ * (see whack_route_connection()).
+ */
+static void route_resolved_connection(struct connection *c)
+{
+	set_cur_connection(c);
+	if (!trap_connection(c))
+		loglog(RC_ROUTE, "could not route");
+	reset_cur_connection();
+}
+
+/*
+ * The peer's address is now known: a connection that was only asked
+ * to be routed (--route sets POLICY_ROUTE, --initiate POLICY_UP) is
+ * routed; anything else is brought up, as it always was.
+ */
+static void ddns_resolved_connection(struct connection *c)
+{
+	if ((c->policy & (POLICY_ROUTE | POLICY_UP)) == POLICY_ROUTE)
+		route_resolved_connection(c);
+	else
+		initiate_connection(c->name, NULL_FD, empty_lmod, empty_lmod,
+				    pcim_demand_crypto, NULL);
+}
+
 /*
  * call me periodically to check to see if any DDNS tunnel can come up
  */
@@ -1137,8 +1167,12 @@ static void connection_check_ddns1(struct connection *c)
 		return;
 	}
 
-	e = ttoaddr(c->dnshostname, 0, AF_UNSPEC, &new_addr);
-	if (e != NULL) {
+	/*
+	 * Use the family the connection was loaded with; when the
+	 * lookup is pending, connections_dns_answered() calls back.
+	 */
+	if (dns_lookup(c->dnshostname, addrtypeof(&c->spd.that.host_addr),
+		       &new_addr, &e) != DNS_FOUND) {
 		DBG(DBG_DNS, {
 			char cib[CONN_INST_BUF];
 			DBG_log("pending ddns: connection \"%s\"%s lookup of \"%s\" failed: %s",
@@ -1171,16 +1205,18 @@ static void connection_check_ddns1(struct connection *c)
 	 * XXX This may mean that the client's address family doesn't match
 	 * tunnel_addr_family.
 	 */
-	if (!c->spd.that.has_client)
+	if (!c->spd.that.has_client) {
 		addrtosubnet(&c->spd.that.host_addr, &c->spd.that.client);
+		rehash_spd_routes_in_db(c);
+	}
 
 	/*
 	 * reduce the work we do by updating all connections waiting for this
 	 * lookup
 	 */
 	update_host_pairs(c);
-	initiate_connection(c->name, NULL_FD, empty_lmod, empty_lmod,
-			    pcim_demand_crypto, NULL);
+
+	ddns_resolved_connection(c);
 
 	/* no host pairs, no more to do */
 	pexpect(c->host_pair != NULL);	/* ??? surely */
@@ -1189,9 +1225,57 @@ static void connection_check_ddns1(struct connection *c)
 
 	for (d = c->host_pair->connections; d != NULL; d = d->hp_next) {
 		if (c != d && same_in_some_sense(c, d))
-			initiate_connection(d->name, NULL_FD,
-					    empty_lmod, empty_lmod,
-					    pcim_demand_crypto, NULL);
+			ddns_resolved_connection(d);
+	}
+}
+
+/*
+ * Fill in an end, other than the peer's dnshostname (which is left
+ * to connection_check_ddns1()), named by a host name that was
+ * unresolved when the connection was loaded.
+ */
+static void dns_answered_end(struct end *end)
+{
+	ip_address addr;
+	err_t ugh;
+
+	if (end->host_type != KH_IPHOSTNAME || end->host_addr_name == NULL ||
+	    !isanyaddr(&end->host_addr) || !dns_answered(end->host_addr_name))
+		return;
+
+	if (dns_lookup(end->host_addr_name, addrtypeof(&end->host_addr),
+		       &addr, &ugh) != DNS_FOUND)
+		return;
+
+	end->host_addr = addr;
+	setportof(htons(end->port), &end->host_addr);
+}
+
+/*
+ * Called by dns_cache.c with a batch of answers: give connections
+ * loaded before their host names were known their addresses, then
+ * bring up or move the connections whose peer is a dnshostname.
+ */
+void connections_dns_answered(void)
+{
+	struct connection *c, *cnext;
+
+	for (c = connections; c != NULL; c = c->ac_next) {
+		dns_answered_end(&c->spd.this);
+		if (c->dnshostname == NULL || NEVER_NEGOTIATE(c->policy))
+			dns_answered_end(&c->spd.that);
+	}
+	check_orientations();
+
+	for (c = connections; c != NULL; c = cnext) {
+		cnext = c->ac_next;
+		if (c->dnshostname == NULL || !oriented(*c) ||
+		    !dns_answered(c->dnshostname))
+			continue;
+		if (isanyaddr(&c->spd.that.host_addr))
+			connection_check_ddns1(c);
+		else
+			update_host_pairs(c);
 	}
 }
 
@@ -2749,6 +2749,37 @@ static void look_for_replacement_state(struct state *st)
  * The Responder will subsequently use install_ipsec_sa for the outbound.
  * The Initiator uses install_ipsec_sa to install both at once.
  */
+void begin_kernel_batch(void)
+{
+	if (kernel_ops->begin_batch != NULL)
+		kernel_ops->begin_batch();
+}
+
+bool end_kernel_batch(void)
+{
+	return kernel_ops->end_batch == NULL || kernel_ops->end_batch();
+}
+
+/*
+ * The halves of an SA bundle are set up in one batch; end it and,
+ * should the kernel have rejected any part, remove what was added.
+ */
+static bool end_setup_ipsec_sa_batch(struct state *st, bool ok,
+				     bool outbound_added, bool inbound_added)
+{
+	if (end_kernel_batch() || !ok)
+		return ok;
+
+	libreswan_log("kernel rejected part of the IPsec SA; removing it");
+	if (outbound_added) {
+		(void) teardown_half_ipsec_sa(st, FALSE);
+		st->st_outbound_done = FALSE;
+	}
+	if (inbound_added)
+		(void) teardown_half_ipsec_sa(st, TRUE);
+	return FALSE;
+}
+
 bool install_inbound_ipsec_sa(struct state *st)
 {
 	struct connection *const c = st->st_connection;
@@ -2830,6 +2861,8 @@ bool install_inbound_ipsec_sa(struct state *st)
 	 * we now have to set up the outgoing SA first, so that
 	 * we can refer to it in the incoming SA.
 	 */
+	begin_kernel_batch();
+	bool outbound_added = FALSE;
 	if (st->st_refhim == IPSEC_SAREF_NULL && !st->st_outbound_done) {
 
 		DBG(DBG_CONTROL,
@@ -2838,16 +2871,18 @@ bool install_inbound_ipsec_sa(struct state *st)
 		if (!setup_half_ipsec_sa(st, FALSE)) {
 			DBG_log("failed to install outgoing SA: %u",
 				st->st_refhim);
-			return FALSE;
+			return end_setup_ipsec_sa_batch(st, FALSE, FALSE, FALSE);
 		}
 
 		st->st_outbound_done = TRUE;
+		outbound_added = TRUE;
 	}
 	DBG(DBG_CONTROL, DBG_log("outgoing SA has refhim=%u", st->st_refhim));
 
 	/* (attempt to) actually set up the SAs */
 
-	return setup_half_ipsec_sa(st, TRUE);
+	bool ok = setup_half_ipsec_sa(st, TRUE);
+	return end_setup_ipsec_sa_batch(st, ok, outbound_added, ok);
 }
 
 /* Install a route and then a prospective shunt eroute or an SA group eroute.
@@ -3203,28 +3238,37 @@ bool install_ipsec_sa(struct state *st, bool inbound_also)
 
 	/* (attempt to) actually set up the SA group */
 
+	begin_kernel_batch();
+	bool outbound_added = FALSE;
+	bool inbound_added = FALSE;
+
 	/* setup outgoing SA if we haven't already */
 	if (!st->st_outbound_done) {
 		if (!setup_half_ipsec_sa(st, FALSE)) {
-			return FALSE;
+			return end_setup_ipsec_sa_batch(st, FALSE, FALSE, FALSE);
 		}
 
 		DBG(DBG_KERNEL,
 			DBG_log("set up outgoing SA, ref=%u/%u", st->st_ref,
 				st->st_refhim));
 		st->st_outbound_done = TRUE;
+		outbound_added = TRUE;
 	}
 
 	/* now setup inbound SA */
 	if (st->st_ref == IPSEC_SAREF_NULL && inbound_also) {
 		if (!setup_half_ipsec_sa(st, TRUE))
-			return FALSE;
+			return end_setup_ipsec_sa_batch(st, FALSE, FALSE, FALSE);
 
 		DBG(DBG_KERNEL,
 			DBG_log("set up incoming SA, ref=%u/%u", st->st_ref,
 				st->st_refhim));
+		inbound_added = TRUE;
 	}
 
+	if (!end_setup_ipsec_sa_batch(st, TRUE, outbound_added, inbound_added))
+		return FALSE;
+
 	if (rb == route_unnecessary)
 		return TRUE;
 
@@ -3401,9 +3445,12 @@ void delete_ipsec_sa(struct state *st)
 #endif
 				}
 			}
+			/* failures are only logged; delete them together */
+			begin_kernel_batch();
 			(void) teardown_half_ipsec_sa(st, FALSE);
 		}
 		(void) teardown_half_ipsec_sa(st, TRUE);
+		(void) end_kernel_batch();
 
 		break;
 #if defined(WIN32) && defined(WIN32_NATIVE)
@@ -3443,6 +3490,177 @@ const char *kernel_if_name(void)
 	return kernel_ops->kern_name;
 }
 
+/*
+ * Which of ST's SAs (ESP, else AH) has its counters read, and in
+ * which direction.
+ */
+static struct ipsec_proto_info *sa_info_said(struct state *st, bool inbound,
+					     u_int *proto, ipsec_spi_t *spi,
+					     const ip_address **src,
+					     const ip_address **dst)
+{
+	const struct connection *c = st->st_connection;
+	struct ipsec_proto_info *p2;
+
+	if (st->st_esp.present) {
+		*proto = SA_ESP;
+		p2 = &st->st_esp;
+	} else if (st->st_ah.present) {
+		*proto = SA_AH;
+		p2 = &st->st_ah;
+	} else {
+		return NULL;
+	}
+
+	if (inbound) {
+		*src = &c->spd.that.host_addr;
+		*dst = &c->spd.this.host_addr;
+		*spi = p2->our_spi;
+	} else {
+		*src = &c->spd.this.host_addr;
+		*dst = &c->spd.that.host_addr;
+		*spi = p2->attrs.spi;
+	}
+	return p2;
+}
+
+static void update_sa_info(struct ipsec_proto_info *p2, bool inbound,
+			   uint64_t bytes, uint64_t add_time, monotime_t now)
+{
+	p2->add_time = add_time;
+
+	/* fied has been set? */
+	passert(!is_monotime_epoch(p2->our_lastused));
+	passert(!is_monotime_epoch(p2->peer_lastused));
+
+	if (inbound) {
+		if (bytes > p2->our_bytes) {
+			p2->our_bytes = bytes;
+			p2->our_lastused = now;
+		}
+		p2->our_info_time = now;
+	} else {
+		if (bytes > p2->peer_bytes) {
+			p2->peer_bytes = bytes;
+			p2->peer_lastused = now;
+		}
+		p2->peer_info_time = now;
+	}
+}
+
+/*
+ * With sa-counter-refresh, instead of asking the kernel for each
+ * SA's counters, every SA is dumped at most once per interval and all
+ * the states are updated from that; in between, get_sa_info() uses
+ * the counters read by the last dump.
+ */
+
+deltatime_t sa_counter_refresh = DELTATIME(0);
+
+static monotime_t sa_counters_dumped;	/* last attempt */
+
+struct sa_counters {
+	ip_address dst;
+	ipsec_spi_t spi;
+	int proto;
+	uint64_t bytes;
+	uint64_t add_time;
+};
+
+struct sa_counters_dump {
+	struct sa_counters *sas;
+	unsigned nr;
+	unsigned size;
+	monotime_t now;
+};
+
+static kernel_sa_counters_cb add_sa_counters; /* type assertion */
+
+static void add_sa_counters(const ip_address *dst, ipsec_spi_t spi,
+			    int proto, uint64_t bytes, uint64_t add_time,
+			    void *context)
+{
+	struct sa_counters_dump *dump = context;
+
+	if (dump->nr >= dump->size) {
+		unsigned size = dump->size == 0 ? 64 : dump->size * 2;
+		struct sa_counters *sas = alloc_things(struct sa_counters, size,
+						       "sa counters");
+		if (dump->nr > 0)
+			memcpy(sas, dump->sas, dump->nr * sizeof(sas[0]));
+		pfreeany(dump->sas);
+		dump->sas = sas;
+		dump->size = size;
+	}
+	dump->sas[dump->nr++] = (struct sa_counters) {
+		.dst = *dst,
+		.spi = spi,
+		.proto = proto,
+		.bytes = bytes,
+		.add_time = add_time,
+	};
+}
+
+static int sa_counters_cmp(const void *l, const void *r)
+{
+	const struct sa_counters *lsa = l;
+	const struct sa_counters *rsa = r;
+
+	if (lsa->spi != rsa->spi)
+		return lsa->spi < rsa->spi ? -1 : 1;
+	if (lsa->proto != rsa->proto)
+		return lsa->proto < rsa->proto ? -1 : 1;
+	return addrcmp(&lsa->dst, &rsa->dst);
+}
+
+static void update_state_sa_info(struct state *st, void *context)
+{
+	const struct sa_counters_dump *dump = context;
+
+	for (int inbound = 0; inbound <= 1; inbound++) {
+		struct sa_counters key;
+		const ip_address *src;
+		const ip_address *dst;
+		u_int proto;
+		struct ipsec_proto_info *p2 = sa_info_said(st, inbound, &proto,
+							   &key.spi, &src, &dst);
+		if (p2 == NULL)
+			return;
+		key.proto = proto;
+		key.dst = *dst;
+		const struct sa_counters *sa = bsearch(&key, dump->sas, dump->nr,
+						       sizeof(dump->sas[0]),
+						       sa_counters_cmp);
+		if (sa != NULL)
+			update_sa_info(p2, inbound, sa->bytes, sa->add_time,
+				       dump->now);
+	}
+}
+
+/* dump the SAs, if the last dump is too old */
+static void refresh_sa_counters(monotime_t now)
+{
+	if (!is_monotime_epoch(sa_counters_dumped) &&
+	    monobefore(now, monotimesum(sa_counters_dumped, sa_counter_refresh)))
+		return;
+	sa_counters_dumped = now;
+
+	struct sa_counters_dump dump = {
+		.now = now,
+	};
+	if (kernel_ops->get_sas(add_sa_counters, &dump)) {
+		DBG(DBG_KERNEL,
+			DBG_log("refreshing SA counters from a dump of %u SAs",
+				dump.nr));
+		if (dump.nr > 0) {
+			qsort(dump.sas, dump.nr, sizeof(dump.sas[0]),
+			      sa_counters_cmp);
+			for_each_state(update_state_sa_info, &dump);
+		}
+	}
+	pfreeany(dump.sas);
+}
+
 /*
  * get information about a given sa - needs merging with was_eroute_idle
  *
@@ -3459,31 +3677,33 @@ bool get_sa_info(struct state *st, bool inbound, deltatime_t *ago /* OUTPUT */)
 	struct kernel_sa sa;
 	struct ipsec_proto_info *p2;
 
-	const struct connection *c = st->st_connection;
-
-	if (kernel_ops->get_sa == NULL || (!st->st_esp.present && !st->st_ah.present)) {
+	if (kernel_ops->get_sa == NULL) {
 		return FALSE;
 	}
 
-	if (st->st_esp.present) {
-		proto = SA_ESP;
-		p2 = &st->st_esp;
-	} else if (st->st_ah.present) {
-		proto = SA_AH;
-		p2 = &st->st_ah;
-	} else {
+	p2 = sa_info_said(st, inbound, &proto, &spi, &src, &dst);
+	if (p2 == NULL) {
 		return FALSE;
 	}
 
-	if (inbound) {
-		src = &c->spd.that.host_addr;
-		dst = &c->spd.this.host_addr;
-		spi = p2->our_spi;
-	} else {
-		src = &c->spd.this.host_addr;
-		dst = &c->spd.that.host_addr;
-		spi = p2->attrs.spi;
+	monotime_t now = mononow();
+
+	/* recent enough? */
+	if (deltasecs(sa_counter_refresh) > 0 && kernel_ops->get_sas != NULL) {
+		refresh_sa_counters(now);
+		monotime_t info_time = inbound ? p2->our_info_time :
+			p2->peer_info_time;
+		if (!is_monotime_epoch(info_time) &&
+		    monobefore(now, monotimesum(info_time, sa_counter_refresh))) {
+			if (ago != NULL)
+				*ago = monotimediff(now, inbound ?
+						    p2->our_lastused :
+						    p2->peer_lastused);
+			return TRUE;
+		}
+		/* not in the dump, presumably new */
 	}
+
 	set_text_said(text_said, dst, spi, proto);
 
 	zero(&sa);
@@ -3498,27 +3718,11 @@ bool get_sa_info(struct state *st, bool inbound, deltatime_t *ago /* OUTPUT */)
 	if (!kernel_ops->get_sa(&sa, &bytes, &add_time))
 		return FALSE;
 
-	p2->add_time = add_time;
+	update_sa_info(p2, inbound, bytes, add_time, now);
 
-	/* fied has been set? */
-	passert(!is_monotime_epoch(p2->our_lastused));
-	passert(!is_monotime_epoch(p2->peer_lastused));
-
-	if (inbound) {
-		if (bytes > p2->our_bytes) {
-			p2->our_bytes = bytes;
-			p2->our_lastused = mononow();
-		}
-		if (ago != NULL)
-			*ago = monotimediff(mononow(), p2->our_lastused);
-	} else {
-		if (bytes > p2->peer_bytes) {
-			p2->peer_bytes = bytes;
-			p2->peer_lastused = mononow();
-		}
-		if (ago != NULL)
-			*ago = monotimediff(mononow(), p2->peer_lastused);
-	}
+	if (ago != NULL)
+		*ago = monotimediff(now, inbound ? p2->our_lastused :
+				    p2->peer_lastused);
 	return TRUE;
 }
 
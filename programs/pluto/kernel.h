@@ -167,6 +167,11 @@ extern char *pluto_listen;	/* from --listen flag */
 #define SADB_X_EALG_AESCBC SADB_X_EALG_AES
 #endif
 
+/* called for each SA dumped by kernel_ops->get_sas() */
+typedef void kernel_sa_counters_cb(const ip_address *dst, ipsec_spi_t spi,
+				   int proto, uint64_t bytes,
+				   uint64_t add_time, void *context);
+
 struct kernel_ops {
 	enum kernel_interface type;
 	const char *kern_name;
@@ -220,8 +225,11 @@ struct kernel_ops {
 	bool (*grp_sa)(const struct kernel_sa *sa_outer,
 		       const struct kernel_sa *sa_inner);
 	bool (*del_sa)(const struct kernel_sa *sa);
+	void (*begin_batch)(void);
+	bool (*end_batch)(void);
 	bool (*get_sa)(const struct kernel_sa *sa, uint64_t *bytes,
 		       uint64_t *add_time);
+	bool (*get_sas)(kernel_sa_counters_cb *cb, void *context);
 	ipsec_spi_t (*get_spi)(const ip_address *src,
 			       const ip_address *dst,
 			       int proto,
@@ -391,6 +399,15 @@ extern ipsec_spi_t get_ipsec_spi(ipsec_spi_t avoid,
 				 bool tunnel_mode);
 extern ipsec_spi_t get_my_cpi(const struct spd_route *sr, bool tunnel_mode);
 
+/*
+ * Between begin_kernel_batch() and end_kernel_batch(), the kernel
+ * may queue SA and policy updates and send them together.  A queued
+ * update reports success; should any fail, end_kernel_batch() returns
+ * FALSE.
+ */
+extern void begin_kernel_batch(void);
+extern bool end_kernel_batch(void);
+
 extern bool install_inbound_ipsec_sa(struct state *st);
 extern bool install_ipsec_sa(struct state *st, bool inbound_also);
 extern void delete_ipsec_sa(struct state *st);
@@ -400,6 +417,7 @@ extern bool route_and_eroute(struct connection *c,
 
 extern bool was_eroute_idle(struct state *st, deltatime_t idle_max);
 extern bool get_sa_info(struct state *st, bool inbound, deltatime_t *ago /* OUTPUT */);
+extern deltatime_t sa_counter_refresh;	/* reuse counters this recent */
 extern bool migrate_ipsec_sa(struct state *st);
 
 
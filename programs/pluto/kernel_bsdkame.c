@@ -42,6 +42,7 @@
 #include "connections.h"
 #include "state.h"
 #include "kernel.h"
+#include "updown.h"
 #include "kernel_pfkey.h"
 #include "timer.h"
 #include "log.h"
@@ -248,7 +249,7 @@ static void bsdkame_process_raw_ifaces(struct raw_iface *rifaces)
 static bool bsdkame_do_command(const struct connection *c, const struct spd_route *sr,
 			       const char *verb, const char *verb_suffix, struct state *st)
 {
-	char cmd[1536]; /* arbitrary limit on shell command length */
+	char env[1536]; /* arbitrary limit on shell command length */
 	char common_shell_out_str[1024];
 
 	if (fmt_common_shell_out(common_shell_out_str,
@@ -259,20 +260,17 @@ static bool bsdkame_do_command(const struct connection *c, const struct spd_rout
 		return FALSE;
 	}
 
-	if (-1 == snprintf(cmd, sizeof(cmd),
-			   "2>&1 "      /* capture stderr along with stdout */
+	if (-1 == snprintf(env, sizeof(env),
 			   "PLUTO_VERB='%s%s' "
-			   "%s"         /* other stuff   */
-			   "%s",        /* actual script */
+			   "%s",        /* other stuff   */
 			   verb, verb_suffix,
-			   common_shell_out_str,
-			   sr->this.updown)) {
+			   common_shell_out_str)) {
 		loglog(RC_LOG_SERIOUS, "%s%s command too long!", verb,
 		       verb_suffix);
 		return FALSE;
 	}
 
-	return invoke_command(verb, verb_suffix, cmd);
+	return run_updown(c, verb, verb_suffix, env, sr->this.updown);
 }
 
 static void bsdkame_algregister(int satype, int supp_exttype,
@@ -40,6 +40,7 @@
 #include "connections.h"
 #include "state.h"
 #include "kernel.h"
+#include "updown.h"
 #include "kernel_pfkey.h"
 #include "timer.h"
 #include "log.h"
@@ -372,7 +373,7 @@ static void mast_process_raw_ifaces(struct raw_iface *rifaces)
 static bool mast_do_command(const struct connection *c, const struct spd_route *sr,
 			    const char *verb, const char *verb_suffix, struct state *st)
 {
-	char cmd[2048]; /* arbitrary limit on shell command length */
+	char env[2048]; /* arbitrary limit on shell command length */
 	char common_shell_out_str[2048];
 	IPsecSAref_t ref, refhim;
 
@@ -393,29 +394,26 @@ static bool mast_do_command(const struct connection *c, const struct spd_route *
 			    verb));
 	}
 
-	if (-1 == snprintf(cmd, sizeof(cmd),
-			   "2>&1 " /* capture stderr along with stdout */
+	if (-1 == snprintf(env, sizeof(env),
 			   "PLUTO_MY_REF=%u "
 			   "PLUTO_PEER_REF=%u "
 			   "PLUTO_SAREF_TRACKING=%s "
 			   "PLUTO_VERB='%s%s' "
-			   "%s"         /* other stuff   */
-			   "%s",        /* actual script */
+			   "%s",        /* other stuff   */
 			   ref,
 			   refhim,
 			   (c->policy & POLICY_SAREF_TRACK_CONNTRACK) ?
 			     "conntrack" :
 			   bool_str((c->policy & POLICY_SAREF_TRACK) != LEMPTY),
 			   verb, verb_suffix,
-			   common_shell_out_str,
-			   sr->this.updown))
+			   common_shell_out_str))
 	{
 		loglog(RC_LOG_SERIOUS, "%s%s command too long!", verb,
 		       verb_suffix);
 		return FALSE;
 	}
 
-	return invoke_command(verb, verb_suffix, cmd);
+	return run_updown(c, verb, verb_suffix, env, sr->this.updown);
 }
 
 static bool mast_do_command_vs(const struct connection *c, const struct spd_route *sr,
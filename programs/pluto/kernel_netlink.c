@@ -71,6 +71,7 @@
 #include "state.h"
 #include "connections.h"
 #include "kernel.h"
+#include "updown.h"
 #include "server.h"
 #include "nat_traversal.h"
 #include "state.h"
@@ -378,6 +379,228 @@ struct nlm_resp {
 	} u;
 };
 
+/*
+ * Batches.
+ *
+ * Between netlink_begin_batch() and netlink_end_batch(), requests
+ * that only need an acknowledgement (adding and deleting SAs and
+ * policies) are queued.  They are then written back-to-back, several
+ * to a datagram, and the acknowledgements are matched against them by
+ * sequence number.  Anything needing a reply (an SPI, SA or policy)
+ * first sends what is queued, so the kernel sees requests in order.
+ *
+ * A queued request's failure is logged when its acknowledgement
+ * arrives and netlink_end_batch() then returns FALSE.
+ */
+
+/*
+ * Small enough that all the acknowledgements (an error includes the
+ * request) fit in the socket's receive buffer.
+ */
+#define NETLINK_BATCH_MESSAGES 32
+#define NETLINK_BATCH_BYTES (32 * 1024)
+
+struct netlink_request {
+	struct netlink_request *next;
+	const char *description;
+	char *text_said;
+	bool enoent_ok;
+	bool acked;
+	struct nlmsghdr *msg;
+};
+
+static struct {
+	unsigned depth;
+	struct netlink_request *queued;
+	struct netlink_request **queued_tail;
+	unsigned nr_queued;
+	size_t queued_bytes;
+	bool failed;
+} netlink_batch = {
+	.queued_tail = &netlink_batch.queued,
+};
+
+static uint32_t netlink_seq = 0;	/* STATIC */
+
+static void netlink_request_failed(const struct netlink_request *req,
+				   int error)
+{
+	if (req->msg->nlmsg_type == XFRM_MSG_UPDSA && error == ESRCH) {
+		loglog(RC_LOG_SERIOUS,
+			"Warning: kernel expired our reserved IPsec SA SPI - negotiation took too long? Try increasing /proc/sys/net/core/xfrm_acq_expires");
+	}
+	loglog(RC_LOG_SERIOUS,
+		"ERROR: netlink %s response for %s %s included errno %d: %s",
+		sparse_val_show(xfrm_type_names, req->msg->nlmsg_type),
+		req->description, req->text_said, error, strerror(error));
+	netlink_batch.failed = TRUE;
+}
+
+/*
+ * Wait for the acknowledgement of each request in REQS (already
+ * written with sequence numbers FIRST_SEQ...).
+ */
+static void netlink_batch_acks(struct netlink_request *reqs, unsigned nr,
+			       uint32_t first_seq)
+{
+	unsigned nr_acked = 0;
+
+	while (nr_acked < nr) {
+		struct nlm_resp rsp;
+		struct sockaddr_nl addr;
+		socklen_t alen = sizeof(addr);
+		ssize_t r = recvfrom(nl_send_fd, &rsp, sizeof(rsp), 0,
+				     (struct sockaddr *)&addr, &alen);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			LOG_ERRNO(errno,
+				  "netlink recvfrom() of responses to %u batched messages failed",
+				  nr - nr_acked);
+			netlink_batch.failed = TRUE;
+			return;
+		} else if ((size_t) r < sizeof(rsp.n)) {
+			libreswan_log("netlink read truncated message: %zd bytes; ignore message",
+				      r);
+			continue;
+		} else if (addr.nl_pid != 0) {
+			/* not for us: ignore */
+			continue;
+		}
+
+		/* out of window, or a repeat, is ignored */
+		uint32_t offset = rsp.n.nlmsg_seq - first_seq;
+		struct netlink_request *req = reqs;
+		for (uint32_t i = 0; req != NULL && i < offset && i < nr; i++)
+			req = req->next;
+		if (offset >= nr || req == NULL || req->acked) {
+			DBG(DBG_KERNEL,
+				DBG_log("netlink: ignoring out of sequence (%u/%u..%u) message %s",
+					rsp.n.nlmsg_seq, first_seq,
+					first_seq + nr - 1,
+					sparse_val_show(xfrm_type_names,
+							rsp.n.nlmsg_type)));
+			continue;
+		}
+		req->acked = TRUE;
+		nr_acked++;
+
+		if (rsp.n.nlmsg_type != NLMSG_ERROR) {
+			/* not an acknowledgement, but not an error either */
+			continue;
+		}
+		int error = -rsp.u.e.error;
+		if (error == 0 || (error == ENOENT && req->enoent_ok))
+			continue;
+		netlink_request_failed(req, error);
+	}
+}
+
+/*
+ * Write the queued requests, as few datagrams as possible, and wait
+ * for them to be acknowledged.
+ */
+static void netlink_flush_batch(void)
+{
+	while (netlink_batch.queued != NULL) {
+		struct netlink_request *reqs = netlink_batch.queued;
+		char buf[NETLINK_BATCH_BYTES];
+		size_t len = 0;
+		unsigned nr = 0;
+		uint32_t first_seq = netlink_seq + 1;
+
+		/* always send at least one */
+		for (struct netlink_request *req = reqs;
+		     req != NULL && nr < NETLINK_BATCH_MESSAGES;
+		     req = req->next) {
+			size_t msg_len = NLMSG_ALIGN(req->msg->nlmsg_len);
+			if (nr > 0 && len + msg_len > sizeof(buf))
+				break;
+			passert(msg_len <= sizeof(buf));
+			req->msg->nlmsg_seq = ++netlink_seq;
+			memcpy(buf + len, req->msg, req->msg->nlmsg_len);
+			len += msg_len;
+			nr++;
+		}
+
+		DBG(DBG_KERNEL,
+			DBG_log("netlink: writing %u batched messages (%zu bytes)",
+				nr, len));
+		ssize_t r;
+		do {
+			r = write(nl_send_fd, buf, len);
+		} while (r < 0 && errno == EINTR);
+		if (r < 0) {
+			LOG_ERRNO(errno, "netlink write() of %u batched messages failed",
+				  nr);
+			netlink_batch.failed = TRUE;
+		} else if ((size_t)r != len) {
+			loglog(RC_LOG_SERIOUS,
+				"ERROR: netlink write() of %u batched messages truncated: %zd instead of %zu",
+				nr, r, len);
+			netlink_batch.failed = TRUE;
+		} else {
+			netlink_batch_acks(reqs, nr, first_seq);
+		}
+
+		/* done with these */
+		for (unsigned i = 0; i < nr; i++) {
+			struct netlink_request *req = netlink_batch.queued;
+			netlink_batch.queued = req->next;
+			pfree(req->msg);
+			pfreeany(req->text_said);
+			pfree(req);
+		}
+		netlink_batch.nr_queued -= nr;
+	}
+	netlink_batch.queued_tail = &netlink_batch.queued;
+	netlink_batch.queued_bytes = 0;
+}
+
+/*
+ * When batching, queue HDR (which must be acknowledged) and return
+ * TRUE; otherwise return FALSE and leave sending it to the caller.
+ */
+static bool netlink_queue_msg(const struct nlmsghdr *hdr, bool enoent_ok,
+			      const char *description, const char *text_said)
+{
+	if (netlink_batch.depth == 0 || !(hdr->nlmsg_flags & NLM_F_ACK))
+		return FALSE;
+
+	struct netlink_request *req = alloc_thing(struct netlink_request,
+						  "netlink request");
+	req->description = description;
+	req->text_said = clone_str(text_said, "netlink request said");
+	req->enoent_ok = enoent_ok;
+	req->msg = clone_bytes(hdr, hdr->nlmsg_len, "netlink request message");
+
+	*netlink_batch.queued_tail = req;
+	netlink_batch.queued_tail = &req->next;
+	netlink_batch.nr_queued++;
+	netlink_batch.queued_bytes += NLMSG_ALIGN(hdr->nlmsg_len);
+
+	if (netlink_batch.nr_queued >= NETLINK_BATCH_MESSAGES ||
+	    netlink_batch.queued_bytes >= NETLINK_BATCH_BYTES)
+		netlink_flush_batch();
+	return TRUE;
+}
+
+/* batches nest; the outermost sends */
+static void netlink_begin_batch(void)
+{
+	if (netlink_batch.depth++ == 0)
+		netlink_batch.failed = FALSE;
+}
+
+static bool netlink_end_batch(void)
+{
+	passert(netlink_batch.depth > 0);
+	if (--netlink_batch.depth > 0)
+		return TRUE;
+	netlink_flush_batch();
+	return !netlink_batch.failed;
+}
+
 /*
  * send_netlink_msg
  *
@@ -399,11 +622,14 @@ static bool send_netlink_msg(struct nlmsghdr *hdr,
 	size_t len;
 	ssize_t r;
 	struct sockaddr_nl addr;
-	static uint32_t seq = 0;	/* STATIC */
+	uint32_t seq;
+
+	/* what is queued goes first */
+	netlink_flush_batch();
 
 	netlink_errno = 0;
 
-	hdr->nlmsg_seq = ++seq;
+	seq = hdr->nlmsg_seq = ++netlink_seq;
 	len = hdr->nlmsg_len;
 	do {
 		r = write(nl_send_fd, hdr, len);
@@ -517,6 +743,9 @@ static bool netlink_policy(struct nlmsghdr *hdr, bool enoent_ok,
 {
 	struct nlm_resp rsp;
 
+	if (netlink_queue_msg(hdr, enoent_ok, "policy", text_said))
+		return TRUE;
+
 	if (!send_netlink_msg(hdr, NLMSG_ERROR, &rsp, "policy", text_said))
 		return FALSE;
 
@@ -1645,6 +1874,11 @@ static bool netlink_add_sa(const struct kernel_sa *sa, bool replace)
 		attr = (struct rtattr *)((char *)attr + attr->rta_len);
 	}
 #endif
+	/* with NIC offload, the caller retries a failure without it */
+	if (sa->nic_offload_dev == NULL &&
+	    netlink_queue_msg(&req.n, FALSE, "Add SA", sa->text_said))
+		return TRUE;
+
 	ret = send_netlink_msg(&req.n, NLMSG_NOOP, NULL, "Add SA", sa->text_said);
 	if (!ret && netlink_errno == ESRCH &&
 		req.n.nlmsg_type == XFRM_MSG_UPDSA) {
@@ -1680,6 +1914,9 @@ static bool netlink_del_sa(const struct kernel_sa *sa)
 
 	req.n.nlmsg_len = NLMSG_ALIGN(NLMSG_LENGTH(sizeof(req.id)));
 
+	if (netlink_queue_msg(&req.n, FALSE, "Del SA", sa->text_said))
+		return TRUE;
+
 	return send_netlink_msg(&req.n, NLMSG_NOOP, NULL, "Del SA", sa->text_said);
 }
 
@@ -2713,10 +2950,113 @@ static bool netlink_get_sa(const struct kernel_sa *sa, uint64_t *bytes,
 	return TRUE;
 }
 
+/*
+ * Dump all the SAs, passing each one's counters to CB.
+ */
+static bool netlink_get_sas(kernel_sa_counters_cb *cb, void *context)
+{
+	struct {
+		struct nlmsghdr n;
+	} req;
+
+	/* what is queued goes first */
+	netlink_flush_batch();
+
+	zero(&req);
+	req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.n.nlmsg_type = XFRM_MSG_GETSA;
+	req.n.nlmsg_len = NLMSG_LENGTH(0);
+	req.n.nlmsg_seq = ++netlink_seq;
+
+	ssize_t r;
+	do {
+		r = write(nl_send_fd, &req, req.n.nlmsg_len);
+	} while (r < 0 && errno == EINTR);
+	if (r != (ssize_t)req.n.nlmsg_len) {
+		LOG_ERRNO(errno, "netlink write() of SA dump request failed");
+		return FALSE;
+	}
+
+	/* a dump is several multi-part messages, each holding several SAs */
+	const size_t buf_size = 64 * 1024;
+	char *buf = alloc_bytes(buf_size, "netlink SA dump");
+	bool ok = FALSE;
+	unsigned nr = 0;
+
+	for (;;) {
+		struct sockaddr_nl addr;
+		socklen_t alen = sizeof(addr);
+
+		r = recvfrom(nl_send_fd, buf, buf_size, 0,
+			     (struct sockaddr *)&addr, &alen);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			LOG_ERRNO(errno, "netlink recvfrom() of SA dump failed");
+			break;
+		} else if (addr.nl_pid != 0) {
+			/* not for us: ignore */
+			continue;
+		}
+
+		bool done = FALSE;
+		size_t len = r;
+		for (struct nlmsghdr *n = (struct nlmsghdr *)buf;
+		     !done && NLMSG_OK(n, len); n = NLMSG_NEXT(n, len)) {
+			if (n->nlmsg_seq != req.n.nlmsg_seq) {
+				DBG(DBG_KERNEL,
+					DBG_log("netlink: ignoring out of sequence (%u/%u) message %s",
+						n->nlmsg_seq, req.n.nlmsg_seq,
+						sparse_val_show(xfrm_type_names,
+								n->nlmsg_type)));
+				continue;
+			}
+			switch (n->nlmsg_type) {
+			case NLMSG_DONE:
+				ok = TRUE;
+				done = TRUE;
+				break;
+			case NLMSG_ERROR:
+			{
+				const struct nlmsgerr *e = NLMSG_DATA(n);
+				loglog(RC_LOG_SERIOUS,
+					"ERROR: netlink SA dump failed with errno %d: %s",
+					-e->error, strerror(-e->error));
+				done = TRUE;
+				break;
+			}
+			case XFRM_MSG_NEWSA:
+			{
+				const struct xfrm_usersa_info *info = NLMSG_DATA(n);
+				ip_address dst;
+
+				if (n->nlmsg_len < NLMSG_LENGTH(sizeof(*info)))
+					break;
+				zero(&dst);
+				xfrm2ip(&info->id.daddr, &dst, info->family);
+				cb(&dst, info->id.spi, info->id.proto,
+				   info->curlft.bytes, info->curlft.add_time,
+				   context);
+				nr++;
+				break;
+			}
+			default:
+				break;
+			}
+		}
+		if (done)
+			break;
+	}
+
+	pfree(buf);
+	DBG(DBG_KERNEL, DBG_log("netlink: SA dump returned %u SAs", nr));
+	return ok;
+}
+
 static bool netkey_do_command(const struct connection *c, const struct spd_route *sr,
 			const char *verb, const char *verb_suffix, struct state *st)
 {
-	char cmd[2048];	/* arbitrary limit on shell command length */
+	char env[2048];	/* arbitrary limit on shell command length */
 	char common_shell_out_str[2048];
 
 	if (-1 == fmt_common_shell_out(common_shell_out_str,
@@ -2727,17 +3067,16 @@ static bool netkey_do_command(const struct connection *c, const struct spd_route
 		return FALSE;
 	}
 
-	if (-1 == snprintf(cmd, sizeof(cmd),
-				"PLUTO_VERB='%s%s' %s%s 2>&1",
+	if (-1 == snprintf(env, sizeof(env),
+				"PLUTO_VERB='%s%s' %s",
 				verb, verb_suffix,
-				common_shell_out_str,
-				sr->this.updown)) {
+				common_shell_out_str)) {
 		loglog(RC_LOG_SERIOUS, "%s%s command too long!", verb,
 			verb_suffix);
 		return FALSE;
 	}
 
-	return invoke_command(verb, verb_suffix, cmd);
+	return run_updown(c, verb, verb_suffix, env, sr->this.updown);
 }
 
 /* add bypass policies/holes icmp */
@@ -2975,7 +3314,10 @@ const struct kernel_ops netkey_kernel_ops = {
 	.raw_eroute = netlink_raw_eroute,
 	.add_sa = netlink_add_sa,
 	.del_sa = netlink_del_sa,
+	.begin_batch = netlink_begin_batch,
+	.end_batch = netlink_end_batch,
 	.get_sa = netlink_get_sa,
+	.get_sas = netlink_get_sas,
 	.process_queue = NULL,
 	.grp_sa = NULL,
 	.get_spi = netlink_get_spi,
@@ -357,13 +357,12 @@ struct tac_state {
 	char *tn;       /* roof of tried[] */
 };
 
-static bool take_a_crack(struct tac_state *s,
-			 struct pubkey *kr,
-			 const char *story)
+/* record the outcome of trying KR; true when it worked */
+static bool record_a_crack(struct tac_state *s,
+			   const struct pubkey *kr,
+			   const char *story,
+			   err_t ugh)
 {
-	err_t ugh =
-		(s->try_RSA_signature)(s->hash_val, s->hash_len, s->sig_pbs,
-				       kr, s->st);
 	const struct RSA_public_key *k = &kr->u.rsa;
 
 	s->tried_cnt++;
@@ -389,6 +388,144 @@ static bool take_a_crack(struct tac_state *s,
 	}
 }
 
+static bool take_a_crack(struct tac_state *s,
+			 struct pubkey *kr,
+			 const char *story)
+{
+	err_t ugh =
+		(s->try_RSA_signature)(s->hash_val, s->hash_len, s->sig_pbs,
+				       kr, s->st);
+	return record_a_crack(s, kr, story, ugh);
+}
+
+/*
+ * Return the preloaded public keys that could have signed for the
+ * peer of C; each is referenced.  Expired keys are deleted.
+ */
+struct pubkey **RSA_signature_candidates(const struct connection *c,
+					 unsigned *nr_keys)
+{
+	realtime_t nw = realnow();
+	struct pubkey **keys = NULL;
+	unsigned nr_allocated = 0;
+
+	*nr_keys = 0;
+
+	DBG(DBG_CONTROL, {
+		char buf[IDTOA_BUF];
+		dntoa_or_null(buf, IDTOA_BUF, c->spd.that.ca, "%any");
+		DBG_log("required CA is '%s'", buf);
+	});
+
+	struct pubkey_list **pp = &pluto_pubkeys;
+
+	for (struct pubkey_list *p = pluto_pubkeys; p != NULL; p = *pp) {
+		struct pubkey *key = p->key;
+		char printkid[IDTOA_BUF];
+
+		idtoa(&key->id, printkid, IDTOA_BUF);
+		DBG(DBG_CONTROL, {
+			char thatid[IDTOA_BUF];
+			idtoa(&c->spd.that.id, thatid, IDTOA_BUF);
+			DBG_log("checking keyid '%s' for match with '%s'",
+				printkid, thatid);
+		});
+
+		int pl;	/* value ignored */
+
+		if (key->alg == PUBKEY_ALG_RSA &&
+		    same_id(&c->spd.that.id, &key->id) &&
+		    trusted_ca_nss(key->issuer, c->spd.that.ca, &pl))
+		{
+			DBG(DBG_CONTROL, {
+				char buf[IDTOA_BUF];
+				dntoa_or_null(buf, IDTOA_BUF,
+					key->issuer, "%any");
+				DBG_log("key issuer CA is '%s'", buf);
+			});
+
+			/* check if found public key has expired */
+			if (!is_realtime_epoch(key->until_time) &&
+			    realbefore(key->until_time, nw))
+			{
+				loglog(RC_LOG_SERIOUS,
+				       "cached RSA public key has expired and has been deleted");
+				*pp = free_public_keyentry(p);
+				continue; /* continue with next public key */
+			}
+
+			if (*nr_keys == nr_allocated) {
+				nr_allocated = nr_allocated * 2 + 4;
+				struct pubkey **more =
+					alloc_things(struct pubkey *, nr_allocated,
+						     "RSA signature candidates");
+				if (keys != NULL) {
+					memcpy(more, keys, *nr_keys * sizeof(keys[0]));
+					pfree(keys);
+				}
+				keys = more;
+			}
+			keys[(*nr_keys)++] = reference_key(key);
+		}
+		pp = &p->next;
+	}
+	return keys;
+}
+
+void release_RSA_signature_candidates(struct pubkey ***keys, unsigned nr_keys)
+{
+	if (*keys == NULL) {
+		return;
+	}
+	for (unsigned i = 0; i < nr_keys; i++) {
+		unreference_key(&(*keys)[i]);
+	}
+	pfree(*keys);
+	*keys = NULL;
+}
+
+/* no acceptable key was found: diagnose */
+static stf_status RSA_signature_failed(const struct tac_state *s)
+{
+	char id_buf[IDTOA_BUF]; /* arbitrary limit on length of ID reported */
+
+	(void) idtoa(&s->st->st_connection->spd.that.id, id_buf,
+		     sizeof(id_buf));
+
+	if (s->best_ugh == NULL) {
+		loglog(RC_LOG_SERIOUS,
+		       "no RSA public key known for '%s'",
+		       id_buf);
+
+		/* ??? is this the best code there is? */
+		return STF_FAIL + INVALID_KEY_INFORMATION;
+	}
+
+	if (s->best_ugh[0] == '9') {
+		loglog(RC_LOG_SERIOUS, "%s", s->best_ugh + 1);
+		/* XXX Could send notification back */
+		return STF_FAIL + INVALID_HASH_INFORMATION;
+	} else {
+		if (s->tried_cnt == 1) {
+			loglog(RC_LOG_SERIOUS,
+			       "Signature check (on %s) failed (wrong key?); tried%s",
+			       id_buf, s->tried);
+			DBG(DBG_CONTROL,
+			    DBG_log("public key for %s failed: decrypted SIG payload into a malformed ECB (%s)",
+				    id_buf, s->best_ugh + 1));
+		} else {
+			loglog(RC_LOG_SERIOUS,
+			       "Signature check (on %s) failed: tried%s keys but none worked.",
+			       id_buf, s->tried);
+			DBG(DBG_CONTROL,
+			    DBG_log("all %d public keys for %s failed: best decrypted SIG payload into a malformed ECB (%s)",
+				    s->tried_cnt, id_buf,
+				    s->best_ugh + 1));
+		}
+		return STF_FAIL + INVALID_KEY_INFORMATION;
+	}
+}
+
 stf_status RSA_check_signature_gen(struct state *st,
 				   const u_char hash_val[MAX_DIGEST_LEN],
 				   size_t hash_len,
@@ -400,7 +537,6 @@ stf_status RSA_check_signature_gen(struct state *st,
 					   struct pubkey *kr,
 					   struct state *st))
 {
-	const struct connection *c = st->st_connection;
 	struct tac_state s;
 
 	s.st = st;
@@ -414,59 +550,17 @@ stf_status RSA_check_signature_gen(struct state *st,
 	s.tn = s.tried;
 
 	/* try all appropriate Public keys */
-	{
-		realtime_t nw = realnow();
-
-		DBG(DBG_CONTROL, {
-			char buf[IDTOA_BUF];
-			dntoa_or_null(buf, IDTOA_BUF, c->spd.that.ca, "%any");
-			DBG_log("required CA is '%s'", buf);
-		});
-
-		struct pubkey_list **pp = &pluto_pubkeys;
-
-		for (struct pubkey_list *p = pluto_pubkeys; p != NULL; p = *pp) {
-			struct pubkey *key = p->key;
-			char printkid[IDTOA_BUF];
-
-			idtoa(&key->id, printkid, IDTOA_BUF);
-			DBG(DBG_CONTROL, {
-				char thatid[IDTOA_BUF];
-				idtoa(&c->spd.that.id, thatid, IDTOA_BUF);
-				DBG_log("checking keyid '%s' for match with '%s'",
-					printkid, thatid);
-			});
-
-			int pl;	/* value ignored */
-
-			if (key->alg == PUBKEY_ALG_RSA &&
-			    same_id(&c->spd.that.id, &key->id) &&
-			    trusted_ca_nss(key->issuer, c->spd.that.ca, &pl))
-			{
-				DBG(DBG_CONTROL, {
-					char buf[IDTOA_BUF];
-					dntoa_or_null(buf, IDTOA_BUF,
-						key->issuer, "%any");
-					DBG_log("key issuer CA is '%s'", buf);
-				});
-
-				/* check if found public key has expired */
-				if (!is_realtime_epoch(key->until_time) &&
-				    realbefore(key->until_time, nw))
-				{
-					loglog(RC_LOG_SERIOUS,
-					       "cached RSA public key has expired and has been deleted");
-					*pp = free_public_keyentry(p);
-					continue; /* continue with next public key */
-				}
-
-				if (take_a_crack(&s, key, "preloaded key")) {
-					loglog(RC_LOG_SERIOUS, "Authenticated using RSA");
-					return STF_OK;
-				}
-			}
-			pp = &p->next;
-		}
+	unsigned nr_keys;
+	struct pubkey **keys = RSA_signature_candidates(st->st_connection,
+							&nr_keys);
+	bool cracked = FALSE;
+	for (unsigned i = 0; i < nr_keys && !cracked; i++) {
+		cracked = take_a_crack(&s, keys[i], "preloaded key");
+	}
+	release_RSA_signature_candidates(&keys, nr_keys);
+	if (cracked) {
+		loglog(RC_LOG_SERIOUS, "Authenticated using RSA");
+		return STF_OK;
 	}
 
 	/* if no key was found (evidenced by best_ugh == NULL)
@@ -475,46 +569,49 @@ stf_status RSA_check_signature_gen(struct state *st,
 	 */
 	/* To be re-implemented */
 
-	/* no acceptable key was found: diagnose */
-	{
-		char id_buf[IDTOA_BUF]; /* arbitrary limit on length of ID reported */
+	return RSA_signature_failed(&s);
+}
 
-		(void) idtoa(&st->st_connection->spd.that.id, id_buf,
-			     sizeof(id_buf));
+/*
+ * Check a signature using KEY; used by both RSA_check_signature_gen()'s
+ * callbacks and by the crypto helpers (so it must not touch any
+ * state).
+ */
+err_t try_RSA_signature_nss(const struct RSA_public_key *k,
+			    const u_char *hash_val, size_t hash_len,
+			    const u_char *sig_val, size_t sig_len)
+{
+	/* decrypt the signature -- reversing RSA_sign_hash */
+	if (sig_len != k->k)
+		return "1" "SIG length does not match public key length";
 
-		if (s.best_ugh == NULL) {
-				loglog(RC_LOG_SERIOUS,
-				       "no RSA public key known for '%s'",
-				       id_buf);
+	return RSA_signature_verify_nss(k, hash_val, hash_len, sig_val,
+					sig_len);
+}
 
-			/* ??? is this the best code there is? */
-			return STF_FAIL + INVALID_KEY_INFORMATION;
-		}
+stf_status RSA_check_signature_results(struct state *st,
+				       struct pubkey **keys,
+				       const err_t *ughs,
+				       unsigned nr_tried)
+{
+	struct tac_state s;
 
-		if (s.best_ugh[0] == '9') {
-			loglog(RC_LOG_SERIOUS, "%s", s.best_ugh + 1);
-			/* XXX Could send notification back */
-			return STF_FAIL + INVALID_HASH_INFORMATION;
-		} else {
-			if (s.tried_cnt == 1) {
-				loglog(RC_LOG_SERIOUS,
-				       "Signature check (on %s) failed (wrong key?); tried%s",
-				       id_buf, s.tried);
-				DBG(DBG_CONTROL,
-				    DBG_log("public key for %s failed: decrypted SIG payload into a malformed ECB (%s)",
-					    id_buf, s.best_ugh + 1));
-			} else {
-				loglog(RC_LOG_SERIOUS,
-				       "Signature check (on %s) failed: tried%s keys but none worked.",
-				       id_buf, s.tried);
-				DBG(DBG_CONTROL,
-				    DBG_log("all %d public keys for %s failed: best decrypted SIG payload into a malformed ECB (%s)",
-					    s.tried_cnt, id_buf,
-					    s.best_ugh + 1));
-			}
-			return STF_FAIL + INVALID_KEY_INFORMATION;
+	zero(&s);
+	s.st = st;
+	s.best_ugh = NULL;
+	s.tried_cnt = 0;
+	s.tn = s.tried;
+
+	for (unsigned i = 0; i < nr_tried; i++) {
+		if (record_a_crack(&s, keys[i], "preloaded key", ughs[i])) {
+			unreference_key(&st->st_peer_pubkey);
+			st->st_peer_pubkey = reference_key(keys[i]);
+			loglog(RC_LOG_SERIOUS, "Authenticated using RSA");
+			return STF_OK;
 		}
 	}
+
+	return RSA_signature_failed(&s);
 }
 
 /*
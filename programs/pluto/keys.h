@@ -75,4 +75,22 @@ extern stf_status RSA_check_signature_gen(struct state *st,
 						  struct pubkey *kr,
 						  struct state *st));
 
+/*
+ * For checking signatures in a crypto helper: the main thread
+ * collects (and references) the candidate keys, a helper tries them
+ * in order stopping at the first that works, and then the main
+ * thread logs the results (and releases the keys).
+ */
+extern struct pubkey **RSA_signature_candidates(const struct connection *c,
+						unsigned *nr_keys);
+extern void release_RSA_signature_candidates(struct pubkey ***keys,
+					     unsigned nr_keys);
+extern err_t try_RSA_signature_nss(const struct RSA_public_key *k,
+				   const u_char *hash_val, size_t hash_len,
+				   const u_char *sig_val, size_t sig_len);
+extern stf_status RSA_check_signature_results(struct state *st,
+					      struct pubkey **keys,
+					      const err_t *ughs,
+					      unsigned nr_tried);
+
 #endif /* _KEYS_H */
@@ -0,0 +1,752 @@
+/* metrics, in the Prometheus text format, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Counters, gauges and fixed-bucket histograms, kept by the main
+ * thread and rendered in the Prometheus text exposition format for
+ * whack --metrics and, optionally, for HTTP clients of
+ * --metrics-socket.
+ *
+ * The hooks are meant for the hot paths: a histogram observation
+ * is a walk over a dozen or so bucket bounds and three additions.
+ * Everything else happens when the metrics are rendered.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+
+#include <libreswan.h>
+
+#include "sysdep.h"
+#include "socketwrapper.h"
+#include "constants.h"
+#include "defs.h"
+#include "lswlog.h"
+#include "ip_address.h"
+#include "log.h"
+#include "server.h"
+#include "state.h"
+#include "demux.h"
+#include "pluto_crypt.h"
+#include "pluto_stats.h"
+#include "metrics.h"
+
+char *metrics_socket = NULL;
+
+/*
+ * Histograms.
+ *
+ * Times are kept in microseconds.  The buckets aren't cumulative
+ * (that is done when rendering) and the last is +Inf.
+ */
+
+static const uintmax_t bucket_bounds[] = {
+	100, 250, 500,
+	1000, 2500, 5000,
+	10000, 25000, 50000,
+	100000, 250000, 500000,
+	1000000, 2500000, 5000000,
+	10000000,
+};
+
+struct histogram {
+	uintmax_t bucket[elemsof(bucket_bounds) + 1];
+	uintmax_t count;
+	uintmax_t sum;
+};
+
+static void observe(struct histogram *h, uintmax_t us)
+{
+	unsigned b = 0;
+
+	while (b < elemsof(bucket_bounds) && us > bucket_bounds[b])
+		b++;
+	h->bucket[b]++;
+	h->count++;
+	h->sum += us;
+}
+
+/*
+ * Packet rates.
+ *
+ * Count the packets during the current second, and remember the
+ * count for the second before; the rate is the count for the last
+ * complete second.
+ */
+
+struct rate {
+	intmax_t second;
+	unsigned long count;	/* during SECOND */
+	unsigned long last;	/* during SECOND - 1 */
+	unsigned long total;
+};
+
+static void rate_add(struct rate *r, intmax_t second, unsigned n)
+{
+	if (second != r->second) {
+		r->last = second == r->second + 1 ? r->count : 0;
+		r->second = second;
+		r->count = 0;
+	}
+	r->count += n;
+	r->total += n;
+}
+
+static unsigned long rate_per_second(const struct rate *r, intmax_t now)
+{
+	return now == r->second ? r->last :
+		now == r->second + 1 ? r->count :
+		0;
+}
+
+static struct rate packets_received;
+static struct rate packets_sent;
+
+void metrics_packets_received(monotime_t now, unsigned n)
+{
+	rate_add(&packets_received, monosecs(now), n);
+}
+
+void metrics_packet_sent(void)
+{
+	rate_add(&packets_sent, monosecs(mononow()), 1);
+}
+
+/*
+ * State transitions, by exchange type.
+ */
+
+static const struct exchange {
+	enum isakmp_xchg_types xchg;
+	const char *labels;
+} exchanges[] = {
+	{ ISAKMP_XCHG_IDPROT, "version=\"ikev1\",exchange=\"main\"", },
+	{ ISAKMP_XCHG_AGGR, "version=\"ikev1\",exchange=\"aggressive\"", },
+	{ ISAKMP_XCHG_QUICK, "version=\"ikev1\",exchange=\"quick\"", },
+	{ ISAKMP_XCHG_INFO, "version=\"ikev1\",exchange=\"informational\"", },
+	{ ISAKMP_XCHG_MODE_CFG, "version=\"ikev1\",exchange=\"mode_cfg\"", },
+	{ ISAKMP_v2_SA_INIT, "version=\"ikev2\",exchange=\"ike_sa_init\"", },
+	{ ISAKMP_v2_AUTH, "version=\"ikev2\",exchange=\"ike_auth\"", },
+	{ ISAKMP_v2_CREATE_CHILD_SA, "version=\"ikev2\",exchange=\"create_child_sa\"", },
+	{ ISAKMP_v2_INFORMATIONAL, "version=\"ikev2\",exchange=\"informational\"", },
+};
+
+static const char other_exchange_labels[] = "version=\"\",exchange=\"other\"";
+
+static struct histogram transitions[elemsof(exchanges) + 1];	/* + other */
+
+void metrics_transition(struct msg_digest *md)
+{
+	if (md == NULL || is_monotime_epoch(md->arrived))
+		return;
+
+	uintmax_t us = monotime_elapsed_us(md->arrived, mononow());
+	md->arrived = monotime_epoch;	/* only the first transition */
+
+	unsigned e = 0;
+
+	while (e < elemsof(exchanges) && exchanges[e].xchg != md->hdr.isa_xchg)
+		e++;
+	observe(&transitions[e], us);
+}
+
+/*
+ * Crypto requests, by operation: the wait for a helper, the time it
+ * took, and the CPU time it used.  These are also what whack
+ * --globalstatus reports.
+ */
+
+static const char *const crypto_operations[] = {
+	[pcr_build_ke_and_nonce] = "ke_and_nonce",
+	[pcr_build_nonce] = "nonce",
+	[pcr_compute_dh_iv] = "dh_iv",
+	[pcr_compute_dh] = "dh",
+	[pcr_compute_dh_v2] = "dh_v2",
+	[pcr_rsa_sign] = "rsa_sign",
+	[pcr_rsa_verify] = "rsa_verify",
+	[pcr_x509_verify] = "x509_verify",
+};
+
+static struct crypto_op {
+	struct histogram wait;
+	struct histogram time;
+	uintmax_t wait_max_us;
+	uintmax_t cpu_us;
+} crypto_ops[elemsof(crypto_operations)];
+
+void metrics_crypto(enum pluto_crypto_requests type, monotime_t queued,
+		    monotime_t started, monotime_t finished, uintmax_t cpu_us)
+{
+	if ((unsigned)type >= elemsof(crypto_ops))
+		return;
+
+	struct crypto_op *op = &crypto_ops[type];
+	uintmax_t wait_us = monotime_elapsed_us(queued, started);
+
+	observe(&op->wait, wait_us);
+	if (wait_us > op->wait_max_us)
+		op->wait_max_us = wait_us;
+	observe(&op->time, monotime_elapsed_us(started, finished));
+	op->cpu_us += cpu_us;
+}
+
+void show_crypto_metrics_status(void)
+{
+	for (unsigned c = 0; c < elemsof(crypto_ops); c++) {
+		const char *name = crypto_operations[c];
+		const struct crypto_op *op = &crypto_ops[c];
+
+		whack_log_comment("total.crypto.%s.requests=%ju",
+				  name, op->time.count);
+		whack_log_comment("total.crypto.%s.wait=%juus",
+				  name, op->wait.sum);
+		whack_log_comment("total.crypto.%s.wait.max=%juus",
+				  name, op->wait_max_us);
+		whack_log_comment("total.crypto.%s.time=%juus",
+				  name, op->time.sum);
+		whack_log_comment("total.crypto.%s.cpu=%juus",
+				  name, op->cpu_us);
+	}
+}
+
+void clear_crypto_metrics(void)
+{
+	zero(&crypto_ops);
+}
+
+/*
+ * Rendering.
+ */
+
+struct text {
+	char *ptr;	/* NUL terminated */
+	size_t len;
+	size_t size;
+};
+
+static void text_grow(struct text *t, size_t need)
+{
+	if (t->len + need < t->size)
+		return;
+
+	size_t size = t->size == 0 ? 4096 : t->size;
+
+	while (t->len + need >= size)
+		size *= 2;
+
+	char *ptr = alloc_bytes(size, "metrics text");
+
+	if (t->ptr != NULL) {
+		memcpy(ptr, t->ptr, t->len + 1);
+		pfree(t->ptr);
+	}
+	t->ptr = ptr;
+	t->size = size;
+}
+
+static void tprintf(struct text *t, const char *fmt, ...) PRINTF_LIKE(2);
+
+static void tprintf(struct text *t, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	int n = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+	passert(n >= 0);
+
+	text_grow(t, n);
+	va_start(ap, fmt);
+	vsnprintf(t->ptr + t->len, t->size - t->len, fmt, ap);
+	va_end(ap);
+	t->len += n;
+}
+
+static void tappend(struct text *t, const char *ptr, size_t len)
+{
+	text_grow(t, len);
+	memcpy(t->ptr + t->len, ptr, len);
+	t->len += len;
+	t->ptr[t->len] = '\0';
+}
+
+static void render_header(struct text *t, const char *name,
+			  const char *type, const char *help)
+{
+	tprintf(t, "# HELP %s %s\n", name, help);
+	tprintf(t, "# TYPE %s %s\n", name, type);
+}
+
+static void render_value(struct text *t, const char *name,
+			 const char *labels, uintmax_t value)
+{
+	if (labels == NULL)
+		tprintf(t, "%s %ju\n", name, value);
+	else
+		tprintf(t, "%s{%s} %ju\n", name, labels, value);
+}
+
+/* microseconds as seconds */
+#define PRI_SECONDS "%ju.%06ju"
+#define pri_seconds(US) (US) / 1000000, (US) % 1000000
+
+static void render_histogram(struct text *t, const char *name,
+			     const char *labels, const struct histogram *h)
+{
+	const char *sep = labels == NULL ? "" : ",";
+	uintmax_t cumulative = 0;
+
+	if (labels == NULL)
+		labels = "";
+
+	for (unsigned b = 0; b < elemsof(bucket_bounds); b++) {
+		cumulative += h->bucket[b];
+		tprintf(t, "%s_bucket{%s%sle=\""PRI_SECONDS"\"} %ju\n",
+			name, labels, sep, pri_seconds(bucket_bounds[b]),
+			cumulative);
+	}
+	cumulative += h->bucket[elemsof(bucket_bounds)];
+	tprintf(t, "%s_bucket{%s%sle=\"+Inf\"} %ju\n",
+		name, labels, sep, cumulative);
+	if (labels[0] == '\0') {
+		tprintf(t, "%s_sum "PRI_SECONDS"\n", name, pri_seconds(h->sum));
+		tprintf(t, "%s_count %ju\n", name, h->count);
+	} else {
+		tprintf(t, "%s_sum{%s} "PRI_SECONDS"\n",
+			name, labels, pri_seconds(h->sum));
+		tprintf(t, "%s_count{%s} %ju\n", name, labels, h->count);
+	}
+}
+
+static void render_metrics(struct text *t)
+{
+	intmax_t now = monosecs(mononow());
+
+	render_header(t, "pluto_state_transition_seconds", "histogram",
+		      "Time from reading a packet to finishing the state transition it triggered.");
+	for (unsigned e = 0; e < elemsof(exchanges); e++) {
+		render_histogram(t, "pluto_state_transition_seconds",
+				 exchanges[e].labels, &transitions[e]);
+	}
+	render_histogram(t, "pluto_state_transition_seconds",
+			 other_exchange_labels, &transitions[elemsof(exchanges)]);
+
+	char labels[64];
+
+	render_header(t, "pluto_crypto_wait_seconds", "histogram",
+		      "Time a crypto request waited for a helper (reset by whack --clearstats).");
+	for (unsigned c = 0; c < elemsof(crypto_ops); c++) {
+		snprintf(labels, sizeof(labels), "operation=\"%s\"",
+			 crypto_operations[c]);
+		render_histogram(t, "pluto_crypto_wait_seconds",
+				 labels, &crypto_ops[c].wait);
+	}
+
+	render_header(t, "pluto_crypto_seconds", "histogram",
+		      "Time a helper took to complete a crypto request (reset by whack --clearstats).");
+	for (unsigned c = 0; c < elemsof(crypto_ops); c++) {
+		snprintf(labels, sizeof(labels), "operation=\"%s\"",
+			 crypto_operations[c]);
+		render_histogram(t, "pluto_crypto_seconds",
+				 labels, &crypto_ops[c].time);
+	}
+
+	render_header(t, "pluto_ike_packets_received_total", "counter",
+		      "IKE packets read.");
+	render_value(t, "pluto_ike_packets_received_total", NULL,
+		     packets_received.total);
+	render_header(t, "pluto_ike_packets_sent_total", "counter",
+		      "IKE packets sent.");
+	render_value(t, "pluto_ike_packets_sent_total", NULL,
+		     packets_sent.total);
+	render_header(t, "pluto_ike_packets_received_per_second", "gauge",
+		      "IKE packets read during the last complete second.");
+	render_value(t, "pluto_ike_packets_received_per_second", NULL,
+		     rate_per_second(&packets_received, now));
+	render_header(t, "pluto_ike_packets_sent_per_second", "gauge",
+		      "IKE packets sent during the last complete second.");
+	render_value(t, "pluto_ike_packets_sent_per_second", NULL,
+		     rate_per_second(&packets_sent, now));
+
+	render_header(t, "pluto_ike_received_bytes_total", "counter",
+		      "IKE bytes read (reset by whack --clearstats).");
+	render_value(t, "pluto_ike_received_bytes_total", NULL,
+		     pstats_ike_in_bytes);
+	render_header(t, "pluto_ike_sent_bytes_total", "counter",
+		      "IKE bytes sent (reset by whack --clearstats).");
+	render_value(t, "pluto_ike_sent_bytes_total", NULL,
+		     pstats_ike_out_bytes);
+
+	struct state_counts sc = count_states();
+
+	render_header(t, "pluto_ike_sas", "gauge",
+		      "IKE SAs, by how far they have got.");
+	render_value(t, "pluto_ike_sas", "state=\"half_open\"",
+		     sc.halfopen_ike);
+	render_value(t, "pluto_ike_sas", "state=\"open\"", sc.open_ike);
+	render_value(t, "pluto_ike_sas", "state=\"established\"",
+		     sc.established_ike);
+	render_header(t, "pluto_ike_sas_half_open_limit", "gauge",
+		      "Half-open IKE SAs beyond which new exchanges are dropped.");
+	render_value(t, "pluto_ike_sas_half_open_limit", NULL,
+		     pluto_max_halfopen);
+	render_header(t, "pluto_ipsec_sas", "gauge",
+		      "Established IPsec SAs.");
+	render_value(t, "pluto_ipsec_sas", NULL, sc.ipsec);
+}
+
+void show_metrics(void)
+{
+	struct text t = { .ptr = NULL, };
+
+	render_metrics(&t);
+
+	/* one line at a time; whack_log_comment() adds the newline */
+	char *ls = t.ptr;
+
+	while (ls != NULL && *ls != '\0') {
+		char *le = strchr(ls, '\n');
+
+		if (le != NULL)
+			*le++ = '\0';
+		whack_log_comment("%s", ls);
+		ls = le;
+	}
+	pfreeany(t.ptr);
+}
+
+/*
+ * The metrics socket.
+ *
+ * Each client is expected to send an HTTP request, which is read
+ * without blocking; when it is complete the metrics are rendered
+ * and written back, also without blocking, and the connection is
+ * closed.  There are at most MAX_METRICS_CLIENTS, and each gets
+ * METRICS_CLIENT_TIMEOUT seconds of silence.
+ */
+
+#define MAX_METRICS_CLIENTS 8
+#define METRICS_CLIENT_TIMEOUT 10
+
+struct metrics_client {
+	int fd;
+	struct pluto_event *ev;
+	size_t len;		/* bytes in request */
+	char request[1024];
+	struct text response;
+	size_t sent;		/* bytes of response written */
+	struct metrics_client *next;
+};
+
+static int metrics_fd = NULL_FD;
+static struct pluto_event *metrics_ev;
+static bool metrics_unix;	/* unlink metrics_socket when done */
+static struct metrics_client *metrics_clients;
+static unsigned nr_metrics_clients;
+
+static const deltatime_t metrics_client_timeout =
+	DELTATIME(METRICS_CLIENT_TIMEOUT);
+
+static void metrics_client_end(struct metrics_client *c)
+{
+	for (struct metrics_client **p = &metrics_clients; *p != NULL;
+	     p = &(*p)->next) {
+		if (*p == c) {
+			*p = c->next;
+			break;
+		}
+	}
+	nr_metrics_clients--;
+	delete_pluto_event(&c->ev);
+	close(c->fd);
+	pfreeany(c->response.ptr);
+	pfree(c);
+}
+
+static void metrics_client_write_cb(evutil_socket_t fd, const short event,
+				    void *arg)
+{
+	struct metrics_client *c = arg;
+
+	if (event & EV_TIMEOUT) {
+		metrics_client_end(c);
+		return;
+	}
+
+	ssize_t n = send(fd, c->response.ptr + c->sent,
+			 c->response.len - c->sent, MSG_NOSIGNAL);
+
+	if (n < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return;
+		DBG(DBG_CONTROLMORE,
+		    DBG_log("metrics client on fd %d: send() failed: %s",
+			    c->fd, strerror(errno)));
+		metrics_client_end(c);
+		return;
+	}
+	c->sent += n;
+	if (c->sent == c->response.len)
+		metrics_client_end(c);
+}
+
+static void metrics_client_respond(struct metrics_client *c)
+{
+	if (c->len > 4 && memeq(c->request, "GET ", 4)) {
+		struct text body = { .ptr = NULL, };
+
+		render_metrics(&body);
+		tprintf(&c->response,
+			"HTTP/1.0 200 OK\r\n"
+			"Content-Type: text/plain; version=0.0.4\r\n"
+			"Content-Length: %zu\r\n"
+			"Connection: close\r\n"
+			"\r\n",
+			body.len);
+		tappend(&c->response, body.ptr, body.len);
+		pfree(body.ptr);
+	} else {
+		tprintf(&c->response,
+			"HTTP/1.0 405 Method Not Allowed\r\n"
+			"Allow: GET\r\n"
+			"Content-Length: 0\r\n"
+			"Connection: close\r\n"
+			"\r\n");
+	}
+
+	delete_pluto_event(&c->ev);
+	c->ev = pluto_event_add(c->fd, EV_WRITE | EV_PERSIST,
+				metrics_client_write_cb, c,
+				&metrics_client_timeout, "metrics client");
+}
+
+static bool request_complete(const struct metrics_client *c)
+{
+	/* the headers end with an empty line */
+	for (size_t i = 1; i < c->len; i++) {
+		if (c->request[i] == '\n' &&
+		    (c->request[i - 1] == '\n' ||
+		     (i >= 2 && c->request[i - 1] == '\r' &&
+		      c->request[i - 2] == '\n')))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void metrics_client_read_cb(evutil_socket_t fd, const short event,
+				   void *arg)
+{
+	struct metrics_client *c = arg;
+
+	if (event & EV_TIMEOUT) {
+		metrics_client_end(c);
+		return;
+	}
+
+	ssize_t n = read(fd, c->request + c->len, sizeof(c->request) - c->len);
+
+	if (n < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return;
+		DBG(DBG_CONTROLMORE,
+		    DBG_log("metrics client on fd %d: read() failed: %s",
+			    c->fd, strerror(errno)));
+		metrics_client_end(c);
+		return;
+	}
+	if (n == 0) {
+		metrics_client_end(c);
+		return;
+	}
+	c->len += n;
+	/* an overlong request gets an answer based on what was read */
+	if (c->len == sizeof(c->request) || request_complete(c))
+		metrics_client_respond(c);
+}
+
+static void metrics_accept_cb(evutil_socket_t fd, const short event UNUSED,
+			      void *arg UNUSED)
+{
+	int cfd = accept(fd, NULL, NULL);
+
+	if (cfd < 0) {
+		if (errno != EINTR && errno != EAGAIN)
+			LOG_ERRNO(errno, "accept() failed on metrics socket");
+		return;
+	}
+	if (nr_metrics_clients >= MAX_METRICS_CLIENTS) {
+		DBG(DBG_CONTROLMORE,
+		    DBG_log("metrics socket: too many clients; dropping one"));
+		close(cfd);
+		return;
+	}
+	if (fcntl(cfd, F_SETFD, FD_CLOEXEC) == -1 ||
+	    fcntl(cfd, F_SETFL, O_NONBLOCK) == -1) {
+		LOG_ERRNO(errno, "fcntl() failed on metrics client");
+		close(cfd);
+		return;
+	}
+
+	struct metrics_client *c = alloc_thing(struct metrics_client,
+					       "metrics client");
+
+	c->fd = cfd;
+	c->next = metrics_clients;
+	metrics_clients = c;
+	nr_metrics_clients++;
+	c->ev = pluto_event_add(cfd, EV_READ | EV_PERSIST,
+				metrics_client_read_cb, c,
+				&metrics_client_timeout, "metrics client");
+}
+
+/*
+ * The bind_*() functions set *ERRP to errno when a system call
+ * failed, and leave it alone otherwise.
+ */
+
+static err_t bind_unix(int *fdp, int *errp, const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX, };
+
+	if (strlen(path) >= sizeof(addr.sun_path))
+		return "path is too long";
+	fill_and_terminate(addr.sun_path, path, sizeof(addr.sun_path));
+
+	unlink(path);	/* preventative medicine */
+	*fdp = safe_socket(AF_UNIX, SOCK_STREAM, 0);
+	if (*fdp == -1) {
+		*errp = errno;
+		return "socket() failed";
+	}
+
+	/* as for the control socket */
+#ifdef PLUTO_GROUP_CTL
+	mode_t ou = umask(~(S_IRWXU | S_IRWXG));
+#else
+	mode_t ou = umask(~S_IRWXU);
+#endif
+	int r = bind(*fdp, (struct sockaddr *)&addr,
+		     offsetof(struct sockaddr_un, sun_path) + strlen(addr.sun_path));
+	if (r < 0)
+		*errp = errno;
+	umask(ou);
+	if (r < 0)
+		return "bind() failed";
+	metrics_unix = TRUE;
+	return NULL;
+}
+
+/* [<address>:]<port>, where an IPv6 address is in brackets */
+static err_t bind_tcp(int *fdp, int *errp, const char *where)
+{
+	const char *colon = strrchr(where, ':');
+	const char *port = colon == NULL ? where : colon + 1;
+	unsigned long u;
+	err_t ugh = ttoulb(port, 0, 10, 65535, &u);
+
+	if (ugh != NULL)
+		return ugh;
+	if (u == 0)
+		return "port must be non-zero";
+
+	ip_address addr;
+
+	if (colon == NULL) {
+		ugh = ttoaddr_num("127.0.0.1", 0, AF_INET, &addr);
+	} else if (where[0] == '[' && colon > where && colon[-1] == ']') {
+		ugh = ttoaddr_num(where + 1, colon - where - 2, AF_INET6, &addr);
+	} else {
+		ugh = ttoaddr_num(where, colon - where, AF_INET, &addr);
+	}
+	if (ugh != NULL)
+		return ugh;
+	setportof(htons(u), &addr);
+
+	*fdp = safe_socket(addrtypeof(&addr), SOCK_STREAM, 0);
+	if (*fdp == -1) {
+		*errp = errno;
+		return "socket() failed";
+	}
+
+	int on = 1;
+
+	if (setsockopt(*fdp, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0) {
+		*errp = errno;
+		return "setsockopt(SO_REUSEADDR) failed";
+	}
+	if (bind(*fdp, sockaddrof(&addr), sockaddrlenof(&addr)) < 0) {
+		*errp = errno;
+		return "bind() failed";
+	}
+	return NULL;
+}
+
+void init_metrics(void)
+{
+	if (metrics_socket == NULL)
+		return;
+
+	int e = 0;	/* errno of the system call that failed */
+	err_t ugh = metrics_socket[0] == '/' ?
+		bind_unix(&metrics_fd, &e, metrics_socket) :
+		bind_tcp(&metrics_fd, &e, metrics_socket);
+
+	if (ugh == NULL && listen(metrics_fd, MAX_METRICS_CLIENTS) < 0) {
+		e = errno;
+		ugh = "listen() failed";
+	}
+	if (ugh == NULL &&
+	    (fcntl(metrics_fd, F_SETFD, FD_CLOEXEC) == -1 ||
+	     fcntl(metrics_fd, F_SETFL, O_NONBLOCK) == -1)) {
+		e = errno;
+		ugh = "fcntl() failed";
+	}
+	if (ugh != NULL) {
+		loglog(RC_LOG_SERIOUS, "metrics-socket=%s: %s%s%s; metrics are only available using whack",
+		       metrics_socket, ugh,
+		       e == 0 ? "" : ": ",
+		       e == 0 ? "" : strerror(e));
+		free_metrics();
+		return;
+	}
+
+	metrics_ev = pluto_event_add(metrics_fd, EV_READ | EV_PERSIST,
+				     metrics_accept_cb, NULL, NULL,
+				     "metrics socket");
+	libreswan_log("serving metrics on %s", metrics_socket);
+}
+
+void free_metrics(void)
+{
+	while (metrics_clients != NULL)
+		metrics_client_end(metrics_clients);
+	if (metrics_ev != NULL)
+		delete_pluto_event(&metrics_ev);
+	if (metrics_fd != NULL_FD) {
+		close(metrics_fd);
+		metrics_fd = NULL_FD;
+	}
+	if (metrics_unix) {
+		unlink(metrics_socket);
+		metrics_unix = FALSE;
+	}
+}
@@ -0,0 +1,63 @@
+/* metrics, in the Prometheus text format, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include "monotime.h"
+
+struct msg_digest;
+enum pluto_crypto_requests;
+
+/*
+ * When non-NULL, where to serve the metrics over HTTP: a unix
+ * socket (an absolute path) or a TCP [<address>:]<port> (the
+ * address defaults to 127.0.0.1).
+ */
+extern char *metrics_socket;
+
+/*
+ * Hooks for the hot paths.  They only update counters or a
+ * histogram's bucket, and are only called from the main thread.
+ */
+
+/* N packets were read at NOW */
+void metrics_packets_received(monotime_t now, unsigned n);
+
+/* a packet was sent */
+void metrics_packet_sent(void);
+
+/*
+ * A state transition, triggered by MD, has finished; if MD was
+ * read from the network, its latency is recorded (once).
+ */
+void metrics_transition(struct msg_digest *md);
+
+/*
+ * A crypto request was queued, then started, then finished, using
+ * CPU_US of the helper's CPU time.
+ */
+void metrics_crypto(enum pluto_crypto_requests type, monotime_t queued,
+		    monotime_t started, monotime_t finished, uintmax_t cpu_us);
+
+/* the per-operation totals, for whack --globalstatus and --clearstats */
+void show_crypto_metrics_status(void);
+void clear_crypto_metrics(void);
+
+/* whack --metrics */
+void show_metrics(void);
+
+void init_metrics(void);
+void free_metrics(void);
+
+#endif
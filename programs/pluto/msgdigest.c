@@ -52,10 +52,28 @@
 #include "log.h"
 #include "demux.h"      /* needs packet.h */
 
-/* message digest allocation and deallocation */
+/*
+ * message digest allocation and deallocation
+ *
+ * Released msg_digests are kept in a pool for re-use.  Each carries
+ * a packet buffer, allocated the first time it is needed, big enough
+ * for a typical IKE message; larger messages get a buffer of their
+ * own.  Everything is allocated with alloc_thing() et.al. so
+ * leak-detective still sees it.
+ */
+
+#define MD_PACKET_BUFFER_SIZE 2048
 
 static struct msg_digest *md_pool = NULL;
 
+static struct {
+	unsigned free;		/* in MD_POOL */
+	unsigned in_use;
+	unsigned long allocated;	/* msg_digests created */
+	unsigned long pooled;		/* packets using the pooled buffer */
+	unsigned long oversize;		/* packets needing their own buffer */
+} md_stats;
+
 /* free_md_pool is only used to avoid leak reports */
 void free_md_pool(void)
 {
@@ -67,7 +85,9 @@ void free_md_pool(void)
 			break;
 		passert(md_pool != md->next);
 		md_pool = md->next;
+		pfreeany(md->packet_buffer);
 		pfree(md);
+		md_stats.free--;
 	}
 }
 
@@ -82,17 +102,45 @@ struct msg_digest *alloc_md(const char *mdname)
 	 */
 	static const struct msg_digest blank_md;
 
-	if (md == NULL)
+	if (md == NULL) {
 		md = alloc_thing(struct msg_digest, mdname);
-	else
+		md_stats.allocated++;
+	} else {
 		md_pool = md->next;
+		md_stats.free--;
+	}
+	md_stats.in_use++;
 
+	u_int8_t *packet_buffer = md->packet_buffer;
 	*md = blank_md;
+	md->packet_buffer = packet_buffer;
 	md->digest_roof = 0;
 
 	return md;
 }
 
+void *alloc_md_packet(struct msg_digest *md, size_t size, const char *name)
+{
+	if (size > MD_PACKET_BUFFER_SIZE) {
+		md_stats.oversize++;
+		return alloc_bytes(size, name);
+	}
+	if (md->packet_buffer == NULL) {
+		md->packet_buffer = alloc_bytes(MD_PACKET_BUFFER_SIZE,
+						"md packet buffer");
+	}
+	md_stats.pooled++;
+	return md->packet_buffer;
+}
+
+void init_md_packet(struct msg_digest *md, const void *bytes, size_t size,
+		    const char *name)
+{
+	void *packet = alloc_md_packet(md, size, name);
+	memcpy(packet, bytes, size);
+	init_pbs(&md->packet_pbs, packet, size, name);
+}
+
 struct msg_digest *clone_md(struct msg_digest *md, const char *name)
 {
 	struct msg_digest *clone = alloc_md(name);
@@ -100,39 +148,55 @@ struct msg_digest *clone_md(struct msg_digest *md, const char *name)
 	/* raw_packet */
 	clone->iface = md->iface; /* copy reference */
 	clone->sender = md->sender; /* copy value */
+	clone->arrived = md->arrived;
 	/* packet_pbs ... */
-	size_t packet_size = pbs_room(&md->packet_pbs);
-	void *packet_bytes = clone_bytes(md->packet_pbs.start, packet_size, name);
-	init_pbs(&clone->packet_pbs, packet_bytes, packet_size, name);
+	init_md_packet(clone, md->packet_pbs.start, pbs_room(&md->packet_pbs),
+		       name);
 	return clone;
 }
 
 void release_md(struct msg_digest *md)
 {
 	freeanychunk(md->raw_packet);
-	pfreeany(md->packet_pbs.start);
+	if (md->packet_pbs.start != md->packet_buffer)
+		pfreeany(md->packet_pbs.start);
 
 	/* check that we are not creating a loop */
 	passert(md != md_pool);
 
+	md_stats.in_use--;
+
 #ifdef MSG_DIGEST_ALLOC_DEBUG
 	/*
 	 * This version does not maintain a pool.
 	 * Thus leak-detective, Electric Fence, and valgrind are more effective.
 	 */
+	pfreeany(md->packet_buffer);
 	pfree(md);
 #else
 	/*
 	 * Shred to useless value.
 	 * Redundant but might catch dangling references.
 	 */
+	u_int8_t *packet_buffer = md->packet_buffer;
 	memset(md, 0xED, sizeof(struct msg_digest));
+	md->packet_buffer = packet_buffer;
 
 	md->next = md_pool;
 	md_pool = md;
+	md_stats.free++;
 #endif
 }
 
+void show_md_pool_status(void)
+{
+	whack_log_comment("current.md.pool.free=%u", md_stats.free);
+	whack_log_comment("current.md.pool.inuse=%u", md_stats.in_use);
+	whack_log_comment("total.md.pool.allocated=%lu", md_stats.allocated);
+	whack_log_comment("total.md.packet.pooled=%lu", md_stats.pooled);
+	whack_log_comment("total.md.packet.oversize=%lu", md_stats.oversize);
+}
+
 void release_any_md(struct msg_digest **mdp)
 {
 	if (*mdp != NULL) {
@@ -75,6 +75,7 @@
 #include "natt_defines.h"
 #include "nat_traversal.h"
 #include "ikev2_send.h"
+#include "pluto_stats.h"
 
 /* As per https://tools.ietf.org/html/rfc3948#section-4 */
 #define DEFAULT_KEEP_ALIVE_PERIOD  20
@@ -82,7 +83,6 @@
 bool nat_traversal_enabled = TRUE; /* can get disabled if kernel lacks support */
 
 static deltatime_t nat_kap = DELTATIME(DEFAULT_KEEP_ALIVE_PERIOD);	/* keep-alive period */
-static bool nat_kap_event = FALSE;
 
 #define IKEV2_NATD_HASH_SIZE	SHA1_DIGEST_SIZE
 
@@ -748,7 +748,7 @@ void ikev1_natd_init(struct state *st, struct msg_digest *md)
 	}
 	if (st->hidden_variables.st_nat_traversal & NAT_T_WITH_KA) {
 		DBG(DBG_NATT, DBG_log(" NAT_T_WITH_KA detected"));
-		nat_traversal_new_ka_event();
+		nat_traversal_new_ka_event(st);
 	}
 }
 
@@ -828,13 +828,30 @@ int nat_traversal_espinudp_socket(int sk, const char *fam)
 	return -1;
 }
 
-void nat_traversal_new_ka_event(void)
+/*
+ * Each state that needs NAT-T keep-alives has its own keep-alive
+ * event.  The first is scheduled at a random point in the period, and
+ * later ones are jittered, so that the keep-alives of many SAs are
+ * spread out rather than sent as one burst.
+ */
+static void schedule_ka_event(struct state *st, double fraction)
+{
+	intmax_t ms = deltamillisecs(nat_kap) * fraction;
+	event_schedule(EVENT_NAT_T_KEEPALIVE, deltatime_ms(ms), st);
+}
+
+void nat_traversal_new_ka_event(struct state *st)
 {
-	if (nat_kap_event)
+	if (st->st_nat_keepalive_event != NULL)
 		return;	/* Event already schedule */
 
-	event_schedule(EVENT_NAT_T_KEEPALIVE, nat_kap, NULL);
-	nat_kap_event = TRUE;
+	if (!st->st_connection->nat_keepalive) {
+		DBG(DBG_NATT,
+			DBG_log("Suppressing sending of NAT-T KEEP-ALIVE by per-conn configuration (nat_keepalive=no)"));
+		return;
+	}
+
+	schedule_ka_event(st, rand() / (RAND_MAX + 1.E0));
 }
 
 static void nat_traversal_send_ka(struct state *st)
@@ -855,24 +872,12 @@ static void nat_traversal_send_ka(struct state *st)
 }
 
 /*
- * Find ISAKMP States with NAT-T and send keep-alive
+ * Does the ISAKMP or IPsec SA need a NAT-T keep-alive?
  */
-static void nat_traversal_ka_event_state(struct state *st, void *data)
+static bool nat_traversal_ka_needed(struct state *st)
 {
-	unsigned int *nat_kap_st = (unsigned int *)data;
 	const struct connection *c = st->st_connection;
 
-	if (c == NULL)
-		return;
-
-	if (!c->nat_keepalive) {
-		DBG(DBG_NATT,
-			DBG_log("Suppressing sending of NAT-T KEEP-ALIVE by per-conn configuration (nat_keepalive=no)"));
-		return;
-	}
-	DBG(DBG_NATT,
-		DBG_log("Sending of NAT-T KEEP-ALIVE enabled by per-conn configuration (nat_keepalive=yes)"));
-
 	if (IS_ISAKMP_SA_ESTABLISHED(st->st_state) &&
 	    LHAS(st->hidden_variables.st_nat_traversal, NATED_HOST)) {
 		/*
@@ -891,14 +896,9 @@ static void nat_traversal_ka_event_state(struct state *st, void *data)
 				IS_ISAKMP_SA_ESTABLISHED(st->st_state) &&
 				LHAS(st_newest->hidden_variables.st_nat_traversal,
 					NATED_HOST))
-				return;
+				return FALSE;
 		}
-		/*
-		 * TODO: We should check idleness of SA before sending
-		 * keep-alive. If there is traffic, no need for it
-		 */
-		nat_traversal_send_ka(st);
-		(*nat_kap_st)++;
+		return TRUE;
 	}
 
 	if ((st->st_state == STATE_QUICK_R2 ||
@@ -921,29 +921,75 @@ static void nat_traversal_ka_event_state(struct state *st, void *data)
 			     st_newest->st_state == STATE_QUICK_I2) &&
 			    LHAS(st_newest->hidden_variables.st_nat_traversal,
 				 NATED_HOST))
-				return;
+				return FALSE;
 		}
-		nat_traversal_send_ka(st);
-		(*nat_kap_st)++;
+		return TRUE;
 	}
 
+	return FALSE;
 }
 
-void nat_traversal_ka_event(void)
+/*
+ * Has the IPsec SA that shares the NAT mapping (the state itself, or
+ * for an ISAKMP SA the connection's newest IPsec SA) sent anything
+ * since the state's last keep-alive?  If so, the mapping is being
+ * kept alive anyway.
+ *
+ * Only asked when the counters come from the periodic dump (see
+ * sa-counter-refresh); otherwise reading them is a kernel round trip
+ * per SA, which costs more than the 1-byte keep-alive it would save.
+ */
+static bool nat_traversal_sent_traffic(struct state *st)
 {
-	unsigned int nat_kap_st = 0;
+	if (deltasecs(sa_counter_refresh) == 0 || kernel_ops->get_sas == NULL)
+		return FALSE;
+
+	struct state *ipsec_st = IS_IPSEC_SA_ESTABLISHED(st) ? st :
+		state_with_serialno(st->st_connection->newest_ipsec_sa);
+
+	if (ipsec_st == NULL ||
+	    !IS_IPSEC_SA_ESTABLISHED(ipsec_st) ||
+	    ipsec_st->st_remoteport != st->st_remoteport ||
+	    !sameaddr(&ipsec_st->st_remoteaddr, &st->st_remoteaddr))
+		return FALSE;
 
-	nat_kap_event = FALSE;  /* ready to be reschedule */
+	if (!get_sa_info(ipsec_st, FALSE, NULL))
+		return FALSE;
 
-	for_each_state(nat_traversal_ka_event_state, &nat_kap_st);
+	/* get_sa_info() updates whichever protocol is outermost */
+	uint64_t bytes = ipsec_st->st_esp.peer_bytes +
+		ipsec_st->st_ah.peer_bytes +
+		ipsec_st->st_ipcomp.peer_bytes;
+	bool sent = bytes > st->st_nat_keepalive_bytes;
+	st->st_nat_keepalive_bytes = bytes;
+	return sent;
+}
+
+void nat_traversal_ka_event(struct state *st)
+{
+	if (!st->st_connection->nat_keepalive)
+		return;
 
-	if (nat_kap_st != 0) {
+	if (nat_traversal_ka_needed(st)) {
 		/*
-		 * If there are still states who needs Keep-Alive,
-		 * schedule new event
+		 * The first check only records the byte count so a
+		 * keep-alive is sent unless there was traffic during
+		 * a whole period.
 		 */
-		nat_traversal_new_ka_event();
+		bool first = st->st_nat_keepalive_bytes == 0;
+		if (nat_traversal_sent_traffic(st) && !first) {
+			DBG(DBG_NATT,
+			    DBG_log("suppressing NAT-T Keep Alive for #%lu; recent outbound traffic",
+				    st->st_serialno));
+			pstats_ike_natt_ka_suppressed++;
+		} else {
+			nat_traversal_send_ka(st);
+			pstats_ike_natt_ka_sent++;
+		}
 	}
+
+	/* up to 1/8 early, so that SAs don't drift into step */
+	schedule_ka_event(st, 1 - rand() / (RAND_MAX + 1.E0) / 8);
 }
 
 struct new_mapp_nfo {
@@ -1220,6 +1266,16 @@ void ikev2_natd_lookup(struct msg_digest *md, const u_char *rcookie)
 
 	natd_lookup_common(st, &md->sender, found_me, found_him);
 
+	/*
+	 * IKEv2 doesn't negotiate a NAT-T method (so NAT_T_WITH_KA
+	 * is never set); its NAT-T is always RFC 3948's, which sends
+	 * keep-alives when we're behind the NAT.
+	 */
+	if (LHAS(st->hidden_variables.st_nat_traversal, NATED_HOST)) {
+		DBG(DBG_NATT, DBG_log(" NAT_T_WITH_KA detected"));
+		nat_traversal_new_ka_event(st);
+	}
+
 	if (st->st_state == STATE_PARENT_I1 &&
 	    (st->hidden_variables.st_nat_traversal & NAT_T_DETECTED)) {
 		DBG(DBG_NATT, {
@@ -96,8 +96,8 @@ bool nat_traversal_add_natoa(u_int8_t np, pb_stream *outs,
 /**
  * NAT-keep_alive
  */
-void nat_traversal_new_ka_event(void);
-void nat_traversal_ka_event(void);
+void nat_traversal_new_ka_event(struct state *st);
+void nat_traversal_ka_event(struct state *st);
 
 extern void ikev1_natd_init(struct state *st, struct msg_digest *md);
 
@@ -420,6 +420,7 @@ const char *const sa_policy_bit_names[] = {
 	"PPK_INSIST",
 	"ESN_NO",
 	"ESN_YES",
+	"ROUTE",
 	NULL	/* end for bitnamesof() */
 };
 
@@ -34,6 +34,7 @@
 #include <unistd.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <time.h>
 
 #include <libreswan.h>
 
@@ -53,6 +54,8 @@
 #include "crypt_dh.h"
 #include "ikev1_prf.h"
 #include "state_db.h"
+#include "helper_queue.h"
+#include "metrics.h"
 
 #ifdef HAVE_SECCOMP
 # include "pluto_seccomp.h"
@@ -84,17 +87,21 @@
 
 struct pluto_crypto_req_cont {
 	crypto_req_cont_func *pcrc_func;	/* function to continue with */
-	struct list_entry pcrc_backlog;
+	struct helper_work pcrc_backlog;
 	so_serial_t pcrc_serialno;	/* sponsoring state's serial number */
 	bool pcrc_cancelled;
 	const char *pcrc_name;
 	struct pluto_crypto_req pcrc_pcr;
 	pcr_req_id pcrc_id;
 	int pcrc_helpernum;
+	monotime_t pcrc_queued;		/* for the metrics */
+	monotime_t pcrc_started;	/* set by the helper */
+	monotime_t pcrc_finished;	/* set by the helper */
+	uintmax_t pcrc_cpu_us;		/* set by the helper */
 };
 
 /*
- * The work queue.  Accesses must be locked.
+ * The work queues; see helper_queue.h.
  */
 
 static size_t log_backlog(struct lswlog *buf, void *data)
@@ -124,11 +131,37 @@ struct list_info backlog_info = {
 	.log = log_backlog,
 };
 
-static pthread_mutex_t backlog_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t backlog_cond = PTHREAD_COND_INITIALIZER;
+static struct helper_queues *backlog;
 
-struct list_head backlog;
-static int backlog_queue_len = 0;
+/*
+ * The helpers hand back answers using a single queue; see
+ * helper_queue.h.  When woken, the main thread delivers at most
+ * HELPER_ANSWER_BATCH answers before giving other events a look in.
+ */
+
+#define HELPER_ANSWER_BATCH 32
+
+static struct helper_answers *answers;
+static unsigned long nr_answers;		/* main thread */
+static unsigned long nr_answer_batches;	/* main thread */
+
+/*
+ * Where the time goes, aggregated by the main thread as each answer
+ * is delivered.  The per-operation totals are kept with the metrics
+ * (see metrics_crypto()); what each helper did is kept here, to see
+ * if there are enough of them.  Times are in microseconds.
+ */
+
+struct helper_stats {
+	unsigned long requests;
+	uintmax_t time_us;	/* picked up -> finished (wall clock) */
+	uintmax_t cpu_us;	/* helper thread's CPU time */
+};
+
+static monotime_t crypto_stats_since;		/* main thread */
+static unsigned long nr_requests;		/* main thread */
+static unsigned long nr_outstanding;		/* main thread */
+static unsigned long nr_outstanding_max;	/* main thread */
 
 /*
  * Create the pluto crypto request object.
@@ -144,7 +177,7 @@ struct pluto_crypto_req_cont *new_pcrc(crypto_req_cont_func fn,
 	r->pcrc_func = fn;
 	r->pcrc_cancelled = false;
 	r->pcrc_name = name;
-	r->pcrc_backlog = list_entry(&backlog_info, r);
+	init_helper_work(&r->pcrc_backlog, &backlog_info, r);
 	r->pcrc_serialno = SOS_NOBODY;
 	return r;
 }
@@ -174,6 +207,8 @@ struct pluto_crypto_worker {
 	bool pcw_dead;
 	pcr_req_id pcw_pcrc_id;
 	so_serial_t pcw_pcrc_serialno;
+	struct helper_stats pcw_stats;	/* main thread */
+	unsigned long pcw_steals_base;	/* main thread; see --clearstats */
 };
 
 static void init_crypto_helper(struct pluto_crypto_worker *w, int n);
@@ -190,10 +225,13 @@ static const char *const pluto_cryptoop_strings[] = {
 	"compute dh+iv (V1 Phase 1)",	/* calculate (g^x)(g^y) and skeyids for Phase 1 DH + prf */
 	"compute dh (V1 Phase 2 PFS)",	/* calculate (g^x)(g^y) for Phase 2 PFS */
 	"compute dh (V2)",	/* perform IKEv2 PARENT SA calculation, create SKEYSEED */
+	"RSA sign",		/* sign a hash using our RSA private key */
+	"RSA verify",		/* check an RSA signature against candidate keys */
+	"X.509 verify",		/* verify the peer's certificate chain */
 };
 
 static enum_names pluto_cryptoop_names = {
-	pcr_build_ke_and_nonce, pcr_compute_dh_v2,
+	pcr_build_ke_and_nonce, pcr_x509_verify,
 	ARRAY_REF(pluto_cryptoop_strings),
 	NULL, /* prefix */
 	NULL
@@ -229,23 +267,26 @@ static void pcr_release(struct pluto_crypto_req *r)
 	case pcr_compute_dh:
 		cancelled_v1_dh(&r->pcr_d.v1_dh);
 		break;
+	case pcr_rsa_sign:
+		cancelled_rsa_sign(&r->pcr_d.rsa_sign);
+		break;
+	case pcr_rsa_verify:
+		cancelled_rsa_verify(&r->pcr_d.rsa_verify);
+		break;
+	case pcr_x509_verify:
+		cancelled_x509_verify(&r->pcr_d.x509_verify);
+		break;
 	}
 }
 
-static void pcrc_release_request(struct pluto_crypto_req_cont *cn)
-{
-	pcr_release(&cn->pcrc_pcr);
-	/* free the heap space */
-	pfree(cn);
-}
-
-void pcr_kenonce_init(struct pluto_crypto_req_cont *cn,
-		      enum pluto_crypto_requests pcr_type,
-		      const struct oakley_group_desc *dh)
+struct pcr_kenonce *pcr_kenonce_init(struct pluto_crypto_req_cont *cn,
+				     enum pluto_crypto_requests pcr_type,
+				     const struct oakley_group_desc *dh)
 {
 	struct pluto_crypto_req *r = &cn->pcrc_pcr;
 	pcr_init(r, pcr_type);
 	r->pcr_d.kn.group = dh;
+	return &r->pcr_d.kn;
 }
 
 struct pcr_v1_dh *pcr_v1_dh_init(struct pluto_crypto_req_cont *cn,
@@ -268,6 +309,27 @@ struct pcr_dh_v2 *pcr_dh_v2_init(struct pluto_crypto_req_cont *cn)
 	return dhq;
 }
 
+struct pcr_rsa_sign *pcr_rsa_sign_init(struct pluto_crypto_req_cont *cn)
+{
+	struct pluto_crypto_req *r = &cn->pcrc_pcr;
+	pcr_init(r, pcr_rsa_sign);
+	return &r->pcr_d.rsa_sign;
+}
+
+struct pcr_rsa_verify *pcr_rsa_verify_init(struct pluto_crypto_req_cont *cn)
+{
+	struct pluto_crypto_req *r = &cn->pcrc_pcr;
+	pcr_init(r, pcr_rsa_verify);
+	return &r->pcr_d.rsa_verify;
+}
+
+struct pcr_x509_verify *pcr_x509_verify_init(struct pluto_crypto_req_cont *cn)
+{
+	struct pluto_crypto_req *r = &cn->pcrc_pcr;
+	pcr_init(r, pcr_x509_verify);
+	return &r->pcr_d.x509_verify;
+}
+
 /*
  * If there are any helper threads, this code is always executed IN A HELPER
  * THREAD. Otherwise it is executed in the main (only) thread.
@@ -277,8 +339,9 @@ static int crypto_helper_delay;
 
 static void pluto_do_crypto_op(struct pluto_crypto_req_cont *cn, int helpernum)
 {
-	struct timeval tv0;
-	gettimeofday(&tv0, NULL);
+	cn->pcrc_started = mononow();
+	struct timespec cpu_start;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
 	struct pluto_crypto_req *r = &cn->pcrc_pcr;
 
 	DBG(DBG_CONTROL,
@@ -315,17 +378,33 @@ static void pluto_do_crypto_op(struct pluto_crypto_req_cont *cn, int helpernum)
 	case pcr_compute_dh_v2:
 		calc_dh_v2(r);
 		break;
+
+	case pcr_rsa_sign:
+		calc_rsa_sign(&r->pcr_d.rsa_sign);
+		break;
+
+	case pcr_rsa_verify:
+		calc_rsa_verify(&r->pcr_d.rsa_verify);
+		break;
+
+	case pcr_x509_verify:
+		calc_x509_verify(&r->pcr_d.x509_verify);
+		break;
 	}
 
+	struct timespec cpu_end;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+	cn->pcrc_finished = mononow();
+	cn->pcrc_cpu_us = ((cpu_end.tv_sec - cpu_start.tv_sec) * 1000000 +
+			   (cpu_end.tv_nsec - cpu_start.tv_nsec) / 1000);
 	DBG(DBG_CONTROL, {
-			struct timeval tv1;
-			unsigned long tv_diff;
-			gettimeofday(&tv1, NULL);
-			tv_diff = (tv1.tv_sec  - tv0.tv_sec) * 1000000 + (tv1.tv_usec - tv0.tv_usec);
+			struct timeval tv_diff;
+			timersub(&cn->pcrc_finished.mt, &cn->pcrc_started.mt, &tv_diff);
 			DBG_log("crypto helper %d finished %s; request ID %u time elapsed %ld usec",
 					helpernum,
 					enum_show(&pluto_cryptoop_names, r->pcr_type),
-					cn->pcrc_id, tv_diff));
+					cn->pcrc_id,
+					tv_diff.tv_sec * 1000000 + tv_diff.tv_usec));
 	}
 
 }
@@ -363,36 +442,21 @@ static void *pluto_crypto_helper_thread(void *arg)
 	for (;;) {
 		w->pcw_pcrc_id = 0;
 		w->pcw_pcrc_serialno = SOS_NOBODY;
-		struct pluto_crypto_req_cont *cn = NULL;
-		pthread_mutex_lock(&backlog_mutex);
-		{
-			/*
-			 * Search the backlog[] for something to do.
-			 * If needed sleep.
-			 */
-			for (;;) {
-				/* get oldest; if any */
-				FOR_EACH_LIST_ENTRY_OLD2NEW(&backlog, cn) {
-					/* CN is the first entry */
-					goto found_work;
-				}
-				DBG(DBG_CONTROL, DBG_log("crypto helper %d waiting (nothing to do)",
-							 w->pcw_helpernum));
-				pthread_cond_wait(&backlog_cond, &backlog_mutex);
-				DBG(DBG_CONTROL, DBG_log("crypto helper %d resuming",
-							 w->pcw_helpernum));
-			}
-		found_work:
-			/*
-			 * Assign the entry to this thread, removing
-			 * it from the backlog.
-			 */
-			remove_list_entry(&cn->pcrc_backlog);
-			cn->pcrc_helpernum = w->pcw_helpernum;
-			w->pcw_pcrc_id = cn->pcrc_id;
-			w->pcw_pcrc_serialno = cn->pcrc_serialno;
+		/*
+		 * While there's nothing else to do, top up the DH
+		 * pools.
+		 */
+		while (!have_helper_work(backlog) && refill_dh_pool()) {
 		}
-		pthread_mutex_unlock(&backlog_mutex);
+		/*
+		 * Get the oldest work-order from this helper's queue,
+		 * or steal one from another helper.  If needed sleep.
+		 */
+		struct pluto_crypto_req_cont *cn =
+			next_helper_work(backlog, w->pcw_helpernum);
+		cn->pcrc_helpernum = w->pcw_helpernum;
+		w->pcw_pcrc_id = cn->pcrc_id;
+		w->pcw_pcrc_serialno = cn->pcrc_serialno;
 		if (!cn->pcrc_cancelled) {
 			DBG(DBG_CONTROL,
 			    DBG_log("crypto helper %d starting work-order %u for state #%lu",
@@ -404,8 +468,7 @@ static void *pluto_crypto_helper_thread(void *arg)
 		    DBG_log("crypto helper %d sending results from work-order %u for state #%lu to event queue",
 			    w->pcw_helpernum, w->pcw_pcrc_id,
 			    w->pcw_pcrc_serialno));
-		pluto_event_now("sending helper answer", w->pcw_pcrc_serialno,
-				handle_helper_answer, cn);
+		send_helper_answer(answers, &cn->pcrc_backlog);
 	}
 	return NULL;
 }
@@ -474,6 +537,11 @@ void send_crypto_helper_request(struct state *st,
 	/* set up the id */
 	static pcr_req_id pcw_id;	/* counter for generating unique request IDs */
 	cn->pcrc_id = ++pcw_id;
+	cn->pcrc_queued = mononow();
+	nr_requests++;
+	if (++nr_outstanding > nr_outstanding_max) {
+		nr_outstanding_max = nr_outstanding;
+	}
 
 	/*
 	 * Save in case it needs to be cancelled.
@@ -495,15 +563,8 @@ void send_crypto_helper_request(struct state *st,
 			    cn->pcrc_serialno));
 		delete_event(st);
 		event_schedule_s(EVENT_CRYPTO_TIMEOUT, EVENT_CRYPTO_TIMEOUT_DELAY, st);
-		/* add to backlog */
-		pthread_mutex_lock(&backlog_mutex);
-		{
-			insert_list_entry(&backlog, &cn->pcrc_backlog);
-			backlog_queue_len++;
-			/* wake up threads waiting for work */
-			pthread_cond_signal(&backlog_cond);
-		}
-		pthread_mutex_unlock(&backlog_mutex);
+		/* add to backlog; doesn't lock */
+		submit_helper_work(backlog, &cn->pcrc_backlog);
 	}
 }
 
@@ -514,26 +575,27 @@ void delete_cryptographic_continuation(struct state *st)
 	if (cn == NULL) {
 		return;
 	}
-	/* shut it down */
+	/*
+	 * Shut it down.
+	 *
+	 * The work-order can't be pulled from a helper's queue (it
+	 * may be in transit between queues) so leave it there.  The
+	 * helper will skip the crypto and hand it back to
+	 * handle_helper_answer() which releases it.
+	 */
 	cn->pcrc_cancelled = true;
 	st->st_offloaded_task = NULL;
-	/* remove it from any queue */
-	if (pc_workers != NULL) {
-		/* remove it from any queue */
-		pthread_mutex_lock(&backlog_mutex);
-		if (remove_list_entry(&cn->pcrc_backlog)) {
-			backlog_queue_len--;
-		} else {
-			/*
-			 * Already grabbed by the helper thread so
-			 * can't delete it here.
-			 */
-			cn = NULL;
-		}
-		pthread_mutex_unlock(&backlog_mutex);
-		if (cn != NULL) {
-			pcrc_release_request(cn);
-		}
+}
+
+/* work done inline, with no helpers, only counts against the operation */
+static void record_helper_stats(const struct pluto_crypto_req_cont *cn)
+{
+	if (cn->pcrc_helpernum >= 0 && cn->pcrc_helpernum < pc_workers_cnt) {
+		struct helper_stats *s = &pc_workers[cn->pcrc_helpernum].pcw_stats;
+		s->requests++;
+		s->time_us += monotime_elapsed_us(cn->pcrc_started,
+						  cn->pcrc_finished);
+		s->cpu_us += cn->pcrc_cpu_us;
 	}
 }
 
@@ -554,6 +616,15 @@ static void handle_helper_answer(struct state *st,
 
 	passert(cn->pcrc_func != NULL);
 
+	nr_outstanding--;
+	/* a cancelled request was skipped */
+	if (!is_monotime_epoch(cn->pcrc_finished)) {
+		metrics_crypto(cn->pcrc_pcr.pcr_type, cn->pcrc_queued,
+			       cn->pcrc_started, cn->pcrc_finished,
+			       cn->pcrc_cpu_us);
+		record_helper_stats(cn);
+	}
+
 	DBG(DBG_CONTROL,
 		DBG_log("calling continuation function %p",
 			cn->pcrc_func));
@@ -565,7 +636,7 @@ static void handle_helper_answer(struct state *st,
 		/* suppressed */
 		DBG(DBG_CONTROL, DBG_log("work-order %u state #%lu crypto result suppressed",
 					 cn->pcrc_id, cn->pcrc_serialno));
-		pexpect(st == NULL || st->st_offloaded_task == NULL);
+		pexpect(st == NULL || st->st_offloaded_task != cn);
 		pcr_release(&cn->pcrc_pcr);
 	} else if (st == NULL) {
 		/* oops, the state disappeared! */
@@ -584,6 +655,87 @@ static void handle_helper_answer(struct state *st,
 	pfree(cn);
 }
 
+/*
+ * Deliver the answers sent back by the helpers.
+ */
+static void helper_answers_cb(evutil_socket_t fd UNUSED,
+			      short events UNUSED,
+			      void *arg UNUSED)
+{
+	clear_helper_answers_fd(answers);
+	unsigned n;
+	for (n = 0; n < HELPER_ANSWER_BATCH; n++) {
+		struct pluto_crypto_req_cont *cn = next_helper_answer(answers);
+		if (cn == NULL) {
+			break;
+		}
+		struct state *st = state_with_serialno(cn->pcrc_serialno);
+		if (st == NULL) {
+			handle_helper_answer(NULL, NULL, cn);
+		} else {
+			struct msg_digest *md = unsuspend_md(st);
+			so_serial_t old_state = push_cur_state(st);
+			handle_helper_answer(st, &md, cn);
+			release_any_md(&md);
+			pop_cur_state(old_state);
+		}
+	}
+	nr_answers += n;
+	nr_answer_batches++;
+	DBG(DBG_CONTROLMORE,
+	    DBG_log("delivered %u crypto helper answers", n));
+	if (have_helper_answers(answers)) {
+		/* come back after the other events */
+		signal_helper_answers_fd(answers);
+	}
+}
+
+void show_crypto_helper_status(void)
+{
+	whack_log_comment("current.crypto.helpers=%d", pc_workers_cnt);
+	whack_log_comment("current.crypto.outstanding=%lu", nr_outstanding);
+	whack_log_comment("current.crypto.outstanding.max=%lu", nr_outstanding_max);
+	whack_log_comment("total.crypto.requests=%lu", nr_requests);
+	whack_log_comment("total.crypto.answers=%lu", nr_answers);
+	whack_log_comment("total.crypto.answers.batches=%lu", nr_answer_batches);
+
+	show_crypto_metrics_status();
+
+	/*
+	 * A helper's busy fraction is the wall-clock time it spent
+	 * on work-orders since startup (or --clearstats); topping up
+	 * the DH pools while idle isn't counted.
+	 */
+	uintmax_t elapsed_us = monotime_elapsed_us(crypto_stats_since, mononow());
+	for (int i = 0; i < pc_workers_cnt; i++) {
+		const struct pluto_crypto_worker *w = &pc_workers[i];
+		const struct helper_stats *s = &w->pcw_stats;
+		whack_log_comment("total.crypto.helper.%d.requests=%lu",
+				  i, s->requests);
+		whack_log_comment("total.crypto.helper.%d.steals=%lu",
+				  i, helper_queue_steals(backlog, i) - w->pcw_steals_base);
+		whack_log_comment("total.crypto.helper.%d.time=%juus",
+				  i, s->time_us);
+		whack_log_comment("total.crypto.helper.%d.cpu=%juus",
+				  i, s->cpu_us);
+		whack_log_comment("current.crypto.helper.%d.busy=%ju%%",
+				  i, elapsed_us == 0 ? 0 : s->time_us * 100 / elapsed_us);
+	}
+}
+
+void clear_crypto_helper_stats(void)
+{
+	clear_crypto_metrics();
+	nr_requests = 0;
+	nr_answers = nr_answer_batches = 0;
+	nr_outstanding_max = nr_outstanding;
+	for (int i = 0; i < pc_workers_cnt; i++) {
+		zero(&pc_workers[i].pcw_stats);
+		pc_workers[i].pcw_steals_base = helper_queue_steals(backlog, i);
+	}
+	crypto_stats_since = mononow();
+}
+
 /*
  * initialize a helper.
  */
@@ -640,8 +792,8 @@ void init_crypto_helpers(int nhelpers)
 
 	pc_workers = NULL;
 	pc_workers_cnt = 0;
+	crypto_stats_since = mononow();
 
-	init_list(&backlog_info, &backlog);
 	init_crypto_helper_delay();
 
 	/* find out how many CPUs there are, if nhelpers is -1 */
@@ -674,6 +826,11 @@ void init_crypto_helpers(int nhelpers)
 		pc_workers = alloc_bytes(sizeof(*pc_workers) * nhelpers,
 					 "pluto crypto helpers (ignore)");
 		pc_workers_cnt = nhelpers;
+		backlog = alloc_helper_queues(nhelpers, &backlog_info);
+		answers = alloc_helper_answers(&backlog_info);
+		pluto_event_add(helper_answers_fd(answers), EV_READ | EV_PERSIST,
+				helper_answers_cb, NULL, NULL,
+				"crypto helper answers");
 
 		for (i = 0; i < nhelpers; i++)
 			init_crypto_helper(&pc_workers[i], i);
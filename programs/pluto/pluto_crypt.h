@@ -40,6 +40,8 @@
 #include "lsw_select.h"
 #include "crypto.h"
 #include "libreswan/passert.h"
+#include "nss_cert_verify.h"	/* for RO_SZ */
+#include "monotime.h"
 
 struct state;
 struct msg_digest;
@@ -53,6 +55,9 @@ enum pluto_crypto_requests {
 	pcr_compute_dh_iv,	/* calculate (g^x)(g^y) and skeyids for Phase 1 DH + prf */
 	pcr_compute_dh,		/* calculate (g^x)(g^y) for Phase 2 PFS */
 	pcr_compute_dh_v2,	/* perform IKEv2 SA calculation, create SKEYSEED */
+	pcr_rsa_sign,		/* sign a hash using our RSA private key */
+	pcr_rsa_verify,		/* check an RSA signature against candidate keys */
+	pcr_x509_verify,	/* verify the peer's certificate chain */
 };
 
 typedef unsigned int pcr_req_id;
@@ -153,6 +158,7 @@ extern void wire_clone_chunk(wire_arena_t *arena,
 struct pcr_kenonce {
 	/* inputs */
 	const struct oakley_group_desc *group;
+	bool reusable;		/* see get_dh_secret() */
 
 	/* outputs */
 	struct dh_secret *secret;
@@ -232,6 +238,42 @@ struct pcr_dh_v2 {
 	chunk_t skey_chunk_SK_pr;
 };
 
+/* query and response */
+struct pcr_rsa_sign {
+	/* query */
+	struct RSA_private_key *key;	/* a copy; see start_rsa_sign() */
+	chunk_t hash;
+
+	/* response */
+	chunk_t sig;			/* empty when signing failed */
+};
+
+/* query and response */
+struct pcr_rsa_verify {
+	/* query */
+	struct pubkey **keys;		/* referenced by the main thread */
+	unsigned nr_keys;
+	chunk_t hash;
+	chunk_t sig;
+
+	/* response */
+	err_t *ughs;			/* per key tried; NULL means it worked */
+	unsigned nr_tried;
+};
+
+/* query and response */
+struct pcr_x509_verify {
+	/* query */
+	chunk_t *ders;			/* copies of the CERT payloads */
+	int nr_ders;
+	bool rev_opts[RO_SZ];
+	monotime_t started;		/* for the latency statistics */
+
+	/* response */
+	int ret;			/* VERIFY_RET_* or -1 */
+	CERTCertificate *end_cert;	/* held by NSS's temporary import */
+};
+
 struct pluto_crypto_req {
 	enum pluto_crypto_requests pcr_type;
 
@@ -239,6 +281,9 @@ struct pluto_crypto_req {
 		struct pcr_kenonce kn;		/* query and result */
 		struct pcr_dh_v2 dh_v2;		/* query and response v2 */
 		struct pcr_v1_dh v1_dh;		/* query and response v1 */
+		struct pcr_rsa_sign rsa_sign;	/* query and response */
+		struct pcr_rsa_verify rsa_verify; /* query and response */
+		struct pcr_x509_verify x509_verify; /* query and response */
 	} pcr_d;
 };
 
@@ -298,6 +343,8 @@ extern struct pluto_crypto_req_cont *new_pcrc(crypto_req_cont_func fn,
 					      const char *name);
 
 extern void init_crypto_helpers(int nhelpers);
+extern void show_crypto_helper_status(void);
+extern void clear_crypto_helper_stats(void);
 
 extern void send_crypto_helper_request(struct state *st,
 				       struct pluto_crypto_req_cont *cn);
@@ -313,6 +360,11 @@ extern void request_ke_and_nonce(const char *name,
 				 const struct oakley_group_desc *group,
 				 crypto_req_cont_func *callback);
 
+extern void request_responder_ke_and_nonce(const char *name,
+					   struct state *st,
+					   const struct oakley_group_desc *group,
+					   crypto_req_cont_func *callback);
+
 extern void request_nonce(const char *name,
 			  struct state *st,
 			  crypto_req_cont_func *callback);
@@ -364,6 +416,50 @@ extern bool finish_dh_v2(struct state *st,
 
 extern void cancelled_dh_v2(struct pcr_dh_v2 *dh);
 
+/*
+ * RSA signatures
+ */
+
+struct RSA_private_key;
+
+extern void start_rsa_sign(struct state *st, const char *name,
+			   const struct RSA_private_key *k,
+			   const u_char *hash_val, size_t hash_len,
+			   crypto_req_cont_func *pcrc_func);
+
+extern bool finish_rsa_sign(struct pluto_crypto_req *r, chunk_t *sig);
+
+extern void calc_rsa_sign(struct pcr_rsa_sign *rs);
+
+extern void cancelled_rsa_sign(struct pcr_rsa_sign *rs);
+
+extern void start_rsa_verify(struct state *st, const char *name,
+			     const u_char *hash_val, size_t hash_len,
+			     const u_char *sig_val, size_t sig_len,
+			     crypto_req_cont_func *pcrc_func);
+
+extern stf_status finish_rsa_verify(struct state *st,
+				    struct pluto_crypto_req *r);
+
+extern void calc_rsa_verify(struct pcr_rsa_verify *rv);
+
+extern void cancelled_rsa_verify(struct pcr_rsa_verify *rv);
+
+/*
+ * X.509 certificate chains
+ */
+
+extern bool start_x509_verify(struct state *st, struct msg_digest *md,
+			      crypto_req_cont_func *pcrc_func);
+
+extern void finish_x509_verify(struct state *st, struct pluto_crypto_req *r);
+
+extern void calc_x509_verify(struct pcr_x509_verify *xv);
+
+extern void cancelled_x509_verify(struct pcr_x509_verify *xv);
+
+extern void free_x509_verified(struct pcr_x509_verify **xv);
+
 /*
  * KE and NONCE
  */
@@ -372,13 +468,19 @@ extern void unpack_KE_from_helper(struct state *st,
 				  struct pluto_crypto_req *r,
 				  chunk_t *g);
 
-void pcr_kenonce_init(struct pluto_crypto_req_cont *cn,
-		      enum pluto_crypto_requests pcr_type,
-		      const struct oakley_group_desc *dh);
+struct pcr_kenonce *pcr_kenonce_init(struct pluto_crypto_req_cont *cn,
+				     enum pluto_crypto_requests pcr_type,
+				     const struct oakley_group_desc *dh);
 
 struct pcr_v1_dh *pcr_v1_dh_init(struct pluto_crypto_req_cont *cn,
 				 enum pluto_crypto_requests pcr_type);
 
 struct pcr_dh_v2 *pcr_dh_v2_init(struct pluto_crypto_req_cont *cn);
 
+struct pcr_rsa_sign *pcr_rsa_sign_init(struct pluto_crypto_req_cont *cn);
+
+struct pcr_rsa_verify *pcr_rsa_verify_init(struct pluto_crypto_req_cont *cn);
+
+struct pcr_x509_verify *pcr_x509_verify_init(struct pluto_crypto_req_cont *cn);
+
 #endif /* _PLUTO_CRYPT_H */
@@ -58,6 +58,8 @@ uint64_t pstats_ipsec_in_bytes;	/* total incoming IPsec traffic */
 uint64_t pstats_ipsec_out_bytes;	/* total outgoing IPsec traffic */
 unsigned long pstats_ike_in_bytes;	/* total incoming IPsec traffic */
 unsigned long pstats_ike_out_bytes;	/* total outgoing IPsec traffic */
+unsigned long pstats_ike_recv_wakeups;	/* reads of an IKE socket */
+unsigned long pstats_ike_recv_packets;	/* packets returned by those reads */
 unsigned long pstats_ikev1_sent_notifies_e[v1N_ERROR_ROOF]; /* types of NOTIFY ERRORS */
 unsigned long pstats_ikev1_recv_notifies_e[v1N_ERROR_ROOF]; /* types of NOTIFY ERRORS */
 unsigned long pstats_ikev2_sent_notifies_e[v2N_ERROR_ROOF]; /* types of NOTIFY ERRORS */
@@ -73,6 +75,11 @@ unsigned long pstats_ipsec_tfc;
 unsigned long pstats_ike_dpd_recv;
 unsigned long pstats_ike_dpd_sent;
 unsigned long pstats_ike_dpd_replied;
+unsigned long pstats_ike_natt_ka_sent;
+unsigned long pstats_ike_natt_ka_suppressed;
+unsigned long pstats_rekeys_spread;
+unsigned long pstats_rekeys_deferred;
+unsigned long pstats_rekeys_overrate;
 unsigned long pstats_xauth_started;
 unsigned long pstats_xauth_stopped;
 unsigned long pstats_xauth_aborted;
@@ -115,8 +122,15 @@ void show_pluto_stats()
 	whack_log_comment("total.ike.dpd.sent=%lu", pstats_ike_dpd_sent);
 	whack_log_comment("total.ike.dpd.recv=%lu", pstats_ike_dpd_recv);
 	whack_log_comment("total.ike.dpd.replied=%lu", pstats_ike_dpd_replied);
+	whack_log_comment("total.ike.natt.keepalive.sent=%lu", pstats_ike_natt_ka_sent);
+	whack_log_comment("total.ike.natt.keepalive.suppressed=%lu", pstats_ike_natt_ka_suppressed);
+	whack_log_comment("total.rekeys.spread=%lu", pstats_rekeys_spread);
+	whack_log_comment("total.rekeys.deferred=%lu", pstats_rekeys_deferred);
+	whack_log_comment("total.rekeys.overrate=%lu", pstats_rekeys_overrate);
 	whack_log_comment("total.ike.traffic.in=%lu", pstats_ike_in_bytes);
 	whack_log_comment("total.ike.traffic.out=%lu", pstats_ike_out_bytes);
+	whack_log_comment("total.ike.recv.wakeups=%lu", pstats_ike_recv_wakeups);
+	whack_log_comment("total.ike.recv.packets=%lu", pstats_ike_recv_packets);
 
 	whack_log_comment("total.xauth.started=%lu", pstats_xauth_started);
 	whack_log_comment("total.xauth.stopped=%lu", pstats_xauth_stopped);
@@ -161,10 +175,13 @@ void clear_pluto_stats()
 	pstats_ikev1_fail = pstats_ikev2_fail = 0;
 	pstats_ipsec_in_bytes = pstats_ipsec_out_bytes = 0;
 	pstats_ike_in_bytes = pstats_ike_out_bytes = 0;
+	pstats_ike_recv_wakeups = pstats_ike_recv_packets = 0;
 	pstats_ipsec_esp = pstats_ipsec_ah = pstats_ipsec_ipcomp = 0;
 	pstats_ipsec_encap_yes = pstats_ipsec_encap_no = 0;
 	pstats_ipsec_esn = pstats_ipsec_tfc = 0;
 	pstats_ike_dpd_recv = pstats_ike_dpd_sent = pstats_ike_dpd_replied = 0;
+	pstats_ike_natt_ka_sent = pstats_ike_natt_ka_suppressed = 0;
+	pstats_rekeys_spread = pstats_rekeys_deferred = pstats_rekeys_overrate = 0;
 	pstats_xauth_started = pstats_xauth_stopped = pstats_xauth_aborted = 0;
 
 	memset(pstats_ikev1_encr, 0, sizeof pstats_ikev1_encr);
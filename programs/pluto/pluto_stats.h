@@ -39,6 +39,8 @@ extern uint64_t pstats_ipsec_in_bytes;	/* total incoming IPsec traffic */
 extern uint64_t pstats_ipsec_out_bytes;	/* total outgoing IPsec traffic */
 extern unsigned long pstats_ike_in_bytes;	/* total incoming IPsec traffic */
 extern unsigned long pstats_ike_out_bytes;	/* total outgoing IPsec traffic */
+extern unsigned long pstats_ike_recv_wakeups;	/* reads of an IKE socket */
+extern unsigned long pstats_ike_recv_packets;	/* packets returned by those reads */
 extern unsigned long pstats_ikev1_sent_notifies_e[v1N_ERROR_ROOF]; /* types of NOTIFY ERRORS */
 extern unsigned long pstats_ikev1_recv_notifies_e[v1N_ERROR_ROOF]; /* types of NOTIFY ERRORS */
 extern unsigned long pstats_ikev2_sent_notifies_e[v2N_ERROR_ROOF]; /* types of NOTIFY ERRORS */
@@ -54,6 +56,11 @@ extern unsigned long pstats_ipsec_tfc;
 extern unsigned long pstats_ike_dpd_recv;
 extern unsigned long pstats_ike_dpd_sent;
 extern unsigned long pstats_ike_dpd_replied;
+extern unsigned long pstats_ike_natt_ka_sent;
+extern unsigned long pstats_ike_natt_ka_suppressed;
+extern unsigned long pstats_rekeys_spread;
+extern unsigned long pstats_rekeys_deferred;
+extern unsigned long pstats_rekeys_overrate;
 
 extern unsigned long pstats_xauth_started;
 extern unsigned long pstats_xauth_stopped;
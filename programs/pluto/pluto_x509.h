@@ -32,6 +32,7 @@
 struct msg_digest;
 
 extern int ike_decode_cert(struct msg_digest *md);
+extern void show_x509_status(void);
 extern void ikev1_decode_cr(struct msg_digest *md);
 extern void ikev2_decode_cr(struct msg_digest *md);
 
@@ -79,10 +79,20 @@
 #include "crypto.h"
 #include "vendor.h"
 #include "pluto_crypt.h"
+#include "crypt_dh.h"	/* for dh_pool_size et.al. */
 #include "enum_names.h"
 #include "virtual.h"	/* needs connections.h */
 #include "state_db.h"	/* for init_state_db() */
+#include "connection_db.h"	/* for init_connection_db() */
+#include "host_pair_db.h"	/* for init_host_pair_db() */
+#include "spd_db.h"		/* for init_spd_db() */
+#include "addresspool.h"	/* for init_addresspools() */
+#include "dns_cache.h"		/* for init_dns_cache() */
+#include "updown.h"		/* for updown_workers et.al. */
 #include "nat_traversal.h"
+#include "rekey.h"		/* for rekey_rate */
+#include "rcv_whack.h"	/* for free_whack_batches() */
+#include "metrics.h"		/* for metrics_socket */
 
 #include "cbc_test_vectors.h"
 #include "ctr_test_vectors.h"
@@ -145,6 +155,8 @@ static void free_pluto_main(void)
 	/* Some values can be NULL if not specified as pluto argument */
 	pfree(coredir);
 	pfreeany(pluto_stats_binary);
+	pfreeany(updown_coprocess);
+	pfreeany(metrics_socket);
 	pfreeany(pluto_listen);
 	pfree(pluto_vendorid);
 	pfreeany(ocsp_uri);
@@ -571,6 +583,17 @@ static const struct option long_opts[] = {
 	{ "nhelpers\0<number>", required_argument, NULL, 'j' },
 	{ "expire-shunt-interval\0<secs>", required_argument, NULL, '9' },
 	{ "seedbits\0<number>", required_argument, NULL, 'c' },
+	{ "dh-pool-size\0<number>", required_argument, NULL, 'Q' },
+	{ "dh-reuse-seconds\0<secs>", required_argument, NULL, 'a' },
+	{ "dh-reuse-limit\0<number>", required_argument, NULL, 'y' },
+	{ "updown-workers\0<number>", required_argument, NULL, 'm' },
+	{ "updown-coprocess\0<filename>", required_argument, NULL, '@' },
+	{ "sa-counter-refresh\0<secs>", required_argument, NULL, '#' },
+	{ "rekey-rate\0<number>", required_argument, NULL, '$' },
+#ifdef XAUTH_HAVE_PAM
+	{ "pam-workers\0<number>", required_argument, NULL, '%' },
+#endif
+	{ "metrics-socket\0<filename|[address:]port>", required_argument, NULL, '^' },
 #ifdef HAVE_LABELED_IPSEC
 	/* ??? really an attribute type, not a value */
 	{ "secctx_attr_value\0_", required_argument, NULL, 'w' },	/* obsolete name; _ */
@@ -811,6 +834,67 @@ int main(int argc, char **argv)
 				nhelpers = u;
 			}
 			continue;
+		case 'Q':	/* --dh-pool-size */
+			ugh = ttoulb(optarg, 0, 10, 1000, &u);
+			if (ugh != NULL)
+				break;
+			dh_pool_size = u;
+			continue;
+
+		case 'a':	/* --dh-reuse-seconds */
+			ugh = ttoulb(optarg, 0, 10, secs_per_day, &u);
+			if (ugh != NULL)
+				break;
+			dh_reuse_time = deltatime(u);
+			continue;
+
+		case 'y':	/* --dh-reuse-limit */
+			ugh = ttoulb(optarg, 0, 10, 0xFFFFFFFF, &u);
+			if (ugh != NULL)
+				break;
+			dh_reuse_limit = u;
+			continue;
+
+		case 'm':	/* --updown-workers */
+			ugh = ttoulb(optarg, 0, 10, 1000, &u);
+			if (ugh != NULL)
+				break;
+			updown_workers = u;
+			continue;
+
+		case '@':	/* --updown-coprocess */
+			pfreeany(updown_coprocess);
+			updown_coprocess = clone_str(optarg, "updown-coprocess");
+			continue;
+
+		case '^':	/* --metrics-socket */
+			pfreeany(metrics_socket);
+			metrics_socket = clone_str(optarg, "metrics-socket");
+			continue;
+
+		case '#':	/* --sa-counter-refresh */
+			ugh = ttoulb(optarg, 0, 10, secs_per_hour, &u);
+			if (ugh != NULL)
+				break;
+			sa_counter_refresh = deltatime(u);
+			continue;
+
+		case '$':	/* --rekey-rate */
+			ugh = ttoulb(optarg, 0, 10, 100000, &u);
+			if (ugh != NULL)
+				break;
+			rekey_rate = u;
+			continue;
+
+#ifdef XAUTH_HAVE_PAM
+		case '%':	/* --pam-workers */
+			ugh = ttoulb(optarg, 0, 10, 1000, &u);
+			if (ugh != NULL)
+				break;
+			pam_workers = u;
+			continue;
+#endif
+
 		case 'c':	/* --seedbits */
 			pluto_nss_seedbits = atoi(optarg);
 			if (pluto_nss_seedbits == 0) {
@@ -1308,6 +1392,25 @@ int main(int argc, char **argv)
 				cfg->setup.strings[KSF_VIRTUALPRIVATE]);
 
 			nhelpers = cfg->setup.options[KBF_NHELPERS];
+			dh_pool_size = cfg->setup.options[KBF_DH_POOL_SIZE];
+			dh_reuse_time = deltatime(cfg->setup.options[KBF_DH_REUSE_SECONDS]);
+			dh_reuse_limit = cfg->setup.options[KBF_DH_REUSE_LIMIT];
+			updown_workers = cfg->setup.options[KBF_UPDOWN_WORKERS];
+			sa_counter_refresh = deltatime(cfg->setup.options[KBF_SA_COUNTER_REFRESH]);
+			rekey_rate = cfg->setup.options[KBF_REKEY_RATE];
+#ifdef XAUTH_HAVE_PAM
+			pam_workers = cfg->setup.options[KBF_PAM_WORKERS];
+#endif
+			if (cfg->setup.strings[KSF_UPDOWN_COPROCESS] != NULL) {
+				pfreeany(updown_coprocess);
+				updown_coprocess = clone_str(cfg->setup.strings[KSF_UPDOWN_COPROCESS],
+							     "updown-coprocess via --config");
+			}
+			if (cfg->setup.strings[KSF_METRICS_SOCKET] != NULL) {
+				pfreeany(metrics_socket);
+				metrics_socket = clone_str(cfg->setup.strings[KSF_METRICS_SOCKET],
+							   "metrics-socket via --config");
+			}
 #ifdef HAVE_LABELED_IPSEC
 			secctx_attr_type = cfg->setup.options[KBF_SECCTX];
 #endif
@@ -1717,18 +1820,26 @@ int main(int argc, char **argv)
 /* Initialize all of the various features */
 
 	init_state_db();
+	init_connection_db();
+	init_host_pair_db();
+	init_spd_db();
+	init_addresspools();
+	init_dns_cache();
 
 	init_nat_traversal(keep_alive);
 
 	init_virtual_ip(virtual_private);
 	/* obsoleted by nss code init_rnd_pool(); */
 	init_event_base();
+	init_timer();
 	init_secret();
 	init_states();
 	init_connections();
 	init_crypto();
 	init_crypto_helpers(nhelpers);
+	init_updown();
 	init_demux();
+	init_metrics();
 	init_kernel();
 	init_vendorid();
 #if defined(LIBCURL) || defined(LIBLDAP)
@@ -1770,7 +1881,17 @@ void exit_pluto(int status)
  #endif
 	free_preshared_secrets();
 	free_remembered_public_keys();
+	free_updown();		/* deleting connections runs updown; wait for it */
+#ifdef XAUTH_HAVE_PAM
+	free_xauth_pam();	/* before the states that own the requests */
+#endif
 	delete_every_connection();
+	free_state_db();	/* grown state hash tables */
+	free_connection_db();	/* grown connection hash tables */
+	free_host_pair_db();	/* grown host pair hash table */
+	free_spd_db();		/* spd route tries */
+	free_addresspools();	/* grown lease ID hash table */
+	free_dns_cache();	/* once no connection can start a lookup */
 
 	/*
 	 * free memory allocated by initialization routines.  Please don't
@@ -1785,10 +1906,14 @@ void exit_pluto(int status)
 
 	free_ifaces();	/* free interface list from memory */
 	free_md_pool();	/* free the md pool */
+	free_dh_pools();	/* pre-computed DH secrets */
 	lsw_nss_shutdown();
 	delete_lock();	/* delete any lock files */
 	free_virtual_ip();	/* virtual_private= */
+	free_whack_batches();	/* before their events are freed */
+	free_metrics();		/* likewise */
 	free_pluto_event_list(); /* no libevent evnts beyond this point */
+	free_rekey();		/* after the replace events are gone */
 	free_pluto_main();	/* our static chars */
 
 #ifdef USE_DNSSEC
@@ -1852,6 +1977,35 @@ void show_setup_plutomain(void)
                 (intmax_t) pluto_xfrmlifetime
 	);
 
+	whack_log(RC_COMMENT,
+		"dh-pool-size=%u, dh-reuse-seconds=%jd, dh-reuse-limit=%lu",
+		dh_pool_size,
+		deltasecs(dh_reuse_time),
+		dh_reuse_limit);
+
+	whack_log(RC_COMMENT,
+		"updown-workers=%u, updown-coprocess=%s",
+		updown_workers,
+		updown_coprocess == NULL ? "<none>" : updown_coprocess);
+
+	whack_log(RC_COMMENT,
+		"sa-counter-refresh=%jd",
+		deltasecs(sa_counter_refresh));
+
+	whack_log(RC_COMMENT,
+		"rekey-rate=%u",
+		rekey_rate);
+
+	whack_log(RC_COMMENT,
+		"metrics-socket=%s",
+		metrics_socket == NULL ? "<none>" : metrics_socket);
+
+#ifdef XAUTH_HAVE_PAM
+	whack_log(RC_COMMENT, "pam-workers=%u", pam_workers);
+#else
+	whack_log(RC_COMMENT, "pam-workers=<unsupported>");
+#endif
+
 	whack_log(RC_COMMENT,
 		"ddos-cookies-threshold=%d, ddos-max-halfopen=%d, ddos-mode=%s",
 		pluto_max_halfopen,
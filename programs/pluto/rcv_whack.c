@@ -77,6 +77,8 @@
 #include "pluto_sd.h"
 
 #include "pluto_stats.h"
+#include "reload.h"
+#include "metrics.h"	/* for show_metrics() */
 
 /* bits loading keys from asynchronous DNS */
 
@@ -110,7 +112,15 @@ static int whack_route_connection(struct connection *c,
 			"we cannot identify ourselves with either end of this connection");
 	else if (c->policy & POLICY_GROUP)
 		route_group(c);
-	else if (!trap_connection(c))
+	else if (c->dnshostname != NULL && isanyaddr(&c->spd.that.host_addr)) {
+		/*
+		 * Until the lookup is answered this is a template for
+		 * any peer; connection_check_ddns1() routes it then.
+		 */
+		loglog(RC_COMMENT,
+			"peer IP address not yet resolved, will route the connection once it is");
+		c->policy |= POLICY_ROUTE;
+	} else if (!trap_connection(c))
 		whack_log(RC_ROUTE, "could not route");
 
 	reset_cur_connection();
@@ -126,6 +136,7 @@ static int whack_unroute_connection(struct connection *c,
 	passert(c != NULL);
 	set_cur_connection(c);
 
+	c->policy &= ~POLICY_ROUTE;
 	for (sr = &c->spd; sr != NULL; sr = sr->spd_next) {
 		if (sr->routing >= RT_ROUTED_TUNNEL)
 			fail++;
@@ -259,9 +270,9 @@ static bool openwhackrecordfile(char *file)
 
 
 /*
- * handle a whack message.
+ * handle a whack message; the caller closes WHACKFD.
  */
-void whack_process(int whackfd, const struct whack_message *const m)
+static void whack_process_msg(int whackfd, const struct whack_message *const m)
 {
 	/*
 	 * May be needed in future:
@@ -274,7 +285,7 @@ void whack_process(int whackfd, const struct whack_message *const m)
 			if (libreswan_fipsmode()) {
 				if (lmod_is_set(m->debugging, DBG_PRIVATE)) {
 					whack_log(RC_FATAL, "FIPS: --debug-private is not allowed in FIPS mode, aborted");
-					goto done;
+					return;
 				}
 			}
 #endif
@@ -361,7 +372,7 @@ void whack_process(int whackfd, const struct whack_message *const m)
 			openwhackrecordfile(m->string1);
 
 			/* do not do any other processing for these */
-			goto done;
+			return;
 
 		case WHACK_STOPWHACKRECORD:
 			if (whackrecordfile != NULL) {
@@ -372,7 +383,7 @@ void whack_process(int whackfd, const struct whack_message *const m)
 			}
 			whackrecordfile = NULL;
 			/* do not do any other processing for these */
-			goto done;
+			return;
 		}
 	}
 
@@ -380,7 +391,14 @@ void whack_process(int whackfd, const struct whack_message *const m)
 	 * To make this more useful, in only this combination,
 	 * delete will silently ignore the lack of the connection.
 	 */
-	if (m->whack_delete)
+	if (m->whack_config == WHACK_CONFIG_RELOAD_START)
+		reload_start();
+
+	/*
+	 * addconn always asks for a replace; when reloading,
+	 * reload_connection() only deletes what changed.
+	 */
+	if (m->whack_delete && m->whack_config != WHACK_CONFIG_RELOAD)
 		delete_connections_by_name(m->name, !m->whack_connection);
 
 	if (m->whack_deleteuser) {
@@ -423,8 +441,18 @@ void whack_process(int whackfd, const struct whack_message *const m)
 	if (m->whack_crash)
 		delete_states_by_peer(&m->whack_crash_peer);
 
-	if (m->whack_connection)
-		add_connection(m);
+	if (m->whack_connection) {
+		if (m->whack_config == WHACK_CONFIG_RELOAD)
+			reload_connection(m);
+		else
+			add_connection(m);
+	}
+
+	if (m->whack_config == WHACK_CONFIG_RELOAD_KEEP)
+		reload_keep(m);
+
+	if (m->whack_config == WHACK_CONFIG_RELOAD_END)
+		reload_end();
 
 	/* update any socket buffer size before calling listen */
 	if (m->ike_buf_size != 0) {
@@ -492,7 +520,7 @@ void whack_process(int whackfd, const struct whack_message *const m)
 		key_add_request(m);
 	}
 
-	if (m->whack_route) {
+	if (m->whack_route && !reload_skip(m)) {
 		if (!listening) {
 			whack_log(RC_DEAF, "need --listen before --route");
 		} else {
@@ -525,7 +553,7 @@ void whack_process(int whackfd, const struct whack_message *const m)
 		}
 	}
 
-	if (m->whack_initiate) {
+	if (m->whack_initiate && !reload_skip(m)) {
 		if (!listening) {
 			whack_log(RC_DEAF, "need --listen before --initiate");
 		} else {
@@ -581,8 +609,13 @@ void whack_process(int whackfd, const struct whack_message *const m)
 	if (m->whack_global_status)
 		show_global_status();
 
-	if (m->whack_clear_stats)
+	if (m->whack_metrics)
+		show_metrics();
+
+	if (m->whack_clear_stats) {
 		clear_pluto_stats();
+		clear_crypto_helper_stats();
+	}
 
 	if (m->whack_traffic_status)
 		show_traffic_status();
@@ -649,14 +682,199 @@ void whack_process(int whackfd, const struct whack_message *const m)
 		libreswan_log("shutting down");
 		exit_pluto(PLUTO_EXIT_OK); /* delete lock and leave, with 0 status */
 	}
+}
 
-done:
+/*
+ * handle a whack message, and then close WHACKFD.
+ */
+void whack_process(int whackfd, const struct whack_message *const m)
+{
+	whack_process_msg(whackfd, m);
 	whack_log_fd = NULL_FD;
 	close(whackfd);
 }
 
 static void whack_handle(int kernelfd);
 
+/*
+ * Check the N byte message MSG and unpack its strings.
+ *
+ * Returns NULL when it should be processed, "" when it has been
+ * dealt with (only basic commands), and otherwise a diagnostic.
+ */
+static err_t whack_unpack(struct whack_message *msg, size_t n)
+{
+	struct whackpacker wp;
+
+	wp.msg = msg;
+	wp.n   = n;
+	wp.str_next = msg->string;
+	wp.str_roof = (unsigned char *)msg + n;
+
+	if (n < offsetof(struct whack_message,
+			 whack_shutdown) + sizeof(msg->whack_shutdown)) {
+		return builddiag(
+			"ignoring runt message from whack: got %d bytes",
+			(int)n);
+	} else if (msg->magic != WHACK_MAGIC) {
+		if (msg->whack_shutdown) {
+			libreswan_log("shutting down%s",
+			    (msg->magic != WHACK_BASIC_MAGIC) ?  " despite whacky magic" : "");
+			exit_pluto(PLUTO_EXIT_OK);  /* delete lock and leave, with 0 status */
+		}
+		if (msg->magic == WHACK_BASIC_MAGIC) {
+			/* Only basic commands.  Simpler inter-version compatibility. */
+			if (msg->whack_status)
+				show_status();
+
+			return "";               /* bail early, but without complaint */
+		} else {
+			return builddiag(
+				"ignoring message from whack with bad magic %d; should be %d; Mismatched versions of userland tools.",
+				msg->magic, WHACK_MAGIC);
+		}
+	} else {
+		if (msg->whack_connection)
+			config_digest(msg, n);
+		return unpack_whack_msg(&wp);
+	}
+}
+
+/*
+ * A whack batch (see whack.h): the connection stays open, and each
+ * message (a uint32_t length followed by the packed message) is
+ * handled as it arrives, its output followed by an ack.
+ */
+
+struct whack_batch_conn {
+	int fd;
+	struct pluto_event *ev;
+	unsigned long nr;	/* messages handled */
+	size_t len;		/* bytes in buf */
+	unsigned char buf[sizeof(uint32_t) + sizeof(struct whack_message)];
+	struct whack_batch_conn *next;
+};
+
+static struct whack_batch_conn *whack_batches;	/* open batches */
+
+static void whack_batch_end(struct whack_batch_conn *b)
+{
+	DBG(DBG_CONTROLMORE,
+	    DBG_log("whack batch on fd %d closed after %lu messages",
+		    b->fd, b->nr));
+	for (struct whack_batch_conn **p = &whack_batches; *p != NULL;
+	     p = &(*p)->next) {
+		if (*p == b) {
+			*p = b->next;
+			break;
+		}
+	}
+	delete_pluto_event(&b->ev);
+	close(b->fd);
+	pfree(b);
+}
+
+static void whack_batch_msg(struct whack_batch_conn *b,
+			    const unsigned char *buf, size_t n)
+{
+	struct whack_message msg;
+
+	/* see whack_handle() */
+	zero(&msg);
+	memcpy(&msg, buf, n);
+	b->nr++;
+
+	whack_log_fd = b->fd;
+	err_t ugh = whack_unpack(&msg, n);
+	if (ugh == NULL && (msg.whack_initiate || msg.whack_oppo_initiate)) {
+		/* could prompt; and would see the next message as the answer */
+		ugh = "ignoring --initiate in a whack batch";
+	}
+	if (ugh == NULL) {
+		writewhackrecord((char *)buf, n);
+		whack_process_msg(b->fd, &msg);
+	} else if (*ugh != '\0') {
+		loglog(RC_BADWHACKMESSAGE, "%s", ugh);
+	}
+	whack_log(RC_WHACK_BATCH_ACK, "%lu", b->nr);
+	whack_log_fd = NULL_FD;
+}
+
+/* handle each complete message in B's buffer */
+static void whack_batch_process(struct whack_batch_conn *b)
+{
+	size_t used = 0;
+
+	for (;;) {
+		uint32_t size;
+
+		if (b->len - used < sizeof(size))
+			break;
+		memcpy(&size, b->buf + used, sizeof(size));
+		if (size > sizeof(struct whack_message)) {
+			libreswan_log("ignoring rest of whack batch; message of %u bytes is too big",
+				      (unsigned)size);
+			whack_batch_end(b);
+			return;
+		}
+		if (b->len - used - sizeof(size) < size)
+			break;
+		whack_batch_msg(b, b->buf + used + sizeof(size), size);
+		used += sizeof(size) + size;
+	}
+	memmove(b->buf, b->buf + used, b->len - used);
+	b->len -= used;
+}
+
+static void whack_batch_cb(evutil_socket_t fd, const short event UNUSED,
+			   void *arg)
+{
+	struct whack_batch_conn *b = arg;
+	ssize_t n = read(fd, b->buf + b->len, sizeof(b->buf) - b->len);
+
+	if (n < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return;
+		LOG_ERRNO(errno, "read() failed in whack batch");
+		whack_batch_end(b);
+		return;
+	}
+	if (n == 0) {
+		if (b->len > 0) {
+			libreswan_log("ignoring truncated message at end of whack batch");
+		}
+		whack_batch_end(b);
+		return;
+	}
+	b->len += n;
+	whack_batch_process(b);
+}
+
+/* BUF contains the N bytes read after the magic */
+static void whack_batch_start(int whackfd, const unsigned char *buf, size_t n)
+{
+	struct whack_batch_conn *b = alloc_thing(struct whack_batch_conn,
+						 "whack batch");
+
+	DBG(DBG_CONTROLMORE,
+	    DBG_log("whack batch on fd %d", whackfd));
+	b->fd = whackfd;
+	b->len = n;
+	memcpy(b->buf, buf, n);
+	b->next = whack_batches;
+	whack_batches = b;
+	b->ev = pluto_event_add(whackfd, EV_READ | EV_PERSIST,
+				whack_batch_cb, b, NULL, "whack batch");
+	/* the first read may have got more than the magic */
+	whack_batch_process(b);
+}
+
+void free_whack_batches(void)
+{
+	while (whack_batches != NULL)
+		whack_batch_end(whack_batches);
+}
+
 void whack_handle_cb(evutil_socket_t fd, const short event UNUSED,
 		void *arg UNUSED)
 {
@@ -705,6 +923,13 @@ static void whack_handle(int whackctlfd)
 		return;
 	}
 
+	if ((size_t)n >= sizeof(msg.magic) && msg.magic == WHACK_BATCH_MAGIC) {
+		whack_batch_start(whackfd,
+				  (unsigned char *)&msg + sizeof(msg.magic),
+				  n - sizeof(msg.magic));
+		return;
+	}
+
 	whack_log_fd = whackfd;
 
 	msg_saved = msg;
@@ -713,40 +938,7 @@ static void whack_handle(int whackctlfd)
 
 	/* sanity check message */
 	{
-		err_t ugh = NULL;
-		struct whackpacker wp;
-
-		wp.msg = &msg;
-		wp.n   = n;
-		wp.str_next = msg.string;
-		wp.str_roof = (unsigned char *)&msg + n;
-
-		if ((size_t)n <
-		    offsetof(struct whack_message,
-			     whack_shutdown) + sizeof(msg.whack_shutdown)) {
-			ugh = builddiag(
-				"ignoring runt message from whack: got %d bytes",
-				(int)n);
-		} else if (msg.magic != WHACK_MAGIC) {
-			if (msg.whack_shutdown) {
-				libreswan_log("shutting down%s",
-				    (msg.magic != WHACK_BASIC_MAGIC) ?  " despite whacky magic" : "");
-				exit_pluto(PLUTO_EXIT_OK);  /* delete lock and leave, with 0 status */
-			}
-			if (msg.magic == WHACK_BASIC_MAGIC) {
-				/* Only basic commands.  Simpler inter-version compatibility. */
-				if (msg.whack_status)
-					show_status();
-
-				ugh = "";               /* bail early, but without complaint */
-			} else {
-				ugh = builddiag(
-					"ignoring message from whack with bad magic %d; should be %d; Mismatched versions of userland tools.",
-					msg.magic, WHACK_MAGIC);
-			}
-		} else {
-			ugh = unpack_whack_msg(&wp);
-		}
+		err_t ugh = whack_unpack(&msg, n);
 
 		if (ugh != NULL) {
 			if (*ugh != '\0')
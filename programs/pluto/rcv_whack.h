@@ -15,3 +15,5 @@
 
 extern void whack_handle_cb(evutil_socket_t fd,
 		const short event UNUSED, void *arg UNUSED);
+
+extern void free_whack_batches(void);
@@ -0,0 +1,242 @@
+/* rekey rate limiting and spreading, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * After a mass (re)connect, for instance when the peer gateway
+ * reboots, every SA gets much the same lifetime and so they all want
+ * replacing in the same few seconds, and again each time after that.
+ *
+ * With rekey_rate set, two things break this up:
+ *
+ * - when the replace event is scheduled, a second that already has
+ *   rekey_rate replacements due is avoided by moving this one
+ *   earlier, within the rekeymargin; each generation of SAs ends up
+ *   a little more spread out than the last
+ *
+ * - when the replace event fires, and rekeys are being initiated
+ *   faster than rekey_rate (a burst of a second's worth is allowed),
+ *   the event is pushed back to the next free slot; this eats into
+ *   the SA's margin, so at most half of the margin is given up
+ */
+
+#include <stdint.h>
+
+#include "libreswan.h"
+#include "lswalloc.h"
+#include "lswlog.h"
+#include "constants.h"
+#include "defs.h"
+#include "connections.h"
+#include "state.h"
+#include "timer.h"
+#include "log.h"		/* for whack_log_comment() */
+#include "pluto_stats.h"
+#include "rekey.h"
+
+unsigned rekey_rate;
+
+/*
+ * The number of replace events due in each second, indexed by the
+ * (monotonic) second modulo REKEY_SECONDS.  SA lifetimes are capped
+ * at a day so this covers all but bogus events.
+ */
+#define REKEY_SECONDS (1 << 17)
+#define REKEY_MASK (REKEY_SECONDS - 1)
+
+static unsigned *rekeys_due;	/* only with rekey_rate; allocated on first use */
+static unsigned nr_rekeys_due;
+
+/* when, in microseconds, the next rekey can start without bursting */
+static uint64_t rekey_tat;
+
+bool is_rekey_event(enum event_type type)
+{
+	switch (type) {
+	case EVENT_SA_REPLACE:
+	case EVENT_SA_REPLACE_IF_USED:
+	case EVENT_v2_SA_REPLACE_IF_USED:
+	case EVENT_v2_SA_REPLACE_IF_USED_IKE:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static unsigned *rekey_slot(intmax_t second)
+{
+	if (rekeys_due == NULL) {
+		rekeys_due = alloc_things(unsigned, REKEY_SECONDS,
+					  "rekeys due");
+	}
+	return &rekeys_due[second & REKEY_MASK];
+}
+
+void rekey_event_scheduled(struct pluto_event *ev)
+{
+	passert(ev->ev_state != NULL && is_rekey_event(ev->ev_type));
+	/* a new replace time; any deferred slot is forgotten */
+	ev->ev_state->st_rekey_deferred = FALSE;
+	/* only rekey_spread() reads the ring */
+	if (rekey_rate == 0) {
+		return;
+	}
+	if (monosecs(ev->ev_time) - monosecs(mononow()) >= REKEY_SECONDS - 1) {
+		return;
+	}
+	(*rekey_slot(monosecs(ev->ev_time)))++;
+	nr_rekeys_due++;
+	ev->ev_rekey = TRUE;
+}
+
+void rekey_event_released(struct pluto_event *ev)
+{
+	if (ev->ev_rekey) {
+		unsigned *due = rekey_slot(monosecs(ev->ev_time));
+		passert(*due > 0 && nr_rekeys_due > 0);
+		(*due)--;
+		nr_rekeys_due--;
+		ev->ev_rekey = FALSE;
+	}
+}
+
+deltatime_t rekey_spread(struct state *st, deltatime_t delay)
+{
+	if (rekey_rate == 0) {
+		return delay;
+	}
+
+	intmax_t due = monosecs(monotimesum(mononow(), delay));
+	intmax_t slack = deltasecs(st->st_connection->sa_rekey_margin);
+	if (slack > deltasecs(delay)) {
+		slack = deltasecs(delay);
+	}
+
+	for (intmax_t early = 0; early <= slack; early++) {
+		if (*rekey_slot(due - early) < rekey_rate) {
+			if (early > 0) {
+				DBG(DBG_LIFECYCLE,
+				    DBG_log("#%lu replace moved %jds earlier; %u rekeys already due",
+					    st->st_serialno, early,
+					    *rekey_slot(due)));
+				delay = deltatime_ms(deltamillisecs(delay) -
+						     early * 1000);
+				st->st_margin = deltatime_add(st->st_margin,
+							      deltatime(early));
+				pstats_rekeys_spread++;
+			}
+			return delay;
+		}
+	}
+	/* every second is busy; leave it to rekey_deferred() */
+	return delay;
+}
+
+bool rekey_deferred(struct state *st, enum event_type type)
+{
+	if (rekey_rate == 0) {
+		return FALSE;
+	}
+	if (st->st_rekey_deferred) {
+		/* this is the slot it was given */
+		st->st_rekey_deferred = FALSE;
+		return FALSE;
+	}
+
+	monotime_t now = mononow();
+	uint64_t now_us = (uint64_t)now.mt.tv_sec * 1000000 + now.mt.tv_usec;
+	uint64_t interval = 1000000 / rekey_rate;
+	uint64_t burst = 1000000 - interval;
+	uint64_t tat = rekey_tat > now_us ? rekey_tat : now_us;
+	if (tat - now_us <= burst) {
+		rekey_tat = tat + interval;
+		return FALSE;
+	}
+
+	deltatime_t wait = deltatime_ms((tat - now_us - burst + 999) / 1000);
+	if (!deltaless(wait, deltatime_divu(st->st_margin, 2))) {
+		/*
+		 * Waiting would risk the SA expiring; go anyway, but
+		 * without taking a slot from the SAs that can wait.
+		 */
+		DBG(DBG_LIFECYCLE,
+		    DBG_log("#%lu rekeying over rekey-rate=%u; can't wait %jdms",
+			    st->st_serialno, rekey_rate,
+			    deltamillisecs(wait)));
+		pstats_rekeys_overrate++;
+		return FALSE;
+	}
+
+	rekey_tat = tat + interval;
+	DBG(DBG_LIFECYCLE,
+	    DBG_log("#%lu rekey deferred %jdms by rekey-rate=%u",
+		    st->st_serialno, deltamillisecs(wait), rekey_rate));
+	st->st_margin = deltatime_ms(deltamillisecs(st->st_margin) -
+				     deltamillisecs(wait));
+	event_schedule(type, wait, st);
+	/* after event_schedule() which clears it */
+	st->st_rekey_deferred = TRUE;
+	pstats_rekeys_deferred++;
+	return TRUE;
+}
+
+void free_rekey(void)
+{
+	pexpect(nr_rekeys_due == 0);
+	pfreeany(rekeys_due);
+}
+
+void show_rekey_status(void)
+{
+	static const struct {
+		const char *name;
+		intmax_t upto;	/* seconds from now */
+	} buckets[] = {
+		{ "1m", 60, },
+		{ "10m", 10 * 60, },
+		{ "1h", 60 * 60, },
+		{ "4h", 4 * 60 * 60, },
+		{ "12h", 12 * 60 * 60, },
+		{ "24h", 24 * 60 * 60, },
+		{ "later", REKEY_SECONDS - 60, },
+	};
+
+	whack_log_comment("current.rekeys.rate=%u", rekey_rate);
+	whack_log_comment("current.rekeys.scheduled=%u", nr_rekeys_due);
+	if (rekeys_due == NULL) {
+		return;
+	}
+
+	/*
+	 * Each second of the ring once; anything overdue (in the
+	 * minute before now) is counted with the first bucket.
+	 */
+	intmax_t now = monosecs(mononow());
+	unsigned busiest = 0;
+	intmax_t busiest_in = 0;
+	intmax_t second = -60;
+	for (unsigned b = 0; b < elemsof(buckets); b++) {
+		unsigned count = 0;
+		for (; second < buckets[b].upto; second++) {
+			unsigned due = *rekey_slot(now + second);
+			count += due;
+			if (due > busiest) {
+				busiest = due;
+				busiest_in = second;
+			}
+		}
+		whack_log_comment("current.rekeys.due.%s=%u",
+				  buckets[b].name, count);
+	}
+	whack_log_comment("current.rekeys.busiest.count=%u", busiest);
+	whack_log_comment("current.rekeys.busiest.in=%jds", busiest_in);
+}
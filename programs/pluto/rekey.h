@@ -0,0 +1,54 @@
+/* rekey rate limiting and spreading, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef _REKEY_H
+#define _REKEY_H
+
+#include "deltatime.h"
+
+struct state;
+struct pluto_event;
+
+/*
+ * When non-zero, the most SA replacements (rekeys) to initiate each
+ * second; when zero (the default) there is no limit and replace
+ * times are left alone.
+ */
+extern unsigned rekey_rate;
+
+bool is_rekey_event(enum event_type type);
+
+/* bookkeeping for the replace events, called by the timer code */
+void rekey_event_scheduled(struct pluto_event *ev);
+void rekey_event_released(struct pluto_event *ev);
+
+/*
+ * Given DELAY, the time until ST should be replaced, return a delay
+ * that is, if needed, moved earlier (by at most the connection's
+ * rekeymargin) to a second where fewer than rekey_rate replacements
+ * are already due.  ST's margin is stretched to match.
+ */
+deltatime_t rekey_spread(struct state *st, deltatime_t delay);
+
+/*
+ * The replace event TYPE for ST has fired and ST is about to be
+ * replaced (it isn't stale or idle): if initiating the rekey now
+ * would exceed rekey_rate, re-schedule the event for a later slot
+ * and return TRUE.
+ */
+bool rekey_deferred(struct state *st, enum event_type type);
+
+void show_rekey_status(void);
+void free_rekey(void);
+
+#endif
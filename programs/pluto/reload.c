@@ -0,0 +1,207 @@
+/* reloading connections from ipsec.conf, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * addconn --reload sends every connection in ipsec.conf; rather than
+ * tearing everything down, only what changed is touched.
+ *
+ * Whether a connection changed is decided by comparing a digest of
+ * the packed whack message it was added with against that of the
+ * message just sent: the message is everything addconn derived from
+ * ipsec.conf (the rsasigkeys, sent separately, are included as a
+ * hash in keyval; auto=, otherwise only used by addconn, as
+ * config_auto), and packing doesn't leave any pointers behind.
+ * Changing only auto= thus replaces the connection, which is then
+ * routed or initiated to match.
+ *
+ * Each reload has a generation number; connections sent by it are
+ * marked as seen, and those (re)added as loaded.  At the end, the
+ * ipsec.conf connections not seen are deleted.  auto=ignore
+ * connections are only named, so those added by hand are seen but
+ * never replaced.
+ */
+
+#include <string.h>
+
+#include "libreswan.h"
+#include "lswalloc.h"
+#include "lswlog.h"
+#include "constants.h"
+#include "defs.h"
+#include "connections.h"
+#include "hostpair.h"		/* for connections */
+#include "whack.h"
+#include "log.h"
+#include "ike_alg_sha2.h"
+#include "crypt_hash.h"
+#include "reload.h"
+
+static unsigned long reload_generation;
+static bool reloading;	/* between start and end */
+
+static unsigned long nr_added;
+static unsigned long nr_replaced;
+static unsigned long nr_unchanged;
+static unsigned long nr_failed;
+
+void config_digest(struct whack_message *wm, size_t n)
+{
+	const unsigned char *raw = (const unsigned char *)wm;
+	size_t skip = offsetof(struct whack_message, whack_config);
+	size_t resume = offsetof(struct whack_message, config_digest) +
+		sizeof(wm->config_digest);
+
+	if (n < resume) {
+		/* truncated; unpacking will reject it */
+		return;
+	}
+
+	struct crypt_hash *ctx = crypt_hash_init(&ike_alg_hash_sha2_256,
+						 "config digest", DBG_CRYPT);
+	crypt_hash_digest_bytes(ctx, "head", raw, skip);
+	crypt_hash_digest_bytes(ctx, "tail", raw + resume, n - resume);
+	crypt_hash_final_bytes(&ctx, wm->config_digest,
+			       sizeof(wm->config_digest));
+}
+
+void reload_start(void)
+{
+	reload_generation++;
+	reloading = TRUE;
+	nr_added = nr_replaced = nr_unchanged = nr_failed = 0;
+	DBG(DBG_CONTROL,
+	    DBG_log("reload %lu of ipsec.conf connections started",
+		    reload_generation));
+}
+
+void reload_connection(const struct whack_message *wm)
+{
+	struct connection *c = conn_by_name(wm->name, TRUE, TRUE);
+
+	passert(sizeof(c->config_digest) == sizeof(wm->config_digest));
+	if (c != NULL && c->from_config &&
+	    memeq(c->config_digest, wm->config_digest,
+		  sizeof(c->config_digest))) {
+		DBG(DBG_CONTROL,
+		    DBG_log("\"%s\" unchanged; leaving it alone", c->name));
+		c->config_seen = reload_generation;
+		nr_unchanged++;
+		return;
+	}
+
+	bool replacing = c != NULL;
+	if (replacing) {
+		libreswan_log("\"%s\" changed; replacing it", wm->name);
+		delete_connections_by_name(wm->name, TRUE);
+	}
+	add_connection(wm);
+
+	c = conn_by_name(wm->name, TRUE, TRUE);
+	if (c == NULL) {
+		nr_failed++;
+		return;
+	}
+	c->config_seen = c->config_loaded = reload_generation;
+	if (replacing) {
+		nr_replaced++;
+	} else {
+		nr_added++;
+	}
+}
+
+void reload_keep(const struct whack_message *wm)
+{
+	size_t len = strlen(wm->name);
+
+	/* also the NxM connections of a subnets= connection */
+	for (struct connection *c = connections; c != NULL; c = c->ac_next) {
+		if (c->from_config && startswith(c->name, wm->name) &&
+		    (c->name[len] == '\0' || c->name[len] == '/')) {
+			DBG(DBG_CONTROL,
+			    DBG_log("\"%s\" is auto=ignore; leaving it alone",
+				    c->name));
+			c->config_seen = reload_generation;
+		}
+	}
+}
+
+static bool stale(const struct connection *c)
+{
+	return c->from_config &&
+		c->config_seen != reload_generation &&
+		c->kind != CK_INSTANCE && c->kind != CK_GOING_AWAY &&
+		(c->policy & POLICY_GROUPINSTANCE) == LEMPTY;
+}
+
+void reload_end(void)
+{
+	if (!reloading) {
+		/* otherwise every ipsec.conf connection would be deleted */
+		loglog(RC_LOG_SERIOUS, "ignoring end of a reload that wasn't started");
+		return;
+	}
+	reloading = FALSE;
+
+	/*
+	 * Deleting one connection can delete others (instances,
+	 * group members) so collect the names first.
+	 */
+	unsigned nr_stale = 0;
+	for (struct connection *c = connections; c != NULL; c = c->ac_next) {
+		if (stale(c)) {
+			nr_stale++;
+		}
+	}
+
+	unsigned long nr_deleted = 0;
+	if (nr_stale > 0) {
+		char **names = alloc_things(char *, nr_stale, "stale names");
+		unsigned n = 0;
+		for (struct connection *c = connections; c != NULL;
+		     c = c->ac_next) {
+			if (stale(c)) {
+				names[n++] = clone_str(c->name, "stale name");
+			}
+		}
+		for (n = 0; n < nr_stale; n++) {
+			struct connection *c = conn_by_name(names[n], TRUE, TRUE);
+			if (c != NULL && stale(c)) {
+				libreswan_log("\"%s\" no longer in ipsec.conf; deleting it",
+					      c->name);
+				delete_connections_by_name(names[n], TRUE);
+				nr_deleted++;
+			}
+			pfree(names[n]);
+		}
+		pfree(names);
+	}
+
+	libreswan_log("reloaded ipsec.conf connections: %lu added, %lu replaced, %lu unchanged, %lu deleted, %lu failed",
+		      nr_added, nr_replaced, nr_unchanged, nr_deleted,
+		      nr_failed);
+}
+
+bool reload_skip(const struct whack_message *wm)
+{
+	if (wm->whack_config != WHACK_CONFIG_RELOAD) {
+		return FALSE;
+	}
+	struct connection *c = conn_by_name(wm->name, TRUE, TRUE);
+	if (c == NULL || c->config_loaded == reload_generation) {
+		return FALSE;
+	}
+	DBG(DBG_CONTROL,
+	    DBG_log("\"%s\" unchanged by reload; ignoring %s", c->name,
+		    wm->whack_route ? "route" : "initiate"));
+	return TRUE;
+}
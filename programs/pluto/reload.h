@@ -0,0 +1,37 @@
+/* reloading connections from ipsec.conf, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef _RELOAD_H
+#define _RELOAD_H
+
+struct whack_message;
+
+/*
+ * Set WM's config_digest from the N bytes of the still packed
+ * message (everything but whack_config and config_digest).
+ */
+void config_digest(struct whack_message *wm, size_t n);
+
+/* the WHACK_CONFIG_RELOAD* messages, see whack.h */
+void reload_start(void);
+void reload_connection(const struct whack_message *wm);
+void reload_keep(const struct whack_message *wm);
+void reload_end(void);
+
+/*
+ * Should WM, a route or initiate, be ignored because it is part of a
+ * reload that left the connection alone?
+ */
+bool reload_skip(const struct whack_message *wm);
+
+#endif
@@ -37,6 +37,7 @@
 #include "server.h"
 #include "demux.h"
 #include "pluto_stats.h"
+#include "metrics.h"
 
 /* send_ike_msg logic is broken into layers.
  * The rest of the system thinks it is simple.
@@ -167,6 +168,7 @@ bool send_chunks(const char *where, bool just_a_keepalive,
 	}
 
 	pstats_ike_out_bytes += len;
+	metrics_packet_sent();
 
 	/* Send a duplicate packet when this impair is enabled - used for testing */
 	if (DBGP(IMPAIR_JACOB_TWO_TWO)) {
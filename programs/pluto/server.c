@@ -467,43 +467,51 @@ static struct pluto_event *free_event_entry(struct pluto_event **evp)
 	struct pluto_event *next = e->next;
 
 	/* unlink this pluto_event from the list */
+	if (e->prevp != NULL) {
+		*e->prevp = e->next;
+		if (e->next != NULL)
+			e->next->prevp = e->prevp;
+		e->prevp = NULL;
+	}
+	e->next = NULL;
+
 	if (e->ev != NULL) {
 		event_free(e->ev);
 		e->ev  = NULL;
 	}
+	cancel_timer_event(e);
 
 	DBG(DBG_LIFECYCLE,
 			const char *en = enum_name(&timer_event_names, e->ev_type);
 			DBG_log("%s: release %s-pe@%p", __func__, en, e));
 
-	pfree(e);
+	if (e->ev_embedded) {
+		zero(e);
+	} else {
+		pfree(e);
+	}
 	*evp = NULL;
 	return next;
 }
 
 static void unlink_pluto_event_list(struct pluto_event **evp) {
-	struct pluto_event **pp;
-	struct pluto_event *p;
-	struct pluto_event *e = *evp;
-
-	for (pp = &pluto_events_head; (p = *pp) != NULL; pp = &p->next) {
-		if (p == e) {
-			*pp = free_event_entry(evp); /* unlink this entry from the list */
-			return;
-		}
-	}
+	if ((*evp)->prevp != NULL)
+		free_event_entry(evp);
 }
 
 void free_pluto_event_list(void)
 {
-	struct pluto_event **head = &pluto_events_head;
-	while (*head != NULL)
-		*head = free_event_entry(head);
-
+	while (pluto_events_head != NULL) {
+		struct pluto_event *e = pluto_events_head;
+		free_event_entry(&e);
+	}
 }
 
 void link_pluto_event_list(struct pluto_event *e) {
 	e->next = pluto_events_head;
+	if (e->next != NULL)
+		e->next->prevp = &e->next;
+	e->prevp = &pluto_events_head;
 	pluto_events_head = e;
 }
 
@@ -624,19 +632,6 @@ void pluto_event_now(const char *name, so_serial_t serialno,
 				  &no_delay);
 }
 
-/*
- * XXX: custom version of event new used only by timer.c.  If you're
- * looking for how to set up a timer, then don't look here and don't
- * look at timer.c.  Why?
- */
-void timer_private_pluto_event_new(struct event **evp,
-				   evutil_socket_t fd, short events,
-				   event_callback_fn cb, void *arg,
-				   deltatime_t delay)
-{
-	fire_event_photon_torpedo(evp, fd, events, cb, arg, &delay);
-}
-
 struct pluto_event *pluto_event_add(evutil_socket_t fd, short events,
 				    event_callback_fn cb, void *arg,
 				    const deltatime_t *delay,
@@ -945,6 +940,52 @@ static void log_status(struct lswlog *buf, int status)
 	lswlogs(buf, ")");
 }
 
+/*
+ * Find CHILD's pid_entry, pass STATUS to its callback, and then
+ * forget it.
+ */
+static void reap_pid_entry(pid_t child, int status)
+{
+	struct pid_entry *pid_entry = NULL;
+	struct list_head *head = hash_table_slot_by_hash(&pids_hash_table, child);
+	FOR_EACH_LIST_ENTRY_OLD2NEW(head, pid_entry) {
+		passert(pid_entry->magic == PID_MAGIC);
+		if (pid_entry->pid == child) {
+			break;
+		}
+	}
+	if (pid_entry == NULL) {
+		LSWLOG(buf) {
+			lswlogf(buf, "waitpid return unknown child pid %d",
+				child);
+			log_status(buf, status);
+		}
+	} else {
+		struct state *st = state_with_serialno(pid_entry->serialno);
+		if (pid_entry->serialno == SOS_NOBODY) {
+			pid_entry->callback(NULL, NULL,
+					    status, pid_entry->context);
+		} else if (st == NULL) {
+			LSWDBGP(DBG_CONTROLMORE, buf) {
+				log_pid_entry(buf, pid_entry);
+				lswlogs(buf, " disappeared");
+			}
+			pid_entry->callback(NULL, NULL,
+					    status, pid_entry->context);
+		} else {
+			so_serial_t old_state = push_cur_state(st);
+			struct msg_digest *md = unsuspend_md(st);
+			pid_entry->callback(st, &md, status,
+					    pid_entry->context);
+			release_any_md(&md);
+			pop_cur_state(old_state);
+		}
+		del_hash_table_entry(&pids_hash_table,
+				     &pid_entry->hash_entry);
+		pfree(pid_entry);
+	}
+}
+
 static void childhandler_cb(int unused UNUSED, const short event UNUSED, void *arg UNUSED)
 {
 	while (true) {
@@ -970,49 +1011,35 @@ static void childhandler_cb(int unused UNUSED, const short event UNUSED, void *a
 					child);
 				log_status(buf, status);
 			}
-			struct pid_entry *pid_entry = NULL;
-			struct list_head *head = hash_table_slot_by_hash(&pids_hash_table, child);
-			FOR_EACH_LIST_ENTRY_OLD2NEW(head, pid_entry) {
-				passert(pid_entry->magic == PID_MAGIC);
-				if (pid_entry->pid == child) {
-					break;
-				}
-			}
-			if (pid_entry == NULL) {
-				LSWLOG(buf) {
-					lswlogf(buf, "waitpid return unknown child pid %d",
-						child);
-					log_status(buf, status);
-				}
-			} else {
-				struct state *st = state_with_serialno(pid_entry->serialno);
-				if (pid_entry->serialno == SOS_NOBODY) {
-					pid_entry->callback(NULL, NULL,
-							    status, pid_entry->context);
-				} else if (st == NULL) {
-					LSWDBGP(DBG_CONTROLMORE, buf) {
-						log_pid_entry(buf, pid_entry);
-						lswlogs(buf, " disappeared");
-					}
-					pid_entry->callback(NULL, NULL,
-							    status, pid_entry->context);
-				} else {
-					so_serial_t old_state = push_cur_state(st);
-					struct msg_digest *md = unsuspend_md(st);
-					pid_entry->callback(st, &md, status,
-							    pid_entry->context);
-					release_any_md(&md);
-					pop_cur_state(old_state);
-				}
-				del_hash_table_entry(&pids_hash_table,
-						     &pid_entry->hash_entry);
-				pfree(pid_entry);
-			}
+			reap_pid_entry(child, status);
 			break;
 		}
 	}
 }
 
+/*
+ * Wait for the pluto_fork()ed child PID to exit and then reap it
+ * through the pid table, as if SIGCHLD had been handled.  Used when
+ * shutting down, after the event loop has stopped.
+ */
+void pluto_fork_wait(pid_t pid)
+{
+	int status;
+	pid_t child;
+	do {
+		child = waitpid(pid, &status, 0);
+	} while (child < 0 && errno == EINTR);
+	if (child < 0) {
+		LOG_ERRNO(errno, "waitpid for child pid %d failed", pid);
+		return;
+	}
+	LSWDBGP(DBG_CONTROLMORE, buf) {
+		lswlogf(buf, "waitpid returned pid %d", child);
+		log_status(buf, status);
+	}
+	reap_pid_entry(child, status);
+}
+
 void init_event_base(void) {
 	libreswan_log("Initializing libevent in pthreads mode: headers: %s (%" PRIx32 "); library: %s (%" PRIx32 ")",
 		      LIBEVENT_VERSION, (ev_uint32_t)LIBEVENT_VERSION_NUMBER,
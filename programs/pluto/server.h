@@ -92,12 +92,6 @@ extern void show_fips_status(void);
 extern void call_server(void);
 extern void init_event_base(void);
 typedef void event_callback_routine(evutil_socket_t, const short, void *);
-extern void timer_private_pluto_event_new(struct event **evp,
-					  evutil_socket_t ft,
-					  short events,
-					  event_callback_fn cb,
-					  void *arg,
-					  deltatime_t delay);
 extern struct pluto_event *pluto_event_add(evutil_socket_t fd, short events,
 					   event_callback_fn cb, void *arg,
 					   const deltatime_t *delay,
@@ -163,6 +157,7 @@ typedef void pluto_fork_cb(struct state *st, struct msg_digest **mdp,
 extern int pluto_fork(const char *name, so_serial_t serialno,
 		      int op(void *context),
 		      pluto_fork_cb *callback, void *context);
+extern void pluto_fork_wait(pid_t pid);
 
 bool check_incoming_msg_errqueue(const struct iface_port *ifp, const char *before);
 void check_outgoing_msg_errqueue(const struct iface_port *ifp, const char *before);
@@ -35,6 +35,21 @@
 #include "log.h"
 #include "server.h"
 #include "state.h"
+#include "state_db.h"
+#include "connection_db.h"
+#include "host_pair_db.h"
+#include "spd_db.h"
+#include "addresspool.h"
+#include "dns_cache.h"		/* for show_dns_cache_status() */
+#include "updown.h"
+#include "xauth.h"		/* for show_xauth_pam_status() */
+#include "timer.h"		/* for show_timer_wheel_status() */
+#include "rekey.h"		/* for show_rekey_status() */
+#include "pluto_crypt.h"
+#include "pluto_x509.h"	/* for show_x509_status() */
+#include "crypt_dh.h"	/* for show_dh_pool_status() */
+#include "packet.h"
+#include "demux.h"	/* for show_md_pool_status() */
 #include "pluto_stats.h"
 #include "connections.h"
 #include "kernel.h"
@@ -72,6 +87,22 @@ static void show_system_security(void)
 void show_global_status(void)
 {
 	show_globalstate_status();
+	show_state_db_status();
+	show_connection_db_status();
+	show_host_pair_db_status();
+	show_spd_db_status();
+	show_addresspool_status();
+	show_dns_cache_status();
+	show_updown_status();
+#ifdef XAUTH_HAVE_PAM
+	show_xauth_pam_status();
+#endif
+	show_timer_wheel_status();
+	show_rekey_status();
+	show_crypto_helper_status();
+	show_dh_pool_status();
+	show_md_pool_status();
+	show_x509_status();
 	show_pluto_stats();
 }
 
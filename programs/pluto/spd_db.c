@@ -0,0 +1,419 @@
+/* Connection spd routes indexed by peer client, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libreswan.h>
+
+#include "defs.h"
+
+#include "lswlog.h"
+#include "lswalloc.h"
+#include "log.h"
+#include "connections.h"
+#include "spd_db.h"
+
+/*
+ * Each address family has a path-compressed binary trie (a Patricia
+ * tree) keyed on the network part of .that.client.  A node holds the
+ * spd routes with exactly that network; its subtree holds the routes
+ * with longer (more specific) networks.  A node with no routes is
+ * only kept while it has two children.
+ *
+ * Looking up a subnet, or the subnets containing an address, is
+ * bounded by the address length, and not the number of connections.
+ *
+ * Addresses without a known family all end up in the root of the
+ * last trie; samesubnet() can still match them.
+ */
+
+#define SPD_KEY_BYTES 16	/* IPv6 */
+
+struct spd_key {
+	unsigned trie;
+	unsigned bits;
+	u_int8_t bytes[SPD_KEY_BYTES];
+};
+
+struct spd_node {
+	struct spd_key key;
+	struct spd_node *child[2];
+	struct list_head routes;
+};
+
+struct spd_db_entry {
+	struct list_entry entry;	/* in NODE->routes */
+	struct spd_node *node;
+	struct spd_route_ref ref;
+};
+
+enum { SPD_TRIE_IPV4, SPD_TRIE_IPV6, SPD_TRIE_OTHER, SPD_TRIE_ROOF, };
+
+static struct spd_node *spd_tries[SPD_TRIE_ROOF];
+
+static unsigned long spd_db_serial;
+static unsigned long spd_db_nr_nodes;
+static unsigned long spd_db_nr_routes;
+
+static size_t log_spd_route(struct lswlog *buf, void *data)
+{
+	struct spd_db_entry *e = data;
+	return lswlogf(buf, "connection \"%s\" spd route %u",
+		       e->ref.c->name, e->ref.position);
+}
+
+static const struct list_info spd_routes_info = {
+	.debug = DBG_CONTROLMORE,
+	.name = "spd routes",
+	.log = log_spd_route,
+};
+
+/* the network part of ADDR/MASKBITS */
+static void spd_key(struct spd_key *key, const ip_address *addr, int maskbits)
+{
+	zero(key);
+	switch (addrtypeof(addr)) {
+	case AF_INET:
+		key->trie = SPD_TRIE_IPV4;
+		break;
+	case AF_INET6:
+		key->trie = SPD_TRIE_IPV6;
+		break;
+	default:
+		key->trie = SPD_TRIE_OTHER;
+		return;
+	}
+	const unsigned char *bytes;
+	size_t len = addrbytesptr_read(addr, &bytes);
+	passert(len <= sizeof(key->bytes));
+	/* an out-of-range mask never matches, so anywhere will do */
+	if (maskbits < 0)
+		maskbits = 0;
+	if (maskbits > (int)len * 8)
+		maskbits = len * 8;
+	key->bits = maskbits;
+	memcpy(key->bytes, bytes, (maskbits + 7) / 8);
+	if (maskbits % 8 != 0)
+		key->bytes[maskbits / 8] &= ~(0xff >> (maskbits % 8));
+}
+
+static unsigned key_bit(const struct spd_key *key, unsigned bit)
+{
+	return (key->bytes[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+/* the number of leading bits that A and B have in common */
+static unsigned common_bits(const struct spd_key *a, const struct spd_key *b)
+{
+	unsigned max = a->bits < b->bits ? a->bits : b->bits;
+	unsigned bit = 0;
+	while (bit < max && a->bytes[bit / 8] == b->bytes[bit / 8])
+		bit += 8;
+	while (bit < max && key_bit(a, bit) == key_bit(b, bit))
+		bit++;
+	return bit < max ? bit : max;
+}
+
+static struct spd_node *alloc_spd_node(const struct spd_key *key,
+				       unsigned bits)
+{
+	struct spd_node *n = alloc_thing(struct spd_node, "spd node");
+	n->key = *key;
+	n->key.bits = bits;
+	if (bits % 8 != 0)
+		n->key.bytes[bits / 8] &= ~(0xff >> (bits % 8));
+	memset(n->key.bytes + (bits + 7) / 8, 0,
+	       sizeof(n->key.bytes) - (bits + 7) / 8);
+	init_list(&spd_routes_info, &n->routes);
+	spd_db_nr_nodes++;
+	return n;
+}
+
+static bool spd_node_empty(const struct spd_node *n)
+{
+	return n->routes.head.newer == &n->routes.head;
+}
+
+/* find, or create, the node for KEY */
+static struct spd_node *spd_node(const struct spd_key *key)
+{
+	struct spd_node **np = &spd_tries[key->trie];
+	while (*np != NULL) {
+		struct spd_node *n = *np;
+		unsigned common = common_bits(&n->key, key);
+		if (common == n->key.bits) {
+			if (n->key.bits == key->bits)
+				return n;
+			/* N is above KEY */
+			np = &n->child[key_bit(key, n->key.bits)];
+			continue;
+		}
+		/* N and KEY part at COMMON; insert KEY above N */
+		struct spd_node *k = alloc_spd_node(key, key->bits);
+		if (common == key->bits) {
+			k->child[key_bit(&n->key, common)] = n;
+			*np = k;
+		} else {
+			struct spd_node *glue = alloc_spd_node(key, common);
+			glue->child[key_bit(key, common)] = k;
+			glue->child[key_bit(&n->key, common)] = n;
+			*np = glue;
+		}
+		return k;
+	}
+	*np = alloc_spd_node(key, key->bits);
+	return *np;
+}
+
+/* N has no routes; remove it if no longer needed */
+static void prune_spd_node(struct spd_node *n)
+{
+	struct spd_node **parentp = NULL;
+	struct spd_node **np = &spd_tries[n->key.trie];
+	while (*np != n) {
+		passert(*np != NULL);
+		parentp = np;
+		np = &(*np)->child[key_bit(&n->key, (*np)->key.bits)];
+	}
+	if (n->child[0] != NULL && n->child[1] != NULL)
+		return;
+	*np = n->child[0] != NULL ? n->child[0] : n->child[1];
+	pfree(n);
+	spd_db_nr_nodes--;
+	/* the parent may now be a node with one child and no routes */
+	if (parentp != NULL) {
+		struct spd_node *parent = *parentp;
+		if (spd_node_empty(parent) &&
+		    (parent->child[0] == NULL || parent->child[1] == NULL)) {
+			*parentp = parent->child[0] != NULL ?
+				parent->child[0] : parent->child[1];
+			pfree(parent);
+			spd_db_nr_nodes--;
+		}
+	}
+}
+
+static bool in_spd_db(const struct connection *c)
+{
+	/* a cloned connection still points at its parent's entries */
+	return c->spd_db_entries != NULL &&
+		c->spd_db_entries[0].ref.c == c;
+}
+
+static void add_entries(struct connection *c)
+{
+	unsigned nr = 0;
+	for (struct spd_route *sr = &c->spd; sr != NULL; sr = sr->spd_next)
+		nr++;
+	c->spd_db_entries = alloc_things(struct spd_db_entry, nr,
+					 "spd db entries");
+	c->nr_spd_db_entries = nr;
+	unsigned position = 0;
+	for (struct spd_route *sr = &c->spd; sr != NULL; sr = sr->spd_next) {
+		struct spd_db_entry *e = &c->spd_db_entries[position];
+		e->ref.c = c;
+		e->ref.sr = sr;
+		e->ref.position = position++;
+		struct spd_key key;
+		spd_key(&key, &sr->that.client.addr, sr->that.client.maskbits);
+		e->node = spd_node(&key);
+		e->entry = list_entry(&spd_routes_info, e);
+		insert_list_entry(&e->node->routes, &e->entry);
+	}
+	spd_db_nr_routes += nr;
+}
+
+static void del_entries(struct connection *c)
+{
+	for (unsigned i = 0; i < c->nr_spd_db_entries; i++) {
+		struct spd_db_entry *e = &c->spd_db_entries[i];
+		remove_list_entry(&e->entry);
+		if (spd_node_empty(e->node))
+			prune_spd_node(e->node);
+	}
+	spd_db_nr_routes -= c->nr_spd_db_entries;
+	pfree(c->spd_db_entries);
+	c->spd_db_entries = NULL;
+	c->nr_spd_db_entries = 0;
+}
+
+void add_spd_routes_to_db(struct connection *c)
+{
+	c->spd_db_serial = ++spd_db_serial;
+	add_entries(c);
+}
+
+void del_spd_routes_from_db(struct connection *c)
+{
+	if (in_spd_db(c))
+		del_entries(c);
+}
+
+void rehash_spd_routes_in_db(struct connection *c)
+{
+	if (in_spd_db(c)) {
+		del_entries(c);
+		add_entries(c);
+	}
+}
+
+static void add_refs(struct spd_route_refs *refs, struct spd_node *n)
+{
+	struct spd_db_entry *e;
+	FOR_EACH_LIST_ENTRY_NEW2OLD(&n->routes, e) {
+		if (refs->nr >= refs->size) {
+			unsigned size = refs->size == 0 ? 8 : refs->size * 2;
+			struct spd_route_ref *r =
+				alloc_things(struct spd_route_ref, size,
+					     "spd route refs");
+			if (refs->refs != NULL) {
+				memcpy(r, refs->refs, refs->nr * sizeof(*r));
+				pfree(refs->refs);
+			}
+			refs->refs = r;
+			refs->size = size;
+		}
+		refs->refs[refs->nr++] = e->ref;
+	}
+}
+
+static void add_subtree_refs(struct spd_route_refs *refs, struct spd_node *n)
+{
+	if (n != NULL) {
+		add_refs(refs, n);
+		add_subtree_refs(refs, n->child[0]);
+		add_subtree_refs(refs, n->child[1]);
+	}
+}
+
+/*
+ * Add the routes for KEY's network and every network containing it;
+ * and when SUBTREE, also every network within it.
+ */
+static void add_overlapping_refs(struct spd_route_refs *refs,
+				 const struct spd_key *key, bool subtree)
+{
+	struct spd_node *n = spd_tries[key->trie];
+	while (n != NULL) {
+		unsigned common = common_bits(&n->key, key);
+		if (common == key->bits) {
+			/* N is KEY or below it */
+			if (subtree)
+				add_subtree_refs(refs, n);
+			else if (n->key.bits == key->bits)
+				add_refs(refs, n);
+			return;
+		}
+		if (common < n->key.bits)
+			return;
+		/* N is above KEY */
+		add_refs(refs, n);
+		n = n->child[key_bit(key, n->key.bits)];
+	}
+}
+
+void spd_routes_with_that_client(struct spd_route_refs *refs,
+				 const ip_subnet *client)
+{
+	struct spd_key key;
+	spd_key(&key, &client->addr, client->maskbits);
+	struct spd_node *n = spd_tries[key.trie];
+	while (n != NULL && common_bits(&n->key, &key) == n->key.bits) {
+		if (n->key.bits == key.bits) {
+			add_refs(refs, n);
+			return;
+		}
+		n = n->child[key_bit(&key, n->key.bits)];
+	}
+}
+
+void spd_routes_with_that_client_containing(struct spd_route_refs *refs,
+					    const ip_address *addr)
+{
+	struct spd_key key;
+	spd_key(&key, addr, addrlenof(addr) * 8);
+	add_overlapping_refs(refs, &key, FALSE);
+}
+
+void spd_routes_with_that_client_overlapping(struct spd_route_refs *refs,
+					     const ip_subnet *net)
+{
+	struct spd_key key;
+	spd_key(&key, &net->addr, net->maskbits);
+	add_overlapping_refs(refs, &key, TRUE);
+}
+
+/* newest connection first; then along the spd chain */
+static int spd_route_ref_cmp(const void *l, const void *r)
+{
+	const struct spd_route_ref *lr = l;
+	const struct spd_route_ref *rr = r;
+	if (lr->c != rr->c)
+		return lr->c->spd_db_serial > rr->c->spd_db_serial ? -1 : 1;
+	if (lr->position != rr->position)
+		return lr->position < rr->position ? -1 : 1;
+	return 0;
+}
+
+void sort_spd_route_refs(struct spd_route_refs *refs)
+{
+	if (refs->nr <= 1)
+		return;
+	qsort(refs->refs, refs->nr, sizeof(refs->refs[0]), spd_route_ref_cmp);
+	unsigned nr = 1;
+	for (unsigned i = 1; i < refs->nr; i++) {
+		if (spd_route_ref_cmp(&refs->refs[nr - 1], &refs->refs[i]) != 0)
+			refs->refs[nr++] = refs->refs[i];
+	}
+	refs->nr = nr;
+}
+
+void free_spd_route_refs(struct spd_route_refs *refs)
+{
+	pfreeany(refs->refs);
+	refs->refs = NULL;
+	refs->nr = refs->size = 0;
+}
+
+void init_spd_db(void)
+{
+	for (unsigned t = 0; t < SPD_TRIE_ROOF; t++)
+		spd_tries[t] = NULL;
+}
+
+static void free_spd_nodes(struct spd_node *n)
+{
+	if (n != NULL) {
+		free_spd_nodes(n->child[0]);
+		free_spd_nodes(n->child[1]);
+		pfree(n);
+	}
+}
+
+void free_spd_db(void)
+{
+	/* any connections still in the table are about to go */
+	for (unsigned t = 0; t < SPD_TRIE_ROOF; t++) {
+		free_spd_nodes(spd_tries[t]);
+		spd_tries[t] = NULL;
+	}
+	spd_db_nr_nodes = 0;
+	spd_db_nr_routes = 0;
+}
+
+void show_spd_db_status(void)
+{
+	whack_log_comment("current.spd.db.routes=%lu", spd_db_nr_routes);
+	whack_log_comment("current.spd.db.nodes=%lu", spd_db_nr_nodes);
+}
@@ -0,0 +1,74 @@
+/* Connection spd routes indexed by peer client, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef _spd_db_h_
+#define _spd_db_h_
+
+#include <libreswan.h>		/* for ip_subnet et.al. */
+
+struct connection;
+struct spd_route;
+
+void init_spd_db(void);
+void free_spd_db(void);
+void show_spd_db_status(void);
+
+/*
+ * Add C's spd routes, indexed by .that.client, to the table.  C must
+ * also have just been added to the front of the connections list: the
+ * table remembers that order.
+ */
+void add_spd_routes_to_db(struct connection *c);
+void del_spd_routes_from_db(struct connection *c);
+/*
+ * After changing a .that.client, or the spd chain, of a connection
+ * that is in the table.  Does nothing when C isn't in the table.
+ */
+void rehash_spd_routes_in_db(struct connection *c);
+
+/*
+ * The spd routes that might match; the caller must still apply the
+ * real test (only the .that.client's network is indexed).
+ *
+ * Lookups add to the set; before it is used it must be sorted (which
+ * also removes duplicates) into the order that walking the
+ * connections list, and then each connection's spd chain, would have
+ * found them in.
+ */
+
+struct spd_route_ref {
+	struct connection *c;
+	struct spd_route *sr;
+	unsigned position;	/* in C's spd chain */
+};
+
+struct spd_route_refs {
+	unsigned nr;
+	unsigned size;
+	struct spd_route_ref *refs;
+};
+
+/* .that.client is (or might be) CLIENT */
+void spd_routes_with_that_client(struct spd_route_refs *refs,
+				 const ip_subnet *client);
+/* .that.client contains ADDR */
+void spd_routes_with_that_client_containing(struct spd_route_refs *refs,
+					    const ip_address *addr);
+/* .that.client contains, or is contained in, NET */
+void spd_routes_with_that_client_overlapping(struct spd_route_refs *refs,
+					     const ip_subnet *net);
+
+void sort_spd_route_refs(struct spd_route_refs *refs);
+void free_spd_route_refs(struct spd_route_refs *refs);
+
+#endif
@@ -82,6 +82,7 @@
 #include <keyhi.h>
 
 #include "pluto_stats.h"
+#include "nat_traversal.h"	/* for nat_traversal_new_ka_event() */
 #include "ikev2_ipseckey.h"
 #include "ip_address.h"
 
@@ -1039,6 +1040,7 @@ void delete_state(struct state *st)
 	delete_state_event(st, &st->st_rel_whack_event);
 	delete_state_event(st, &st->st_send_xauth_event);
 	delete_state_event(st, &st->st_addr_change_event);
+	delete_state_event(st, &st->st_nat_keepalive_event);
 
 	/* if there is a suspended state transition, disconnect us */
 	struct msg_digest *md = unsuspend_md(st);
@@ -1200,10 +1202,21 @@ void delete_state(struct state *st)
 	pfreeany(st->st_seen_cfg_banner);
 
 	freeanychunk(st->st_no_ppk_auth);
+	freeanychunk(st->st_v2_rsa_sig);
+	free_x509_verified(&st->st_x509_verified);
 
 #ifdef HAVE_LABELED_IPSEC
 	pfreeany(st->sec_ctx);
 #endif
+
+	/* the events use the state's storage */
+	for (unsigned i = 0; i < elemsof(st->st_timers); i++) {
+		struct pluto_event *ev = &st->st_timers[i];
+		pexpect(ev->prevp == NULL);
+		if (ev->prevp != NULL)
+			delete_pluto_event(&ev);
+	}
+
 	messup(st);
 	pfree(st);
 }
@@ -1477,6 +1490,9 @@ static struct state *duplicate_state(struct state *st, sa_t sa_type)
 
 	nst->quirks = st->quirks;
 	nst->hidden_variables = st->hidden_variables;
+	/* the child needs keep-alives when the parent does */
+	if (st->st_nat_keepalive_event != NULL)
+		nat_traversal_new_ka_event(nst);
 	nst->st_remoteaddr = st->st_remoteaddr;
 	nst->st_remoteport = st->st_remoteport;
 	nst->st_localaddr = st->st_localaddr;
@@ -1804,12 +1820,23 @@ struct state *ikev1_find_info_state(const u_char *icookie,
 
 /*
  * Find the state that sent a packet with this prefix
- * ??? this could be expensive -- it should be rate-limited to avoid DoS
+ *
+ * The prefix starts with the IKE header and every state's
+ * transmitted packet has that state's ICOOKIE, so only the states in
+ * the ICOOKIE's hash slot need to be compared.  The rest of the
+ * header (RCOOKIE, message ID, ...) is checked by the memeq().
+ *
+ * The ICOOKIE, rather than both cookies, is used since a state that
+ * has just learnt its RCOOKIE may still be holding a packet that was
+ * sent without it.
  */
 struct state *find_likely_sender(size_t packet_len, u_char *packet)
 {
 	if (packet_len >= sizeof(struct isakmp_hdr)) {
-		FOR_EACH_COOKIED_STATE(st, {
+		/* on the wire, the IKE header starts with the ICOOKIE */
+		const u_char *icookie = packet;
+		struct state *st = NULL;
+		FOR_EACH_STATE_WITH_ICOOKIE(st, icookie, {
 			if (st->st_tpacket.ptr != NULL &&
 			    st->st_tpacket.len >= packet_len &&
 			    memeq(st->st_tpacket.ptr, packet, packet_len))
@@ -2856,6 +2883,16 @@ bool drop_new_exchanges(void)
 	return cat_count[CAT_HALF_OPEN_IKE] >= pluto_max_halfopen;
 }
 
+struct state_counts count_states(void)
+{
+	return (struct state_counts) {
+		.halfopen_ike = cat_count[CAT_HALF_OPEN_IKE],
+		.open_ike = cat_count[CAT_OPEN_IKE],
+		.established_ike = total_established_ike(),
+		.ipsec = total_ipsec(),
+	};
+}
+
 void show_globalstate_status(void)
 {
 	unsigned shunts = show_shunt_count();
@@ -45,6 +45,7 @@
 #include "labeled_ipsec.h"	/* for struct xfrm_user_sec_ctx_ike and friends */
 #include "list_entry.h"
 #include "retransmit.h"
+#include "timer.h"
 
 /* msgid_t defined in defs.h */
 
@@ -156,6 +157,8 @@ struct ipsec_proto_info {
 	monotime_t our_lastused;
 	monotime_t peer_lastused;
 	uint64_t add_time;
+	monotime_t our_info_time;	/* when *_bytes were read from the kernel */
+	monotime_t peer_info_time;
 };
 
 struct initiate_list {
@@ -501,6 +504,7 @@ struct state {
 					 * 0 means the only time.
 					 */
 	deltatime_t st_margin;		/* life after EVENT_SA_REPLACE*/
+	bool st_rekey_deferred;		/* EVENT_SA_REPLACE* is in its rekey-rate slot */
 	unsigned long st_outbound_count;	/* traffic through eroute */
 	monotime_t st_outbound_time;	/* time of last change to
 					 * st_outbound_count
@@ -580,6 +584,8 @@ struct state {
 	bool st_seen_ppk;			/* does remote peer support PPK? */
 
 	chunk_t st_no_ppk_auth;
+	chunk_t st_v2_rsa_sig;			/* AUTH signature from a helper */
+	struct pcr_x509_verify *st_x509_verified; /* peer's cert chain, checked by a helper */
 	PK11SymKey *st_sk_d_no_ppk;
 	PK11SymKey *st_sk_pi_no_ppk;
 	PK11SymKey *st_sk_pr_no_ppk;
@@ -612,6 +618,8 @@ struct state {
 	struct pluto_event *st_rel_whack_event;
 	struct pluto_event *st_send_xauth_event;
 	struct pluto_event *st_addr_change_event;
+	struct pluto_event *st_nat_keepalive_event;
+	uint64_t st_nat_keepalive_bytes;	/* outbound IPsec bytes at the last NAT-T keep-alive */
 
 
 	/* RFC 3706 Dead Peer Detection */
@@ -622,6 +630,9 @@ struct state {
 	u_int32_t st_dpd_rdupcount;		/* openbsd isakmpd bug workaround */
 	struct pluto_event *st_dpd_event;	/* backpointer for DPD events */
 
+	/* storage for the above events */
+	struct pluto_event st_timers[STATE_TIMER_ROOF];
+
 	bool st_seen_nortel_vid;                /* To work around a nortel bug */
 	struct isakmp_quirks quirks;            /* work arounds for faults in other products */
 	bool st_xauth_soft;                     /* XAUTH failed but policy is to soft fail */
@@ -789,6 +800,16 @@ extern bool state_is_busy(const struct state *st);
 extern bool verbose_state_busy(const struct state *st);
 extern bool drop_new_exchanges(void);
 extern bool require_ddos_cookies(void);
+
+/* the states in each category, for the metrics */
+struct state_counts {
+	unsigned halfopen_ike;
+	unsigned open_ike;
+	unsigned established_ike;
+	unsigned ipsec;
+};
+
+extern struct state_counts count_states(void);
 extern void show_globalstate_status(void);
 extern void set_newest_ipsec_sa(const char *m, struct state *const st);
 extern void update_ike_endpoints(struct state *st, const struct msg_digest *md);
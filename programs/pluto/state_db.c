@@ -21,6 +21,10 @@
 #include "cookie.h"
 #include "hash_table.h"
 
+/*
+ * Initial (and minimum) number of slots in each table; the tables
+ * grow as states are added.
+ */
 #define STATE_TABLE_SIZE 499
 
 static size_t log_state(struct lswlog *buf, void *data)
@@ -100,15 +104,10 @@ struct state *state_by_serialno(so_serial_t serialno)
 static size_t icookie_hasher(const uint8_t *icookie)
 {
 	/*
-	 * 251 is a prime close to 256 (so like <<8).
-	 *
-	 * There's no real rationale for doing this.
+	 * The peer gets to choose the cookie (SPI) so use a keyed
+	 * hash.
 	 */
-	size_t hash = 0;
-	for (unsigned j = 0; j < COOKIE_SIZE; j++) {
-		hash = hash * 251 + icookie[j];
-	}
-	return hash;
+	return hash_table_bytes(icookie, COOKIE_SIZE);
 }
 
 static size_t icookie_hash(void *data)
@@ -161,17 +160,11 @@ struct list_head *icookie_slot(const u_char *icookie)
 static size_t cookies_hasher(const uint8_t *icookie,
 			     const uint8_t *rcookie)
 {
-	/*
-	 * 251 is a prime close to 256 aka <<8.  65521 is a prime
-	 * close to 65536 aka <<16.
-	 *
-	 * There's no real rationale for doing this.
-	 */
-	size_t hash = 0;
-	for (unsigned j = 0; j < COOKIE_SIZE; j++) {
-		hash = hash * 65521 + icookie[j] * 251 + rcookie[j];
-	}
-	return hash;
+	/* see icookie_hasher() */
+	uint8_t cookies[COOKIE_SIZE * 2];
+	memcpy(cookies, icookie, COOKIE_SIZE);
+	memcpy(cookies + COOKIE_SIZE, rcookie, COOKIE_SIZE);
+	return hash_table_bytes(cookies, sizeof(cookies));
 }
 
 static size_t cookies_hash(void *data)
@@ -296,3 +289,17 @@ void init_state_db(void)
 	init_hash_table(&cookies_hash_table);
 	init_hash_table(&icookie_hash_table);
 }
+
+void free_state_db(void)
+{
+	free_hash_table(&serialno_hash_table);
+	free_hash_table(&cookies_hash_table);
+	free_hash_table(&icookie_hash_table);
+}
+
+void show_state_db_status(void)
+{
+	show_hash_table_status(&serialno_hash_table, "serialno");
+	show_hash_table_status(&icookie_hash_table, "icookie");
+	show_hash_table_status(&cookies_hash_table, "cookies");
+}
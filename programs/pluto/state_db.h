@@ -20,6 +20,8 @@ struct state;
 struct list_entry;
 
 void init_state_db(void);
+void free_state_db(void);
+void show_state_db_status(void);
 
 void add_state_to_db(struct state *st);
 void rehash_state_cookies_in_db(struct state *st);
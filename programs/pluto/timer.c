@@ -65,6 +65,7 @@
 #include "ikev1_send.h"
 #include "ikev2_send.h"
 #include "pluto_sd.h"
+#include "rekey.h"
 
 /*
  * This file has the event handling routines. Events are
@@ -528,10 +529,8 @@ void delete_state_event(struct state *st, struct pluto_event **evp)
 	delete_pluto_event(evp);
 }
 
-static event_callback_routine timer_event_cb;
-static void timer_event_cb(evutil_socket_t fd UNUSED, const short event UNUSED, void *arg)
+static void dispatch_timer_event(struct pluto_event *ev)
 {
-	struct pluto_event *ev = arg;
 	DBG(DBG_LIFECYCLE,
 	    DBG_log("%s: processing event@%p", __func__, ev));
 
@@ -568,10 +567,14 @@ static void timer_event_cb(evutil_socket_t fd UNUSED, const short event UNUSED,
 	case EVENT_PENDING_DDNS:
 	case EVENT_PENDING_PHASE2:
 	case EVENT_SD_WATCHDOG:
-	case EVENT_NAT_T_KEEPALIVE:
 		passert(st == NULL);
 		break;
 
+	case EVENT_NAT_T_KEEPALIVE:
+		passert(st != NULL && st->st_nat_keepalive_event == ev);
+		st->st_nat_keepalive_event = NULL;
+		break;
+
 	case EVENT_v1_SEND_XAUTH:
 		passert(st != NULL && st->st_send_xauth_event == ev);
 		DBG(DBG_CONTROLMORE|DBG_XAUTH,
@@ -625,6 +628,12 @@ static void timer_event_cb(evutil_socket_t fd UNUSED, const short event UNUSED,
 		bad_case(type);
 	}
 
+	/*
+	 * Release the event before doing its work: the handler may
+	 * want the state's event slot back, or delete the state.
+	 */
+	delete_pluto_event(&ev);
+
 	/* now do the actual event's work */
 	switch (type) {
 	case EVENT_v2_ADDR_CHANGE:
@@ -663,7 +672,7 @@ static void timer_event_cb(evutil_socket_t fd UNUSED, const short event UNUSED,
 #endif
 
 	case EVENT_NAT_T_KEEPALIVE:
-		nat_traversal_ka_event();
+		nat_traversal_ka_event(st);
 		break;
 
 	case EVENT_v2_RELEASE_WHACK:
@@ -749,6 +758,9 @@ static void timer_event_cb(evutil_socket_t fd UNUSED, const short event UNUSED,
 					event_schedule_s(EVENT_SA_EXPIRE, 0, cst);
 					ikev2_expire_parent(cst, last_used_age);
 					break;
+				} else if (rekey_deferred(st, type)) {
+					/* see below */
+					break;
 				} else {
 					ikev2_log_v2_sa_expired(st, type);
 					ipsecdoi_replace(st, LEMPTY, LEMPTY, 1);
@@ -777,6 +789,13 @@ static void timer_event_cb(evutil_socket_t fd UNUSED, const short event UNUSED,
 					IS_IKE_SA(st) ? "ISAKMP" : "IPsec",
 					deltasecs(monotimediff(mononow(),
 							       st->st_outbound_time))));
+		} else if (rekey_deferred(st, type)) {
+			/*
+			 * Too many rekeys being initiated?  Come back
+			 * later (with less margin).  Only SAs that are
+			 * really going to be replaced get this far.
+			 */
+			break;
 		} else {
 			ikev2_log_v2_sa_expired(st, type);
 			ipsecdoi_replace(st, LEMPTY, LEMPTY, 1);
@@ -891,11 +910,94 @@ static void timer_event_cb(evutil_socket_t fd UNUSED, const short event UNUSED,
 		bad_case(type);
 	}
 
-	delete_pluto_event(&ev);
 	if (state_event)
 		reset_cur_state();
 }
 
+/*
+ * All timer events are kept on a timer wheel (1ms ticks), driven by a
+ * single libevent timer that is armed for the wheel's next deadline.
+ */
+
+static struct timer_wheel timer_wheel;
+static struct event *timer_wheel_event;
+static uint64_t timer_wheel_armed = UINT64_MAX;	/* tick, or none */
+
+static uint64_t monotick(monotime_t t, bool round_up)
+{
+	return (uint64_t)t.mt.tv_sec * 1000 +
+		(t.mt.tv_usec + (round_up ? 999 : 0)) / 1000;
+}
+
+static void arm_timer_wheel(void)
+{
+	uint64_t next;
+	if (!timer_wheel_next(&timer_wheel, &next) ||
+	    next >= timer_wheel_armed) {
+		/* nothing to do, or already going off earlier */
+		return;
+	}
+	uint64_t now = monotick(mononow(), FALSE);
+	uint64_t delay = next > now ? next - now : 0;
+	struct timeval tv = {
+		.tv_sec = delay / 1000,
+		.tv_usec = (delay % 1000) * 1000,
+	};
+	/* re-adding a pending event re-schedules it */
+	passert(event_add(timer_wheel_event, &tv) >= 0);
+	timer_wheel_armed = next;
+}
+
+static event_callback_routine timer_wheel_cb;
+static void timer_wheel_cb(evutil_socket_t fd UNUSED, const short event UNUSED,
+			   void *arg UNUSED)
+{
+	timer_wheel_armed = UINT64_MAX;
+	uint64_t now = monotick(mononow(), FALSE);
+
+	/*
+	 * Don't let events that keep re-scheduling themselves "now"
+	 * starve everything else; leave any extra for the next time
+	 * around the event loop.
+	 */
+	unsigned budget = timer_wheel.nr_entries;
+	struct timer_wheel_entry *e;
+	while (budget-- > 0 &&
+	       (e = timer_wheel_expire(&timer_wheel, now)) != NULL) {
+		dispatch_timer_event(e->data);
+	}
+	arm_timer_wheel();
+}
+
+void init_timer(void)
+{
+	init_timer_wheel(&timer_wheel, monotick(mononow(), FALSE));
+	timer_wheel_event = event_new(get_pluto_event_base(), NULL_FD,
+				      EV_TIMEOUT, timer_wheel_cb, NULL);
+	passert(timer_wheel_event != NULL);
+}
+
+void cancel_timer_event(struct pluto_event *ev)
+{
+	/* leave the libevent timer alone; going off early is harmless */
+	timer_wheel_del(&timer_wheel, &ev->ev_wheel);
+	rekey_event_released(ev);
+}
+
+void show_timer_wheel_status(void)
+{
+	whack_log_comment("current.timers.events=%u", timer_wheel.nr_entries);
+	whack_log_comment("current.timers.cascaded=%lu", timer_wheel.nr_cascaded);
+	for (unsigned level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		struct timer_wheel_level_occupancy o;
+		timer_wheel_occupancy(&timer_wheel, level, &o);
+		whack_log_comment("current.timers.level%u.slots=%u", level, o.slots);
+		whack_log_comment("current.timers.level%u.used=%u", level, o.used);
+		whack_log_comment("current.timers.level%u.events=%u", level, o.entries);
+		whack_log_comment("current.timers.level%u.span=%lums", level, o.span);
+	}
+}
+
 /*
  * Delete an event.
  */
@@ -936,16 +1038,6 @@ void event_schedule(enum event_type type, deltatime_t delay, struct state *st)
 	pexpect(deltasecs(delay) < secs_per_day * 31);
 
 	const char *en = enum_name(&timer_event_names, type);
-	struct pluto_event *ev = alloc_thing(struct pluto_event, en);
-	DBG(DBG_LIFECYCLE, DBG_log("%s: new %s-pe@%p", __func__, en, ev));
-
-	ev->ev_type = type;
-	ev->ev_name = en;
-	ev->ev_state = st;
-
-	/* ??? ev_time lacks required precision */
-	ev->ev_time = monotimesum(mononow(), delay);
-	link_pluto_event_list(ev); /* add to global ist to track */
 
 	/*
 	 * If the event is associated with a state, put a backpointer to the
@@ -953,25 +1045,34 @@ void event_schedule(enum event_type type, deltatime_t delay, struct state *st)
 	 * if we need to (for example, if we receive a reply).
 	 * (There are actually three classes of event associated
 	 * with a state.)
+	 *
+	 * The event itself uses the state's storage for that slot.
 	 */
+	struct pluto_event **evp = NULL;
+	enum state_timer slot = STATE_TIMER_EVENT;
 	if (st != NULL) {
 		switch (type) {
 
 
 		case EVENT_v2_ADDR_CHANGE:
-			passert(st->st_addr_change_event == NULL);
-			st->st_addr_change_event = ev;
+			evp = &st->st_addr_change_event;
+			slot = STATE_TIMER_ADDR_CHANGE;
 			break;
 
 		case EVENT_DPD:
 		case EVENT_DPD_TIMEOUT:
-			passert(st->st_dpd_event == NULL);
-			st->st_dpd_event = ev;
+			evp = &st->st_dpd_event;
+			slot = STATE_TIMER_DPD;
 			break;
 
 		case EVENT_v2_LIVENESS:
-			passert(st->st_liveness_event == NULL);
-			st->st_liveness_event = ev;
+			evp = &st->st_liveness_event;
+			slot = STATE_TIMER_LIVENESS;
+			break;
+
+		case EVENT_NAT_T_KEEPALIVE:
+			evp = &st->st_nat_keepalive_event;
+			slot = STATE_TIMER_NAT_KEEPALIVE;
 			break;
 
 		case EVENT_RETAIN:
@@ -979,22 +1080,45 @@ void event_schedule(enum event_type type, deltatime_t delay, struct state *st)
 			break;
 
 		case EVENT_v2_RELEASE_WHACK:
-			passert(st->st_rel_whack_event == NULL);
-			st->st_rel_whack_event = ev;
+			evp = &st->st_rel_whack_event;
+			slot = STATE_TIMER_REL_WHACK;
 			break;
 
 		case  EVENT_v1_SEND_XAUTH:
-			passert(st->st_send_xauth_event == NULL);
-			st->st_send_xauth_event = ev;
+			evp = &st->st_send_xauth_event;
+			slot = STATE_TIMER_SEND_XAUTH;
 			break;
 
 		default:
-			passert(st->st_event == NULL);
-			st->st_event = ev;
+			evp = &st->st_event;
+			slot = STATE_TIMER_EVENT;
 			break;
 		}
 	}
 
+	struct pluto_event *ev;
+	if (evp != NULL) {
+		passert(*evp == NULL);
+		ev = &st->st_timers[slot];
+		passert(ev->prevp == NULL);
+		ev->ev_embedded = TRUE;
+		*evp = ev;
+	} else {
+		ev = alloc_thing(struct pluto_event, en);
+	}
+	DBG(DBG_LIFECYCLE, DBG_log("%s: new %s-pe@%p", __func__, en, ev));
+
+	ev->ev_type = type;
+	ev->ev_name = en;
+	ev->ev_state = st;
+
+	/* ??? ev_time lacks required precision */
+	ev->ev_time = monotimesum(mononow(), delay);
+	link_pluto_event_list(ev); /* add to global ist to track */
+	if (st != NULL && is_rekey_event(type)) {
+		rekey_event_scheduled(ev);
+	}
+
 	if (DBGP(DBG_CONTROL) || DBGP(DBG_LIFECYCLE) ||
 	    (DBGP(DBG_RETRANSMITS) && (ev->ev_type == EVENT_v1_RETRANSMIT ||
 				       ev->ev_type == EVENT_v2_RETRANSMIT))) {
@@ -1012,9 +1136,9 @@ void event_schedule(enum event_type type, deltatime_t delay, struct state *st)
 			}
 	}
 
-	timer_private_pluto_event_new(&ev->ev,
-				      NULL_FD, EV_TIMEOUT,
-				      timer_event_cb, ev, delay);
+	timer_wheel_add(&timer_wheel, &ev->ev_wheel,
+			monotick(ev->ev_time, TRUE), ev);
+	arm_timer_wheel();
 }
 
 void event_schedule_s(enum event_type type, time_t delay_sec, struct state *st)
@@ -21,6 +21,7 @@
 
 #include "deltatime.h"
 #include "monotime.h"
+#include "timer_wheel.h"
 
 struct state;   /* forward declaration */
 
@@ -29,8 +30,27 @@ struct pluto_event {
 	const char *ev_name;		/* Name or enum_name(ev_type) */
 	struct state   *ev_state;       /* Pointer to relevant state (if any) */
 	struct event *ev;               /* libevent data structure */
+	struct timer_wheel_entry ev_wheel;	/* when time based */
+	bool ev_embedded;		/* part of a state; don't pfree() */
+	bool ev_rekey;			/* counted by rekey.c */
 	monotime_t ev_time;
 	struct pluto_event *next;
+	struct pluto_event **prevp;	/* NULL when not listed */
+};
+
+/*
+ * A state has storage for each of its timer events (st_event et.al.
+ * point into it); scheduling one doesn't allocate.
+ */
+enum state_timer {
+	STATE_TIMER_EVENT,
+	STATE_TIMER_LIVENESS,
+	STATE_TIMER_REL_WHACK,
+	STATE_TIMER_SEND_XAUTH,
+	STATE_TIMER_ADDR_CHANGE,
+	STATE_TIMER_DPD,
+	STATE_TIMER_NAT_KEEPALIVE,
+	STATE_TIMER_ROOF,
 };
 
 extern void event_schedule(enum event_type type, deltatime_t delay,
@@ -40,6 +60,8 @@ extern void event_schedule_s(enum event_type type, time_t delay_seconds,
 extern void delete_event(struct state *st);
 extern void handle_next_timer_event(void);
 extern void init_timer(void);
+extern void cancel_timer_event(struct pluto_event *ev);
+extern void show_timer_wheel_status(void);
 
 extern void delete_state_event(struct state *st, struct pluto_event **ev);
 #define delete_liveness_event(ST) delete_state_event((ST), &(ST)->st_liveness_event)
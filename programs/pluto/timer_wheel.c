@@ -0,0 +1,270 @@
+/* hierarchical timer wheel, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <stddef.h>
+
+#include "timer_wheel.h"
+
+#define LEVEL0_SLOTS (1 << TIMER_WHEEL_LEVEL0_BITS)
+#define LEVEL0_MASK (LEVEL0_SLOTS - 1)
+#define LEVEL_SLOTS (1 << TIMER_WHEEL_LEVEL_BITS)
+#define LEVEL_MASK (LEVEL_SLOTS - 1)
+
+static unsigned level_shift(unsigned level)
+{
+	return level == 0 ? 0 :
+		TIMER_WHEEL_LEVEL0_BITS + (level - 1) * TIMER_WHEEL_LEVEL_BITS;
+}
+
+/* log2 of the ticks a level covers, relative to .tick */
+static unsigned level_range(unsigned level)
+{
+	return level_shift(level) +
+		(level == 0 ? TIMER_WHEEL_LEVEL0_BITS : TIMER_WHEEL_LEVEL_BITS);
+}
+
+static unsigned level_offset(unsigned level)
+{
+	return level == 0 ? 0 : LEVEL0_SLOTS + (level - 1) * LEVEL_SLOTS;
+}
+
+static unsigned slot_level(unsigned slot)
+{
+	return slot < LEVEL0_SLOTS ? 0 : 1 + (slot - LEVEL0_SLOTS) / LEVEL_SLOTS;
+}
+
+static void set_occupied(struct timer_wheel *w, unsigned slot)
+{
+	w->occupied[slot / 64] |= (uint64_t)1 << (slot % 64);
+}
+
+static void clear_occupied(struct timer_wheel *w, unsigned slot)
+{
+	w->occupied[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+}
+
+/* the first non-empty slot in [FROM, TO), or TO */
+static unsigned next_occupied(const struct timer_wheel *w,
+			      unsigned from, unsigned to)
+{
+	while (from < to) {
+		uint64_t bits = w->occupied[from / 64] >> (from % 64);
+		if (bits != 0) {
+			unsigned slot = from + __builtin_ctzll(bits);
+			return slot < to ? slot : to;
+		}
+		from = (from / 64 + 1) * 64;
+	}
+	return to;
+}
+
+static void file_entry(struct timer_wheel *w, struct timer_wheel_entry *e)
+{
+	uint64_t expires = e->expires > w->tick ? e->expires : w->tick;
+	uint64_t delta = expires - w->tick;
+
+	unsigned level = 0;
+	while (level < TIMER_WHEEL_LEVELS - 1 &&
+	       (delta >> level_range(level)) != 0) {
+		level++;
+	}
+	/* beyond the top level; park it in the furthest slot */
+	unsigned top = level_range(TIMER_WHEEL_LEVELS - 1);
+	if ((delta >> top) != 0) {
+		expires = w->tick + ((uint64_t)1 << top) - 1;
+	}
+
+	unsigned mask = level == 0 ? LEVEL0_MASK : LEVEL_MASK;
+	unsigned slot = level_offset(level) +
+		((expires >> level_shift(level)) & mask);
+	struct timer_wheel_slot *s = &w->slots[slot];
+
+	e->slot = slot;
+	e->next = NULL;
+	e->prevp = s->tail;
+	*s->tail = e;
+	s->tail = &e->next;
+	set_occupied(w, slot);
+	w->level_entries[level]++;
+	w->nr_entries++;
+}
+
+static void unlink_entry(struct timer_wheel *w, struct timer_wheel_entry *e)
+{
+	struct timer_wheel_slot *s = &w->slots[e->slot];
+	*e->prevp = e->next;
+	if (e->next != NULL) {
+		e->next->prevp = e->prevp;
+	} else {
+		s->tail = e->prevp;
+	}
+	if (s->head == NULL) {
+		clear_occupied(w, e->slot);
+	}
+	e->next = NULL;
+	e->prevp = NULL;
+	w->level_entries[slot_level(e->slot)]--;
+	w->nr_entries--;
+}
+
+void init_timer_wheel(struct timer_wheel *w, uint64_t now)
+{
+	*w = (struct timer_wheel) {
+		.tick = now,
+	};
+	for (unsigned i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+		w->slots[i].tail = &w->slots[i].head;
+	}
+}
+
+void timer_wheel_add(struct timer_wheel *w, struct timer_wheel_entry *e,
+		     uint64_t expires, void *data)
+{
+	e->expires = expires;
+	e->data = data;
+	file_entry(w, e);
+}
+
+void timer_wheel_del(struct timer_wheel *w, struct timer_wheel_entry *e)
+{
+	if (e->prevp != NULL) {
+		unlink_entry(w, e);
+	}
+}
+
+bool timer_wheel_queued(const struct timer_wheel_entry *e)
+{
+	return e->prevp != NULL;
+}
+
+/*
+ * .tick has just entered a new level 0 block: re-file the entries in
+ * the corresponding level 1 slot; and when that is the first level 1
+ * slot, the corresponding level 2 slot; and so on.
+ */
+static void cascade(struct timer_wheel *w)
+{
+	for (unsigned level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+		unsigned index = (w->tick >> level_shift(level)) & LEVEL_MASK;
+		unsigned slot = level_offset(level) + index;
+		struct timer_wheel_slot *s = &w->slots[slot];
+		struct timer_wheel_entry *e = s->head;
+		s->head = NULL;
+		s->tail = &s->head;
+		clear_occupied(w, slot);
+		while (e != NULL) {
+			struct timer_wheel_entry *next = e->next;
+			w->level_entries[level]--;
+			w->nr_entries--;
+			w->nr_cascaded++;
+			file_entry(w, e);
+			e = next;
+		}
+		if (index != 0) {
+			break;
+		}
+	}
+}
+
+bool timer_wheel_next(const struct timer_wheel *w, uint64_t *tick)
+{
+	if (w->nr_entries == 0) {
+		return false;
+	}
+
+	uint64_t next = UINT64_MAX;
+
+	/* level 0: the rest of this block, then the start of the next */
+	if (w->level_entries[0] > 0) {
+		unsigned index = w->tick & LEVEL0_MASK;
+		uint64_t block = w->tick - index;
+		unsigned slot = next_occupied(w, index, LEVEL0_SLOTS);
+		if (slot < LEVEL0_SLOTS) {
+			next = block + slot;
+		} else {
+			slot = next_occupied(w, 0, index);
+			if (slot < index) {
+				next = block + LEVEL0_SLOTS + slot;
+			}
+		}
+	}
+
+	/*
+	 * Higher levels: when the next non-empty slot, after the
+	 * current one, is cascaded.
+	 */
+	for (unsigned level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+		if (w->level_entries[level] == 0) {
+			continue;
+		}
+		unsigned shift = level_shift(level);
+		uint64_t bits = w->occupied[level_offset(level) / 64];
+		unsigned from = ((w->tick >> shift) + 1) & LEVEL_MASK;
+		if (from != 0) {
+			bits = (bits >> from) | (bits << (64 - from));
+		}
+		uint64_t distance = __builtin_ctzll(bits) + 1;
+		uint64_t cascade = ((w->tick >> shift) + distance) << shift;
+		if (cascade < next) {
+			next = cascade;
+		}
+	}
+
+	*tick = next;
+	return true;
+}
+
+struct timer_wheel_entry *timer_wheel_expire(struct timer_wheel *w, uint64_t now)
+{
+	for (;;) {
+		unsigned index = w->tick & LEVEL0_MASK;
+		struct timer_wheel_entry *e = w->slots[index].head;
+		if (e != NULL) {
+			unlink_entry(w, e);
+			return e;
+		}
+		if (w->tick >= now) {
+			return NULL;
+		}
+		/*
+		 * Skip straight to the next tick with something to do;
+		 * block boundaries in between only have empty slots to
+		 * cascade.
+		 */
+		uint64_t next;
+		if (!timer_wheel_next(w, &next) || next > now) {
+			next = now;
+		}
+		w->tick = next;
+		if ((w->tick & LEVEL0_MASK) == 0) {
+			cascade(w);
+		}
+	}
+}
+
+void timer_wheel_occupancy(const struct timer_wheel *w, unsigned level,
+			   struct timer_wheel_level_occupancy *occupancy)
+{
+	unsigned offset = level_offset(level);
+	unsigned slots = level == 0 ? LEVEL0_SLOTS : LEVEL_SLOTS;
+	unsigned used = 0;
+	for (unsigned i = offset / 64; i < (offset + slots) / 64; i++) {
+		used += __builtin_popcountll(w->occupied[i]);
+	}
+	*occupancy = (struct timer_wheel_level_occupancy) {
+		.slots = slots,
+		.used = used,
+		.entries = w->level_entries[level],
+		.span = 1UL << level_shift(level),
+	};
+}
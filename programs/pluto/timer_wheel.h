@@ -0,0 +1,95 @@
+/* hierarchical timer wheel, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef _TIMER_WHEEL_H
+#define _TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * A hierarchical timer wheel, counting in "ticks" (pluto uses
+ * milliseconds).
+ *
+ * Level 0 has a slot for each of the next 256 ticks; each of the
+ * higher levels has 64 slots, each covering 64 times the span of a
+ * lower level slot.  As time advances, the entries in a higher level
+ * slot are cascaded down into the lower levels.  Entries too far in
+ * the future (more than 2^32 ticks, about 49 days in milliseconds)
+ * are parked in the top level and re-filed as it turns.
+ *
+ * Adding and removing an entry is O(1).  The caller embeds a struct
+ * timer_wheel_entry in its own object and provides the memory.
+ */
+
+#define TIMER_WHEEL_LEVELS 5
+#define TIMER_WHEEL_LEVEL0_BITS 8
+#define TIMER_WHEEL_LEVEL_BITS 6
+#define TIMER_WHEEL_SLOTS ((1 << TIMER_WHEEL_LEVEL0_BITS) + \
+			   (TIMER_WHEEL_LEVELS - 1) * (1 << TIMER_WHEEL_LEVEL_BITS))
+
+struct timer_wheel_entry {
+	struct timer_wheel_entry *next;
+	struct timer_wheel_entry **prevp;	/* NULL when not on the wheel */
+	uint64_t expires;			/* tick */
+	unsigned slot;				/* index into .slots[] */
+	void *data;
+};
+
+struct timer_wheel_slot {
+	struct timer_wheel_entry *head;
+	struct timer_wheel_entry **tail;
+};
+
+struct timer_wheel {
+	uint64_t tick;				/* next tick to expire */
+	unsigned nr_entries;
+	unsigned long nr_cascaded;
+	struct timer_wheel_slot slots[TIMER_WHEEL_SLOTS];
+	/* which slots are non-empty */
+	uint64_t occupied[TIMER_WHEEL_SLOTS / 64];
+	unsigned level_entries[TIMER_WHEEL_LEVELS];
+};
+
+void init_timer_wheel(struct timer_wheel *w, uint64_t now);
+
+/* EXPIRES in the past expires on the next call to timer_wheel_expire() */
+void timer_wheel_add(struct timer_wheel *w, struct timer_wheel_entry *e,
+		     uint64_t expires, void *data);
+void timer_wheel_del(struct timer_wheel *w, struct timer_wheel_entry *e);
+bool timer_wheel_queued(const struct timer_wheel_entry *e);
+
+/*
+ * Advance the wheel to NOW, returning (and removing) the next entry
+ * that has expired, or NULL when there is none.
+ */
+struct timer_wheel_entry *timer_wheel_expire(struct timer_wheel *w, uint64_t now);
+
+/*
+ * The next tick at which the wheel needs attention: either an entry
+ * expires, or a higher level slot needs to be cascaded.  FALSE when
+ * the wheel is empty.
+ */
+bool timer_wheel_next(const struct timer_wheel *w, uint64_t *tick);
+
+struct timer_wheel_level_occupancy {
+	unsigned slots;
+	unsigned used;		/* non-empty slots */
+	unsigned entries;
+	unsigned long span;	/* ticks covered by one slot */
+};
+
+void timer_wheel_occupancy(const struct timer_wheel *w, unsigned level,
+			   struct timer_wheel_level_occupancy *occupancy);
+
+#endif
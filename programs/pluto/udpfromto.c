@@ -75,32 +75,21 @@ int udpfromto_init(int s)
 	return err;
 }
 
-int recvfromto(int s, void *buf, size_t len, int flags,
-	struct sockaddr *from, socklen_t *fromlen,
-	struct sockaddr *to, socklen_t *tolen)
-{
 #if defined(HAVE_IP_PKTINFO) || defined(HAVE_IP_RECVDSTADDR)
-	struct msghdr msgh;
+/*
+ * Fill in TO with the address that MSGH, received on S using
+ * recvmsg() (or recvmmsg()) with a control buffer, was sent to.
+ */
+void udpfromto_dest(int s, struct msghdr *msgh,
+		    struct sockaddr *to, socklen_t *tolen)
+{
 	struct cmsghdr *cmsg;
-	struct iovec iov;
-	char cbuf[256];
-	int err;
-
-	/*
-	 * If from or to are set, they must be big enough
-	 * to store a struct sockaddr_in.
-	 */
-	if ((from && (!fromlen || *fromlen < sizeof(struct sockaddr_in))) ||
-		(to && (!tolen || *tolen < sizeof(struct sockaddr_in)))) {
-		errno = EINVAL;
-		return -1;
-	}
 
 	/*
 	 * IP_PKTINFO / IP_RECVDSTADDR don't provide sin_port so we have to
 	 * retrieve it using getsockname().
 	 */
-	if (to != NULL) {
+	{
 		struct sockaddr_in si;
 		socklen_t l = sizeof(si);
 
@@ -120,41 +109,19 @@ int recvfromto(int s, void *buf, size_t len, int flags,
 			*tolen = sizeof(struct sockaddr_in);
 	}
 
-	/* Set up iov and msgh structures. */
-	zero(&msgh);
-	iov.iov_base = buf;
-	iov.iov_len = len;
-	msgh.msg_control = cbuf;
-	msgh.msg_controllen = sizeof(cbuf);
-	msgh.msg_name = from;
-	msgh.msg_namelen = fromlen ? *fromlen : 0;
-	msgh.msg_iov = &iov;
-	msgh.msg_iovlen = 1;
-	msgh.msg_flags = 0;
-
-	/* Receive one packet. */
-	if ((err = recvmsg(s, &msgh, flags)) < 0)
-		return err;
-
-	if (fromlen != NULL)
-		*fromlen = msgh.msg_namelen;
-
 	/* Process auxiliary received data in msgh */
-	for (cmsg = CMSG_FIRSTHDR(&msgh);
+	for (cmsg = CMSG_FIRSTHDR(msgh);
 		cmsg != NULL;
-		cmsg = CMSG_NXTHDR(&msgh, cmsg)) {
+		cmsg = CMSG_NXTHDR(msgh, cmsg)) {
 
 #ifdef HAVE_IP_PKTINFO
 		if (cmsg->cmsg_level == SOL_IP &&
 			cmsg->cmsg_type == IP_PKTINFO) {
 			struct in_pktinfo *i =
 				(struct in_pktinfo *)CMSG_DATA(cmsg);
-			if (to != NULL) {
-				((struct sockaddr_in *)to)->sin_addr =
-					i->ipi_addr;
-				if (tolen != NULL)
-					*tolen = sizeof(struct sockaddr_in);
-			}
+			((struct sockaddr_in *)to)->sin_addr = i->ipi_addr;
+			if (tolen != NULL)
+				*tolen = sizeof(struct sockaddr_in);
 			break;
 		}
 #endif	/* HAVE_IP_PKTINFO */
@@ -163,15 +130,57 @@ int recvfromto(int s, void *buf, size_t len, int flags,
 		if (cmsg->cmsg_level == IPPROTO_IP &&
 			cmsg->cmsg_type == IP_RECVDSTADDR) {
 			struct in_addr *i = (struct in_addr *)CMSG_DATA(cmsg);
-			if (to) {
-				((struct sockaddr_in *)to)->sin_addr = *i;
-				if (tolen)
-					*tolen = sizeof(struct sockaddr_in);
-			}
+			((struct sockaddr_in *)to)->sin_addr = *i;
+			if (tolen)
+				*tolen = sizeof(struct sockaddr_in);
 			break;
 		}
 #endif	/* HAVE_IP_RECVDSTADDR */
 	}
+}
+#endif	/* defined(HAVE_IP_PKTINFO) || defined(HAVE_IP_RECVDSTADDR) */
+
+int recvfromto(int s, void *buf, size_t len, int flags,
+	struct sockaddr *from, socklen_t *fromlen,
+	struct sockaddr *to, socklen_t *tolen)
+{
+#if defined(HAVE_IP_PKTINFO) || defined(HAVE_IP_RECVDSTADDR)
+	struct msghdr msgh;
+	struct iovec iov;
+	char cbuf[UDPFROMTO_CMSG_SIZE];
+	int err;
+
+	/*
+	 * If from or to are set, they must be big enough
+	 * to store a struct sockaddr_in.
+	 */
+	if ((from && (!fromlen || *fromlen < sizeof(struct sockaddr_in))) ||
+		(to && (!tolen || *tolen < sizeof(struct sockaddr_in)))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Set up iov and msgh structures. */
+	zero(&msgh);
+	iov.iov_base = buf;
+	iov.iov_len = len;
+	msgh.msg_control = cbuf;
+	msgh.msg_controllen = sizeof(cbuf);
+	msgh.msg_name = from;
+	msgh.msg_namelen = fromlen ? *fromlen : 0;
+	msgh.msg_iov = &iov;
+	msgh.msg_iovlen = 1;
+	msgh.msg_flags = 0;
+
+	/* Receive one packet. */
+	if ((err = recvmsg(s, &msgh, flags)) < 0)
+		return err;
+
+	if (fromlen != NULL)
+		*fromlen = msgh.msg_namelen;
+
+	if (to != NULL)
+		udpfromto_dest(s, &msgh, to, tolen);
 	return err;
 
 #else
@@ -12,4 +12,9 @@ int recvfromto(int s, void *buf, size_t len, int flags,
 	       struct sockaddr *from, socklen_t *fromlen,
 	       struct sockaddr *to, socklen_t *tolen);
 
+/* for callers doing their own recvmsg() or recvmmsg() */
+#define UDPFROMTO_CMSG_SIZE 256
+void udpfromto_dest(int s, struct msghdr *msgh,
+		    struct sockaddr *to, socklen_t *tolen);
+
 #endif
@@ -0,0 +1,848 @@
+/* updown script execution, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * By default pluto runs each updown command using popen() and waits
+ * for it to finish.  A slow script stalls everything else.
+ *
+ * With updown-workers=N, commands are instead queued and run as
+ * pluto_fork() children, at most N at once, with their output
+ * collected by an event and their exit status logged when the child
+ * is reaped.  Commands for the same connection are still run one at
+ * a time and in order (prepare before route before up ...).  Since
+ * the kernel code acts on whether they succeed, prepare and route
+ * commands are always run synchronously, once the connection's
+ * earlier commands have finished.
+ *
+ * With updown-coprocess=PROGRAM, PROGRAM is started once and each
+ * command is written to its stdin as a single line of NAME='value'
+ * assignments (the environment the script would have been given,
+ * including PLUTO_VERB, plus PLUTO_UPDOWN, the script, its shell
+ * metacharacters escaped like the other values).  For each
+ * line, in order, PROGRAM writes zero or more lines of output
+ * (logged) followed by "status <N>" where N is the script's exit
+ * status.  Should PROGRAM die, commands are forked instead.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+#include <event2/event.h>
+
+#include "libreswan.h"
+#include "lswalloc.h"
+#include "lswlog.h"
+#include "constants.h"
+#include "defs.h"
+#include "connections.h"
+#include "server.h"
+#include "kernel.h"		/* for invoke_command() */
+#include "log.h"		/* for whack_log_comment() */
+#include "hash_table.h"
+#include "updown.h"
+
+unsigned updown_workers = 0;
+char *updown_coprocess = NULL;
+
+/* lines longer than this are folded */
+#define UPDOWN_LINE 256
+
+struct updown_line {
+	char buf[UPDOWN_LINE];
+	size_t len;
+};
+
+struct updown_job {
+	struct updown_job *next;	/* queued, or sent to the coprocess */
+	struct updown_key *key;
+	char *verb;			/* with suffix */
+	char *cmd;			/* for sh -c */
+	char *request;			/* for the coprocess */
+	pid_t pid;
+	int out_fd;
+	struct pluto_event *out_ev;
+	struct updown_line line;
+};
+
+/*
+ * Commands for a connection (well, its name and instance) are run
+ * one at a time.  Keys with a queued command and nothing running are
+ * on the ready list.
+ */
+struct updown_key {
+	struct list_entry hash_entry;
+	struct list_entry all_entry;
+	char *name;
+	unsigned long instance_serial;
+	char *who;			/* for logging */
+	struct updown_job *queued;
+	struct updown_job **queued_tail;
+	struct updown_job *running;
+	struct updown_key *next_ready;
+};
+
+static struct updown_key *ready_head = NULL;
+static struct updown_key **ready_tail = &ready_head;
+
+static unsigned nr_queued;
+static unsigned nr_running;
+static unsigned long total_commands;
+static unsigned long total_failed;
+static unsigned long total_coprocess;
+
+static bool stopping = FALSE;
+
+static struct {
+	pid_t pid;
+	int to_fd;
+	int from_fd;
+	struct pluto_event *from_ev;
+	struct updown_job *sent;	/* oldest first */
+	struct updown_job **sent_tail;
+	struct updown_line line;
+	bool failed;
+} coprocess = {
+	.to_fd = -1,
+	.from_fd = -1,
+	.sent_tail = &coprocess.sent,
+};
+
+/* the coprocess must keep up; see write_request() */
+#define MAX_COPROCESS_REQUESTS 16
+
+static size_t log_updown_key(struct lswlog *buf, void *data)
+{
+	struct updown_key *key = data;
+	return lswlogs(buf, key->who);
+}
+
+static size_t updown_key_hasher(const char *name, unsigned long instance_serial)
+{
+	return hash_table_bytes(name, strlen(name)) + instance_serial;
+}
+
+static size_t updown_key_hash(void *data)
+{
+	struct updown_key *key = data;
+	return updown_key_hasher(key->name, key->instance_serial);
+}
+
+static struct list_head updown_key_slots[37];
+static struct hash_table updown_key_table = {
+	.info = {
+		.debug = DBG_CONTROLMORE,
+		.name = "updown key table",
+		.log = log_updown_key,
+	},
+	.hash = updown_key_hash,
+	.nr_slots = elemsof(updown_key_slots),
+	.slots = updown_key_slots,
+};
+
+static const struct list_info updown_key_info = {
+	.debug = DBG_CONTROLMORE,
+	.name = "updown keys",
+	.log = log_updown_key,
+};
+
+static struct list_head all_updown_keys;
+
+static struct updown_key *find_updown_key(const struct connection *c)
+{
+	struct updown_key *key;
+	struct list_head *slot =
+		hash_table_slot_by_hash(&updown_key_table,
+					updown_key_hasher(c->name,
+							  c->instance_serial));
+	FOR_EACH_LIST_ENTRY_NEW2OLD(slot, key) {
+		if (key->instance_serial == c->instance_serial &&
+		    streq(key->name, c->name))
+			return key;
+	}
+	return NULL;
+}
+
+static struct updown_key *updown_key(const struct connection *c)
+{
+	struct updown_key *key = find_updown_key(c);
+	if (key != NULL)
+		return key;
+
+	char inst[CONN_INST_BUF];
+	char who[sizeof("\"\"") + 256 + CONN_INST_BUF];
+	snprintf(who, sizeof(who), "\"%s\"%s", c->name,
+		 fmt_conn_instance(c, inst));
+
+	key = alloc_thing(struct updown_key, "updown key");
+	key->name = clone_str(c->name, "updown key name");
+	key->instance_serial = c->instance_serial;
+	key->who = clone_str(who, "updown key who");
+	key->queued_tail = &key->queued;
+	key->hash_entry = list_entry(&updown_key_table.info, key);
+	add_hash_table_entry(&updown_key_table, key, &key->hash_entry);
+	key->all_entry = list_entry(&updown_key_info, key);
+	insert_list_entry(&all_updown_keys, &key->all_entry);
+	return key;
+}
+
+static void free_updown_key(struct updown_key *key)
+{
+	del_hash_table_entry(&updown_key_table, &key->hash_entry);
+	remove_list_entry(&key->all_entry);
+	pfree(key->name);
+	pfree(key->who);
+	pfree(key);
+}
+
+static void free_updown_job(struct updown_job *job)
+{
+	pfree(job->verb);
+	pfree(job->cmd);
+	pfree(job->request);
+	pfree(job);
+}
+
+/*
+ * Output, folded into lines.
+ */
+
+static void log_line(const struct updown_job *job, const char *line)
+{
+	if (job == NULL) {
+		libreswan_log("updown coprocess output: %s", line);
+	} else {
+		libreswan_log("%s %s output: %s", job->key->who, job->verb,
+			      line);
+	}
+}
+
+static void add_output(struct updown_line *line, const struct updown_job *job,
+		       const char *bytes, size_t len,
+		       void (*flush)(const struct updown_job *job,
+				     const char *line))
+{
+	for (size_t i = 0; i < len; i++) {
+		if (bytes[i] == '\n' || line->len >= sizeof(line->buf) - 1) {
+			line->buf[line->len] = '\0';
+			line->len = 0;
+			flush(job, line->buf);
+			if (bytes[i] == '\n')
+				continue;
+		}
+		line->buf[line->len++] = bytes[i];
+	}
+}
+
+static void flush_output(struct updown_line *line, const struct updown_job *job)
+{
+	if (line->len > 0) {
+		line->buf[line->len] = '\0';
+		line->len = 0;
+		log_line(job, line->buf);
+	}
+}
+
+/*
+ * Queue management.
+ */
+
+static void make_ready(struct updown_key *key)
+{
+	key->next_ready = NULL;
+	*ready_tail = key;
+	ready_tail = &key->next_ready;
+}
+
+static struct updown_job *dequeue_job(struct updown_key *key)
+{
+	struct updown_job *job = key->queued;
+	key->queued = job->next;
+	if (key->queued == NULL)
+		key->queued_tail = &key->queued;
+	job->next = NULL;
+	key->running = job;
+	nr_queued--;
+	nr_running++;
+	return job;
+}
+
+static struct updown_job *next_ready_job(void)
+{
+	struct updown_key *key = ready_head;
+	if (key == NULL)
+		return NULL;
+	ready_head = key->next_ready;
+	if (ready_head == NULL)
+		ready_tail = &ready_head;
+	return dequeue_job(key);
+}
+
+/* jump the queue */
+static struct updown_job *take_ready_job(struct updown_key *key)
+{
+	struct updown_key **kp = &ready_head;
+	while (*kp != key) {
+		passert(*kp != NULL);
+		kp = &(*kp)->next_ready;
+	}
+	*kp = key->next_ready;
+	if (*kp == NULL)
+		ready_tail = kp;
+	return dequeue_job(key);
+}
+
+static void start_jobs(void);
+
+static void job_done(struct updown_job *job, int status)
+{
+	struct updown_key *key = job->key;
+	bool failed = TRUE;
+
+	if (WIFEXITED(status)) {
+		if (WEXITSTATUS(status) != 0) {
+			loglog(RC_LOG_SERIOUS,
+			       "%s %s command exited with status %d",
+			       key->who, job->verb, WEXITSTATUS(status));
+		} else {
+			failed = FALSE;
+		}
+	} else if (WIFSIGNALED(status)) {
+		loglog(RC_LOG_SERIOUS,
+		       "%s %s command exited with signal %d",
+		       key->who, job->verb, WTERMSIG(status));
+	} else {
+		loglog(RC_LOG_SERIOUS,
+		       "%s %s command exited with unknown status %d",
+		       key->who, job->verb, status);
+	}
+	if (failed)
+		total_failed++;
+
+	passert(key->running == job);
+	key->running = NULL;
+	nr_running--;
+	free_updown_job(job);
+
+	if (key->queued != NULL) {
+		make_ready(key);
+	} else {
+		free_updown_key(key);
+	}
+	start_jobs();
+}
+
+/* like pipe2(O_CLOEXEC) */
+static bool cloexec_pipe(int fds[2])
+{
+	if (pipe(fds) != 0)
+		return FALSE;
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	return TRUE;
+}
+
+/*
+ * Fork a child per command.
+ */
+
+static void close_output(struct updown_job *job)
+{
+	if (job->out_ev != NULL)
+		delete_pluto_event(&job->out_ev);
+	if (job->out_fd >= 0) {
+		close(job->out_fd);
+		job->out_fd = -1;
+	}
+	flush_output(&job->line, job);
+}
+
+static void read_output(struct updown_job *job)
+{
+	for (;;) {
+		char buf[1024];
+		ssize_t n = read(job->out_fd, buf, sizeof(buf));
+		if (n > 0) {
+			add_output(&job->line, job, buf, n, log_line);
+		} else if (n == 0) {
+			close_output(job);
+			return;
+		} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return;
+		} else if (errno != EINTR) {
+			LOG_ERRNO(errno, "reading output of %s %s command failed",
+				  job->key->who, job->verb);
+			close_output(job);
+			return;
+		}
+	}
+}
+
+static void updown_output_cb(evutil_socket_t fd UNUSED,
+			     const short event UNUSED, void *arg)
+{
+	read_output(arg);
+}
+
+static pluto_fork_cb updown_exited; /* type assertion */
+
+static void updown_exited(struct state *null_st UNUSED,
+			  struct msg_digest **null_mdp UNUSED,
+			  int status, void *context)
+{
+	struct updown_job *job = context;
+
+	/* the child is gone; what is left is in the pipe */
+	if (job->out_fd >= 0)
+		read_output(job);
+	close_output(job);
+	job_done(job, status);
+}
+
+static int updown_child(void *context)
+{
+	struct updown_job *job = context;
+
+	/* stdout and stderr go to the pipe (dup2() clears FD_CLOEXEC) */
+	if (dup2(job->out_fd, STDOUT_FILENO) < 0 ||
+	    dup2(job->out_fd, STDERR_FILENO) < 0)
+		return 127;
+	execl("/bin/sh", "sh", "-c", job->cmd, (char *) NULL);
+	return 127;
+}
+
+static bool fork_job(struct updown_job *job)
+{
+	int fds[2];
+
+	if (!cloexec_pipe(fds)) {
+		LOG_ERRNO(errno, "pipe for %s %s command failed",
+			  job->key->who, job->verb);
+		return FALSE;
+	}
+	job->out_fd = fds[1];	/* for the child */
+	job->pid = pluto_fork("updown", SOS_NOBODY, updown_child,
+			      updown_exited, job);
+	close(fds[1]);
+	job->out_fd = fds[0];
+	if (job->pid < 0) {
+		close(fds[0]);
+		job->out_fd = -1;
+		return FALSE;
+	}
+	fcntl(job->out_fd, F_SETFL, O_NONBLOCK);
+	job->out_ev = pluto_event_add(job->out_fd, EV_READ | EV_PERSIST,
+				      updown_output_cb, job, NULL,
+				      "updown output");
+	return TRUE;
+}
+
+/*
+ * The coprocess.
+ */
+
+static void stop_coprocess(const char *why)
+{
+	if (coprocess.to_fd >= 0) {
+		close(coprocess.to_fd);
+		coprocess.to_fd = -1;
+	}
+	if (coprocess.from_ev != NULL)
+		delete_pluto_event(&coprocess.from_ev);
+	if (coprocess.from_fd >= 0) {
+		close(coprocess.from_fd);
+		coprocess.from_fd = -1;
+	}
+	if (!coprocess.failed && !stopping) {
+		loglog(RC_LOG_SERIOUS,
+		       "updown coprocess %s %s; forking updown commands instead",
+		       updown_coprocess, why);
+	}
+	coprocess.failed = TRUE;
+
+	/* anything sent is lost */
+	while (coprocess.sent != NULL) {
+		struct updown_job *job = coprocess.sent;
+		coprocess.sent = job->next;
+		if (coprocess.sent == NULL)
+			coprocess.sent_tail = &coprocess.sent;
+		flush_output(&coprocess.line, job);
+		loglog(RC_LOG_SERIOUS, "%s %s command lost by updown coprocess",
+		       job->key->who, job->verb);
+		if (!stopping) {
+			job_done(job, W_EXITCODE(127, 0));
+		}
+	}
+}
+
+static void coprocess_line(const struct updown_job *null_job UNUSED,
+			   const char *line)
+{
+	struct updown_job *job = coprocess.sent;
+	unsigned status;
+	char junk;
+
+	if (job != NULL && sscanf(line, "status %u%c", &status, &junk) == 1) {
+		coprocess.sent = job->next;
+		if (coprocess.sent == NULL)
+			coprocess.sent_tail = &coprocess.sent;
+		job->next = NULL;
+		job_done(job, W_EXITCODE(status & 0xff, 0));
+	} else {
+		log_line(job, line);
+	}
+}
+
+/* returns FALSE when there is nothing more to read, for now */
+static bool read_coprocess_output(void)
+{
+	char buf[1024];
+	ssize_t n = read(coprocess.from_fd, buf, sizeof(buf));
+	if (n > 0) {
+		add_output(&coprocess.line, NULL, buf, n, coprocess_line);
+		return TRUE;
+	} else if (n == 0) {
+		stop_coprocess("closed its output");
+		return FALSE;
+	} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		return FALSE;
+	} else if (errno != EINTR) {
+		LOG_ERRNO(errno, "reading updown coprocess output failed");
+		stop_coprocess("failed");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void coprocess_output_cb(evutil_socket_t fd UNUSED,
+				const short event UNUSED, void *arg UNUSED)
+{
+	/* a status can finish a job that then stops the coprocess */
+	while (coprocess.from_fd >= 0 && read_coprocess_output())
+		;
+}
+
+static pluto_fork_cb coprocess_exited; /* type assertion */
+
+static void coprocess_exited(struct state *null_st UNUSED,
+			     struct msg_digest **null_mdp UNUSED,
+			     int status, void *context UNUSED)
+{
+	coprocess.pid = 0;
+	if (!coprocess.failed) {
+		LSWLOG(buf) {
+			lswlogf(buf, "updown coprocess %s exited", updown_coprocess);
+			if (WIFEXITED(status))
+				lswlogf(buf, " with status %d", WEXITSTATUS(status));
+			else if (WIFSIGNALED(status))
+				lswlogf(buf, " with signal %d", WTERMSIG(status));
+		}
+		stop_coprocess("exited");
+		start_jobs();
+	}
+}
+
+static int coprocess_fds[2] = { -1, -1, };	/* stdin, stdout for the child */
+
+static int coprocess_child(void *context UNUSED)
+{
+	if (dup2(coprocess_fds[0], STDIN_FILENO) < 0 ||
+	    dup2(coprocess_fds[1], STDOUT_FILENO) < 0 ||
+	    dup2(coprocess_fds[1], STDERR_FILENO) < 0)
+		return 127;
+	execl(updown_coprocess, updown_coprocess, (char *) NULL);
+	return 127;
+}
+
+static void start_coprocess(void)
+{
+	int to[2];
+	int from[2];
+
+	if (!cloexec_pipe(to)) {
+		LOG_ERRNO(errno, "pipe for updown coprocess failed");
+		coprocess.failed = TRUE;
+		return;
+	}
+	if (!cloexec_pipe(from)) {
+		LOG_ERRNO(errno, "pipe for updown coprocess failed");
+		close(to[0]);
+		close(to[1]);
+		coprocess.failed = TRUE;
+		return;
+	}
+	coprocess_fds[0] = to[0];
+	coprocess_fds[1] = from[1];
+	coprocess.pid = pluto_fork("updown coprocess", SOS_NOBODY,
+				   coprocess_child, coprocess_exited, NULL);
+	close(to[0]);
+	close(from[1]);
+	if (coprocess.pid < 0) {
+		close(to[1]);
+		close(from[0]);
+		coprocess.pid = 0;
+		coprocess.failed = TRUE;
+		return;
+	}
+	coprocess.to_fd = to[1];
+	coprocess.from_fd = from[0];
+	fcntl(coprocess.to_fd, F_SETFL, O_NONBLOCK);
+	fcntl(coprocess.from_fd, F_SETFL, O_NONBLOCK);
+	coprocess.from_ev = pluto_event_add(coprocess.from_fd,
+					    EV_READ | EV_PERSIST,
+					    coprocess_output_cb, NULL, NULL,
+					    "updown coprocess output");
+	libreswan_log("started updown coprocess %s (pid %d)",
+		      updown_coprocess, coprocess.pid);
+}
+
+/*
+ * Once its input is closed, the coprocess should reply to what it
+ * has been sent and then exit; wait for that.
+ */
+static void finish_coprocess(void)
+{
+	if (coprocess.to_fd < 0)
+		return;
+	close(coprocess.to_fd);
+	coprocess.to_fd = -1;
+	fcntl(coprocess.from_fd, F_SETFL, 0);	/* blocking */
+	coprocess_output_cb(coprocess.from_fd, EV_READ, NULL);
+	if (coprocess.pid > 0) {
+		/* coprocess_exited() clears coprocess.pid */
+		pluto_fork_wait(coprocess.pid);
+	}
+}
+
+/*
+ * With at most MAX_COPROCESS_REQUESTS (each smaller than the
+ * commands built by the kernel backends) outstanding, a write only
+ * fails if the coprocess has stopped reading.
+ */
+static bool write_request(struct updown_job *job)
+{
+	size_t len = strlen(job->request);
+	ssize_t n = write(coprocess.to_fd, job->request, len);
+	if (n != (ssize_t)len) {
+		if (n < 0)
+			LOG_ERRNO(errno, "writing to updown coprocess failed");
+		stop_coprocess("is not reading");
+		return FALSE;
+	}
+	job->next = NULL;
+	*coprocess.sent_tail = job;
+	coprocess.sent_tail = &job->next;
+	total_coprocess++;
+	return TRUE;
+}
+
+static bool use_coprocess(void)
+{
+	return updown_coprocess != NULL && !coprocess.failed;
+}
+
+static unsigned max_running(void)
+{
+	if (use_coprocess()) {
+		return updown_workers == 0 ? 1 :
+			updown_workers > MAX_COPROCESS_REQUESTS ?
+			MAX_COPROCESS_REQUESTS : updown_workers;
+	}
+	return updown_workers == 0 ? 1 : updown_workers;
+}
+
+static void start_jobs(void)
+{
+	if (stopping)
+		return;
+	while (nr_running < max_running()) {
+		struct updown_job *job = next_ready_job();
+		if (job == NULL)
+			return;
+		if (use_coprocess() && write_request(job))
+			continue;
+		if (!fork_job(job)) {
+			/* no choice but to do it the old way */
+			int status = invoke_command(job->verb, "", job->cmd) ?
+				0 : W_EXITCODE(1, 0);
+			job_done(job, status);
+			/* job_done() called start_jobs() */
+			return;
+		}
+	}
+}
+
+/*
+ * Block until nothing is queued or running for C.  A job still
+ * waiting for a free slot is run now; one that is running is waited
+ * for.  Finishing a job can free the key, so look it up each time.
+ */
+static void drain_updown_key(const struct connection *c)
+{
+	struct updown_key *key;
+	while ((key = find_updown_key(c)) != NULL) {
+		struct updown_job *job = key->running;
+		if (job == NULL) {
+			job = take_ready_job(key);
+			int status = invoke_command(job->verb, "", job->cmd) ?
+				0 : W_EXITCODE(1, 0);
+			job_done(job, status);
+		} else if (job->pid > 0) {
+			/* updown_exited() finishes the job */
+			pluto_fork_wait(job->pid);
+		} else {
+			/*
+			 * It was sent to the coprocess (should that
+			 * die, stop_coprocess() finishes the job).
+			 */
+			passert(coprocess.from_fd >= 0);
+			fcntl(coprocess.from_fd, F_SETFL, 0);	/* blocking */
+			(void) read_coprocess_output();
+			if (coprocess.from_fd >= 0)
+				fcntl(coprocess.from_fd, F_SETFL, O_NONBLOCK);
+		}
+	}
+}
+
+/*
+ * route_and_eroute() acts on whether these succeed, so they are
+ * always run synchronously (after anything already queued for the
+ * connection) and are not counted against updown-workers.
+ */
+static bool updown_verb_is_sync(const char *verb)
+{
+	return streq(verb, "prepare") || streq(verb, "route");
+}
+
+bool run_updown(const struct connection *c,
+		const char *verb, const char *verb_suffix,
+		const char *env, const char *script)
+{
+	size_t cmd_len = strlen("2>&1 ") + strlen(env) + strlen(script) + 1;
+	char *cmd = alloc_bytes(cmd_len, "updown command");
+	snprintf(cmd, cmd_len, "2>&1 %s%s", env, script);
+	total_commands++;
+
+	if (stopping || (updown_workers == 0 && updown_coprocess == NULL) ||
+	    updown_verb_is_sync(verb)) {
+		if (!stopping)
+			drain_updown_key(c);
+		bool ok = invoke_command(verb, verb_suffix, cmd);
+		if (!ok)
+			total_failed++;
+		pfree(cmd);
+		return ok;
+	}
+
+	struct updown_job *job = alloc_thing(struct updown_job, "updown job");
+	size_t verb_len = strlen(verb) + strlen(verb_suffix) + 1;
+	job->verb = alloc_bytes(verb_len, "updown verb");
+	snprintf(job->verb, verb_len, "%s%s", verb, verb_suffix);
+	job->cmd = cmd;
+	job->out_fd = -1;
+	if (updown_coprocess != NULL) {
+		/* quoted like the other values; see escape_metachar() */
+		size_t quoted_len = strlen(script) * 5 + 6;
+		char *quoted = alloc_bytes(quoted_len, "updown script");
+		escape_metachar(script, quoted, quoted_len);
+		size_t request_len = strlen(env) + strlen("PLUTO_UPDOWN=''\n") +
+			strlen(quoted) + 1;
+		job->request = alloc_bytes(request_len, "updown request");
+		snprintf(job->request, request_len, "%sPLUTO_UPDOWN='%s'\n",
+			 env, quoted);
+		pfree(quoted);
+		/* exactly one line */
+		for (char *p = job->request; p[1] != '\0'; p++) {
+			if (*p == '\n')
+				*p = ' ';
+		}
+	}
+
+	DBG(DBG_CONTROL, DBG_log("queueing %s command: %s", job->verb, cmd));
+
+	struct updown_key *key = updown_key(c);
+	job->key = key;
+	bool idle = key->queued == NULL && key->running == NULL;
+	*key->queued_tail = job;
+	key->queued_tail = &job->next;
+	nr_queued++;
+	if (idle)
+		make_ready(key);
+	start_jobs();
+	return TRUE;
+}
+
+void init_updown(void)
+{
+	init_hash_table(&updown_key_table);
+	init_list(&updown_key_info, &all_updown_keys);
+	if (updown_coprocess != NULL)
+		start_coprocess();
+}
+
+/*
+ * At exit the connections are deleted, and their down and unroute
+ * commands need to run before pluto exits; let the coprocess finish
+ * what it has been sent, and then run everything still queued, and
+ * anything later, synchronously.
+ */
+void free_updown(void)
+{
+	stopping = TRUE;
+	finish_coprocess();
+	stop_coprocess("stopped");
+
+	/* pluto died before init_updown() */
+	if (all_updown_keys.head.newer == NULL)
+		return;
+
+	struct updown_key *key;
+	FOR_EACH_LIST_ENTRY_OLD2NEW(&all_updown_keys, key) {
+		struct updown_job *job = key->running;
+		if (job != NULL && job->pid > 0) {
+			/* let it finish first */
+			int status;
+			waitpid(job->pid, &status, 0);
+			if (job->out_fd >= 0)
+				read_output(job);
+			close_output(job);
+		}
+		if (job != NULL)
+			free_updown_job(job);
+		key->running = NULL;
+		while (key->queued != NULL) {
+			job = key->queued;
+			key->queued = job->next;
+			(void) invoke_command(job->verb, "", job->cmd);
+			free_updown_job(job);
+		}
+		free_updown_key(key);
+	}
+	ready_head = NULL;
+	ready_tail = &ready_head;
+	nr_queued = nr_running = 0;
+	free_hash_table(&updown_key_table);
+}
+
+void show_updown_status(void)
+{
+	whack_log_comment("current.updown.queued=%u", nr_queued);
+	whack_log_comment("current.updown.running=%u", nr_running);
+	whack_log_comment("total.updown.commands=%lu", total_commands);
+	whack_log_comment("total.updown.failed=%lu", total_failed);
+	whack_log_comment("total.updown.coprocess=%lu", total_coprocess);
+}
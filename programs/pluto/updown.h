@@ -0,0 +1,49 @@
+/* updown script execution, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef _UPDOWN_H
+#define _UPDOWN_H
+
+struct connection;
+
+/*
+ * When non-zero, updown commands are queued and run asynchronously,
+ * at most this many at once; when zero (the default) pluto waits for
+ * each command.
+ */
+extern unsigned updown_workers;
+
+/*
+ * When non-NULL, a program that is started once and then fed each
+ * updown command over a pipe (instead of forking the script).
+ */
+extern char *updown_coprocess;
+
+void init_updown(void);
+void free_updown(void);
+void show_updown_status(void);
+
+/*
+ * Run SCRIPT with the environment ENV (a string of NAME='value '
+ * assignments that includes PLUTO_VERB).
+ *
+ * When the command is queued, TRUE is returned and any failure is
+ * only logged; commands for the same connection are still run in
+ * order.  Prepare and route commands are never queued: they wait for
+ * the connection's queued commands and then run.
+ */
+bool run_updown(const struct connection *c,
+		const char *verb, const char *verb_suffix,
+		const char *env, const char *script);
+
+#endif
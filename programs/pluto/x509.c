@@ -62,6 +62,7 @@
 #include "hostpair.h" /* for find_host_pair_connections */
 #include "secrets.h"
 #include "ip_address.h"
+#include "pluto_crypt.h"
 
 /* new NSS code */
 #include "pluto_x509.h"
@@ -722,6 +723,41 @@ static bool find_fetch_dn(SECItem *dn, struct connection *c,
 }
 #endif
 
+/*
+ * Certificate verification latency, from the request to the result
+ * being available to the main thread.
+ */
+static struct {
+	unsigned long helper;	/* verified by a crypto helper */
+	unsigned long main;	/* verified by the main thread */
+	unsigned long usec;
+	unsigned long usec_max;
+} x509_verify_stats;
+
+static void record_x509_verify_time(monotime_t started)
+{
+	unsigned long usec = monotime_elapsed_us(started, mononow());
+	x509_verify_stats.usec += usec;
+	if (usec > x509_verify_stats.usec_max)
+		x509_verify_stats.usec_max = usec;
+}
+
+/* has a helper already verified exactly these certificates? */
+static const struct pcr_x509_verify *x509_verified(const struct state *st,
+						   const chunk_t *certs,
+						   int num_certs)
+{
+	const struct pcr_x509_verify *xv = st->st_x509_verified;
+
+	if (xv == NULL || xv->nr_ders != num_certs)
+		return NULL;
+	for (int i = 0; i < num_certs; i++) {
+		if (!same_chunk(xv->ders[i], certs[i]))
+			return NULL;
+	}
+	return xv;
+}
+
 /*
  * WARNING: This function's bool return case is not what you expect!
  *
@@ -748,10 +784,21 @@ static int pluto_process_certs(struct state *st, chunk_t *certs,
 	rev_opts[RO_CRL_S] = crl_strict;
 
 	CERTCertificate *end_cert = NULL;
+	int ret;
+	const struct pcr_x509_verify *xv = x509_verified(st, certs, num_certs);
 
+	if (xv != NULL) {
+		DBG(DBG_X509, DBG_log("using certificate chain verified by a crypto helper"));
+		ret = xv->ret;
+		end_cert = xv->end_cert;
+	} else {
+		monotime_t started = mononow();
 
-	int ret = verify_and_cache_chain(certs, num_certs, &end_cert,
-						       rev_opts);
+		ret = verify_and_cache_chain(certs, num_certs, &end_cert,
+					     rev_opts);
+		x509_verify_stats.main++;
+		record_x509_verify_time(started);
+	}
 
 	if (ret == -1) {
 		libreswan_log("cert verify failed with internal error");
@@ -884,29 +931,16 @@ static int pluto_process_certs(struct state *st, chunk_t *certs,
 	return cont;
 }
 
+#define MAX_CERT_PAYLOADS 32
+
 /*
- * Decode the CERT payload of Phase 1.
- */
-/* todo:
- * http://tools.ietf.org/html/rfc4945
- *  3.3.4. PKCS #7 Wrapped X.509 Certificate
- *
- *  This type defines a particular encoding, not a particular certificate
- *  type.  Implementations SHOULD NOT generate CERTs that contain this
- *  Certificate Type.  Implementations SHOULD accept CERTs that contain
- *  this Certificate Type because several implementations are known to
- *  generate them.  Note that those implementations sometimes include
- *  entire certificate hierarchies inside a single CERT PKCS #7 payload,
- *  which violates the requirement specified in ISAKMP that this payload
- *  contain a single certificate.
- *
+ * Clone the X.509 CERT payloads into DER_LIST, returning the number
+ * found.
  */
-int ike_decode_cert(struct msg_digest *md)
+static int collect_cert_ders(struct state *st, struct msg_digest *md,
+			     chunk_t der_list[MAX_CERT_PAYLOADS], bool log_ignored)
 {
-	struct state *st = md->st;
 	struct payload_digest *p;
-	chunk_t der_list[32] = { {NULL, 0} };
-	int ret = LSW_CERT_NONE;
 	int der_num = 0;
 	int np = st->st_ikev2 ? ISAKMP_NEXT_v2CERT : ISAKMP_NEXT_CERT;
 
@@ -925,15 +959,47 @@ int ike_decode_cert(struct msg_digest *md)
 		{
 			chunk_t blob;
 
+			if (der_num == MAX_CERT_PAYLOADS) {
+				if (log_ignored)
+					loglog(RC_LOG_SERIOUS, "ignoring certificate payloads after the first %d",
+						MAX_CERT_PAYLOADS);
+				break;
+			}
 			clonetochunk(blob, p->pbs.cur, pbs_left(&p->pbs), "cert chain blob");
 			der_list[der_num++] = blob;
-		} else {
+		} else if (log_ignored) {
 			loglog(RC_LOG_SERIOUS, "ignoring %s certificate payload",
 				!st->st_ikev2 ? enum_show(&ike_cert_type_names, cert->isacert_type)
 					: enum_show(&ikev2_cert_type_names, v2cert->isac_enc)
 				);
 		}
 	}
+	return der_num;
+}
+
+/*
+ * Decode the CERT payload of Phase 1.
+ */
+/* todo:
+ * http://tools.ietf.org/html/rfc4945
+ *  3.3.4. PKCS #7 Wrapped X.509 Certificate
+ *
+ *  This type defines a particular encoding, not a particular certificate
+ *  type.  Implementations SHOULD NOT generate CERTs that contain this
+ *  Certificate Type.  Implementations SHOULD accept CERTs that contain
+ *  this Certificate Type because several implementations are known to
+ *  generate them.  Note that those implementations sometimes include
+ *  entire certificate hierarchies inside a single CERT PKCS #7 payload,
+ *  which violates the requirement specified in ISAKMP that this payload
+ *  contain a single certificate.
+ *
+ */
+int ike_decode_cert(struct msg_digest *md)
+{
+	struct state *st = md->st;
+	chunk_t der_list[MAX_CERT_PAYLOADS];
+	int ret = LSW_CERT_NONE;
+	int der_num = collect_cert_ders(st, md, der_list, TRUE);
 
 	if (der_num > 0) {
 		DBG(DBG_X509, DBG_log("found at last one CERT payload, calling pluto_process_certs()"));
@@ -961,6 +1027,96 @@ int ike_decode_cert(struct msg_digest *md)
 	return ret;
 }
 
+/*
+ * Verify the peer's certificate chain in a crypto helper.
+ *
+ * With OCSP or AIA fetching enabled NSS can block waiting on a slow
+ * server.  Instead, the chain is verified by a helper and the result
+ * saved in the state; pluto_process_certs() then uses it when handed
+ * the same certificates.
+ *
+ * Returns FALSE, and does nothing, when there are no certificates.
+ */
+
+bool start_x509_verify(struct state *st, struct msg_digest *md,
+		       crypto_req_cont_func *pcrc_func)
+{
+	chunk_t der_list[MAX_CERT_PAYLOADS];
+	int der_num = collect_cert_ders(st, md, der_list, FALSE);
+
+	if (der_num == 0)
+		return FALSE;
+
+	struct pluto_crypto_req_cont *cn = new_pcrc(pcrc_func,
+						    "verify peer certificates");
+	struct pcr_x509_verify *xv = pcr_x509_verify_init(cn);
+
+	xv->ders = alloc_things(chunk_t, der_num, "cert chain blobs");
+	memcpy(xv->ders, der_list, der_num * sizeof(der_list[0]));
+	xv->nr_ders = der_num;
+	xv->rev_opts[RO_OCSP] = ocsp_enable;
+	xv->rev_opts[RO_OCSP_S] = ocsp_strict;
+	xv->rev_opts[RO_CRL_S] = crl_strict;
+	xv->started = mononow();
+
+	DBG(DBG_X509,
+	    DBG_log("verifying %d certificates in a crypto helper", der_num));
+
+	send_crypto_helper_request(st, cn);
+	return TRUE;
+}
+
+void calc_x509_verify(struct pcr_x509_verify *xv)
+{
+	xv->ret = verify_and_cache_chain(xv->ders, xv->nr_ders,
+					 &xv->end_cert, xv->rev_opts);
+}
+
+void cancelled_x509_verify(struct pcr_x509_verify *xv)
+{
+	if (xv->ders != NULL) {
+		for (int i = 0; i < xv->nr_ders; i++)
+			freeanychunk(xv->ders[i]);
+		pfree(xv->ders);
+		xv->ders = NULL;
+	}
+	xv->nr_ders = 0;
+}
+
+void finish_x509_verify(struct state *st, struct pluto_crypto_req *r)
+{
+	struct pcr_x509_verify *xv = &r->pcr_d.x509_verify;
+	passert(r->pcr_type == pcr_x509_verify);
+
+	x509_verify_stats.helper++;
+	record_x509_verify_time(xv->started);
+
+	free_x509_verified(&st->st_x509_verified);
+	st->st_x509_verified = clone_thing(*xv, "verified cert chain");
+	xv->ders = NULL;
+	xv->nr_ders = 0;
+}
+
+void free_x509_verified(struct pcr_x509_verify **xv)
+{
+	if (*xv != NULL) {
+		cancelled_x509_verify(*xv);
+		pfree(*xv);
+		*xv = NULL;
+	}
+}
+
+void show_x509_status(void)
+{
+	whack_log_comment("total.x509.verify.helper=%lu",
+			  x509_verify_stats.helper);
+	whack_log_comment("total.x509.verify.inline=%lu",
+			  x509_verify_stats.main);
+	whack_log_comment("total.x509.verify.usec=%lu",
+			  x509_verify_stats.usec);
+	whack_log_comment("total.x509.verify.usec.max=%lu",
+			  x509_verify_stats.usec_max);
+}
 
 /*
  * Decode the CR payload of Phase 1.
@@ -18,6 +18,15 @@
 #include <pthread.h> /* Must be the first include file */
 
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <event2/event.h>
 
 #include "constants.h"
 #include "lswlog.h"
@@ -37,6 +46,8 @@
 #include "deltatime.h"
 #include "monotime.h"
 
+unsigned pam_workers = 0;
+
 /* information for tracking xauth PAM work in flight */
 
 struct xauth {
@@ -45,8 +56,61 @@ struct xauth {
 	monotime_t start_time;
 	xauth_callback_t *callback;
 	pid_t child;
+	/* with pam_workers */
+	unsigned long id;
+	struct xauth *next;		/* when queued */
+	struct xauth **prevp;		/* when queued */
+	struct pam_worker *worker;	/* when sent */
+	bool success;
+};
+
+/*
+ * A long-lived PAM-process, talking to pluto over a socketpair; it
+ * authenticates one request at a time.
+ */
+struct pam_worker {
+	pid_t pid;			/* 0 when not running */
+	int fd;
+	struct pluto_event *ev;
+	struct pluto_event *timeout;
+	struct xauth *xauth;		/* being authenticated, or NULL */
 };
 
+static struct pam_worker *workers;	/* [pam_workers] */
+static struct xauth *queue_head = NULL;
+static struct xauth **queue_tail = &queue_head;
+static unsigned long next_request_id = 1;
+static bool stopping = FALSE;
+
+static unsigned nr_queued;
+static unsigned max_queued;
+static unsigned nr_busy;
+static unsigned long total_requests;
+static unsigned long total_timeouts;
+static unsigned long total_worker_starts;
+static intmax_t total_wait_ms;
+static intmax_t max_wait_ms;
+static intmax_t total_latency_ms;
+static intmax_t max_latency_ms;
+static unsigned long total_completed;
+
+/*
+ * On the wire: a header and then the strings (NUL terminated) name,
+ * password, c_name, ra and atype; the reply echoes the ID.
+ */
+struct pam_request {
+	unsigned long id;
+	so_serial_t st_serialno;
+	unsigned long c_instance_serial;
+};
+
+struct pam_reply {
+	unsigned long id;
+	bool success;
+};
+
+#define PAM_REQUEST_MAX 8192
+
 static void pfree_xauth(struct xauth *x)
 {
 	pfree(x->ptarg.name);
@@ -58,63 +122,26 @@ static void pfree_xauth(struct xauth *x)
 }
 
 /*
- * Abort the transaction, disconnecting it from state.
- *
- * Need to pass in serialno so that something sane can be logged when
- * the xauth request has already been deleted.  Need to pass in
- * st_callback, but only when it needs to notify an abort.
- */
-void xauth_pam_abort(struct state *st)
-{
-	struct xauth *xauth = st->st_xauth;
-
-	if (xauth == NULL) {
-		PEXPECT_LOG("PAM: #%lu: main-process: no process to abort (already aborted?)",
-			    st->st_serialno);
-	} else {
-		st->st_xauth = NULL; /* aborted */
-		pstats_xauth_aborted++;
-		passert(xauth->serialno == st->st_serialno);
-		libreswan_log("PAM: #%lu: main-process: aborting authentication PAM-process for '%s'",
-			      st->st_serialno, xauth->ptarg.name);
-		/*
-		 * Don't hold back.
-		 *
-		 * XXX: need to fix child so that more friendly
-		 * SIGTERM is handled - currently the forked process
-		 * has it blocked by libvent.
-		 */
-		kill(xauth->child, SIGKILL);
-		/*
-		 * xauth is deleted by xauth_pam_callback() _after_
-		 * the process exits and the callback has been called.
-		 */
-	}
-}
-
-/*
- * This is the callback from pluto_fork when the process dies.
  * On the main thread; notify the state (if it is present) of the
  * xauth result, and then release everything.
  */
-
-static pluto_fork_cb pam_callback; /* type assertion */
-
-static void pam_callback(struct state *st,
-			 struct msg_digest **mdp,
-			 int status, void *arg)
+static void pam_completed(struct state *st, struct msg_digest **mdp,
+			  struct xauth *xauth, bool success)
 {
-	struct xauth *xauth = arg;
-
 	pstats_xauth_stopped++;
 
-	bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	deltatime_t elapsed = monotimediff(mononow(), xauth->start_time);
+	total_completed++;
+	total_latency_ms += deltamillisecs(elapsed);
+	if (deltamillisecs(elapsed) > max_latency_ms)
+		max_latency_ms = deltamillisecs(elapsed);
+
 	LSWDBGP(DBG_XAUTH, buf) {
 		lswlogf(buf, "PAM: #%lu: main-process cleaning up PAM-process for user '%s' result %s time elapsed ",
 			xauth->serialno,
 			xauth->ptarg.name,
 			success ? "SUCCESS" : "FAILURE");
-		lswlog_deltatime(buf, monotimediff(mononow(), xauth->start_time));
+		lswlog_deltatime(buf, elapsed);
 		if (st == NULL) {
 			lswlogs(buf, " (state deleted)");
 		} else if (st->st_xauth == NULL) {
@@ -139,6 +166,20 @@ static void pam_callback(struct state *st,
 	pfree_xauth(xauth);
 }
 
+/*
+ * This is the callback from pluto_fork when the process dies.
+ */
+
+static pluto_fork_cb pam_callback; /* type assertion */
+
+static void pam_callback(struct state *st,
+			 struct msg_digest **mdp,
+			 int status, void *arg)
+{
+	pam_completed(st, mdp, arg,
+		      WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
 /*
  * Perform the authentication in the child process.
  */
@@ -158,6 +199,414 @@ static int pam_child(void *arg)
 	return success ? 0 : 1;
 }
 
+/*
+ * The pool of PAM-processes (pam_workers > 0).
+ *
+ * Requests are queued, oldest first, and sent to an idle process,
+ * forking one when there are fewer than pam_workers.  The result is
+ * handed back to the state through pluto_event_now(), as if from a
+ * forked process.  An aborted or timed out request that is being
+ * authenticated takes its process with it: PAM can't be interrupted.
+ */
+
+static void dispatch_requests(void);
+
+static pluto_event_now_cb pam_resume; /* type assertion */
+
+static void pam_resume(struct state *st, struct msg_digest **mdp, void *arg)
+{
+	struct xauth *xauth = arg;
+	pam_completed(st, mdp, xauth, xauth->success);
+}
+
+static void request_done(struct xauth *xauth, bool success)
+{
+	xauth->success = success;
+	pluto_event_now("PAM", xauth->serialno, pam_resume, xauth);
+}
+
+static void stop_worker(struct pam_worker *w)
+{
+	if (w->timeout != NULL)
+		delete_pluto_event(&w->timeout);
+	if (w->ev != NULL)
+		delete_pluto_event(&w->ev);
+	if (w->fd >= 0) {
+		close(w->fd);
+		w->fd = -1;
+	}
+}
+
+/* the rest happens in pam_worker_exited() */
+static void kill_worker(struct pam_worker *w)
+{
+	if (w->ev != NULL)
+		delete_pluto_event(&w->ev);	/* no longer idle */
+	if (w->pid > 0)
+		kill(w->pid, SIGKILL);
+}
+
+static pluto_fork_cb pam_worker_exited; /* type assertion */
+
+static void pam_worker_exited(struct state *null_st UNUSED,
+			      struct msg_digest **null_mdp UNUSED,
+			      int status, void *context)
+{
+	struct pam_worker *w = context;
+
+	DBG(DBG_XAUTH,
+	    DBG_log("PAM: PAM-process %d exited with status %d",
+		    w->pid, status));
+	w->pid = 0;
+	stop_worker(w);
+	struct xauth *xauth = w->xauth;
+	if (xauth != NULL) {
+		w->xauth = NULL;
+		xauth->worker = NULL;
+		nr_busy--;
+		request_done(xauth, FALSE);
+	}
+	dispatch_requests();
+}
+
+static void pam_worker_cb(evutil_socket_t fd UNUSED, const short event UNUSED,
+			  void *arg)
+{
+	struct pam_worker *w = arg;
+	struct pam_reply reply;
+
+	ssize_t n = recv(w->fd, &reply, sizeof(reply), MSG_DONTWAIT);
+	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+		      errno == EINTR))
+		return;
+	if (n != sizeof(reply)) {
+		if (n < 0) {
+			LOG_ERRNO(errno, "PAM: reading from PAM-process %d failed",
+				  w->pid);
+		}
+		kill_worker(w);
+		return;
+	}
+
+	struct xauth *xauth = w->xauth;
+	if (xauth == NULL || reply.id != xauth->id) {
+		loglog(RC_LOG_SERIOUS,
+		       "PAM: PAM-process %d replied to unknown request %lu",
+		       w->pid, reply.id);
+		kill_worker(w);
+		return;
+	}
+	w->xauth = NULL;
+	xauth->worker = NULL;
+	nr_busy--;
+	delete_pluto_event(&w->timeout);
+	request_done(xauth, reply.success);
+	dispatch_requests();
+}
+
+static void pam_worker_timeout_cb(evutil_socket_t fd UNUSED,
+				  const short event UNUSED, void *arg)
+{
+	struct pam_worker *w = arg;
+
+	delete_pluto_event(&w->timeout);
+	total_timeouts++;
+	libreswan_log("PAM: #%lu: PAM-process %d timed out authenticating user '%s'",
+		      w->xauth->serialno, w->pid, w->xauth->ptarg.name);
+	kill_worker(w);
+}
+
+static int worker_fds[2] = { -1, -1, };	/* pluto's, the PAM-process's */
+
+static int pam_worker_child(void *context UNUSED)
+{
+	int fd = worker_fds[1];
+
+	/* don't hold pluto's end of this, or any other, socket open */
+	close(worker_fds[0]);
+	for (unsigned i = 0; i < pam_workers; i++) {
+		if (workers[i].fd >= 0)
+			close(workers[i].fd);
+	}
+
+	for (;;) {
+		char buf[PAM_REQUEST_MAX + 1];
+		ssize_t n = recv(fd, buf, PAM_REQUEST_MAX, 0);
+		if (n == 0)
+			return 0;	/* pluto closed its end */
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < (ssize_t)sizeof(struct pam_request))
+			return 1;
+		buf[n] = '\0';
+
+		struct pam_request req;
+		memcpy(&req, buf, sizeof(req));
+		char *strings[5];
+		char *p = buf + sizeof(req);
+		for (unsigned i = 0; i < elemsof(strings); i++) {
+			if (p >= buf + n)
+				return 1;
+			strings[i] = p;
+			p += strlen(p) + 1;
+		}
+		struct pam_thread_arg arg = {
+			.name = strings[0],
+			.password = strings[1],
+			.c_name = strings[2],
+			.ra = strings[3],
+			.atype = strings[4],
+			.st_serialno = req.st_serialno,
+			.c_instance_serial = req.c_instance_serial,
+		};
+
+		DBG(DBG_XAUTH,
+		    DBG_log("PAM: #%lu: PAM-process authenticating user '%s' (request %lu)",
+			    arg.st_serialno, arg.name, req.id));
+		struct pam_reply reply = {
+			.id = req.id,
+			.success = do_pam_authentication(&arg),
+		};
+		if (send(fd, &reply, sizeof(reply), 0) != sizeof(reply))
+			return 1;
+	}
+}
+
+static bool start_worker(struct pam_worker *w)
+{
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0,
+		       worker_fds) != 0) {
+		LOG_ERRNO(errno, "PAM: socketpair for PAM-process failed");
+		return FALSE;
+	}
+	w->pid = pluto_fork("PAM worker", SOS_NOBODY, pam_worker_child,
+			    pam_worker_exited, w);
+	close(worker_fds[1]);
+	if (w->pid < 0) {
+		close(worker_fds[0]);
+		w->pid = 0;
+		return FALSE;
+	}
+	w->fd = worker_fds[0];
+	w->ev = pluto_event_add(w->fd, EV_READ | EV_PERSIST, pam_worker_cb,
+				w, NULL, "PAM worker");
+	total_worker_starts++;
+	DBG(DBG_XAUTH,
+	    DBG_log("PAM: started PAM-process %d", w->pid));
+	return TRUE;
+}
+
+static const char *request_strings(const struct xauth *xauth, unsigned i)
+{
+	const char *strings[] = {
+		xauth->ptarg.name,
+		xauth->ptarg.password,
+		xauth->ptarg.c_name,
+		xauth->ptarg.ra,
+		xauth->ptarg.atype,
+	};
+	return i < elemsof(strings) ? strings[i] : NULL;
+}
+
+static size_t request_size(const struct xauth *xauth)
+{
+	size_t len = sizeof(struct pam_request);
+	const char *s;
+	for (unsigned i = 0; (s = request_strings(xauth, i)) != NULL; i++)
+		len += strlen(s) + 1;
+	return len;
+}
+
+static bool send_request(struct pam_worker *w, const struct xauth *xauth)
+{
+	char buf[PAM_REQUEST_MAX];
+	struct pam_request req = {
+		.id = xauth->id,
+		.st_serialno = xauth->ptarg.st_serialno,
+		.c_instance_serial = xauth->ptarg.c_instance_serial,
+	};
+	size_t len = sizeof(req);
+	memcpy(buf, &req, sizeof(req));
+	const char *s;
+	for (unsigned i = 0; (s = request_strings(xauth, i)) != NULL; i++) {
+		size_t sl = strlen(s) + 1;
+		passert(len + sl <= sizeof(buf));	/* see request_size() */
+		memcpy(buf + len, s, sl);
+		len += sl;
+	}
+	ssize_t n = send(w->fd, buf, len, MSG_DONTWAIT);
+	if (n != (ssize_t)len) {
+		LOG_ERRNO(errno, "PAM: #%lu: sending request to PAM-process %d failed",
+			  xauth->serialno, w->pid);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static unsigned nr_workers(void)
+{
+	unsigned nr = 0;
+	for (unsigned i = 0; workers != NULL && i < pam_workers; i++) {
+		if (workers[i].pid > 0)
+			nr++;
+	}
+	return nr;
+}
+
+static struct pam_worker *idle_worker(void)
+{
+	struct pam_worker *unused = NULL;
+	for (unsigned i = 0; i < pam_workers; i++) {
+		struct pam_worker *w = &workers[i];
+		if (w->pid == 0) {
+			if (unused == NULL)
+				unused = w;
+		} else if (w->xauth == NULL && w->ev != NULL) {
+			return w;
+		}
+	}
+	if (unused != NULL && start_worker(unused))
+		return unused;
+	return NULL;
+}
+
+static struct xauth *dequeue_request(struct xauth *xauth)
+{
+	*xauth->prevp = xauth->next;
+	if (xauth->next != NULL)
+		xauth->next->prevp = xauth->prevp;
+	else
+		queue_tail = xauth->prevp;
+	xauth->next = NULL;
+	xauth->prevp = NULL;
+	nr_queued--;
+	return xauth;
+}
+
+static void dispatch_requests(void)
+{
+	while (!stopping && queue_head != NULL) {
+		struct pam_worker *w = idle_worker();
+		if (w == NULL) {
+			if (nr_workers() == 0) {
+				/* nothing will pick them up; give up */
+				loglog(RC_LOG_SERIOUS,
+				       "PAM: no PAM-process; failing %u queued requests",
+				       nr_queued);
+				while (queue_head != NULL)
+					request_done(dequeue_request(queue_head), FALSE);
+			}
+			return;
+		}
+
+		struct xauth *xauth = dequeue_request(queue_head);
+		deltatime_t waited = monotimediff(mononow(), xauth->start_time);
+		total_wait_ms += deltamillisecs(waited);
+		if (deltamillisecs(waited) > max_wait_ms)
+			max_wait_ms = deltamillisecs(waited);
+		if (!deltaless(waited, deltatime(EVENT_PAM_TIMEOUT_DELAY))) {
+			total_timeouts++;
+			libreswan_log("PAM: #%lu: timed out waiting for a PAM-process to authenticate user '%s'",
+				      xauth->serialno, xauth->ptarg.name);
+			request_done(xauth, FALSE);
+			continue;
+		}
+		if (!send_request(w, xauth)) {
+			kill_worker(w);
+			request_done(xauth, FALSE);
+			continue;
+		}
+		w->xauth = xauth;
+		xauth->worker = w;
+		nr_busy++;
+		deltatime_t timeout = deltatime(EVENT_PAM_TIMEOUT_DELAY);
+		w->timeout = pluto_event_add(NULL_FD, EV_TIMEOUT,
+					     pam_worker_timeout_cb, w,
+					     &timeout, "PAM timeout");
+	}
+}
+
+static bool queue_request(struct xauth *xauth)
+{
+	if (request_size(xauth) > PAM_REQUEST_MAX) {
+		libreswan_log("PAM: #%lu: request to authenticate user '%s' is too big",
+			      xauth->serialno, xauth->ptarg.name);
+		return FALSE;
+	}
+	if (workers == NULL) {
+		workers = alloc_things(struct pam_worker, pam_workers,
+				       "PAM workers");
+		for (unsigned i = 0; i < pam_workers; i++)
+			workers[i].fd = -1;
+	}
+	xauth->id = next_request_id++;
+	xauth->next = NULL;
+	xauth->prevp = queue_tail;
+	*queue_tail = xauth;
+	queue_tail = &xauth->next;
+	nr_queued++;
+	if (nr_queued > max_queued)
+		max_queued = nr_queued;
+	total_requests++;
+	DBG(DBG_XAUTH,
+	    DBG_log("PAM: #%lu: queued request %lu to authenticate user '%s'; %u queued",
+		    xauth->serialno, xauth->id, xauth->ptarg.name, nr_queued));
+	dispatch_requests();
+	return TRUE;
+}
+
+static void abort_request(struct xauth *xauth)
+{
+	if (stopping) {
+		/* free_xauth_pam() disowned it */
+		pfree_xauth(xauth);
+	} else if (xauth->worker != NULL) {
+		/* the result comes when the process has died */
+		kill_worker(xauth->worker);
+	} else {
+		request_done(dequeue_request(xauth), FALSE);
+	}
+}
+
+/*
+ * Abort the transaction, disconnecting it from state.
+ *
+ * Need to pass in serialno so that something sane can be logged when
+ * the xauth request has already been deleted.  Need to pass in
+ * st_callback, but only when it needs to notify an abort.
+ */
+void xauth_pam_abort(struct state *st)
+{
+	struct xauth *xauth = st->st_xauth;
+
+	if (xauth == NULL) {
+		PEXPECT_LOG("PAM: #%lu: main-process: no process to abort (already aborted?)",
+			    st->st_serialno);
+	} else {
+		st->st_xauth = NULL; /* aborted */
+		pstats_xauth_aborted++;
+		passert(xauth->serialno == st->st_serialno);
+		libreswan_log("PAM: #%lu: main-process: aborting authentication PAM-process for '%s'",
+			      st->st_serialno, xauth->ptarg.name);
+		if (pam_workers > 0) {
+			abort_request(xauth);
+			return;
+		}
+		/*
+		 * Don't hold back.
+		 *
+		 * XXX: need to fix child so that more friendly
+		 * SIGTERM is handled - currently the forked process
+		 * has it blocked by libvent.
+		 */
+		kill(xauth->child, SIGKILL);
+		/*
+		 * xauth is deleted by xauth_pam_callback() _after_
+		 * the process exits and the callback has been called.
+		 */
+	}
+}
+
 void xauth_start_pam_thread(struct state *st,
 			    const char *name,
 			    const char *password,
@@ -189,6 +638,16 @@ void xauth_start_pam_thread(struct state *st,
 	xauth->ptarg.c_instance_serial = st->st_connection->instance_serial;
 	xauth->ptarg.atype = atype;
 
+	if (pam_workers > 0) {
+		if (!queue_request(xauth)) {
+			pfree_xauth(xauth);
+			return;
+		}
+		st->st_xauth = xauth;
+		pstats_xauth_started++;
+		return;
+	}
+
 	DBG(DBG_XAUTH,
 	    DBG_log("PAM: #%lu: main-process starting PAM-process for authenticating user '%s'",
 		    xauth->serialno, xauth->ptarg.name));
@@ -205,4 +664,62 @@ void xauth_start_pam_thread(struct state *st,
 	pstats_xauth_started++;
 }
 
+/*
+ * A request still belonging to a state is freed when the state is
+ * deleted (xauth_pam_abort()); an aborted one is freed now.
+ */
+static void disown_request(struct xauth *xauth)
+{
+	struct state *st = state_with_serialno(xauth->serialno);
+	xauth->worker = NULL;
+	if (st == NULL || st->st_xauth != xauth)
+		pfree_xauth(xauth);
+}
+
+/*
+ * At exit, before the states are deleted; idle PAM-processes see
+ * their socket close and exit, busy ones are killed.
+ */
+void free_xauth_pam(void)
+{
+	stopping = TRUE;
+	if (workers == NULL)
+		return;
+	for (unsigned i = 0; i < pam_workers; i++) {
+		struct pam_worker *w = &workers[i];
+		if (w->xauth != NULL) {
+			if (w->pid > 0)
+				kill(w->pid, SIGKILL);
+			disown_request(w->xauth);
+			w->xauth = NULL;
+		}
+		if (w->pid > 0) {
+			stop_worker(w);
+			/* pam_worker_exited() clears w->pid */
+			pluto_fork_wait(w->pid);
+		}
+	}
+	nr_busy = 0;
+	while (queue_head != NULL)
+		disown_request(dequeue_request(queue_head));
+	pfree(workers);
+	workers = NULL;
+}
+
+void show_xauth_pam_status(void)
+{
+	whack_log_comment("current.pam.workers=%u", nr_workers());
+	whack_log_comment("current.pam.busy=%u", nr_busy);
+	whack_log_comment("current.pam.queued=%u", nr_queued);
+	whack_log_comment("current.pam.queued.max=%u", max_queued);
+	whack_log_comment("total.pam.requests=%lu", total_requests);
+	whack_log_comment("total.pam.completed=%lu", total_completed);
+	whack_log_comment("total.pam.timeouts=%lu", total_timeouts);
+	whack_log_comment("total.pam.workers.started=%lu", total_worker_starts);
+	whack_log_comment("total.pam.wait=%jdms", total_wait_ms);
+	whack_log_comment("total.pam.wait.max=%jdms", max_wait_ms);
+	whack_log_comment("total.pam.latency=%jdms", total_latency_ms);
+	whack_log_comment("total.pam.latency.max=%jdms", max_latency_ms);
+}
+
 #endif
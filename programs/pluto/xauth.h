@@ -27,6 +27,13 @@ typedef void xauth_callback_t(struct state *st,
 
 #ifdef XAUTH_HAVE_PAM
 
+/*
+ * When non-zero, PAM authentication is done by a pool of at most this
+ * many long-lived PAM-processes; when zero (the default) a process is
+ * forked for each request.
+ */
+extern unsigned pam_workers;
+
 /*
  * XXX: Should XAUTH handle timeouts internally?
  */
@@ -38,4 +45,7 @@ void xauth_start_pam_thread(struct state *st,
 			    const char *atype,
 			    xauth_callback_t *callback);
 
+void free_xauth_pam(void);
+void show_xauth_pam_status(void);
+
 #endif
@@ -177,7 +177,7 @@ static void help(void)
 		"\n"
 		"reread: whack [--rereadsecrets] [--fetchcrls] [--rereadall] \\\n"
 		"\n"
-		"status: whack --status --trafficstatus --globalstatus --clearstats --shuntstatus --fipsstatus\n"
+		"status: whack --status --trafficstatus --globalstatus --metrics --clearstats --shuntstatus --fipsstatus\n"
 		"\n"
 #ifdef HAVE_SECCOMP
 		"status: whack --seccomp-crashtest (CAREFUL!)\n"
@@ -292,6 +292,7 @@ enum option_enums {
 
 	OPT_STATUS,
 	OPT_GLOBAL_STATUS,
+	OPT_METRICS,
 	OPT_CLEAR_STATS,
 	OPT_SHUTDOWN,
 	OPT_TRAFFIC_STATUS,
@@ -522,6 +523,7 @@ static const struct option long_opts[] = {
 
 	{ "status", no_argument, NULL, OPT_STATUS + OO },
 	{ "globalstatus", no_argument, NULL, OPT_GLOBAL_STATUS + OO },
+	{ "metrics", no_argument, NULL, OPT_METRICS + OO },
 	{ "clearstats", no_argument, NULL, OPT_CLEAR_STATS + OO },
 	{ "trafficstatus", no_argument, NULL, OPT_TRAFFIC_STATUS + OO },
 	{ "shuntstatus", no_argument, NULL, OPT_SHUNT_STATUS + OO },
@@ -1225,6 +1227,10 @@ int main(int argc, char **argv)
 			msg.whack_global_status = TRUE;
 			continue;
 
+		case OPT_METRICS:	/* --metrics */
+			msg.whack_metrics = TRUE;
+			continue;
+
 		case OPT_CLEAR_STATS:	/* --clearstats */
 			msg.whack_clear_stats = TRUE;
 			continue;
@@ -1874,7 +1880,7 @@ int main(int argc, char **argv)
 			continue;
 
 		case END_ADDRESSPOOL:
-			ttorange(optarg, 0, AF_INET, &msg.right.pool_range,
+			ttorange(optarg, 0, AF_UNSPEC, &msg.right.pool_range,
 					TRUE);
 			continue;
 
@@ -2218,7 +2224,8 @@ int main(int argc, char **argv)
 	      msg.whack_unlisten || msg.whack_list || msg.ike_buf_size ||
 	      msg.whack_ddos != DDOS_undefined ||
 	      msg.whack_reread || msg.whack_crash || msg.whack_shunt_status ||
-	      msg.whack_status || msg.whack_global_status || msg.whack_traffic_status ||
+	      msg.whack_status || msg.whack_global_status || msg.whack_metrics ||
+	      msg.whack_traffic_status ||
 	      msg.whack_fips_status || msg.whack_clear_stats || msg.whack_options ||
 	      msg.whack_shutdown || msg.whack_purgeocsp || msg.whack_seccomp_crashtest))
 		diag("no action specified; try --help for hints");
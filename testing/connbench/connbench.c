@@ -0,0 +1,207 @@
+/* connection name and alias lookup benchmark, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Load --connections connections into pluto's name and alias tables
+ * and then look each one up, by name and by alias, the way
+ * conn_by_name() and foreach_connection_by_alias() do.  For
+ * comparison, the same lookups are also done using a linear search
+ * of the all-connections list (what pluto used to do).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "constants.h"
+#include "lswlog.h"
+#include "lswalloc.h"
+
+#include "defs.h"
+#include "connections.h"
+#include "connection_db.h"
+#include "rnd.h"		/* for get_rnd_bytes() */
+#include "log.h"		/* for whack_log_comment() */
+
+/* stand-ins for the parts of pluto that aren't linked in */
+
+void get_rnd_bytes(u_char *buffer, int length)
+{
+	for (int i = 0; i < length; i++) {
+		buffer[i] = random();
+	}
+}
+
+void whack_log_comment(const char *message, ...)
+{
+	va_list ap;
+	va_start(ap, message);
+	vprintf(message, ap);
+	va_end(ap);
+	printf("\n");
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static struct connection *by_name(const char *name)
+{
+	struct connection *c;
+	FOR_EACH_LIST_ENTRY_NEW2OLD(connection_name_slot(name), c) {
+		if (streq(c->name, name)) {
+			return c;
+		}
+	}
+	return NULL;
+}
+
+static struct connection *by_name_linear(struct connection *connections,
+					 const char *name)
+{
+	for (struct connection *c = connections; c != NULL; c = c->ac_next) {
+		if (streq(c->name, name)) {
+			return c;
+		}
+	}
+	return NULL;
+}
+
+static int count_connection(struct connection *c UNUSED, void *arg UNUSED)
+{
+	return 1;
+}
+
+static void report(const char *what, unsigned long nr, double elapsed)
+{
+	printf("%s: lookups=%lu seconds=%.3f lookups/sec=%.0f\n",
+	       what, nr, elapsed, nr / elapsed);
+}
+
+static void usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [--connections <count>] [--linear <count>]\n",
+		progname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "connections", required_argument, NULL, 'c', },
+		{ "linear", required_argument, NULL, 'l', },
+		{ 0, 0, 0, 0, },
+	};
+
+	tool_init_log(argv[0]);
+
+	unsigned long nr_conns = 50000;
+	/* a linear search is slow; only do a sample */
+	unsigned long nr_linear = 2000;
+	for (;;) {
+		int c = getopt_long(argc, argv, "", options, NULL);
+		if (c == -1) {
+			break;
+		}
+		switch (c) {
+		case 'c':
+			nr_conns = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			nr_linear = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || nr_conns < 1) {
+		usage(argv[0]);
+	}
+	if (nr_linear > nr_conns) {
+		nr_linear = nr_conns;
+	}
+
+	init_connection_db();
+
+	/* every 10 connections share an alias */
+	struct connection *conns = alloc_things(struct connection, nr_conns,
+						"connections");
+	struct connection *connections = NULL;
+	double start = now();
+	for (unsigned long i = 0; i < nr_conns; i++) {
+		char buf[64];
+		struct connection *c = &conns[i];
+		snprintf(buf, sizeof(buf), "conn-%lu", i);
+		c->name = clone_str(buf, "name");
+		snprintf(buf, sizeof(buf), "all group-%lu", i / 10);
+		c->connalias = clone_str(buf, "alias");
+		c->ac_next = connections;
+		connections = c;
+		add_connection_to_db(c);
+	}
+	double elapsed = now() - start;
+	printf("load: connections=%lu seconds=%.3f connections/sec=%.0f\n",
+	       nr_conns, elapsed, nr_conns / elapsed);
+
+	start = now();
+	for (unsigned long i = 0; i < nr_conns; i++) {
+		if (by_name(conns[i].name) != &conns[i]) {
+			fprintf(stderr, "lookup of %s failed\n", conns[i].name);
+			exit(1);
+		}
+	}
+	report("name", nr_conns, now() - start);
+
+	start = now();
+	for (unsigned long i = 0; i < nr_linear; i++) {
+		/* spread the sample across the list */
+		struct connection *c = &conns[i * (nr_conns / nr_linear)];
+		if (by_name_linear(connections, c->name) != c) {
+			fprintf(stderr, "linear lookup of %s failed\n", c->name);
+			exit(1);
+		}
+	}
+	report("name-linear", nr_linear, now() - start);
+
+	start = now();
+	unsigned long nr_groups = (nr_conns + 9) / 10;
+	for (unsigned long g = 0; g < nr_groups; g++) {
+		char alias[64];
+		snprintf(alias, sizeof(alias), "group-%lu", g);
+		int nr = foreach_connection_with_alias(alias, count_connection,
+						       NULL);
+		if (nr == 0 || nr > 10) {
+			fprintf(stderr, "lookup of alias %s found %d\n",
+				alias, nr);
+			exit(1);
+		}
+	}
+	report("alias", nr_groups, now() - start);
+
+	show_connection_db_status();
+
+	for (unsigned long i = 0; i < nr_conns; i++) {
+		del_connection_from_db(&conns[i]);
+		pfree(conns[i].name);
+		pfree(conns[i].connalias);
+	}
+	pfree(conns);
+	free_connection_db();
+
+	return 0;
+}
@@ -0,0 +1,199 @@
+/* crypto helper queue benchmark, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Push work-orders through pluto's helper queues, collect the answers
+ * the way pluto's main thread does, and measure the throughput for an
+ * increasing number of helper threads.
+ *
+ * Each work-order spins for --work iterations, standing in for the
+ * crypto.  Small values measure the queue overhead; large values
+ * should show throughput scaling with the number of helpers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "lswlog.h"
+#include "lswalloc.h"
+
+#include "helper_queue.h"
+
+struct order {
+	struct helper_work work;
+	bool stop;
+	unsigned long result;
+};
+
+struct helper {
+	int helpernum;
+	struct helper_queues *queues;
+	struct helper_answers *answers;
+	pthread_t thread;
+};
+
+static unsigned long work_iterations = 1000;
+
+static size_t log_order(struct lswlog *buf, void *data UNUSED)
+{
+	return lswlogs(buf, "order");
+}
+
+static const struct list_info order_info = {
+	.name = "order",
+	.log = log_order,
+};
+
+static void *helper_thread(void *arg)
+{
+	struct helper *h = arg;
+	for (;;) {
+		struct order *o = next_helper_work(h->queues, h->helpernum);
+		if (o->stop) {
+			return NULL;
+		}
+		/* xorshift, so the compiler can't skip it */
+		unsigned long x = (unsigned long)o | 1;
+		for (unsigned long i = 0; i < work_iterations; i++) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+		}
+		o->result = x;
+		send_helper_answer(h->answers, &o->work);
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(int nr_helpers, unsigned long nr_orders)
+{
+	struct helper_queues *queues = alloc_helper_queues(nr_helpers, &order_info);
+	struct helper_answers *answers = alloc_helper_answers(&order_info);
+	struct helper *helpers = alloc_things(struct helper, nr_helpers, "helpers");
+	struct order *orders = alloc_things(struct order, nr_orders + nr_helpers, "orders");
+
+	for (int h = 0; h < nr_helpers; h++) {
+		helpers[h].helpernum = h;
+		helpers[h].queues = queues;
+		helpers[h].answers = answers;
+		if (pthread_create(&helpers[h].thread, NULL, helper_thread, &helpers[h]) != 0) {
+			fprintf(stderr, "pthread_create failed\n");
+			exit(1);
+		}
+	}
+
+	double start = now();
+	for (unsigned long i = 0; i < nr_orders; i++) {
+		init_helper_work(&orders[i].work, &order_info, &orders[i]);
+		submit_helper_work(queues, &orders[i].work);
+	}
+	unsigned long nr_completed = 0;
+	unsigned long wakeups = 0;
+	while (nr_completed < nr_orders) {
+		struct pollfd pfd = {
+			.fd = helper_answers_fd(answers),
+			.events = POLLIN,
+		};
+		poll(&pfd, 1, -1);
+		clear_helper_answers_fd(answers);
+		wakeups++;
+		while (next_helper_answer(answers) != NULL) {
+			nr_completed++;
+		}
+	}
+	double elapsed = now() - start;
+
+	unsigned long steals = 0;
+	for (int h = 0; h < nr_helpers; h++) {
+		steals += helper_queue_steals(queues, h);
+	}
+	printf("helpers=%d orders=%lu seconds=%.3f orders/sec=%.0f steals=%lu wakeups=%lu\n",
+	       nr_helpers, nr_orders, elapsed, nr_orders / elapsed, steals,
+	       wakeups);
+
+	/* one stop order per helper */
+	for (int h = 0; h < nr_helpers; h++) {
+		struct order *o = &orders[nr_orders + h];
+		o->stop = true;
+		init_helper_work(&o->work, &order_info, o);
+		submit_helper_work(queues, &o->work);
+	}
+	for (int h = 0; h < nr_helpers; h++) {
+		pthread_join(helpers[h].thread, NULL);
+	}
+	pfree(orders);
+	pfree(helpers);
+	/* the queues and answers are "(ignore)" */
+}
+
+static void usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [--helpers <max>] [--orders <count>] [--work <iterations>]\n",
+		progname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "helpers", required_argument, NULL, 'h', },
+		{ "orders", required_argument, NULL, 'o', },
+		{ "work", required_argument, NULL, 'w', },
+		{ 0, 0, 0, 0, },
+	};
+
+	tool_init_log(argv[0]);
+
+	long max_helpers = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long nr_orders = 100000;
+	for (;;) {
+		int c = getopt_long(argc, argv, "", options, NULL);
+		if (c == -1) {
+			break;
+		}
+		switch (c) {
+		case 'h':
+			max_helpers = strtol(optarg, NULL, 0);
+			break;
+		case 'o':
+			nr_orders = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			work_iterations = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || max_helpers < 1 || nr_orders < 1) {
+		usage(argv[0]);
+	}
+
+	for (int h = 1; h <= max_helpers; h++) {
+		bench(h, nr_orders);
+	}
+
+	return 0;
+}
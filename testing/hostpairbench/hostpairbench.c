@@ -0,0 +1,197 @@
+/* host pair lookup benchmark, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Register --peers host pairs (plus a %any host pair for a template)
+ * in pluto's host pair table and then, as a responder does for each
+ * IKE_SA_INIT, look up each peer followed by %any.  For comparison,
+ * the same lookups are also done using a linear search of the
+ * host_pairs list (what pluto used to do).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <libreswan.h>
+
+#include "constants.h"
+#include "lswlog.h"
+#include "lswalloc.h"
+
+#include "defs.h"
+#include "hostpair.h"
+#include "host_pair_db.h"
+#include "rnd.h"		/* for get_rnd_bytes() */
+#include "log.h"		/* for whack_log_comment() */
+
+/* stand-ins for the parts of pluto that aren't linked in */
+
+void get_rnd_bytes(u_char *buffer, int length)
+{
+	for (int i = 0; i < length; i++) {
+		buffer[i] = random();
+	}
+}
+
+void whack_log_comment(const char *message, ...)
+{
+	va_list ap;
+	va_start(ap, message);
+	vprintf(message, ap);
+	va_end(ap);
+	printf("\n");
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static struct host_pair *by_addrs_linear(struct host_pair *host_pairs,
+					 const ip_address *myaddr,
+					 const ip_address *hisaddr)
+{
+	for (struct host_pair *p = host_pairs; p != NULL; p = p->next) {
+		if (sameaddr(&p->me.addr, myaddr) &&
+		    sameaddr(&p->him.addr, hisaddr)) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+static void peer_addr(unsigned long i, ip_address *addr)
+{
+	/* 10.0.0.0/8 */
+	u_int32_t a = htonl(0x0a000000 | (i + 1));
+	initaddr((const unsigned char *)&a, sizeof(a), AF_INET, addr);
+}
+
+static void report(const char *what, unsigned long nr, double elapsed)
+{
+	printf("%s: lookups=%lu seconds=%.3f lookups/sec=%.0f\n",
+	       what, nr, elapsed, nr / elapsed);
+}
+
+static void usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [--peers <count>] [--linear <count>]\n",
+		progname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "peers", required_argument, NULL, 'p', },
+		{ "linear", required_argument, NULL, 'l', },
+		{ 0, 0, 0, 0, },
+	};
+
+	tool_init_log(argv[0]);
+
+	unsigned long nr_peers = 20000;
+	/* a linear search is slow; only do a sample */
+	unsigned long nr_linear = 2000;
+	for (;;) {
+		int c = getopt_long(argc, argv, "", options, NULL);
+		if (c == -1) {
+			break;
+		}
+		switch (c) {
+		case 'p':
+			nr_peers = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			nr_linear = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || nr_peers < 1 || nr_peers >= 0xffffff) {
+		usage(argv[0]);
+	}
+	if (nr_linear > nr_peers) {
+		nr_linear = nr_peers;
+	}
+
+	init_host_pair_db();
+
+	ip_address me;
+	ttoaddr("192.0.2.1", 0, AF_INET, &me);
+	const ip_address *any = aftoinfo(AF_INET)->any;
+
+	/* the last one is ME <-> %any */
+	struct host_pair *hps = alloc_things(struct host_pair, nr_peers + 1,
+					     "host pairs");
+	struct host_pair *host_pairs = NULL;
+	double start = now();
+	for (unsigned long i = 0; i <= nr_peers; i++) {
+		struct host_pair *hp = &hps[i];
+		hp->me.addr = me;
+		if (i < nr_peers) {
+			peer_addr(i, &hp->him.addr);
+		} else {
+			hp->him.addr = *any;
+		}
+		hp->me.host_port = hp->him.host_port = 500;
+		hp->next = host_pairs;
+		host_pairs = hp;
+		add_host_pair_to_db(hp);
+	}
+	double elapsed = now() - start;
+	printf("load: host_pairs=%lu seconds=%.3f host_pairs/sec=%.0f\n",
+	       nr_peers + 1, elapsed, (nr_peers + 1) / elapsed);
+
+	start = now();
+	for (unsigned long i = 0; i < nr_peers; i++) {
+		ip_address him;
+		peer_addr(i, &him);
+		if (host_pair_by_addrs(&me, 500, &him, 4500) != &hps[i] ||
+		    host_pair_by_addrs(&me, 500, any, 500) != &hps[nr_peers]) {
+			fprintf(stderr, "lookup of peer %lu failed\n", i);
+			exit(1);
+		}
+	}
+	report("hashed", 2 * nr_peers, now() - start);
+
+	start = now();
+	for (unsigned long i = 0; i < nr_linear; i++) {
+		/* spread the sample across the list */
+		unsigned long p = i * (nr_peers / nr_linear);
+		ip_address him;
+		peer_addr(p, &him);
+		if (by_addrs_linear(host_pairs, &me, &him) != &hps[p] ||
+		    by_addrs_linear(host_pairs, &me, any) != &hps[nr_peers]) {
+			fprintf(stderr, "linear lookup of peer %lu failed\n", p);
+			exit(1);
+		}
+	}
+	report("linear", 2 * nr_linear, now() - start);
+
+	show_host_pair_db_status();
+
+	for (unsigned long i = 0; i <= nr_peers; i++) {
+		del_host_pair_from_db(&hps[i]);
+	}
+	pfree(hps);
+	free_host_pair_db();
+
+	return 0;
+}
@@ -0,0 +1,344 @@
+/* address pool lease check, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Have lots of connections, some sharing a peer ID, repeatedly lease
+ * and release addresses from a small IPv4 and a small IPv6 pool and
+ * check that each lease is exactly what a linear walk of the pool's
+ * leases (what lease_an_address() et.al. used to do) would have
+ * given: the lowest free address; a shared (or lingering) address
+ * for the same ID; or, when the pool is full, the address that has
+ * been lingering the longest.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <getopt.h>
+
+#include <libreswan.h>
+
+#include "constants.h"
+#include "lswlog.h"
+#include "lswalloc.h"
+#include "id.h"
+#include "ip_address.h"
+
+#include "defs.h"
+#include "connections.h"
+#include "addresspool.h"
+#include "rnd.h"		/* for get_rnd_bytes() */
+#include "log.h"		/* for whack_log_comment() */
+
+/* stand-ins for the parts of pluto that aren't linked in */
+
+void get_rnd_bytes(u_char *buffer, int length)
+{
+	for (int i = 0; i < length; i++) {
+		buffer[i] = random();
+	}
+}
+
+void whack_log_comment(const char *message, ...)
+{
+	va_list ap;
+	va_start(ap, message);
+	vprintf(message, ap);
+	va_end(ap);
+	printf("\n");
+}
+
+bool uniqueIDs = TRUE;
+
+/*
+ * The model: each pool index is free, or leased to an ID (NULL for
+ * ID_NULL, "" for ID_NONE).
+ */
+
+struct model_lease {
+	bool present;
+	const char *id;
+	unsigned refcnt;
+	unsigned long lingering_since;
+};
+
+struct pool {
+	const char *range;
+	unsigned size;
+	struct ip_pool *ip_pool;
+	ip_range r;
+	struct model_lease *leases;
+	unsigned long now;
+};
+
+struct peer {
+	const char *id;		/* canonical: lower case, no trailing dots */
+	struct connection c;
+	struct pool *pool;
+	unsigned index;		/* while leased */
+};
+
+static unsigned long nr_checks;
+
+static bool model_same_id(const char *a, const char *b)
+{
+	if ((a != NULL && a[0] == '\0') || (b != NULL && b[0] == '\0'))
+		return TRUE;	/* ID_NONE matches anything */
+	return a != NULL && b != NULL && streq(a, b);
+}
+
+static bool model_lease(struct pool *pool, const char *id, unsigned *index)
+{
+	/* share? */
+	for (unsigned i = 0; id != NULL && i < pool->size; i++) {
+		struct model_lease *l = &pool->leases[i];
+		if (l->present && model_same_id(l->id, id)) {
+			l->refcnt++;
+			*index = i;
+			return TRUE;
+		}
+	}
+	/* new? */
+	for (unsigned i = 0; i < pool->size; i++) {
+		struct model_lease *l = &pool->leases[i];
+		if (!l->present) {
+			*l = (struct model_lease) {
+				.present = TRUE,
+				.id = id,
+				.refcnt = 1,
+			};
+			*index = i;
+			return TRUE;
+		}
+	}
+	/* longest lingering */
+	struct model_lease *oldest = NULL;
+	for (unsigned i = 0; i < pool->size; i++) {
+		struct model_lease *l = &pool->leases[i];
+		if (l->refcnt == 0 && (oldest == NULL ||
+				       l->lingering_since < oldest->lingering_since)) {
+			oldest = l;
+			*index = i;
+		}
+	}
+	if (oldest == NULL)
+		return FALSE;
+	oldest->id = id;
+	oldest->refcnt = 1;
+	return TRUE;
+}
+
+static void model_release(struct pool *pool, const char *id, unsigned index)
+{
+	struct model_lease *l = &pool->leases[index];
+	if (id == NULL) {
+		l->present = FALSE;
+	} else if (--l->refcnt == 0) {
+		l->lingering_since = ++pool->now;
+	}
+}
+
+static void pool_address(const struct pool *pool, unsigned index,
+			 ip_address *addr)
+{
+	const unsigned char *start;
+	size_t len = addrbytesptr_read(&pool->r.start, &start);
+	unsigned char bytes[16];
+	memcpy(bytes, start, len);
+	/* the pools are small */
+	unsigned sum = bytes[len - 1] + index;
+	bytes[len - 1] = sum & 0xff;
+	bytes[len - 2] += sum >> 8;
+	initaddr(bytes, len, addrtypeof(&pool->r.start), addr);
+}
+
+static void lease(struct peer *peer)
+{
+	ip_address addr;
+	unsigned index;
+	err_t e = lease_an_address(&peer->c, &addr);
+	bool ok = model_lease(peer->pool, peer->id, &index);
+	if ((e == NULL) != ok) {
+		fprintf(stderr, "lease for '%s' from %s: %s\n",
+			peer->id == NULL ? "(null)" : peer->id,
+			peer->pool->range, e == NULL ? "unexpected" : e);
+		exit(1);
+	}
+	if (ok) {
+		ip_address expected;
+		pool_address(peer->pool, index, &expected);
+		if (!sameaddr(&addr, &expected)) {
+			ipstr_buf a, b;
+			fprintf(stderr, "lease for '%s' from %s: got %s expecting %s\n",
+				peer->id == NULL ? "(null)" : peer->id,
+				peer->pool->range, ipstr(&addr, &a),
+				ipstr(&expected, &b));
+			exit(1);
+		}
+		peer->c.spd.that.client.addr = addr;
+		peer->c.spd.that.has_lease = TRUE;
+		peer->index = index;
+	}
+	nr_checks++;
+}
+
+static void release(struct peer *peer)
+{
+	rel_lease_addr(&peer->c);
+	model_release(peer->pool, peer->id, peer->index);
+}
+
+/* some IDs are the same, but only once case and trailing dots are ignored */
+static void new_peer(struct peer *peer, struct pool *pool, unsigned long nr_ids)
+{
+	char name[64];
+
+	peer->pool = pool;
+	peer->c.name = "peer";
+	peer->c.kind = CK_INSTANCE;
+	peer->c.pool = pool->ip_pool;
+	reference_addresspool(&peer->c);
+
+	/*
+	 * An ID_NONE peer could share an ID_NULL peer's lease, which
+	 * then can't be freed; keep them in separate pools.
+	 */
+	if (random() % 16 == 0) {
+		if (addrtypeof(&pool->r.start) == AF_INET6) {
+			peer->id = NULL;
+			peer->c.spd.that.id.kind = ID_NULL;
+			return;
+		} else if (random() % 4 == 0) {
+			peer->id = "";
+			peer->c.spd.that.id.kind = ID_NONE;
+			return;
+		}
+	}
+
+	snprintf(name, sizeof(name), "peer%lu@example.com",
+		 random() % nr_ids);
+	peer->id = clone_str(name, "model id");
+	for (char *p = name; *p != '\0'; p++) {
+		if (random() % 2)
+			*p = toupper(*p);
+	}
+	if (random() % 2)
+		strcat(name, ".");
+	struct id id = {
+		.kind = ID_USER_FQDN,
+		.name = { .ptr = (unsigned char *)name, .len = strlen(name), },
+	};
+	duplicate_id(&peer->c.spd.that.id, &id);
+}
+
+static void usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [--peers <count>] [--leases <count>]\n",
+		progname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "peers", required_argument, NULL, 'p', },
+		{ "leases", required_argument, NULL, 'l', },
+		{ 0, 0, 0, 0, },
+	};
+
+	tool_init_log(argv[0]);
+
+	unsigned long nr_peers = 400;
+	unsigned long nr_leases = 100000;
+	for (;;) {
+		int c = getopt_long(argc, argv, "", options, NULL);
+		if (c == -1) {
+			break;
+		}
+		switch (c) {
+		case 'p':
+			nr_peers = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			nr_leases = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || nr_peers < 1) {
+		usage(argv[0]);
+	}
+
+	srandom(1);
+	init_addresspools();
+
+	/* pools smaller than the number of peers, so they fill */
+	struct pool pools[] = {
+		{ .range = "192.0.2.1-192.0.2.100", .size = 100, },
+		{ .range = "2001:db8::1:1-2001:db8::1:ff", .size = 255, },
+	};
+	const unsigned nr_pools = elemsof(pools);
+	for (unsigned p = 0; p < nr_pools; p++) {
+		err_t e = ttorange(pools[p].range, 0, AF_UNSPEC,
+				   &pools[p].r, TRUE);
+		if (e != NULL) {
+			fprintf(stderr, "bad range %s: %s\n", pools[p].range, e);
+			exit(1);
+		}
+		pools[p].ip_pool = install_addresspool(&pools[p].r);
+		pools[p].leases = alloc_things(struct model_lease, pools[p].size,
+					       "model leases");
+	}
+
+	struct peer *peers = alloc_things(struct peer, nr_peers, "peers");
+	for (unsigned long i = 0; i < nr_peers; i++) {
+		new_peer(&peers[i], &pools[i % nr_pools], nr_peers / 2 + 1);
+	}
+
+	for (unsigned long i = 0; i < nr_leases; i++) {
+		struct peer *peer = &peers[random() % nr_peers];
+		if (peer->c.spd.that.has_lease) {
+			release(peer);
+		} else {
+			lease(peer);
+		}
+	}
+
+	show_addresspool_status();
+
+	/* releasing everything frees the pools */
+	for (unsigned long i = 0; i < nr_peers; i++) {
+		struct peer *peer = &peers[i];
+		if (peer->c.spd.that.has_lease) {
+			release(peer);
+		}
+		unreference_addresspool(&peer->c);
+		free_id_content(&peer->c.spd.that.id);
+		if (peer->id != NULL && peer->id[0] != '\0')
+			pfree((char *)peer->id);
+	}
+	pfree(peers);
+	for (unsigned p = 0; p < nr_pools; p++) {
+		pfree(pools[p].leases);
+	}
+
+	/* should be empty */
+	show_addresspool_status();
+	free_addresspools();
+
+	printf("checks=%lu\n", nr_checks);
+	return 0;
+}
@@ -0,0 +1,9 @@
+ipsec whack --trafficstatus | grep '"named"' > /dev/null && echo "tunnel up"
+# clean up after ourselves
+rm -f /etc/systemd/system/unbound.service
+: ==== cut ====
+ipsec auto --status
+: ==== tuc ====
+../bin/check-for-core.sh
+if [ -f /sbin/ausearch ]; then ausearch -r -m avc -ts recent ; fi
+: ==== end ====
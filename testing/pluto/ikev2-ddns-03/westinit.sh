@@ -0,0 +1,11 @@
+/testing/guestbin/swan-prep
+ipsec start
+/testing/pluto/bin/wait-until-pluto-started
+cp resolv.conf /etc
+# need to disable ipv6 and activate auto-interface
+cp west-unbound.conf /etc/unbound/unbound.conf
+ipsec auto --add named
+# the name can't resolve yet; routing is deferred
+ipsec auto --route named
+ipsec auto --status | grep '"named".*erouted' && echo "TEST FAILED - routed before the name resolved"
+echo "initdone"
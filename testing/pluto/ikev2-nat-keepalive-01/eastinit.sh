@@ -0,0 +1,6 @@
+/testing/guestbin/swan-prep
+ipsec start
+/testing/pluto/bin/wait-until-pluto-started
+ipsec auto --add road-eastnet
+ipsec status |grep encaps:
+echo "initdone"
@@ -0,0 +1,8 @@
+# east isn't behind a NAT; it shouldn't send any
+hostname | grep east > /dev/null && ipsec whack --globalstatus | grep natt.keepalive.sent
+: ==== cut ====
+ipsec auto --status
+: ==== tuc ====
+../bin/check-for-core.sh
+if [ -f /sbin/ausearch ]; then ausearch -r -m avc -ts recent ; fi
+: ==== end ====
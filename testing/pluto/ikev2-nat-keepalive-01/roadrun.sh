@@ -0,0 +1,6 @@
+ipsec whack --name road-eastnet-forceencaps --initiate
+ping -n -c 4 192.0.2.254
+# a keep-alive is sent every 5 seconds or so
+sleep 12
+ipsec whack --globalstatus | grep 'natt.keepalive.sent=[1-9]' > /dev/null && echo "keep-alives sent"
+echo done
@@ -0,0 +1,11 @@
+/testing/guestbin/swan-prep
+# confirm that the network is alive
+../../pluto/bin/wait-until-alive -I 192.0.1.254 192.0.2.254
+# ensure that clear text does not get through
+iptables -A INPUT -i eth1 -s 192.0.2.0/24 -j LOGDROP
+iptables -I INPUT -m policy --dir in --pol ipsec -j ACCEPT
+ipsec start
+/testing/pluto/bin/wait-until-pluto-started
+ipsec auto --add westnet-eastnet-ikev2
+ipsec auto --add westnet-eastnet-ignore
+echo "initdone"
@@ -0,0 +1,24 @@
+ipsec auto --up  westnet-eastnet-ikev2
+ping -n -c 4 -I 192.0.1.254 192.0.2.254
+ipsec whack --trafficstatus
+# nothing changed; the connection and its SAs are left alone
+ipsec auto --reload
+grep "reloaded ipsec.conf" /tmp/pluto.log
+# the auto=ignore connection added by hand is still there
+ipsec whack --status | grep '"westnet-eastnet-ignore": 192'
+ipsec whack --trafficstatus
+ping -n -c 4 -I 192.0.1.254 192.0.2.254
+ipsec whack --trafficstatus
+# only east's key changed; the connection is replaced
+cp west-newkey.conf /etc/ipsec.conf
+ipsec auto --reload
+grep "reloaded ipsec.conf" /tmp/pluto.log
+# the auto=ignore connection added by hand is still there
+ipsec whack --status | grep '"westnet-eastnet-ignore": 192'
+ipsec whack --trafficstatus
+# only auto= changed (add to route); the connection is replaced and routed
+cp west-route.conf /etc/ipsec.conf
+ipsec auto --reload
+grep "reloaded ipsec.conf" /tmp/pluto.log
+ipsec whack --status | grep '"westnet-eastnet-ikev2": 192'
+echo done
@@ -0,0 +1,11 @@
+ipsec look
+hostname | grep east > /dev/null && ipsec whack --globalstatus | grep '\.pam\.' | grep -v '\.wait='
+if [ -f /etc/pam.d/pluto.stock ]; then mv /etc/pam.d/pluto.stock /etc/pam.d/pluto ; fi
+: ==== cut ====
+ipsec auto --status
+: ==== tuc ====
+ipsec stop
+hostname | grep east > /dev/null && grep -c 'PAM: PAM-process .* exited' /tmp/pluto.log
+../bin/check-for-core.sh
+if [ -f /sbin/ausearch ]; then ausearch -r -m avc -ts recent ; fi
+: ==== end ====
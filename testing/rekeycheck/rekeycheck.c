@@ -0,0 +1,184 @@
+/* rekey rate limiter check, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Fire a burst of replace events at rekey_deferred() and check that
+ * a second's worth go ahead and the rest are deferred, each to the
+ * next free slot; that a deferred event, when it fires again, goes
+ * ahead; and that an SA that can't afford to wait goes anyway,
+ * without taking a slot away from the SAs that can.
+ *
+ * The burst takes far less than the 1/rekey_rate interval, so it is
+ * treated as happening at a single instant.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include <libreswan.h>
+
+#include "constants.h"
+#include "lswlog.h"
+#include "lswalloc.h"
+
+#include "defs.h"
+#include "connections.h"
+#include "state.h"
+#include "timer.h"
+#include "log.h"		/* for whack_log_comment() */
+#include "pluto_stats.h"
+#include "rekey.h"
+
+/* stand-ins for the parts of pluto that aren't linked in */
+
+unsigned long pstats_rekeys_spread;
+unsigned long pstats_rekeys_deferred;
+unsigned long pstats_rekeys_overrate;
+
+void whack_log_comment(const char *message UNUSED, ...)
+{
+}
+
+static struct state *scheduled_st;
+static enum event_type scheduled_type;
+static deltatime_t scheduled_delay;
+
+void event_schedule(enum event_type type, deltatime_t delay, struct state *st)
+{
+	scheduled_st = st;
+	scheduled_type = type;
+	scheduled_delay = delay;
+	/* as rekey_event_scheduled() does */
+	st->st_rekey_deferred = FALSE;
+}
+
+static void fail(const char *message, ...)
+{
+	va_list ap;
+	va_start(ap, message);
+	vfprintf(stderr, message, ap);
+	va_end(ap);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+#define RATE 10
+#define INTERVAL_MS (1000 / RATE)
+
+static struct state states[3 * RATE];
+
+static struct state *test_state(unsigned i, intmax_t margin_ms)
+{
+	struct state *st = &states[i];
+	st->st_serialno = i + 1;
+	st->st_margin = deltatime_ms(margin_ms);
+	return st;
+}
+
+/*
+ * The Nth over the rate waits N intervals, give or take a
+ * millisecond for the time spent getting here.
+ */
+static void check_deferred(struct state *st, unsigned n)
+{
+	intmax_t margin = deltamillisecs(st->st_margin);
+	scheduled_st = NULL;
+	if (!rekey_deferred(st, EVENT_SA_REPLACE)) {
+		fail("#%lu: not deferred", st->st_serialno);
+	}
+	if (scheduled_st != st || scheduled_type != EVENT_SA_REPLACE) {
+		fail("#%lu: replace event not re-scheduled", st->st_serialno);
+	}
+	intmax_t wait = deltamillisecs(scheduled_delay);
+	intmax_t expect = n * INTERVAL_MS;
+	if (wait < expect - 1 || wait > expect) {
+		fail("#%lu: deferred %jdms; expecting %jdms",
+		     st->st_serialno, wait, expect);
+	}
+	if (deltamillisecs(st->st_margin) != margin - wait) {
+		fail("#%lu: margin %jdms; expecting %jdms",
+		     st->st_serialno, deltamillisecs(st->st_margin),
+		     margin - wait);
+	}
+	if (!st->st_rekey_deferred) {
+		fail("#%lu: not marked as deferred", st->st_serialno);
+	}
+}
+
+int main(int argc UNUSED, char *argv[])
+{
+	tool_init_log(argv[0]);
+
+	/* no limit */
+	for (unsigned i = 0; i < elemsof(states); i++) {
+		struct state *st = test_state(i, 60 * 1000);
+		if (rekey_deferred(st, EVENT_SA_REPLACE)) {
+			fail("#%lu: deferred without a rekey-rate",
+			     st->st_serialno);
+		}
+	}
+
+	rekey_rate = RATE;
+	unsigned i = 0;
+
+	/* a burst of a second's worth goes ahead */
+	for (; i < RATE; i++) {
+		struct state *st = test_state(i, 60 * 1000);
+		if (rekey_deferred(st, EVENT_SA_REPLACE)) {
+			fail("#%lu: deferred within the burst",
+			     st->st_serialno);
+		}
+	}
+
+	/* then each is deferred one interval more */
+	check_deferred(test_state(i++, 60 * 1000), 1);
+	check_deferred(test_state(i++, 60 * 1000), 2);
+
+	/*
+	 * This one would wait 3 intervals, which is more than half its
+	 * margin; it goes anyway and the next still waits 3 intervals.
+	 */
+	struct state *st = test_state(i++, 5 * INTERVAL_MS);
+	if (rekey_deferred(st, EVENT_SA_REPLACE)) {
+		fail("#%lu: deferred with no margin to spare",
+		     st->st_serialno);
+	}
+	if (pstats_rekeys_overrate != 1) {
+		fail("#%lu: going over the rate not counted",
+		     st->st_serialno);
+	}
+	struct state *third = test_state(i++, 60 * 1000);
+	check_deferred(third, 3);
+
+	/* when it fires again, it has its slot */
+	if (rekey_deferred(third, EVENT_SA_REPLACE)) {
+		fail("#%lu: deferred twice", third->st_serialno);
+	}
+	if (third->st_rekey_deferred) {
+		fail("#%lu: still marked as deferred", third->st_serialno);
+	}
+
+	/* and it didn't take another */
+	check_deferred(test_state(i++, 60 * 1000), 4);
+
+	if (pstats_rekeys_deferred != 4) {
+		fail("%lu rekeys deferred; expecting 4",
+		     pstats_rekeys_deferred);
+	}
+	printf("rekeys: deferred=%lu overrate=%lu\n",
+	       pstats_rekeys_deferred, pstats_rekeys_overrate);
+
+	free_rekey();
+	return 0;
+}
@@ -0,0 +1,310 @@
+/* spd route table check, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Load lots of connections, with overlapping .that.client subnets,
+ * into pluto's spd route table and check that each lookup, once
+ * filtered and sorted, finds exactly the spd routes, in the same
+ * order, as a linear walk of the connections list (what
+ * route_owner() et.al. used to do).  Connections are then changed,
+ * deleted and added, and everything is checked again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <getopt.h>
+
+#include <libreswan.h>
+
+#include "constants.h"
+#include "lswlog.h"
+#include "lswalloc.h"
+
+#include "defs.h"
+#include "connections.h"
+#include "hostpair.h"		/* for list_rm() */
+#include "spd_db.h"
+#include "log.h"		/* for whack_log_comment() */
+
+/* stand-ins for the parts of pluto that aren't linked in */
+
+void whack_log_comment(const char *message, ...)
+{
+	va_list ap;
+	va_start(ap, message);
+	vprintf(message, ap);
+	va_end(ap);
+	printf("\n");
+}
+
+struct connection *connections = NULL;
+
+static unsigned long nr_checks;
+
+/* a small address space so that subnets overlap */
+static void random_subnet(ip_subnet *net)
+{
+	if (random() % 8 == 0) {
+		/* 2001:db8:N::/M */
+		unsigned char bytes[16] = { 0x20, 0x01, 0x0d, 0xb8, };
+		bytes[4] = random() % 4;
+		bytes[15] = random() % 4;
+		initaddr(bytes, sizeof(bytes), AF_INET6, &net->addr);
+		net->maskbits = random() % 2 ? 128 : 32 + random() % 8;
+	} else {
+		/* 10.N.N.N/M, with a bias to hosts and /24s */
+		unsigned char bytes[4] = { 10, random() % 4, random() % 8,
+					   random() % 16, };
+		initaddr(bytes, sizeof(bytes), AF_INET, &net->addr);
+		switch (random() % 4) {
+		case 0:
+			net->maskbits = 32;
+			break;
+		case 1:
+			net->maskbits = 24;
+			break;
+		default:
+			net->maskbits = random() % 33;
+			break;
+		}
+	}
+	/* only sometimes clear the host bits */
+	if (random() % 2) {
+		ip_address network;
+		networkof(net, &network);
+		net->addr = network;
+	}
+}
+
+static void random_address(ip_address *addr)
+{
+	ip_subnet net;
+	random_subnet(&net);
+	*addr = net.addr;
+}
+
+static struct connection *new_connection(unsigned long i)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "conn-%lu", i);
+	struct connection *c = alloc_thing(struct connection, "connection");
+	c->name = clone_str(name, "name");
+	random_subnet(&c->spd.that.client);
+	/* some have several spd routes */
+	struct spd_route **srp = &c->spd.spd_next;
+	for (long nr = random() % 4 - 1; nr > 0; nr--) {
+		*srp = alloc_thing(struct spd_route, "spd route");
+		random_subnet(&(*srp)->that.client);
+		srp = &(*srp)->spd_next;
+	}
+	/* like add_connection() */
+	c->ac_next = connections;
+	connections = c;
+	add_spd_routes_to_db(c);
+	return c;
+}
+
+static void drop_connection(struct connection *c)
+{
+	list_rm(struct connection, ac_next, c, connections);
+	del_spd_routes_from_db(c);
+	struct spd_route *sr = c->spd.spd_next;
+	while (sr != NULL) {
+		struct spd_route *next = sr->spd_next;
+		pfree(sr);
+		sr = next;
+	}
+	pfree(c->name);
+	pfree(c);
+}
+
+enum query { WITH, CONTAINING, OVERLAPPING, };
+
+static bool matches(enum query query, const ip_subnet *net,
+		    const struct spd_route *sr)
+{
+	switch (query) {
+	case WITH:
+		return samesubnet(net, &sr->that.client);
+	case CONTAINING:
+		return addrinsubnet(&net->addr, &sr->that.client);
+	case OVERLAPPING:
+		return subnetinsubnet(net, &sr->that.client) ||
+			subnetinsubnet(&sr->that.client, net);
+	}
+	abort();
+}
+
+static void check(enum query query, const ip_subnet *net)
+{
+	struct spd_route_refs refs = { 0, 0, NULL, };
+	switch (query) {
+	case WITH:
+		spd_routes_with_that_client(&refs, net);
+		break;
+	case CONTAINING:
+		spd_routes_with_that_client_containing(&refs, &net->addr);
+		break;
+	case OVERLAPPING:
+		spd_routes_with_that_client_overlapping(&refs, net);
+		break;
+	}
+	sort_spd_route_refs(&refs);
+
+	unsigned i = 0;
+	for (struct connection *c = connections; c != NULL; c = c->ac_next) {
+		for (struct spd_route *sr = &c->spd; sr != NULL; sr = sr->spd_next) {
+			if (!matches(query, net, sr))
+				continue;
+			/* skip candidates that the real test rejects */
+			while (i < refs.nr && !matches(query, net, refs.refs[i].sr))
+				i++;
+			if (i >= refs.nr || refs.refs[i].c != c ||
+			    refs.refs[i].sr != sr) {
+				char b[SUBNETTOT_BUF];
+				subnettot(net, 0, b, sizeof(b));
+				fprintf(stderr, "query %d for %s: \"%s\" missing or out of order\n",
+					query, b, c->name);
+				exit(1);
+			}
+			i++;
+		}
+	}
+	for (; i < refs.nr; i++) {
+		if (matches(query, net, refs.refs[i].sr)) {
+			fprintf(stderr, "query %d: \"%s\" unexpected\n",
+				query, refs.refs[i].c->name);
+			exit(1);
+		}
+	}
+	free_spd_route_refs(&refs);
+	nr_checks++;
+}
+
+static void check_all(unsigned long nr_queries)
+{
+	for (unsigned long q = 0; q < nr_queries; q++) {
+		ip_subnet net;
+		random_subnet(&net);
+		check(WITH, &net);
+		check(OVERLAPPING, &net);
+		random_address(&net.addr);
+		check(CONTAINING, &net);
+	}
+	/* and everything that is in the table */
+	for (struct connection *c = connections; c != NULL; c = c->ac_next) {
+		for (struct spd_route *sr = &c->spd; sr != NULL; sr = sr->spd_next) {
+			check(WITH, &sr->that.client);
+			check(CONTAINING, &sr->that.client);
+			check(OVERLAPPING, &sr->that.client);
+		}
+	}
+}
+
+static struct connection *random_connection(unsigned long nr_conns)
+{
+	struct connection *c = connections;
+	for (unsigned long n = random() % nr_conns; n > 0; n--)
+		c = c->ac_next;
+	return c;
+}
+
+static void usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [--connections <count>] [--queries <count>]\n",
+		progname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "connections", required_argument, NULL, 'c', },
+		{ "queries", required_argument, NULL, 'q', },
+		{ 0, 0, 0, 0, },
+	};
+
+	tool_init_log(argv[0]);
+
+	unsigned long nr_conns = 500;
+	unsigned long nr_queries = 1000;
+	for (;;) {
+		int c = getopt_long(argc, argv, "", options, NULL);
+		if (c == -1) {
+			break;
+		}
+		switch (c) {
+		case 'c':
+			nr_conns = strtoul(optarg, NULL, 0);
+			break;
+		case 'q':
+			nr_queries = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || nr_conns < 2) {
+		usage(argv[0]);
+	}
+
+	srandom(1);
+	init_spd_db();
+
+	unsigned long next = 0;
+	for (; next < nr_conns; next++) {
+		new_connection(next);
+	}
+	check_all(nr_queries);
+
+	/* change clients, as an instantiate or a lease would */
+	for (unsigned long i = 0; i < nr_conns / 4; i++) {
+		struct connection *c = random_connection(nr_conns);
+		random_subnet(&c->spd.that.client);
+		rehash_spd_routes_in_db(c);
+	}
+	check_all(nr_queries);
+
+	/* grow spd chains, as a CISCO_SPLIT_INC would */
+	for (unsigned long i = 0; i < nr_conns / 4; i++) {
+		struct connection *c = random_connection(nr_conns);
+		struct spd_route *sr = alloc_thing(struct spd_route, "spd route");
+		random_subnet(&sr->that.client);
+		sr->spd_next = c->spd.spd_next;
+		c->spd.spd_next = sr;
+		rehash_spd_routes_in_db(c);
+	}
+	check_all(nr_queries);
+
+	/* replace half */
+	for (unsigned long i = 0; i < nr_conns / 2; i++) {
+		drop_connection(random_connection(nr_conns - i));
+	}
+	for (unsigned long i = 0; i < nr_conns / 2; i++) {
+		new_connection(next++);
+	}
+	check_all(nr_queries);
+
+	while (connections != NULL) {
+		drop_connection(connections);
+	}
+	check_all(nr_queries);
+
+	/* should be empty */
+	show_spd_db_status();
+	free_spd_db();
+
+	printf("checks=%lu\n", nr_checks);
+	return 0;
+}
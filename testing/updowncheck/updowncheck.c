@@ -0,0 +1,464 @@
+/* updown queue check, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Queue lots of updown commands, for several connections, and run
+ * them, either forked or through a coprocess (that optionally dies
+ * part way through), under a minimal event loop.  Each command
+ * records when it starts and ends in a log; check that, for each
+ * connection, the commands ran one at a time and in order (including
+ * the prepare and route commands that are run synchronously), that
+ * no more than updown-workers (plus one synchronous command) ran at
+ * once, that failures were counted, and that the commands still
+ * queued at exit are run.
+ *
+ * The coprocess is the reference implementation of the protocol
+ * described in updown.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <event2/event.h>
+
+#include <libreswan.h>
+
+#include "constants.h"
+#include "lswlog.h"
+#include "lswalloc.h"
+
+#include "defs.h"
+#include "connections.h"
+#include "server.h"
+#include "timer.h"		/* for struct pluto_event */
+#include "kernel.h"		/* for invoke_command() */
+#include "rnd.h"		/* for get_rnd_bytes() */
+#include "log.h"		/* for whack_log_comment() */
+#include "updown.h"
+
+/* stand-ins for the parts of pluto that aren't linked in */
+
+void get_rnd_bytes(u_char *buffer, int length)
+{
+	for (int i = 0; i < length; i++) {
+		buffer[i] = random();
+	}
+}
+
+/* show_updown_status() is parsed, and only sometimes printed */
+static bool quiet;
+static unsigned long current_queued;
+static unsigned long current_running;
+static unsigned long total_failed;
+
+void whack_log_comment(const char *message, ...)
+{
+	char buf[256];
+	va_list ap;
+	va_start(ap, message);
+	vsnprintf(buf, sizeof(buf), message, ap);
+	va_end(ap);
+	sscanf(buf, "current.updown.queued=%lu", &current_queued);
+	sscanf(buf, "current.updown.running=%lu", &current_running);
+	sscanf(buf, "total.updown.failed=%lu", &total_failed);
+	if (!quiet)
+		printf("%s\n", buf);
+}
+
+char *fmt_conn_instance(const struct connection *c UNUSED,
+			char buf[CONN_INST_BUF])
+{
+	buf[0] = '\0';
+	return buf;
+}
+
+bool invoke_command(const char *verb UNUSED, const char *verb_suffix UNUSED,
+		    const char *cmd)
+{
+	int status = system(cmd);
+	return status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static struct event_base *base;
+
+struct pluto_event *pluto_event_add(evutil_socket_t fd, short events,
+				    event_callback_fn cb, void *arg,
+				    const deltatime_t *delay UNUSED,
+				    const char *name)
+{
+	struct pluto_event *e = alloc_thing(struct pluto_event, name);
+	e->ev_name = name;
+	e->ev = event_new(base, fd, events, cb, arg);
+	passert(e->ev != NULL);
+	passert(event_add(e->ev, NULL) == 0);
+	return e;
+}
+
+void delete_pluto_event(struct pluto_event **evp)
+{
+	event_free((*evp)->ev);
+	pfree(*evp);
+	*evp = NULL;
+}
+
+static struct child {
+	pid_t pid;
+	pluto_fork_cb *callback;
+	void *context;
+} children[64];
+
+static unsigned long nr_forks;
+
+int pluto_fork(const char *name UNUSED, so_serial_t serialno UNUSED,
+	       int op(void *context),
+	       pluto_fork_cb *callback, void *context)
+{
+	struct child *child = NULL;
+	for (unsigned i = 0; i < elemsof(children); i++) {
+		if (children[i].pid == 0) {
+			child = &children[i];
+			break;
+		}
+	}
+	passert(child != NULL);
+	pid_t pid = fork();
+	if (pid == 0) {
+		_exit(op(context));
+	}
+	passert(pid > 0);
+	*child = (struct child) {
+		.pid = pid,
+		.callback = callback,
+		.context = context,
+	};
+	nr_forks++;
+	return pid;
+}
+
+static void reap_child(pid_t pid, int status)
+{
+	for (unsigned i = 0; i < elemsof(children); i++) {
+		struct child *child = &children[i];
+		if (child->pid == pid) {
+			child->pid = 0;
+			child->callback(NULL, NULL, status, child->context);
+			return;
+		}
+	}
+}
+
+void pluto_fork_wait(pid_t pid)
+{
+	int status;
+	passert(waitpid(pid, &status, 0) == pid);
+	reap_child(pid, status);
+}
+
+static void sigchld_cb(evutil_socket_t fd UNUSED, const short event UNUSED,
+		       void *arg UNUSED)
+{
+	for (;;) {
+		int status;
+		pid_t pid = waitpid(-1, &status, WNOHANG);
+		if (pid <= 0)
+			return;
+		reap_child(pid, status);
+	}
+}
+
+/*
+ * The commands.
+ */
+
+static char dir[] = "/tmp/updowncheck.XXXXXX";
+static char script[sizeof(dir) + 32];
+static char log_file[sizeof(dir) + 32];
+
+static const char updown_sh[] =
+	"#!/bin/sh\n"
+	"echo \"start $CONN $SEQ\" >> \"$LOG\"\n"
+	"echo \"$PLUTO_VERB of $CONN\"\n"
+	"sleep 0.01\n"
+	"echo \"end $CONN $SEQ\" >> \"$LOG\"\n"
+	"exit $STATUS\n";
+
+/* runs each request in turn, stopping after $LIMIT requests */
+static const char coprocess_sh[] =
+	"#!/bin/sh\n"
+	"n=0\n"
+	"while read -r request ; do\n"
+	"  eval \"$request\"\n"
+	"  export PLUTO_VERB CONN SEQ LOG STATUS\n"
+	"  $PLUTO_UPDOWN\n"
+	"  echo \"status $?\"\n"
+	"  n=$((n + 1))\n"
+	"  if test -n \"$LIMIT\" -a $n -ge \"${LIMIT:-0}\" ; then exit 0 ; fi\n"
+	"done\n";
+
+static void write_script(const char *path, const char *text)
+{
+	FILE *f = fopen(path, "w");
+	if (f == NULL || fputs(text, f) < 0 || fclose(f) != 0 ||
+	    chmod(path, 0700) != 0) {
+		perror(path);
+		exit(1);
+	}
+}
+
+#define MAX_CONNS 32
+
+static struct connection conns[MAX_CONNS];
+static unsigned long nr_commands[MAX_CONNS];	/* per connection */
+static unsigned long nr_failures;
+
+static void run(unsigned conn, bool fail)
+{
+	static const char *const verbs[] = {
+		"prepare-host", "route-host", "up-host", "down-host",
+		"unroute-host",
+	};
+	struct connection *c = &conns[conn];
+	unsigned long seq = nr_commands[conn]++;
+	char env[1024];
+	snprintf(env, sizeof(env),
+		 "PLUTO_VERB='%s' CONN='%u' SEQ='%lu' LOG='%s' STATUS='%d' ",
+		 verbs[seq % elemsof(verbs)], conn, seq, log_file, fail);
+	if (fail)
+		nr_failures++;
+	char *dash = strchr(verbs[seq % elemsof(verbs)], '-');
+	char verb[32];
+	snprintf(verb, sizeof(verb), "%.*s",
+		 (int)(dash - verbs[seq % elemsof(verbs)]),
+		 verbs[seq % elemsof(verbs)]);
+	run_updown(c, verb, dash, env, script);
+}
+
+static bool idle(void)
+{
+	quiet = TRUE;
+	show_updown_status();
+	quiet = FALSE;
+	return current_queued == 0 && current_running == 0;
+}
+
+/*
+ * Check the log: each connection's commands in order (and, unless
+ * the coprocess dropped some, all of them), one at a time, and no
+ * more than MAX_RUNNING at once.
+ */
+static void check_log(unsigned nr_conns, unsigned max_running, bool all)
+{
+	FILE *f = fopen(log_file, "r");
+	if (f == NULL) {
+		perror(log_file);
+		exit(1);
+	}
+	long next[MAX_CONNS] = { 0, };
+	bool running[MAX_CONNS] = { FALSE, };
+	unsigned nr_running = 0;
+	unsigned most_running = 0;
+	char line[128];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char what[8];
+		unsigned conn;
+		long seq;
+		if (sscanf(line, "%7s %u %ld", what, &conn, &seq) != 3 ||
+		    conn >= nr_conns) {
+			fprintf(stderr, "bad log line: %s", line);
+			exit(1);
+		}
+		if (streq(what, "start")) {
+			if (running[conn] || seq < next[conn] ||
+			    (all && seq != next[conn])) {
+				fprintf(stderr, "connection %u: command %ld out of order (expecting %ld%s)\n",
+					conn, seq, next[conn],
+					running[conn] ? ", one running" : "");
+				exit(1);
+			}
+			running[conn] = TRUE;
+			next[conn] = seq + 1;
+			nr_running++;
+			if (nr_running > most_running)
+				most_running = nr_running;
+		} else if (streq(what, "end")) {
+			if (!running[conn] || seq + 1 != next[conn]) {
+				fprintf(stderr, "connection %u: command %ld ended unexpectedly\n",
+					conn, seq);
+				exit(1);
+			}
+			running[conn] = FALSE;
+			nr_running--;
+		}
+	}
+	fclose(f);
+	for (unsigned conn = 0; conn < nr_conns; conn++) {
+		if (running[conn] ||
+		    (all && next[conn] != (long)nr_commands[conn])) {
+			fprintf(stderr, "connection %u: ran %ld of %lu commands\n",
+				conn, next[conn], nr_commands[conn]);
+			exit(1);
+		}
+	}
+	if (most_running > max_running) {
+		fprintf(stderr, "%u commands ran at once; expecting at most %u\n",
+			most_running, max_running);
+		exit(1);
+	}
+	printf("at most %u commands ran at once\n", most_running);
+}
+
+static void usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [--connections <count>] [--commands <count>] [--workers <count>] [--coprocess] [--coprocess-limit <count>]\n",
+		progname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "connections", required_argument, NULL, 'c', },
+		{ "commands", required_argument, NULL, 'n', },
+		{ "workers", required_argument, NULL, 'w', },
+		{ "coprocess", no_argument, NULL, 'p', },
+		{ "coprocess-limit", required_argument, NULL, 'l', },
+		{ 0, 0, 0, 0, },
+	};
+
+	tool_init_log(argv[0]);
+
+	unsigned nr_conns = 10;
+	unsigned long nr_runs = 100;
+	bool coprocess = FALSE;
+	const char *limit = NULL;
+	updown_workers = 4;
+	for (;;) {
+		int c = getopt_long(argc, argv, "", options, NULL);
+		if (c == -1) {
+			break;
+		}
+		switch (c) {
+		case 'c':
+			nr_conns = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			nr_runs = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			updown_workers = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			coprocess = TRUE;
+			break;
+		case 'l':
+			limit = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || nr_conns < 1 || nr_conns > MAX_CONNS ||
+	    updown_workers < 1 || updown_workers >= elemsof(children)) {
+		usage(argv[0]);
+	}
+
+	srandom(1);
+	if (mkdtemp(dir) == NULL) {
+		perror(dir);
+		exit(1);
+	}
+	snprintf(script, sizeof(script), "%s/updown.sh", dir);
+	snprintf(log_file, sizeof(log_file), "%s/log", dir);
+	write_script(script, updown_sh);
+	if (coprocess) {
+		updown_coprocess = alloc_bytes(sizeof(dir) + 32, "coprocess");
+		snprintf(updown_coprocess, sizeof(dir) + 32,
+			 "%s/coprocess.sh", dir);
+		write_script(updown_coprocess, coprocess_sh);
+		if (limit != NULL)
+			setenv("LIMIT", limit, 1);
+	}
+
+	for (unsigned i = 0; i < nr_conns; i++) {
+		char name[16];
+		snprintf(name, sizeof(name), "conn%u", i);
+		conns[i].name = clone_str(name, "name");
+		conns[i].instance_serial = i % 2;
+	}
+
+	base = event_base_new();
+	passert(base != NULL);
+	struct event *sigchld = evsignal_new(base, SIGCHLD, sigchld_cb, NULL);
+	passert(sigchld != NULL && event_add(sigchld, NULL) == 0);
+
+	init_updown();
+
+	/* queue them in bursts */
+	unsigned long nr_queued = 0;
+	while (nr_queued < nr_runs) {
+		for (long burst = random() % 16; burst >= 0 && nr_queued < nr_runs;
+		     burst--, nr_queued++) {
+			run(random() % nr_conns, random() % 8 == 0);
+		}
+		event_base_loop(base, EVLOOP_ONCE);
+	}
+	while (!idle()) {
+		event_base_loop(base, EVLOOP_ONCE);
+	}
+
+	/*
+	 * The coprocess runs one command at a time; and a prepare or
+	 * route command can run alongside, it doesn't wait for a slot.
+	 */
+	unsigned max_running = (coprocess && limit == NULL ? 1 : updown_workers) + 1;
+	check_log(nr_conns, max_running, limit == NULL);
+	show_updown_status();
+	if (limit == NULL && total_failed != nr_failures) {
+		fprintf(stderr, "%lu failures counted; expecting %lu\n",
+			total_failed, nr_failures);
+		exit(1);
+	}
+
+	/* what is queued at exit still runs */
+	for (unsigned i = 0; i < nr_conns; i++) {
+		run(i, FALSE);
+		run(i, FALSE);
+	}
+	free_updown();
+	check_log(nr_conns, max_running, limit == NULL);
+
+	printf("commands=%lu forks=%lu\n", nr_queued + 2 * nr_conns, nr_forks);
+
+	event_free(sigchld);
+	event_base_free(base);
+	for (unsigned i = 0; i < nr_conns; i++) {
+		pfree(conns[i].name);
+	}
+	pfreeany(updown_coprocess);
+	unlink(script);
+	unlink(log_file);
+	if (coprocess) {
+		char path[sizeof(dir) + 32];
+		snprintf(path, sizeof(path), "%s/coprocess.sh", dir);
+		unlink(path);
+	}
+	rmdir(dir);
+	return 0;
+}
@@ -0,0 +1,268 @@
+/* whack connection loading benchmark, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Add --connections connections to a running pluto, first the way
+ * addconn used to (a control socket connection, and a wait for the
+ * reply, per connection), and then as a single whack batch; report
+ * the connections loaded per second for each.  The connections are
+ * deleted again afterwards.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <libreswan.h>
+
+#include "constants.h"
+#include "lswlog.h"
+#include "socketwrapper.h"
+#include "whack.h"
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fail(const char *what, err_t ugh)
+{
+	fprintf(stderr, "whackbench: %s: %s\n", what, ugh);
+	exit(1);
+}
+
+/* a host-to-host PSK connection to 10.x.y.z */
+static void add_message(struct whack_message *msg, const char *prefix,
+			unsigned long i)
+{
+	static char name[64];	/* packed before the next call */
+	char peer[32];
+	err_t ugh;
+
+	zero(msg);
+	msg->magic = WHACK_MAGIC;
+	msg->whack_connection = TRUE;
+	snprintf(name, sizeof(name), "%s-%lu", prefix, i);
+	msg->name = name;
+
+	msg->addr_family = AF_INET;
+	msg->tunnel_addr_family = AF_INET;
+	msg->policy = POLICY_PSK | POLICY_ENCRYPT | POLICY_TUNNEL |
+		POLICY_IKEV1_ALLOW | POLICY_IKEV2_ALLOW;
+	msg->sa_ike_life_seconds = deltatime(IKE_SA_LIFETIME_DEFAULT);
+	msg->sa_ipsec_life_seconds = deltatime(IPSEC_SA_LIFETIME_DEFAULT);
+	msg->sa_rekey_margin = deltatime(SA_REPLACEMENT_MARGIN_DEFAULT);
+	msg->sa_rekey_fuzz = SA_REPLACEMENT_FUZZ_DEFAULT;
+	msg->sa_keying_tries = SA_REPLACEMENT_RETRIES_DEFAULT;
+	msg->sa_replay_window = IPSEC_SA_DEFAULT_REPLAY_WINDOW;
+	msg->r_timeout = deltatime(RETRANSMIT_TIMEOUT_DEFAULT);
+	msg->r_interval = deltatime_ms(RETRANSMIT_INTERVAL_DEFAULT_MS);
+	msg->xauthby = XAUTHBY_FILE;
+	msg->xauthfail = XAUTHFAIL_HARD;
+
+	clear_end(&msg->left);
+	msg->left.host_type = KH_IPADDR;
+	ugh = ttoaddr("192.0.2.1", 0, AF_INET, &msg->left.host_addr);
+	if (ugh != NULL)
+		fail("left", ugh);
+	anyaddr(AF_INET, &msg->left.host_nexthop);
+	msg->left.updown = "ipsec _updown";
+
+	clear_end(&msg->right);
+	msg->right.host_type = KH_IPADDR;
+	snprintf(peer, sizeof(peer), "10.%lu.%lu.%lu",
+		 ((i + 1) >> 16) & 0xff, ((i + 1) >> 8) & 0xff, (i + 1) & 0xff);
+	ugh = ttoaddr(peer, 0, AF_INET, &msg->right.host_addr);
+	if (ugh != NULL)
+		fail("right", ugh);
+	anyaddr(AF_INET, &msg->right.host_nexthop);
+	msg->right.updown = "ipsec _updown";
+}
+
+static void delete_message(struct whack_message *msg, const char *prefix,
+			   unsigned long i)
+{
+	static char name[64];
+
+	zero(msg);
+	msg->magic = WHACK_MAGIC;
+	msg->whack_delete = TRUE;
+	snprintf(name, sizeof(name), "%s-%lu", prefix, i);
+	msg->name = name;
+}
+
+/*
+ * Send MSG on its own connection and read the reply, as
+ * send_whack_msg() in libipsecconf does; return the RC of the last
+ * line that affects the status.
+ */
+static int send_one(const char *ctlsocket, struct whack_message *msg)
+{
+	struct sockaddr_un ctl_addr = { .sun_family = AF_UNIX };
+	struct whackpacker wp;
+	err_t ugh;
+
+	fill_and_terminate(ctl_addr.sun_path, ctlsocket,
+			   sizeof(ctl_addr.sun_path));
+
+	wp.msg = msg;
+	wp.str_next = (unsigned char *)msg->string;
+	wp.str_roof = (unsigned char *)&msg->string[sizeof(msg->string)];
+	ugh = pack_whack_msg(&wp);
+	if (ugh != NULL)
+		fail("pack", ugh);
+	ssize_t len = wp.str_next - (unsigned char *)msg;
+
+	int sock = safe_socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0)
+		fail("socket()", strerror(errno));
+	if (connect(sock, (struct sockaddr *)&ctl_addr,
+		    offsetof(struct sockaddr_un, sun_path) +
+			strlen(ctl_addr.sun_path)) < 0)
+		fail("connect(pluto_ctl)", strerror(errno));
+	if (write(sock, msg, len) != len)
+		fail("write(pluto_ctl)", strerror(errno));
+
+	int status = 0;
+	char buf[4097];
+	size_t have = 0;
+	for (;;) {
+		ssize_t n = read(sock, buf + have, sizeof(buf) - 1 - have);
+		if (n < 0)
+			fail("read(pluto_ctl)", strerror(errno));
+		if (n == 0)
+			break;
+		have += n;
+		char *ls = buf;
+		char *le;
+		while ((le = memchr(ls, '\n', buf + have - ls)) != NULL) {
+			unsigned long s = strtoul(ls, NULL, 10);
+			if (s == RC_SUCCESS)
+				status = 0;
+			else if (s != RC_COMMENT && s != RC_LOG)
+				status = s;
+			ls = le + 1;
+		}
+		have = buf + have - ls;
+		memmove(buf, ls, have);
+		if (have == sizeof(buf) - 1)
+			have = 0;	/* overlong line */
+	}
+	close(sock);
+	return status;
+}
+
+static void batch_delete(const char *ctlsocket, const char *prefix,
+			 unsigned long nr_conns)
+{
+	struct whack_batch b = { .reply = NULL, };
+	struct whack_message msg;
+	err_t ugh = whack_batch_open(&b, ctlsocket);
+
+	for (unsigned long i = 0; ugh == NULL && i < nr_conns; i++) {
+		delete_message(&msg, prefix, i);
+		ugh = whack_batch_send(&b, &msg);
+	}
+	err_t cugh = whack_batch_close(&b);
+	if (ugh == NULL)
+		ugh = cugh;
+	if (ugh != NULL)
+		fail("delete", ugh);
+}
+
+static void report(const char *what, unsigned long nr, unsigned long failed,
+		   double elapsed)
+{
+	printf("%s: connections=%lu failed=%lu seconds=%.3f connections/sec=%.0f\n",
+	       what, nr, failed, elapsed, nr / elapsed);
+}
+
+static void usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [--ctlsocket <file>] [--connections <count>]\n",
+		progname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "ctlsocket", required_argument, NULL, 's', },
+		{ "connections", required_argument, NULL, 'c', },
+		{ 0, 0, 0, 0, },
+	};
+
+	tool_init_log(argv[0]);
+
+	const char *ctlsocket = DEFAULT_CTL_SOCKET;
+	unsigned long nr_conns = 2000;
+	for (;;) {
+		int c = getopt_long(argc, argv, "", options, NULL);
+		if (c == -1) {
+			break;
+		}
+		switch (c) {
+		case 's':
+			ctlsocket = optarg;
+			break;
+		case 'c':
+			nr_conns = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || nr_conns < 1 || nr_conns >= 0xffffff) {
+		usage(argv[0]);
+	}
+
+	struct whack_message msg;
+
+	/* one at a time */
+	unsigned long failed = 0;
+	double start = now();
+	for (unsigned long i = 0; i < nr_conns; i++) {
+		add_message(&msg, "single", i);
+		if (send_one(ctlsocket, &msg) != 0)
+			failed++;
+	}
+	report("single", nr_conns, failed, now() - start);
+	batch_delete(ctlsocket, "single", nr_conns);
+
+	/* batched */
+	struct whack_batch b = { .reply = NULL, };
+	start = now();
+	err_t ugh = whack_batch_open(&b, ctlsocket);
+	for (unsigned long i = 0; ugh == NULL && i < nr_conns; i++) {
+		add_message(&msg, "batch", i);
+		ugh = whack_batch_send(&b, &msg);
+	}
+	err_t cugh = whack_batch_close(&b);
+	if (ugh == NULL)
+		ugh = cugh;
+	if (ugh != NULL)
+		fail("batch", ugh);
+	report("batch", nr_conns, b.failed, now() - start);
+	batch_delete(ctlsocket, "batch", nr_conns);
+
+	return 0;
+}
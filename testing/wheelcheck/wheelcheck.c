@@ -0,0 +1,236 @@
+/* timer wheel check, for libreswan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Randomly add, delete and expire timers, with delays from a tick to
+ * beyond the wheel's range, while advancing time both in small steps
+ * and in big jumps, and check the wheel against a model: each timer
+ * expires once time reaches it (and not before), in order; and
+ * timer_wheel_next() never sleeps past the earliest timer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <getopt.h>
+
+#include <libreswan.h>
+
+#include "constants.h"
+#include "lswlog.h"
+#include "lswalloc.h"
+
+#include "timer_wheel.h"
+
+struct timer {
+	struct timer_wheel_entry entry;
+	bool queued;
+	uint64_t due;		/* when it is filed */
+};
+
+static struct timer_wheel wheel;
+static struct timer *timers;
+static unsigned long nr_timers;
+static unsigned long nr_checks;
+static unsigned long nr_expired;
+
+static void fail(const char *message, ...)
+{
+	va_list ap;
+	va_start(ap, message);
+	fprintf(stderr, "tick %ju: ", (uintmax_t)wheel.tick);
+	vfprintf(stderr, message, ap);
+	va_end(ap);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+static uint64_t random_delay(void)
+{
+	switch (random() % 16) {
+	case 0:
+		return 0;
+	case 1 ... 6:
+		return random() % 256;
+	case 7 ... 10:
+		return random() % (1 << 14);
+	case 11 ... 13:
+		return random() % (1 << 26);
+	case 14:
+		return (uint64_t)random() * 2;		/* up to 2^32 */
+	default:
+		return (uint64_t)random() * 8;		/* beyond the wheel */
+	}
+}
+
+static void add(struct timer *t, uint64_t now)
+{
+	uint64_t expires = now + random_delay();
+	/* sometimes in the past */
+	if (random() % 32 == 0 && now > 1000) {
+		expires = now - random() % 1000;
+	}
+	timer_wheel_add(&wheel, &t->entry, expires, t);
+	t->queued = TRUE;
+	t->due = expires > wheel.tick ? expires : wheel.tick;
+	if (!timer_wheel_queued(&t->entry))
+		fail("timer %zu not queued", t - timers);
+}
+
+static void del(struct timer *t)
+{
+	timer_wheel_del(&wheel, &t->entry);
+	t->queued = FALSE;
+	if (timer_wheel_queued(&t->entry))
+		fail("timer %zu still queued", t - timers);
+}
+
+static void check_next(void)
+{
+	uint64_t earliest = UINT64_MAX;
+	unsigned long nr_queued = 0;
+	for (unsigned long i = 0; i < nr_timers; i++) {
+		if (timers[i].queued) {
+			nr_queued++;
+			if (timers[i].due < earliest)
+				earliest = timers[i].due;
+		}
+	}
+	if (nr_queued != wheel.nr_entries)
+		fail("%u entries expecting %lu", wheel.nr_entries, nr_queued);
+	uint64_t next;
+	if (timer_wheel_next(&wheel, &next) != (nr_queued > 0))
+		fail("timer_wheel_next() wrong");
+	if (nr_queued > 0 && next > earliest)
+		fail("next %ju is after timer due at %ju",
+		     (uintmax_t)next, (uintmax_t)earliest);
+	nr_checks++;
+}
+
+static void expire(uint64_t now)
+{
+	uint64_t last = 0;
+	struct timer_wheel_entry *e;
+	while ((e = timer_wheel_expire(&wheel, now)) != NULL) {
+		struct timer *t = e->data;
+		if (!t->queued)
+			fail("timer %zu expired twice", t - timers);
+		if (t->due > now)
+			fail("timer %zu due at %ju expired early",
+			     t - timers, (uintmax_t)t->due);
+		if (t->due < last)
+			fail("timer %zu due at %ju expired after one due at %ju",
+			     t - timers, (uintmax_t)t->due, (uintmax_t)last);
+		last = t->due;
+		t->queued = FALSE;
+		nr_expired++;
+	}
+	for (unsigned long i = 0; i < nr_timers; i++) {
+		if (timers[i].queued && timers[i].due <= now)
+			fail("timer %lu due at %ju missed",
+			     i, (uintmax_t)timers[i].due);
+	}
+	nr_checks++;
+}
+
+static void usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [--timers <count>] [--steps <count>]\n",
+		progname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "timers", required_argument, NULL, 't', },
+		{ "steps", required_argument, NULL, 's', },
+		{ 0, 0, 0, 0, },
+	};
+
+	tool_init_log(argv[0]);
+
+	nr_timers = 1000;
+	unsigned long nr_steps = 20000;
+	for (;;) {
+		int c = getopt_long(argc, argv, "", options, NULL);
+		if (c == -1) {
+			break;
+		}
+		switch (c) {
+		case 't':
+			nr_timers = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			nr_steps = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || nr_timers < 1) {
+		usage(argv[0]);
+	}
+
+	srandom(1);
+	/* not block aligned */
+	uint64_t now = 1000000007;
+	init_timer_wheel(&wheel, now);
+	timers = alloc_things(struct timer, nr_timers, "timers");
+
+	for (unsigned long step = 0; step < nr_steps; step++) {
+		/* churn, as states come and go */
+		for (unsigned i = random() % 16; i > 0; i--) {
+			struct timer *t = &timers[random() % nr_timers];
+			if (t->queued) {
+				del(t);
+			} else {
+				add(t, now);
+			}
+		}
+		check_next();
+		uint64_t next;
+		switch (random() % 4) {
+		case 0:
+			/* what pluto does: sleep until the wheel's next tick */
+			if (timer_wheel_next(&wheel, &next) && next > now)
+				now = next;
+			break;
+		case 1:
+			now += random() % (1 << 28);
+			break;
+		default:
+			now += random() % 300;
+			break;
+		}
+		expire(now);
+	}
+
+	for (unsigned long i = 0; i < nr_timers; i++) {
+		if (timers[i].queued)
+			del(&timers[i]);
+	}
+	check_next();
+
+	for (unsigned level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		struct timer_wheel_level_occupancy o;
+		timer_wheel_occupancy(&wheel, level, &o);
+		if (o.used != 0 || o.entries != 0)
+			fail("level %u not empty", level);
+	}
+	pfree(timers);
+
+	printf("checks=%lu expired=%lu cascaded=%lu\n",
+	       nr_checks, nr_expired, wheel.nr_cascaded);
+	return 0;
+}